@@ -0,0 +1,191 @@
+// Microbenchmark for the DELTA_BINARY_PACKED miniblock kernels.
+//
+//   parquet_bitpack_bench [--iterations N] [--check]
+//
+// For every bit width 1..16 the dispatched (AVX2 when compiled in) min/max
+// and packing kernels are timed against the scalar reference and their output
+// is compared byte for byte.  The full page encoder is then timed on real
+// prime gaps.  --check only runs the comparisons, which is what CTest uses.
+
+#include "parquet_bitpack.h"
+#include "parquet_format.h"
+
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<string>
+#include<vector>
+
+namespace{
+
+using calcprime::parquet::kBitPackSlack;
+using calcprime::parquet::kMiniBlockValues;
+
+constexpr std::size_t kMiniBlocks=4096;
+
+// Values are base+r with r drawn from [0, 2^width); the packers subtract
+// base modulo 2^16, so wrapped values still pack at exactly `width` bits.
+std::vector<std::uint16_t> make_miniblocks(unsigned width,std::uint16_t base){
+	std::vector<std::uint16_t> values(kMiniBlocks*kMiniBlockValues);
+	std::uint32_t state=0x9e3779b9U^width;
+	std::uint32_t mask=(1U<<width)-1U;
+	for(std::size_t i=0;i<values.size();++i){
+		state=state*1664525U+1013904223U;
+		values[i]=static_cast<std::uint16_t>(base+((state>>8)&mask));
+	}
+	return values;
+}
+
+std::vector<std::uint64_t> make_primes(std::size_t count){
+	std::vector<std::uint64_t> primes;
+	primes.reserve(count);
+	primes.push_back(2);
+	for(std::uint64_t n=3;primes.size()<count;n+=2){
+		bool prime=true;
+		for(std::size_t i=1;i<primes.size();++i){
+			std::uint64_t p=primes[i];
+			if(p*p>n){
+				break;
+			}
+			if(n%p==0){
+				prime=false;
+				break;
+			}
+		}
+		if(prime){
+			primes.push_back(n);
+		}
+	}
+	return primes;
+}
+
+template<class Fn>
+double time_ns_per_miniblock(std::size_t iterations,Fn&&fn){
+	auto start=std::chrono::steady_clock::now();
+	for(std::size_t it=0;it<iterations;++it){
+		fn();
+	}
+	auto elapsed=std::chrono::steady_clock::now()-start;
+	double ns=std::chrono::duration<double,std::nano>(elapsed).count();
+	return ns/static_cast<double>(iterations*kMiniBlocks);
+}
+
+bool check_width(unsigned width){
+	const std::uint16_t base=7;
+	std::vector<std::uint16_t> values=make_miniblocks(width,base);
+	std::vector<std::uint8_t> simd(4U*width+kBitPackSlack);
+	std::vector<std::uint8_t> scalar(4U*width+kBitPackSlack);
+	for(std::size_t mini=0;mini<kMiniBlocks;++mini){
+		const std::uint16_t*block=values.data()+mini*kMiniBlockValues;
+		std::uint16_t lo_simd=0;
+		std::uint16_t hi_simd=0;
+		std::uint16_t lo_scalar=0;
+		std::uint16_t hi_scalar=0;
+		calcprime::parquet::miniblock_min_max_u16(block,lo_simd,hi_simd);
+		calcprime::parquet::miniblock_min_max_u16_scalar(block,lo_scalar,
+														 hi_scalar);
+		if(lo_simd!=lo_scalar||hi_simd!=hi_scalar){
+			std::cerr<<"min/max mismatch at width "<<width<<"\n";
+			return false;
+		}
+		std::size_t a=calcprime::parquet::pack_miniblock_u16(block,base,width,
+															 simd.data());
+		std::size_t b=calcprime::parquet::pack_miniblock_u16_scalar(
+			block,base,width,scalar.data());
+		if(a!=b||std::memcmp(simd.data(),scalar.data(),a)!=0){
+			std::cerr<<"pack mismatch at width "<<width<<"\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	std::size_t iterations=200;
+	bool check_only=false;
+	for(int i=1;i<argc;++i){
+		std::string arg=argv[i];
+		if(arg=="--check"){
+			check_only=true;
+		}else if(arg=="--iterations"&&i+1<argc){
+			iterations=std::strtoull(argv[++i],nullptr,10);
+		}else{
+			std::cerr<<"usage: parquet_bitpack_bench [--iterations N] [--check]\n";
+			return 2;
+		}
+	}
+
+	for(unsigned width=1;width<=16;++width){
+		if(!check_width(width)){
+			return 1;
+		}
+	}
+	if(check_only){
+		std::cout<<"bit-packing kernels match the scalar reference\n";
+		return 0;
+	}
+
+	const char*kernel=
+		calcprime::parquet::bitpack_uses_avx2()?"avx2":"scalar";
+	std::cout<<"kernel: "<<kernel<<", "<<kMiniBlocks<<" miniblocks x "
+			 <<iterations<<" iterations\n";
+	std::cout<<"width  minmax ns  minmax ref  pack ns  pack ref\n";
+	std::vector<std::uint8_t> out(kMiniBlocks*(64U+kBitPackSlack));
+	for(unsigned width=1;width<=16;++width){
+		std::vector<std::uint16_t> values=make_miniblocks(width,0);
+		volatile std::uint32_t sink=0;
+		auto minmax=[&](auto kernel_fn){
+			return time_ns_per_miniblock(iterations,[&]{
+				std::uint32_t acc=0;
+				for(std::size_t mini=0;mini<kMiniBlocks;++mini){
+					std::uint16_t lo=0;
+					std::uint16_t hi=0;
+					kernel_fn(values.data()+mini*kMiniBlockValues,lo,hi);
+					acc+=static_cast<std::uint32_t>(lo)+hi;
+				}
+				sink=sink+acc;
+			});
+		};
+		auto pack=[&](auto kernel_fn){
+			return time_ns_per_miniblock(iterations,[&]{
+				std::uint8_t*dest=out.data();
+				for(std::size_t mini=0;mini<kMiniBlocks;++mini){
+					dest+=kernel_fn(values.data()+mini*kMiniBlockValues,0,width,
+									dest);
+				}
+				sink=sink+out[0];
+			});
+		};
+		double minmax_fast=minmax(calcprime::parquet::miniblock_min_max_u16);
+		double minmax_ref=
+			minmax(calcprime::parquet::miniblock_min_max_u16_scalar);
+		double pack_fast=pack(calcprime::parquet::pack_miniblock_u16);
+		double pack_ref=pack(calcprime::parquet::pack_miniblock_u16_scalar);
+		std::printf("%5u  %9.2f  %10.2f  %7.2f  %8.2f\n",width,minmax_fast,
+					minmax_ref,pack_fast,pack_ref);
+	}
+
+	std::vector<std::uint64_t> primes=make_primes(1U<<17);
+	std::size_t encode_iterations=iterations/10U+1U;
+	auto start=std::chrono::steady_clock::now();
+	std::string encoded;
+	for(std::size_t it=0;it<encode_iterations;++it){
+		encoded.clear();
+		calcprime::parquet::encode_delta_binary_packed(
+			encoded,primes.data(),primes.size(),128);
+	}
+	std::size_t encoded_bytes=encoded.size();
+	double seconds=std::chrono::duration<double>(
+					   std::chrono::steady_clock::now()-start)
+					   .count();
+	double values_per_second=
+		static_cast<double>(primes.size()*encode_iterations)/seconds;
+	std::printf("page encode: %zu primes -> %zu bytes, %.1f Mvalues/s\n",
+				primes.size(),encoded_bytes,values_per_second/1e6);
+	return 0;
+}
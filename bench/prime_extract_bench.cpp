@@ -0,0 +1,187 @@
+// Microbenchmark for the segment-to-primes extraction kernels.
+//
+//   prime_extract_bench [--iterations N] [--check]
+//
+// Random bitsets with prime densities from near 1e12 down to small segments
+// are expanded by the dispatched (AVX-512 or AVX2 when compiled in) u64 and
+// u32 extractors and by the scalar references, and the results compared
+// element for element, including odd tails and the appending wrapper used by
+// the sieve.  --check only runs the comparisons, which is what CTest uses.
+
+#include "popcnt.h"
+#include "prime_extract.h"
+
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<iostream>
+#include<string>
+#include<vector>
+
+namespace{
+
+using calcprime::kExtractSlack;
+
+constexpr std::size_t kSegmentBits=1U<<20;
+
+// A composite bit is set with probability 1 - density.
+std::vector<std::uint64_t> make_bits(std::size_t bit_count,double density,
+									 std::uint32_t seed){
+	std::vector<std::uint64_t> bits((bit_count+63)/64,0);
+	std::uint32_t state=0x9e3779b9U^seed;
+	std::uint32_t threshold=
+		static_cast<std::uint32_t>(density*static_cast<double>(1U<<24));
+	for(std::size_t i=0;i<bit_count;++i){
+		state=state*1664525U+1013904223U;
+		if((state>>8)>=threshold){
+			bits[i/64]|=1ULL<<(i%64);
+		}
+	}
+	// Garbage past bit_count must be ignored.
+	if(bit_count%64!=0){
+		bits.back()|=~0ULL<<(bit_count%64);
+	}
+	return bits;
+}
+
+bool check_bits(std::size_t bit_count,double density,std::uint32_t seed){
+	std::vector<std::uint64_t> bits=make_bits(bit_count,density,seed);
+	std::size_t count=static_cast<std::size_t>(
+		calcprime::count_zero_bits(bits.data(),bit_count));
+	const std::uint64_t seg_low=1000000000001ULL;
+
+	std::vector<std::uint64_t> fast(count+kExtractSlack);
+	std::vector<std::uint64_t> reference(count+kExtractSlack);
+	std::size_t a=calcprime::extract_primes_u64(bits.data(),bit_count,seg_low,
+												fast.data());
+	std::size_t b=calcprime::extract_primes_u64_scalar(
+		bits.data(),bit_count,seg_low,reference.data());
+	if(a!=count||b!=count){
+		std::cerr<<"u64 count mismatch at "<<bit_count<<" bits\n";
+		return false;
+	}
+	for(std::size_t i=0;i<count;++i){
+		if(fast[i]!=reference[i]){
+			std::cerr<<"u64 mismatch at "<<bit_count<<" bits, index "<<i
+					 <<"\n";
+			return false;
+		}
+	}
+
+	std::vector<std::uint32_t> offsets(count+kExtractSlack);
+	std::vector<std::uint32_t> offsets_ref(count+kExtractSlack);
+	a=calcprime::extract_prime_offsets_u32(bits.data(),bit_count,
+										   offsets.data());
+	b=calcprime::extract_prime_offsets_u32_scalar(bits.data(),bit_count,
+												  offsets_ref.data());
+	if(a!=count||b!=count){
+		std::cerr<<"u32 count mismatch at "<<bit_count<<" bits\n";
+		return false;
+	}
+	for(std::size_t i=0;i<count;++i){
+		if(offsets[i]!=offsets_ref[i]||
+		   seg_low+2*static_cast<std::uint64_t>(offsets[i])!=reference[i]){
+			std::cerr<<"u32 mismatch at "<<bit_count<<" bits, index "<<i
+					 <<"\n";
+			return false;
+		}
+	}
+
+	std::vector<std::uint64_t> appended{2,3,5};
+	calcprime::extract_segment_primes(bits,seg_low,bit_count,appended);
+	if(appended.size()!=count+3||appended[2]!=5){
+		std::cerr<<"append size mismatch at "<<bit_count<<" bits\n";
+		return false;
+	}
+	for(std::size_t i=0;i<count;++i){
+		if(appended[i+3]!=reference[i]){
+			std::cerr<<"append mismatch at "<<bit_count<<" bits, index "<<i
+					 <<"\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+template<class Fn>
+double time_ms(std::size_t iterations,Fn&&fn){
+	auto start=std::chrono::steady_clock::now();
+	for(std::size_t it=0;it<iterations;++it){
+		fn();
+	}
+	auto elapsed=std::chrono::steady_clock::now()-start;
+	return std::chrono::duration<double,std::milli>(elapsed).count()/
+		   static_cast<double>(iterations);
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	std::size_t iterations=50;
+	bool check_only=false;
+	for(int i=1;i<argc;++i){
+		std::string arg=argv[i];
+		if(arg=="--check"){
+			check_only=true;
+		}else if(arg=="--iterations"&&i+1<argc){
+			iterations=std::strtoull(argv[++i],nullptr,10);
+		}else{
+			std::cerr<<"usage: prime_extract_bench [--iterations N] [--check]\n";
+			return 2;
+		}
+	}
+
+	const double densities[]={0.0,0.04,0.1,0.15,0.3,1.0};
+	const std::size_t sizes[]={1,63,64,65,1000,4095,4096,4097,100003};
+	std::uint32_t seed=1;
+	for(double density:densities){
+		for(std::size_t size:sizes){
+			if(!check_bits(size,density,seed++)){
+				return 1;
+			}
+		}
+	}
+	if(check_only){
+		std::cout<<"extraction kernels match the scalar reference\n";
+		return 0;
+	}
+
+	std::cout<<"kernel: "<<calcprime::prime_extract_kernel()<<", "
+			 <<kSegmentBits<<" bits x "<<iterations<<" iterations\n";
+	std::cout<<"density  u64 ms  u64 ref  u32 ms  u32 ref  append ms\n";
+	for(double density:{0.04,0.1,0.15,0.3}){
+		std::vector<std::uint64_t> bits=make_bits(kSegmentBits,density,7);
+		std::size_t count=static_cast<std::size_t>(
+			calcprime::count_zero_bits(bits.data(),kSegmentBits));
+		std::vector<std::uint64_t> out(count+kExtractSlack);
+		std::vector<std::uint32_t> offsets(count+kExtractSlack);
+		std::vector<std::uint64_t> appended;
+		appended.reserve(count+kExtractSlack);
+		volatile std::uint64_t sink=0;
+		double u64_fast=time_ms(iterations,[&]{
+			sink=sink+calcprime::extract_primes_u64(bits.data(),kSegmentBits,1,
+												   out.data());
+		});
+		double u64_ref=time_ms(iterations,[&]{
+			sink=sink+calcprime::extract_primes_u64_scalar(
+						   bits.data(),kSegmentBits,1,out.data());
+		});
+		double u32_fast=time_ms(iterations,[&]{
+			sink=sink+calcprime::extract_prime_offsets_u32(
+						   bits.data(),kSegmentBits,offsets.data());
+		});
+		double u32_ref=time_ms(iterations,[&]{
+			sink=sink+calcprime::extract_prime_offsets_u32_scalar(
+						   bits.data(),kSegmentBits,offsets.data());
+		});
+		double append=time_ms(iterations,[&]{
+			appended.clear();
+			calcprime::extract_segment_primes(bits,1,kSegmentBits,appended);
+			sink=sink+appended.size();
+		});
+		std::printf("%7.2f  %6.3f  %7.3f  %6.3f  %7.3f  %9.3f\n",density,
+					u64_fast,u64_ref,u32_fast,u32_ref,append);
+	}
+	return 0;
+}
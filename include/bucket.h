@@ -1,34 +1,111 @@
 #pragma once
 
+#include<cstddef>
 #include<cstdint>
 #include<vector>
 
 namespace calcprime{
 
-struct LargePrimeState;
+class SieveArena;
 
+// A large sieving prime waiting for its next hit, filed under the
+// super-segment that holds the hit.
 struct BucketEntry{
-	std::uint32_t prime;
-	std::uint64_t next_index; // segment index where the next hit resides
-	std::uint64_t offset;	  // bit offset within that segment (odd index)
-	std::uint64_t value;	  // actual value of the composite hit
-	LargePrimeState*owner;	  // pointer back to the prime state
+	std::uint32_t prime_index; // into PrimeMarker's large primes
+	std::uint32_t offset;	   // bit offset of the hit in its super-segment
 };
 
+// One bucket per super-segment for a window of consecutive super-segments
+// that wraps around, plus one "near" bucket per segment of the super-segment
+// being sieved.  Every entry must be at most slot_count()-1 super-segments
+// ahead of the oldest one still to be drained.
+//
+// Buckets are chains of fixed-size pages shared through a free list, so
+// memory follows the number of filed primes rather than the fullest bucket
+// times the number of buckets.  Pages come from a SieveArena and are never
+// returned to it.
 class BucketRing{
   public:
-	BucketRing();
-	void reset(std::uint64_t start_segment);
-	void push(std::uint64_t segment,BucketEntry entry);
-	std::vector<BucketEntry> take(std::uint64_t segment);
+	// A page is 8 KiB: a cache-line aligned header and entries.
+	static constexpr std::uint32_t kPageEntries=1023;
+
+	// Pages are allocated from `arena`, which must outlive the ring; a ring
+	// without an arena cannot hold entries.
+	explicit BucketRing(SieveArena*arena=nullptr);
+	// Drops every entry and sizes the ring for `slots` super-segments
+	// (rounded up to a power of two) and `near_slots` segments, keeping
+	// allocated pages.
+	void reset(std::size_t slots,std::size_t near_slots);
+
+	void push(std::uint64_t super_segment,BucketEntry entry){
+		push_to(heads_[super_segment&mask_],entry);
+	}
+	void push_near(std::size_t segment,BucketEntry entry){
+		push_to(heads_[near_begin_+segment],entry);
+	}
+
+	// Calls fn(entry) for the entries filed under `super_segment` and
+	// empties its bucket.  The bucket is detached first, so fn may file
+	// entries anywhere.
+	template<typename Fn>
+	void drain(std::uint64_t super_segment,Fn&&fn){
+		drain_list(heads_[super_segment&mask_],fn);
+	}
+	template<typename Fn>
+	void drain_near(std::size_t segment,Fn&&fn){
+		drain_list(heads_[near_begin_+segment],fn);
+	}
+
+	std::size_t slot_count() const{ return mask_+1; }
+	// Heap bytes of the bucket heads and the page index; the pages are
+	// counted by the arena.
+	std::size_t index_bytes() const{
+		return pages_.capacity()*sizeof(Page*)+
+			   heads_.capacity()*sizeof(std::uint32_t)+
+			   free_pages_.capacity()*sizeof(std::uint32_t);
+	}
 
   private:
-	void ensure_capacity(std::uint64_t segment);
-	void rehash(std::size_t new_size);
+	static constexpr std::uint32_t kNoPage=~0U;
+
+	struct alignas(64) Page{
+		std::uint32_t count;
+		std::uint32_t next;
+		BucketEntry entries[kPageEntries];
+	};
+	static_assert(sizeof(Page)==8192,"bucket pages are 8 KiB");
+
+	void push_to(std::uint32_t&head,BucketEntry entry){
+		if(head==kNoPage||pages_[head]->count==kPageEntries){
+			head=new_page(head);
+		}
+		Page&page=*pages_[head];
+		page.entries[page.count++]=entry;
+	}
+
+	template<typename Fn>
+	void drain_list(std::uint32_t&head,Fn&fn){
+		std::uint32_t page_index=head;
+		head=kNoPage;
+		while(page_index!=kNoPage){
+			const Page&page=*pages_[page_index];
+			for(std::uint32_t i=0;i<page.count;++i){
+				fn(page.entries[i]);
+			}
+			std::uint32_t next=page.next;
+			free_pages_.push_back(page_index);
+			page_index=next;
+		}
+	}
+
+	std::uint32_t new_page(std::uint32_t next);
 
-	std::uint64_t base_segment_;
+	SieveArena*arena_;
 	std::size_t mask_;
-	std::vector<std::vector<BucketEntry>> buckets_;
+	std::size_t near_begin_;
+	std::vector<std::uint32_t> heads_;
+	std::vector<Page*> pages_;
+	std::vector<std::uint32_t> free_pages_;
 };
 
 } // namespace calcprime
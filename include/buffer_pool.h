@@ -0,0 +1,126 @@
+#pragma once
+
+#include<algorithm>
+#include<atomic>
+#include<bit>
+#include<cstddef>
+#include<cstdint>
+#include<mutex>
+#include<utility>
+#include<vector>
+
+namespace calcprime{
+
+// Acquisitions of a pool and how many allocations its buffers needed, both
+// in acquire() and while their holders filled them; sums over several pools
+// with +=.
+struct BufferPoolStats{
+	std::uint64_t acquired=0;
+	std::uint64_t allocated=0;
+
+	BufferPoolStats&operator+=(const BufferPoolStats&other){
+		acquired+=other.acquired;
+		allocated+=other.allocated;
+		return *this;
+	}
+};
+
+// Free list of reusable buffers (std::vector or std::string) that travel
+// from the thread filling them to the one consuming them and back.  Once
+// the pool holds as many buffers as are in flight, and each is as large as
+// the biggest request, acquire() stops allocating.  Thread-safe.
+//
+// acquire() only hands out a few capacities: 4, 5, 6 or 7 times a power of
+// two, plus kClassTag.  A holder that grows a buffer has it reallocated to
+// the size it needed or to a multiple of the old capacity, which is
+// practically never such a size.  release() counts a buffer of any other
+// capacity, grown or allocated elsewhere, as one more allocation and frees
+// it, so the pool only ever keeps its own sizes.
+template<typename Buffer>
+class BufferPool{
+  public:
+	// Buffers released beyond `max_pooled` are freed.
+	explicit BufferPool(std::size_t max_pooled): max_pooled_(max_pooled){}
+
+	BufferPool(const BufferPool&)=delete;
+	BufferPool&operator=(const BufferPool&)=delete;
+
+	// An empty buffer with room for at least `capacity` elements, and
+	// usually somewhat more, so that slightly larger requests later do not
+	// allocate again.
+	Buffer acquire(std::size_t capacity){
+		Buffer buffer;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(!free_.empty()){
+				buffer=std::move(free_.back());
+				free_.pop_back();
+			}
+		}
+		acquired_.fetch_add(1,std::memory_order_relaxed);
+		buffer.clear();
+		if(buffer.capacity()<capacity){
+			// Reserving on an empty buffer gets exactly the class size;
+			// growing a string in place may round up to twice the old one.
+			buffer=Buffer();
+			buffer.reserve(size_class(capacity));
+			allocated_.fetch_add(1,std::memory_order_relaxed);
+		}
+		return buffer;
+	}
+
+	void release(Buffer&&buffer){
+		// Nothing worth keeping, such as a moved-from or short string.
+		if(buffer.capacity()<=Buffer().capacity()){
+			return;
+		}
+		if(!is_size_class(buffer.capacity())){
+			allocated_.fetch_add(1,std::memory_order_relaxed);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		if(free_.size()<max_pooled_){
+			free_.push_back(std::move(buffer));
+		}
+	}
+
+	BufferPoolStats stats() const{
+		BufferPoolStats stats;
+		stats.acquired=acquired_.load(std::memory_order_relaxed);
+		stats.allocated=allocated_.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+  private:
+	static constexpr std::size_t kClassTag=32;
+	static constexpr std::size_t kMinClassStep=64;
+	// Strings may round a reservation up to their allocation granularity.
+	static constexpr std::size_t kClassSlack=16;
+
+	// The smallest class holding `capacity` elements.
+	static std::size_t size_class(std::size_t capacity){
+		std::size_t step=kMinClassStep;
+		while(step*7<capacity){
+			step*=2;
+		}
+		std::size_t multiple=std::max<std::size_t>((capacity+step-1)/step,4);
+		return multiple*step+kClassTag;
+	}
+
+	static bool is_size_class(std::size_t capacity){
+		if(capacity<4*kMinClassStep+kClassTag){
+			return false;
+		}
+		std::size_t base=capacity-kClassTag;
+		std::size_t step=std::bit_floor(base)/4;
+		return base%step<kClassSlack;
+	}
+
+	std::mutex mutex_;
+	std::vector<Buffer> free_;
+	std::size_t max_pooled_;
+	std::atomic<std::uint64_t> acquired_{0};
+	std::atomic<std::uint64_t> allocated_{0};
+};
+
+} // namespace calcprime
@@ -50,7 +50,12 @@ typedef enum calcprime_output_format{
 	CALCPRIME_OUTPUT_BINARY=1,
 	CALCPRIME_OUTPUT_DELTA16=2,
 	CALCPRIME_OUTPUT_ZSTD_DELTA=CALCPRIME_OUTPUT_DELTA16,
-	CALCPRIME_OUTPUT_PARQUET=3
+	CALCPRIME_OUTPUT_PARQUET=3,
+	CALCPRIME_OUTPUT_GAP8=4,
+	CALCPRIME_OUTPUT_WHEEL30=5,
+	CALCPRIME_OUTPUT_EF=6,
+	CALCPRIME_OUTPUT_CONTAINER=7,
+	CALCPRIME_OUTPUT_ARROW=8
 } calcprime_output_format;
 
 typedef enum calcprime_parquet_encoding{
@@ -87,6 +92,8 @@ typedef struct calcprime_range_options{
 	int compress_zstd;
 	calcprime_parquet_encoding parquet_encoding;
 	std::size_t parquet_delta_block_values;
+	std::size_t parquet_row_group_bytes;
+	unsigned parquet_threads;
 } calcprime_range_options;
 
 typedef struct calcprime_range_stats{
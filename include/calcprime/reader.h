@@ -0,0 +1,100 @@
+#pragma once
+
+#include "calcprime/api.h"
+
+#include<cstddef>
+#include<cstdint>
+
+#if defined(_WIN32)&&defined(CALCPRIME_DLL_EXPORT)
+#define CALCPRIME_API __declspec(dllexport)
+#else
+#define CALCPRIME_API
+#endif
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+struct calcprime_reader;
+typedef struct calcprime_reader calcprime_reader;
+
+typedef struct calcprime_reader_options{
+	int detect_format;				/* nonzero: detect from the file (default) */
+	calcprime_output_format format; /* used when detect_format is 0 */
+	unsigned threads;				/* decode threads, 0 = automatic */
+} calcprime_reader_options;
+
+CALCPRIME_API int
+calcprime_reader_options_init(calcprime_reader_options*options);
+
+/**
+ * Opens a file written by calcprimelist in any output format, including
+ * zstd-compressed streams.  *out_reader is set even on failure so that the
+ * error message can be read; it must always be released with
+ * calcprime_reader_close.
+ */
+CALCPRIME_API calcprime_status
+calcprime_reader_open(const char*path,const calcprime_reader_options*options,
+					  calcprime_reader**out_reader);
+
+CALCPRIME_API const char*
+calcprime_reader_error_message(const calcprime_reader*reader);
+
+CALCPRIME_API calcprime_output_format
+calcprime_reader_format(const calcprime_reader*reader);
+
+/**
+ * Decodes the next block of ascending primes.  The returned pointer stays
+ * valid until the next call on the same reader; *out_count is 0 at the end
+ * of the file.
+ */
+CALCPRIME_API calcprime_status
+calcprime_reader_next_block(calcprime_reader*reader,
+							const std::uint64_t**out_primes,
+							std::size_t*out_count);
+
+/**
+ * Positions the reader so that the next block starts at the first prime
+ * that is >= value.
+ */
+CALCPRIME_API calcprime_status calcprime_reader_seek(calcprime_reader*reader,
+													 std::uint64_t value);
+
+CALCPRIME_API void calcprime_reader_close(calcprime_reader*reader);
+
+struct calcprime_shm_reader;
+typedef struct calcprime_shm_reader calcprime_shm_reader;
+
+/**
+ * Attaches to the shared-memory ring of a running `--out shm:NAME` export,
+ * waiting up to timeout_ms for the producer to create it.  Several readers,
+ * in one or more processes, may attach to the same ring; each block is
+ * delivered to exactly one of them.  *out_reader is set even on failure and
+ * must be released with calcprime_shm_reader_close.
+ */
+CALCPRIME_API calcprime_status
+calcprime_shm_reader_open(const char*name,unsigned timeout_ms,
+						  calcprime_shm_reader**out_reader);
+
+CALCPRIME_API const char*
+calcprime_shm_reader_error_message(const calcprime_shm_reader*reader);
+
+/**
+ * Returns the previous block to the producer and takes the next one.  The
+ * primes point into shared memory and stay valid until the next call;
+ * *out_sequence numbers the blocks from 0 in prime order.  *out_count is 0
+ * once the producer has finished and no block is left.
+ */
+CALCPRIME_API calcprime_status
+calcprime_shm_reader_next_block(calcprime_shm_reader*reader,
+								const std::uint64_t**out_primes,
+								std::size_t*out_count,
+								std::uint64_t*out_sequence);
+
+CALCPRIME_API void calcprime_shm_reader_close(calcprime_shm_reader*reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef CALCPRIME_API
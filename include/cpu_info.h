@@ -18,6 +18,12 @@ struct CpuInfo{
 	std::size_t efficiency_l1_data_bytes=32*1024;
 	std::size_t efficiency_l2_bytes=1024*1024;
 	std::size_t l2_total_bytes=0;
+	// Smallest last-level (L3) cache instance, the logical CPUs sharing it
+	// and its size divided by the physical cores sharing it; all 0 when no
+	// L3 was found.
+	std::size_t l3_bytes=0;
+	unsigned l3_shared_cpus=0;
+	std::size_t l3_per_core_bytes=0;
 	bool has_smt=false;
 	bool has_hybrid=false;
 };
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include<cstddef>
+#include<cstdint>
+#include<iterator>
+#include<string>
+
+namespace calcprime{
+
+// Random access over a memory-mapped `--out-format ef` file.  select() and
+// rank() touch one directory bucket and one block, so they run in a few
+// hundred nanoseconds even for files covering 1e12.
+class EliasFanoReader{
+  public:
+	class const_iterator;
+
+	explicit EliasFanoReader(const std::string&path);
+
+	// The exported range [from, to).
+	std::uint64_t from() const{ return from_; }
+	std::uint64_t to() const{ return to_; }
+	std::uint64_t size() const{ return count_; }
+
+	// The k-th prime of the file, 0-based; throws std::out_of_range when
+	// k >= size().
+	std::uint64_t select(std::uint64_t k) const;
+	// Number of primes in the file below x, i.e. pi(x) - pi(from).
+	std::uint64_t rank(std::uint64_t x) const;
+
+	const_iterator begin() const;
+	const_iterator end() const;
+	// Iterator positioned at the k-th prime (end() when k >= size()).
+	const_iterator iterator_at(std::uint64_t k) const;
+
+  private:
+	struct Block{
+		const std::uint64_t*lower=nullptr;
+		const std::uint64_t*upper=nullptr;
+		std::uint64_t first=0;
+		std::uint64_t count=0;
+		std::uint64_t upper_words=0;
+		unsigned lower_bits=0;
+	};
+
+	Block block(std::uint64_t index) const;
+	static std::uint64_t lower_value(const Block&block,std::uint64_t i);
+	std::uint64_t block_first(std::uint64_t index) const;
+
+	MappedFile file_;
+	std::uint64_t from_=0;
+	std::uint64_t to_=0;
+	std::uint64_t count_=0;
+	std::uint64_t block_values_=0;
+	std::uint64_t block_count_=0;
+	std::uint64_t bucket_count_=0;
+	unsigned bucket_shift_=0;
+	const std::uint8_t*directory_=nullptr;
+	const std::uint8_t*buckets_=nullptr;
+};
+
+// Forward iterator decoding one block at a time: each step finds the next
+// set upper bit and reads the matching lower bits.
+class EliasFanoReader::const_iterator{
+  public:
+	using iterator_category=std::forward_iterator_tag;
+	using value_type=std::uint64_t;
+	using difference_type=std::ptrdiff_t;
+	using pointer=const std::uint64_t*;
+	using reference=std::uint64_t;
+
+	const_iterator()=default;
+
+	std::uint64_t operator*() const{ return value_; }
+	const_iterator&operator++();
+	const_iterator operator++(int){
+		const_iterator copy=*this;
+		++*this;
+		return copy;
+	}
+	// Position of the current prime in the file.
+	std::uint64_t index() const{ return index_; }
+
+	friend bool operator==(const const_iterator&a,const const_iterator&b){
+		return a.index_==b.index_;
+	}
+	friend bool operator!=(const const_iterator&a,const const_iterator&b){
+		return a.index_!=b.index_;
+	}
+
+  private:
+	friend class EliasFanoReader;
+
+	const_iterator(const EliasFanoReader*reader,std::uint64_t index);
+	void load_block(std::uint64_t block,std::uint64_t offset);
+	void decode();
+
+	const EliasFanoReader*reader_=nullptr;
+	std::uint64_t index_=0;
+	EliasFanoReader::Block block_;
+	std::uint64_t block_index_=0;
+	std::uint64_t in_block_=0;
+	std::uint64_t word_index_=0;
+	std::uint64_t word_=0;
+	std::uint64_t value_=0;
+};
+
+} // namespace calcprime
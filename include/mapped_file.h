@@ -0,0 +1,31 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace calcprime{
+
+// Read-only memory mapping of a whole file.  Empty files map to a null
+// pointer with size 0.
+class MappedFile{
+  public:
+	explicit MappedFile(const std::string&path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&)=delete;
+	MappedFile&operator=(const MappedFile&)=delete;
+
+	const std::uint8_t*data() const{ return data_; }
+	std::size_t size() const{ return size_; }
+
+  private:
+	const std::uint8_t*data_=nullptr;
+	std::size_t size_=0;
+#ifdef _WIN32
+	void*file_handle_=nullptr;
+	void*mapping_handle_=nullptr;
+#endif
+};
+
+} // namespace calcprime
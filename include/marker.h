@@ -2,20 +2,16 @@
 
 #include "bucket.h"
 #include "segmenter.h"
+#include "sieve_arena.h"
 #include "wheel.h"
 
 #include<cstddef>
 #include<cstdint>
+#include<memory>
 #include<vector>
 
 namespace calcprime{
 
-struct LargePrimeState{
-	std::uint32_t prime;
-	std::uint64_t next_value;
-	std::uint64_t stride;
-};
-
 struct TileView{
 	std::uint64_t start_value;
 	std::size_t bit_offset;
@@ -30,47 +26,138 @@ class PrimeMarker{
 				std::uint64_t range_begin,std::uint64_t range_end,
 				const std::vector<std::uint32_t>&primes,
 				std::uint32_t small_prime_limit=29);
+	// A marker with its own tile size that shares `other`'s read-only
+	// sieving-prime tables; the segment and super-segment sizes must match.
+	PrimeMarker(const PrimeMarker&other,SegmentConfig config);
+
+	static constexpr std::uint64_t kNoSuperSegment=~0ULL;
+	static constexpr std::uint64_t kNoPosition=~0ULL;
 
+	// Everything a thread owns: cursors into the shared tables, no copies
+	// of them.
 	struct ThreadState{
+		// The segment bitset and the bucket pages; huge-page backed when
+		// the config asks for it.
+		std::unique_ptr<SieveArena> arena;
+		// words_for_bits(segment_span/2) words, 64-byte aligned, holding
+		// the last sieved segment.
+		std::uint64_t*bits=nullptr;
+		// Large primes by the super-segment of their next hit, and within
+		// the loaded super-segment by segment.  The ring is valid from
+		// next_super_segment on; a thread that skips ahead advances the
+		// primes filed for the skipped super-segments.
 		BucketRing bucket;
+		std::vector<BucketEntry> carried;
+		std::uint64_t next_super_segment=kNoSuperSegment;
+		// Large primes from this index on start at p*p beyond the ring and
+		// are filed once the sieve gets close.
+		std::size_t unfiled_large=0;
+		std::uint64_t loaded_super_segment=kNoSuperSegment;
+		// First segment of the loaded super-segment whose near bucket has
+		// not been sieved.
+		std::size_t next_near_segment=0;
+		std::uint64_t super_segment_seeds=0;
 		std::vector<std::uint64_t> small_positions;
-		std::vector<LargePrimeState> large_states;
-		std::vector<std::uint64_t> medium_positions;
-		std::vector<std::int32_t> medium_next;
-		std::vector<std::int32_t> medium_tile_heads;
+		// Next hit of each medium prime with p*p below medium_base so far,
+		// in bits from medium_base (the end of the last sieved segment).
+		std::uint64_t medium_base=kNoPosition;
+		std::vector<std::uint32_t> medium_offsets;
 	};
 
 	ThreadState make_thread_state(std::size_t thread_index,
 								  std::size_t thread_count) const;
 
-	void sieve_segment(ThreadState&state,std::uint64_t segment_id,
-					   std::uint64_t segment_low,std::uint64_t segment_high,
-					   std::vector<std::uint64_t>&bitset) const;
+	// Sieves the segment into state.bits and returns them.
+	const std::uint64_t*sieve_segment(ThreadState&state,
+									  std::uint64_t segment_id,
+									  std::uint64_t segment_low,
+									  std::uint64_t segment_high) const;
+
+	// sieve_segment() that also returns the number of primes (zero bits) in
+	// the segment.  Each tile is counted right after its last marking pass,
+	// while it is still in L1, instead of re-reading the whole segment
+	// afterwards.
+	std::uint64_t sieve_segment_count(ThreadState&state,
+									  std::uint64_t segment_id,
+									  std::uint64_t segment_low,
+									  std::uint64_t segment_high) const;
+
+	// sieve_segment() that appends the segment's primes to `primes`, each
+	// tile extracted while it is still in L1, and returns how many it
+	// appended.
+	std::uint64_t sieve_segment_primes(ThreadState&state,
+									   std::uint64_t segment_id,
+									   std::uint64_t segment_low,
+									   std::uint64_t segment_high,
+									   std::vector<std::uint64_t>&primes) const;
+
+	// sieve_segment_count() that also looks up the prime of one-based rank
+	// `rank` within the segment, in the tile holding it.  `nth_value` is
+	// set to it, or to 0 when the segment has fewer primes (or rank is 0).
+	std::uint64_t sieve_segment_nth(ThreadState&state,std::uint64_t segment_id,
+									std::uint64_t segment_low,
+									std::uint64_t segment_high,
+									std::uint64_t rank,
+									std::uint64_t&nth_value) const;
 
 	const SegmentConfig&config() const{ return config_; }
 
+	// Heap bytes of the tables shared by all threads and by markers built
+	// from this one, and of one thread's state (its whole arena included).
+	std::size_t shared_bytes() const;
+	std::size_t thread_state_bytes(const ThreadState&state) const;
+
   private:
+	// Read-only after construction.
+	struct Tables{
+		std::vector<std::uint32_t> small_primes;
+		std::vector<std::uint64_t> small_initial;
+		std::vector<const SmallPrimePattern*> small_prime_patterns;
+		// Ascending, as are the large primes.
+		std::vector<std::uint32_t> medium_primes;
+		std::vector<std::uint32_t> large_primes;
+	};
+
 	const Wheel&wheel_;
 	SegmentConfig config_;
 	std::uint64_t range_begin_;
 	std::uint64_t range_end_;
-	std::vector<std::uint32_t> small_primes_;
-	std::vector<std::uint64_t> small_initial_;
-	std::vector<const SmallPrimePattern*> small_prime_patterns_;
-	std::vector<std::uint32_t> medium_primes_;
-	std::vector<std::uint64_t> medium_initial_;
-	std::vector<LargePrimeState> large_primes_template_;
+	std::shared_ptr<const Tables> tables_;
+	// Medium primes [0, tile_medium_count_) hit every tile and are sieved
+	// tile by tile; the others are sieved once per segment.
+	std::size_t tile_medium_count_;
+	std::uint64_t super_span_;
+	std::size_t ring_slots_;
 
 	static std::uint64_t first_hit(std::uint32_t prime,std::uint64_t start);
+	void init_layout();
 	void apply_small_primes(ThreadState&state,const TileView&tile) const;
-	void apply_medium_primes(ThreadState&state,const TileView&tile,
-							 std::uint64_t segment_low,
-							 std::uint64_t segment_high,std::size_t tile_index,
-							 std::size_t tile_count) const;
+	void start_medium_primes(ThreadState&state,std::uint64_t segment_low,
+							 std::uint64_t segment_high) const;
+	void apply_medium_primes(ThreadState&state,std::size_t first,
+							 std::size_t last,std::uint64_t*bits,
+							 std::uint32_t end_bit,
+							 std::uint32_t rebase_bits) const;
+	void file_large_prime(ThreadState&state,std::uint32_t prime_index,
+						  std::uint64_t value) const;
+	void file_new_large_primes(ThreadState&state,std::uint64_t low,
+							   std::uint64_t horizon) const;
+	void seed_large_primes(ThreadState&state) const;
+	void skip_large_primes(ThreadState&state,std::uint64_t first,
+						   std::uint64_t last) const;
+	void finish_super_segment(ThreadState&state) const;
+	void load_super_segment(ThreadState&state,
+							std::uint64_t super_segment) const;
+	void apply_near_bucket(ThreadState&state,std::size_t segment,
+						   std::uint64_t*bits) const;
 	void apply_large_primes(ThreadState&state,std::uint64_t segment_id,
-							std::uint64_t segment_low,
-							std::uint64_t segment_high,
-							std::vector<std::uint64_t>&bitset) const;
+							std::uint64_t*bits) const;
+	// Sieves the segment and calls on_tile(tile) for every tile once its
+	// bits are final.
+	template<typename OnTile>
+	void sieve_tiles(ThreadState&state,std::uint64_t segment_id,
+					 std::uint64_t segment_low,std::uint64_t segment_high,
+					 OnTile&&on_tile) const;
 };
 
 } // namespace calcprime
@@ -0,0 +1,60 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+namespace calcprime{
+
+// Turning a sieved segment into primes.  Bit i of `bits` stands for the odd
+// number seg_low + 2*i and is set when that number is composite; bits at
+// and past `bit_count` are ignored.
+//
+// The extractors write whole vectors, so `out` needs room for the
+// count_zero_bits(bits, bit_count) results plus kExtractSlack elements;
+// the slack is scratch and its contents are unspecified.  They return the
+// number of results written.  Built with AVX-512F they expand 16 bits at a
+// time with VPCOMPRESSD, with AVX2 8 bits at a time from a lookup table.
+constexpr std::size_t kExtractSlack=16;
+
+std::size_t extract_primes_u64(const std::uint64_t*bits,std::size_t bit_count,
+							   std::uint64_t seg_low,
+							   std::uint64_t*out) noexcept;
+
+// Bit indices i instead of values, for callers that only need positions
+// within the segment (the prime is seg_low + 2*i); `bit_count` must be
+// below 2^32.
+std::size_t extract_prime_offsets_u32(const std::uint64_t*bits,
+									  std::size_t bit_count,
+									  std::uint32_t*out) noexcept;
+
+// "avx512", "avx2" or "scalar": the kernel the extractors were compiled
+// with.
+const char*prime_extract_kernel() noexcept;
+
+// Portable reference implementations; the extractors above are these when
+// neither AVX-512F nor AVX2 is available at compile time.
+std::size_t extract_primes_u64_scalar(const std::uint64_t*bits,
+									  std::size_t bit_count,
+									  std::uint64_t seg_low,
+									  std::uint64_t*out) noexcept;
+std::size_t extract_prime_offsets_u32_scalar(const std::uint64_t*bits,
+											 std::size_t bit_count,
+											 std::uint32_t*out) noexcept;
+
+// Appends the primes of `bit_count` bits starting at value seg_low to
+// `primes`, growing it as it goes.
+void append_primes(const std::uint64_t*bits,std::size_t bit_count,
+				   std::uint64_t seg_low,std::vector<std::uint64_t>&primes);
+
+// Appends the segment's primes to `primes`.
+void extract_segment_primes(const std::vector<std::uint64_t>&bits,
+							std::uint64_t seg_low,std::size_t bit_count,
+							std::vector<std::uint64_t>&primes);
+
+// The prime of zero-based rank `rank` among the bits, which must hold more
+// than `rank` primes.
+std::uint64_t select_prime(const std::uint64_t*bits,std::size_t bit_count,
+						   std::uint64_t seg_low,std::uint64_t rank) noexcept;
+
+} // namespace calcprime
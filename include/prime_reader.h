@@ -0,0 +1,62 @@
+#pragma once
+
+#include "writer.h"
+
+#include<cstdint>
+#include<memory>
+#include<optional>
+#include<string>
+#include<vector>
+
+namespace calcprime{
+
+// Decodes any file written by PrimeWriter, in every format and compression
+// variant, as a sequence of blocks of ascending primes.
+//
+// Formats with independent blocks (binary, gap8, wheel30, ef, container,
+// arrow, parquet) are decoded ahead on a small thread pool and seek by
+// block; text, delta16 and zstd-compressed streams are decoded in order on
+// the calling thread, with zstd streamed through a fixed-size window.
+class PrimeReader{
+  public:
+	// The format is detected from the file contents unless given; a file
+	// of a single u64 reads the same as binary or delta16.  `threads` == 0
+	// picks the hardware concurrency, capped at 8.
+	explicit PrimeReader(const std::string&path,
+						 std::optional<PrimeOutputFormat> format=std::nullopt,
+						 unsigned threads=0);
+	~PrimeReader();
+
+	PrimeReader(const PrimeReader&)=delete;
+	PrimeReader&operator=(const PrimeReader&)=delete;
+
+	PrimeOutputFormat format() const;
+	// True when the whole file is a zstd stream (--zstd with text, binary,
+	// delta16 or gap8).
+	bool zstd_stream() const;
+	// Decode threads in use; 1 for sequential formats.
+	unsigned threads() const;
+	// True when seek() jumps to a block rather than rescanning the file.
+	bool indexed() const;
+
+	// Replaces `out` with the next block; returns false with `out` empty
+	// once the file is exhausted.  Blocks are never empty otherwise.
+	bool next_block(std::vector<std::uint64_t>&out);
+
+	// Repositions so that the next block starts at the first prime that is
+	// >= value.  Indexed formats jump straight to the block; sequential
+	// ones restart from the beginning and skip.
+	void seek(std::uint64_t value);
+
+	// Replaces `out` with the final non-empty block and leaves the reader
+	// at the end of the file; returns false if the file holds no primes.
+	// Indexed formats decode only the blocks needed, sequential ones scan
+	// the whole file.
+	bool last_block(std::vector<std::uint64_t>&out);
+
+  private:
+	struct Impl;
+	std::unique_ptr<Impl> impl_;
+};
+
+} // namespace calcprime
@@ -20,6 +20,13 @@ struct SegmentConfig{
 	std::size_t tile_bits;
 	std::uint64_t segment_span;
 	std::uint64_t tile_span;
+	// Consecutive segments that form one super-segment: large sieving
+	// primes are bucketed per super-segment and workers claim whole
+	// super-segments.  1 disables the grouping.
+	std::uint32_t super_segment_segments=1;
+	// Back each thread's segment bitset and bucket pages with 2 MiB pages
+	// where the system allows it (see SieveArena).
+	bool huge_pages=false;
 };
 
 SegmentConfig choose_segment_config(const CpuInfo&info,unsigned threads,
@@ -27,6 +34,16 @@ SegmentConfig choose_segment_config(const CpuInfo&info,unsigned threads,
 									std::size_t requested_tile_bytes,
 									std::uint64_t range_length);
 
+// Segments per super-segment for sieving [range_end-range_length,
+// range_end): a per-core share of L3, or 1 when no sieving prime is large
+// enough to be bucketed or the range is too short to keep every thread
+// busy with whole super-segments.
+std::uint32_t choose_super_segment_segments(const CpuInfo&info,
+											const SegmentConfig&config,
+											unsigned threads,
+											std::uint64_t range_end,
+											std::uint64_t range_length);
+
 SegmentConfig choose_worker_segment_config(const CpuInfo&info,
 										   const SegmentConfig&base_config,
 										   unsigned worker_index,
@@ -42,6 +59,7 @@ class SegmentWorkQueue{
 	bool next(std::uint64_t&segment_id,std::uint64_t&segment_low,
 			  std::uint64_t&segment_high);
 
+	// Claims `requested_segments` whole super-segments.
 	bool next_chunk(std::uint64_t requested_segments,
 					std::uint64_t&segment_begin_id,
 					std::uint64_t&segment_end_id);
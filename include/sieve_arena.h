@@ -0,0 +1,64 @@
+#pragma once
+
+#include<cstddef>
+#include<vector>
+
+namespace calcprime{
+
+// What backs an arena's memory, weakest first.
+enum class ArenaPages{
+	Normal,		 // ordinary pages
+	Transparent, // madvise(MADV_HUGEPAGE): transparent 2 MiB pages
+	HugeTlb,	 // MAP_HUGETLB: 2 MiB pages from the reserved pool
+};
+
+const char*arena_pages_name(ArenaPages pages);
+
+// Bump allocator for one thread's sieve memory (segment bitset and bucket
+// pages).  Blocks are 64-byte aligned and live as long as the arena; memory
+// is taken from the system in chunks of at least 256 KiB, or 2 MiB with
+// huge pages.
+//
+// With huge pages requested on Linux, chunks are 2 MiB aligned and mapped
+// with MAP_HUGETLB.  Once that fails (no pages reserved in
+// /proc/sys/vm/nr_hugepages) they are advised with MADV_HUGEPAGE instead,
+// which needs transparent huge pages in "madvise" or "always" mode.
+// Otherwise, and on other systems, chunks come from aligned operator new.
+class SieveArena{
+  public:
+	static constexpr std::size_t kAlignment=64;
+	static constexpr std::size_t kChunkBytes=std::size_t(256)*1024;
+	static constexpr std::size_t kHugePageBytes=std::size_t(2)*1024*1024;
+
+	explicit SieveArena(bool huge_pages);
+	~SieveArena();
+
+	SieveArena(const SieveArena&)=delete;
+	SieveArena&operator=(const SieveArena&)=delete;
+
+	void*allocate(std::size_t bytes);
+
+	// Bytes taken from the system.
+	std::size_t reserved_bytes() const{ return reserved_; }
+	// The weakest backing of any chunk; Normal while there are none.
+	ArenaPages pages() const;
+
+  private:
+	struct Chunk{
+		void*base;
+		std::size_t bytes;
+		ArenaPages pages;
+		bool mapped;
+	};
+
+	Chunk allocate_chunk(std::size_t bytes);
+
+	bool huge_pages_;
+	bool try_hugetlb_;
+	std::vector<Chunk> chunks_;
+	char*cursor_=nullptr;
+	char*end_=nullptr;
+	std::size_t reserved_=0;
+};
+
+} // namespace calcprime
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include<cstddef>
+#include<cstdint>
+#include<optional>
+#include<string>
+
+namespace calcprime{
+
+// Random-access queries over a memory-mapped `--out-format wheel30` file.
+// All ranges are half-open like the CLI's [from, to).
+class Wheel30Reader{
+  public:
+	explicit Wheel30Reader(const std::string&path);
+
+	std::uint64_t from() const{ return from_; }
+	std::uint64_t to() const{ return to_; }
+	std::uint64_t prime_count() const{ return total_; }
+
+	// Throws std::out_of_range when n lies outside [from, to).
+	bool is_prime(std::uint64_t n) const;
+	// Primes in [a, b) intersected with the file range.
+	std::uint64_t count(std::uint64_t a,std::uint64_t b) const;
+	// The k-th prime of the file, 1-based like --nth.
+	std::optional<std::uint64_t> nth(std::uint64_t k) const;
+
+  private:
+	std::uint64_t index_entry(std::size_t entry) const;
+	std::uint64_t bitmap_primes_below_byte(std::uint64_t byte) const;
+	std::uint64_t count_below(std::uint64_t x) const;
+
+	MappedFile file_;
+	std::uint64_t from_=0;
+	std::uint64_t to_=0;
+	std::uint64_t base_=0;
+	std::uint64_t bitmap_bytes_=0;
+	std::uint64_t index_entries_=0;
+	std::uint32_t index_interval_=0;
+	std::uint8_t small_primes_=0;
+	unsigned small_count_=0;
+	const std::uint8_t*bitmap_=nullptr;
+	const std::uint8_t*index_=nullptr;
+	std::uint64_t total_=0;
+};
+
+} // namespace calcprime
@@ -1,11 +1,16 @@
 #pragma once
 
+#include "buffer_pool.h"
+
 #include<atomic>
 #include<condition_variable>
 #include<cstdint>
 #include<cstdio>
 #include<deque>
+#include<future>
+#include<memory>
 #include<mutex>
+#include<optional>
 #include<string>
 #include<thread>
 #include<vector>
@@ -17,6 +22,11 @@ enum class PrimeOutputFormat{
 	Binary,
 	Delta16,
 	Parquet,
+	Gap8,
+	Wheel30,
+	EliasFano,
+	Container,
+	Arrow,
 };
 
 enum class ParquetEncoding{
@@ -24,26 +34,170 @@ enum class ParquetEncoding{
 	DeltaBinaryPacked,
 };
 
+// Payload of container blocks: absolute values stored as u32 when they fit
+// and u64 otherwise, or gap8 codes.
+enum class ContainerEncoding{
+	Width,
+	Gap8,
+};
+
+// How output files are written: buffered stdio, or io_uring (Linux) with
+// several writes in flight.  IoUring falls back to stdio, with a warning,
+// when it cannot be set up; --extend always uses stdio.  Standard output
+// is not configurable: a pipe is fed with large write(2) calls (Pipe) on
+// Linux, anything else goes through stdio.  A `shm:NAME` path selects the
+// shared-memory ring (SharedMemory).
+enum class FileIoBackend{
+	Stdio,
+	IoUring,
+	Pipe,
+	SharedMemory,
+};
+
+// True for `shm:NAME`, the shared-memory ring output (binary format only).
+inline bool is_shm_output(const std::string&path){
+	return path.rfind("shm:",0)==0;
+}
+
+struct FileIoOptions{
+	FileIoBackend backend=FileIoBackend::Stdio;
+	bool direct=false;		// O_DIRECT, io_uring only
+	unsigned queue_depth=0; // writes in flight; 0 picks the default
+	// shm: rings give up after this long without a consumer releasing a
+	// block; 0 waits forever.
+	unsigned shm_timeout_ms=30000;
+};
+
+// What a writer did with its file; sums over several writers with +=.
+struct FileIoStats{
+	FileIoBackend backend=FileIoBackend::Stdio;
+	bool direct=false;
+	unsigned queue_depth=0;
+	std::uint64_t bytes=0;
+	std::uint64_t submissions=0;
+	std::uint64_t in_flight_total=0;
+	std::uint64_t waits=0;		   // shared-memory ring found full
+
+	FileIoStats&operator+=(const FileIoStats&other);
+	// Average share of the queue depth in use when a write was submitted.
+	double queue_utilization() const;
+};
+
+class ShmRingWriter;
+class PipeOutput;
+class UringFile;
+
+constexpr std::size_t kDefaultParquetRowGroupBytes=128u<<20; // 128 MiB
+
+// How a PrimeWriter encodes and writes its output.
+struct PrimeWriterOptions{
+	PrimeOutputFormat format=PrimeOutputFormat::Text;
+	bool use_zstd=false;
+	bool use_lz4=false; // Arrow buffer codec
+	ParquetEncoding parquet_encoding=ParquetEncoding::Plain;
+	std::size_t parquet_delta_block_values=128;
+	std::size_t parquet_row_group_bytes=kDefaultParquetRowGroupBytes;
+	// Encode workers for Parquet, Elias-Fano, container and Arrow; 0 picks
+	// one per core, up to 8.
+	unsigned encode_threads=0;
+	ContainerEncoding container_encoding=ContainerEncoding::Width;
+	// The path already holds a text, binary or delta16 export (plain or a
+	// zstd stream) or a Parquet file ending at this prime, and is continued
+	// instead of replaced (--extend).
+	std::optional<std::uint64_t> extend_after;
+	// Start no threads: pages and blocks are encoded and written on the
+	// calling thread (--out-unordered shards).
+	bool synchronous=false;
+	FileIoOptions io;
+};
+
 class PrimeWriter{
   public:
-	PrimeWriter(bool enabled,const std::string&path="",
-				PrimeOutputFormat format=PrimeOutputFormat::Text,
-				bool use_zstd=false,
-				ParquetEncoding parquet_encoding=ParquetEncoding::Plain,
-				std::size_t parquet_delta_block_values=128);
+	explicit PrimeWriter(bool enabled,const std::string&path="",
+						 const PrimeWriterOptions&options=PrimeWriterOptions{});
 	~PrimeWriter();
 
 	bool enabled() const{ return enabled_; }
+	// Declares the exported range [from, to).  Formats that lay out the
+	// whole range up front (wheel30) require this before the first write;
+	// the others ignore it.
+	void set_range(std::uint64_t from,std::uint64_t to);
+	// Records the sieve wheel modulus in self-describing headers
+	// (container); must also precede the first write.
+	void set_wheel(std::uint32_t modulus);
 	void write_segment(const std::vector<std::uint64_t>&primes);
 	void write_value(std::uint64_t value);
 	void flush();
 	void finish();
+	// Complete once finish() has returned.
+	const FileIoStats&io_stats() const{ return io_stats_; }
+	// Encoded text, binary, delta16 and gap8 chunks, the values of encode
+	// jobs and Parquet pages.
+	BufferPoolStats buffer_stats() const{
+		BufferPoolStats stats=chunk_buffers_.stats();
+		stats+=value_buffers_.stats();
+		stats+=page_buffers_.stats();
+		return stats;
+	}
 
   private:
+	// A finished Parquet data page: page header followed by the (possibly
+	// compressed) payload, ready to be appended to the file.
+	struct ParquetEncodedPage{
+		std::string bytes;
+		std::int64_t uncompressed_size=0;
+		std::uint64_t value_count=0;
+		std::uint64_t min_value=0;
+		std::uint64_t max_value=0;
+	};
+
+	// Elias-Fano blocks of one worker job; offsets are relative to the
+	// start of `bytes`.
+	struct EliasFanoBlock{
+		std::uint64_t first=0;
+		std::uint64_t offset=0;
+		unsigned lower_bits=0;
+	};
+
+	struct EliasFanoEncodedGroup{
+		std::string bytes;
+		std::vector<EliasFanoBlock> blocks;
+		std::uint64_t value_count=0;
+		std::uint64_t last_value=0;
+	};
+
+	// Work for the encode pool, depending on the output format: a Parquet
+	// page, an Elias-Fano group, or the bytes of a container block or Arrow
+	// record batch.
+	struct EncodeJob{
+		std::vector<std::uint64_t> values;
+		std::promise<ParquetEncodedPage> page;
+		std::promise<EliasFanoEncodedGroup> ef_group;
+		std::promise<std::string> encoded;
+	};
+
+	// Footer entry of an Arrow record batch (arrow::BlockInfo).
+	struct ArrowBatch{
+		std::int64_t offset=0;
+		std::int32_t metadata_length=0;
+		std::int64_t body_length=0;
+	};
+
 	struct Chunk{
 		std::string data;
 		bool flush=false;
-		std::uint64_t value_count=0;
+		std::future<ParquetEncodedPage> page;
+		std::future<EliasFanoEncodedGroup> ef_group;
+		std::future<std::string> encoded;
+	};
+
+	struct ParquetPage{
+		std::int64_t offset=0;
+		std::int32_t compressed_page_size=0;
+		std::int64_t first_row_index=0;
+		std::int64_t num_values=0;
+		std::uint64_t min_value=0;
+		std::uint64_t max_value=0;
 	};
 
 	struct ParquetRowGroup{
@@ -51,17 +205,54 @@ class PrimeWriter{
 		std::int64_t num_values=0;
 		std::int64_t total_uncompressed_size=0;
 		std::int64_t total_compressed_size=0;
+		std::uint64_t min_value=0;
+		std::uint64_t max_value=0;
+		std::vector<ParquetPage> pages;
 	};
 
+	void open_for_extend(const std::string&path,std::uint64_t last_prime);
 	void enqueue_chunk(Chunk&&chunk);
+	void submit_encode_job(Chunk&&chunk,EncodeJob&&job);
+	void run_encode_job(EncodeJob&job,void*zstd_cctx) const;
 	void writer_loop();
+	void write_chunk(Chunk&chunk);
+	void write_trailer();
 	void flush_buffer();
 	void check_io_error() const;
 	void set_error(const std::string&message);
 	std::string encode_delta16(const std::vector<std::uint64_t>&primes);
 	std::string encode_delta16_value(std::uint64_t value);
+	void reserve_gap8_encoded(std::size_t bytes);
+	void append_gap8_values(const std::uint64_t*values,std::size_t count);
+	void flush_gap8_block();
+	void append_wheel30_values(const std::uint64_t*values,std::size_t count);
+	void emit_wheel30_bytes_until(std::uint64_t byte,std::string&out);
+	void finish_wheel30();
+	void append_elias_fano_values(const std::uint64_t*values,std::size_t count);
+	void submit_elias_fano_group(std::vector<std::uint64_t>&&values);
+	EliasFanoEncodedGroup encode_elias_fano_group(
+		const std::vector<std::uint64_t>&values) const;
+	void write_elias_fano_group(EliasFanoEncodedGroup&&group);
+	void write_elias_fano_footer();
+	void append_container_values(const std::uint64_t*values,std::size_t count);
+	void submit_container_block(std::vector<std::uint64_t>&&values);
+	void write_container_header();
+	void write_container_block(std::string&&block);
+	void write_container_footer();
+	void submit_arrow_batch();
+	void write_arrow_schema();
+	void write_arrow_batch(std::string&&message);
+	void write_arrow_footer();
 	void write_file_bytes(const char*data,std::size_t size);
-	void write_parquet_chunk(const Chunk&chunk);
+	void flush_file();
+	bool has_output() const{ return file_||uring_||pipe_||shm_; }
+	void submit_parquet_page(std::vector<std::uint64_t>&&values);
+	void encode_worker_loop();
+	ParquetEncodedPage encode_parquet_page(
+		const std::vector<std::uint64_t>&values,void*zstd_cctx) const;
+	void write_parquet_page(ParquetEncodedPage&&page);
+	void close_parquet_row_group();
+	void stop_encode_workers();
 	void write_parquet_footer();
 #if defined(CALCPRIME_HAS_ZSTD)
 	void flush_zstd_stream(bool final_frame);
@@ -70,6 +261,11 @@ class PrimeWriter{
 	bool enabled_;
 	std::FILE*file_;
 	bool owns_file_;
+	std::unique_ptr<UringFile> uring_;
+	std::unique_ptr<PipeOutput> pipe_;
+	std::unique_ptr<ShmRingWriter> shm_;
+	FileIoStats io_stats_;
+	bool synchronous_;
 	std::thread writer_thread_;
 
 	std::mutex queue_mutex_;
@@ -81,20 +277,67 @@ class PrimeWriter{
 
 	std::string buffer_;
 	std::size_t buffer_threshold_;
+	// Chunk bytes go back here once the writer thread has written them.
+	BufferPool<std::string> chunk_buffers_;
+	// Values of encode jobs return once encoded, Parquet pages once written
+	// and their scratch buffers right away; shared by the encode workers.
+	mutable BufferPool<std::vector<std::uint64_t>> value_buffers_;
+	mutable BufferPool<std::string> page_buffers_;
 
 	PrimeOutputFormat format_;
 	bool use_zstd_;
+	bool use_lz4_;
+	// zstd over the whole byte stream, as opposed to per page or block.
+	bool stream_zstd_;
 	ParquetEncoding parquet_encoding_;
 	std::size_t parquet_delta_block_values_;
 	bool has_first_prime_;
 	std::uint64_t previous_prime_;
+	// Stream compression context; a synchronous writer also encodes its
+	// pages and blocks with it.
 	void*zstd_cctx_;
 	std::string zstd_out_buffer_;
 	std::uint64_t file_offset_;
 	std::uint64_t parquet_num_rows_;
+	std::size_t parquet_row_group_bytes_;
+	std::vector<std::uint64_t> parquet_pending_values_;
+	std::vector<std::uint64_t> gap8_pending_values_;
+	std::string gap8_encoded_;
+	bool range_set_=false;
+	std::uint64_t range_from_=0;
+	std::uint64_t range_to_=0;
+	std::uint64_t wheel30_base_=0;
+	std::uint64_t wheel30_bitmap_bytes_=0;
+	std::uint32_t wheel30_index_interval_=0;
+	std::uint64_t wheel30_next_byte_=0;
+	std::uint8_t wheel30_current_=0;
+	std::uint64_t wheel30_bits_=0;
+	std::vector<std::uint64_t> wheel30_index_;
+	bool wheel30_finished_=false;
+	std::vector<std::uint64_t> ef_pending_values_;
+	std::vector<EliasFanoBlock> ef_blocks_;
+	std::uint64_t ef_count_=0;
+	std::uint64_t ef_last_value_=0;
+	ContainerEncoding container_encoding_;
+	std::uint32_t wheel_modulus_=0;
+	bool container_header_written_=false;
+	std::vector<std::uint64_t> container_pending_values_;
+	std::string container_index_;
+	std::uint64_t container_blocks_=0;
+	std::uint64_t container_count_=0;
+	bool arrow_schema_written_=false;
+	std::vector<std::uint64_t> arrow_pending_values_;
+	std::vector<ArrowBatch> arrow_batches_;
+	ParquetRowGroup parquet_current_row_group_;
 	std::vector<ParquetRowGroup> parquet_row_groups_;
 	bool parquet_footer_written_;
 
+	std::vector<std::thread> encode_workers_;
+	std::mutex encode_jobs_mutex_;
+	std::condition_variable encode_jobs_cv_;
+	std::deque<EncodeJob> encode_jobs_;
+	bool encode_workers_stop_;
+
 	mutable std::mutex error_mutex_;
 	std::atomic<bool> io_error_;
 	std::string error_message_;
@@ -5,9 +5,12 @@
 #include "marker.h"
 #include "popcnt.h"
 #include "prime_count.h"
+#include "prime_extract.h"
+#include "segment_window.h"
 #include "segmenter.h"
 #include "wheel.h"
 #include "writer.h"
+#include "api_output_format.h"
 
 #include<algorithm>
 #include<atomic>
@@ -24,6 +27,10 @@
 
 namespace{
 
+using calcprime::capi::is_valid_output_format;
+using calcprime::capi::to_c_output;
+using calcprime::capi::to_cpp_output;
+
 bool is_valid_wheel(calcprime_wheel_type type){
 	switch(type){
 	case CALCPRIME_WHEEL_MOD30:
@@ -34,17 +41,6 @@ bool is_valid_wheel(calcprime_wheel_type type){
 	return false;
 }
 
-bool is_valid_output_format(calcprime_output_format format){
-	switch(format){
-	case CALCPRIME_OUTPUT_TEXT:
-	case CALCPRIME_OUTPUT_BINARY:
-	case CALCPRIME_OUTPUT_DELTA16:
-	case CALCPRIME_OUTPUT_PARQUET:
-		return true;
-	}
-	return false;
-}
-
 bool is_valid_parquet_encoding(calcprime_parquet_encoding encoding){
 	switch(encoding){
 	case CALCPRIME_PARQUET_ENCODING_PLAIN:
@@ -74,20 +70,6 @@ calcprime::WheelType to_cpp_wheel(calcprime_wheel_type type){
 	return calcprime::WheelType::Mod30;
 }
 
-calcprime::PrimeOutputFormat to_cpp_output(calcprime_output_format format){
-	switch(format){
-	case CALCPRIME_OUTPUT_TEXT:
-		return calcprime::PrimeOutputFormat::Text;
-	case CALCPRIME_OUTPUT_BINARY:
-		return calcprime::PrimeOutputFormat::Binary;
-	case CALCPRIME_OUTPUT_DELTA16:
-		return calcprime::PrimeOutputFormat::Delta16;
-	case CALCPRIME_OUTPUT_PARQUET:
-		return calcprime::PrimeOutputFormat::Parquet;
-	}
-	return calcprime::PrimeOutputFormat::Text;
-}
-
 calcprime_wheel_type to_c_wheel(calcprime::WheelType type){
 	switch(type){
 	case calcprime::WheelType::Mod30:
@@ -100,20 +82,6 @@ calcprime_wheel_type to_c_wheel(calcprime::WheelType type){
 	return CALCPRIME_WHEEL_MOD30;
 }
 
-calcprime_output_format to_c_output(calcprime::PrimeOutputFormat format){
-	switch(format){
-	case calcprime::PrimeOutputFormat::Text:
-		return CALCPRIME_OUTPUT_TEXT;
-	case calcprime::PrimeOutputFormat::Binary:
-		return CALCPRIME_OUTPUT_BINARY;
-	case calcprime::PrimeOutputFormat::Delta16:
-		return CALCPRIME_OUTPUT_DELTA16;
-	case calcprime::PrimeOutputFormat::Parquet:
-		return CALCPRIME_OUTPUT_PARQUET;
-	}
-	return CALCPRIME_OUTPUT_TEXT;
-}
-
 calcprime_segment_config
 to_c_segment_config(const calcprime::SegmentConfig&config){
 	calcprime_segment_config out{};
@@ -137,12 +105,6 @@ calcprime_cpu_info to_c_cpu_info(const calcprime::CpuInfo&info){
 	return out;
 }
 
-struct SegmentResult{
-	std::uint64_t count=0;
-	std::vector<std::uint64_t> primes;
-	std::atomic<bool> ready{false};
-};
-
 struct RangeOptions{
 	std::uint64_t from=0;
 	std::uint64_t to=0;
@@ -160,6 +122,8 @@ struct RangeOptions{
 	calcprime::ParquetEncoding parquet_encoding=
 		calcprime::ParquetEncoding::Plain;
 	std::size_t parquet_delta_block_values=128;
+	std::size_t parquet_row_group_bytes=calcprime::kDefaultParquetRowGroupBytes;
+	unsigned encode_threads=0;
 	std::string output_path;
 	calcprime_prime_chunk_callback prime_callback=nullptr;
 	void*prime_user_data=nullptr;
@@ -184,6 +148,8 @@ RangeOptions make_range_options(const calcprime_range_options&opts){
 	result.output_format=to_cpp_output(opts.output_format);
 	result.parquet_encoding=to_cpp_parquet_encoding(opts.parquet_encoding);
 	result.parquet_delta_block_values=opts.parquet_delta_block_values;
+	result.parquet_row_group_bytes=opts.parquet_row_group_bytes;
+	result.encode_threads=opts.parquet_threads;
 	if(opts.output_path){
 		result.output_path=opts.output_path;
 	}
@@ -368,6 +334,8 @@ extern "C" int calcprime_range_options_init(calcprime_range_options*options){
 	options->compress_zstd=0;
 	options->parquet_encoding=CALCPRIME_PARQUET_ENCODING_PLAIN;
 	options->parquet_delta_block_values=128;
+	options->parquet_row_group_bytes=calcprime::kDefaultParquetRowGroupBytes;
+	options->parquet_threads=0;
 	return 0;
 }
 
@@ -465,6 +433,12 @@ calcprime_run_range(const calcprime_range_options*options,
 		*out_result=result.release();
 		return CALCPRIME_STATUS_INVALID_ARGUMENT;
 	}
+	if(options->output_format==CALCPRIME_OUTPUT_PARQUET&&
+	   options->parquet_row_group_bytes==0){
+		result->error_message="Parquet row group size must be positive";
+		*out_result=result.release();
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
 
 	RangeOptions opts=make_range_options(*options);
 #if !defined(CALCPRIME_HAS_ZSTD)
@@ -629,6 +603,8 @@ calcprime_run_range(const calcprime_range_options*options,
 
 	calcprime::SegmentConfig config=calcprime::choose_segment_config(
 		cpu_info,threads,opts.segment_bytes,opts.tile_bytes,length);
+	config.super_segment_segments=calcprime::choose_super_segment_segments(
+		cpu_info,config,threads,range.end,length);
 	result->stats.segment=to_c_segment_config(config);
 
 	std::size_t num_segments=
@@ -693,14 +669,21 @@ calcprime_run_range(const calcprime_range_options*options,
 	std::unique_ptr<calcprime::PrimeMarker> efficiency_marker;
 	if(split_tile){
 		efficiency_marker=std::make_unique<calcprime::PrimeMarker>(
-			wheel,efficiency_config,range.begin,range.end,base_primes,
-			small_limit);
+			performance_marker,efficiency_config);
 	}
 	calcprime::SegmentWorkQueue queue(range,config);
 
-	std::vector<SegmentResult> segment_results(num_segments);
-	std::mutex segment_ready_mutex;
-	std::condition_variable segment_ready_cv;
+	calcprime::SegmentReorderWindow window(
+		num_segments,calcprime::SegmentReorderWindow::choose_capacity(
+						 threads,
+						 std::max(performance_batch,efficiency_batch)*
+							 config.super_segment_segments,
+						 num_segments));
+	std::atomic<std::uint64_t> sieved_total{0};
+	// Handed back by deliver_chunk unless the primes are collected, in which
+	// case the workers allocate their own vectors.
+	calcprime::BufferPool<std::vector<std::uint64_t>> prime_buffers(
+		window.capacity()+threads+1);
 	std::atomic<bool> stop{false};
 	std::atomic<bool> nth_found_flag{false};
 	std::uint64_t nth_value=0;
@@ -715,9 +698,18 @@ calcprime_run_range(const calcprime_range_options*options,
 	std::unique_ptr<calcprime::PrimeWriter> writer;
 	if(opts.write_to_file){
 		try{
+			calcprime::PrimeWriterOptions writer_options;
+			writer_options.format=opts.output_format;
+			writer_options.use_zstd=opts.compress_zstd;
+			writer_options.parquet_encoding=opts.parquet_encoding;
+			writer_options.parquet_delta_block_values=
+				opts.parquet_delta_block_values;
+			writer_options.parquet_row_group_bytes=opts.parquet_row_group_bytes;
+			writer_options.encode_threads=opts.encode_threads;
 			writer=std::make_unique<calcprime::PrimeWriter>(
-				true,opts.output_path,opts.output_format,opts.compress_zstd,
-				opts.parquet_encoding,opts.parquet_delta_block_values);
+				true,opts.output_path,writer_options);
+			writer->set_wheel(calcprime::get_wheel(opts.wheel).modulus);
+			writer->set_range(opts.from,opts.to);
 		}catch(const std::exception&ex){
 			result->status=CALCPRIME_STATUS_IO_ERROR;
 			result->error_message=ex.what();
@@ -768,6 +760,8 @@ calcprime_run_range(const calcprime_range_options*options,
 		if(opts.collect_primes){
 			result->prime_chunks.emplace_back(std::move(chunk));
 			result->stored_prime_total+=static_cast<std::uint64_t>(chunk_size);
+		}else{
+			prime_buffers.release(std::move(chunk));
 		}
 		return true;
 	};
@@ -823,8 +817,9 @@ calcprime_run_range(const calcprime_range_options*options,
 					?*efficiency_marker
 					:performance_marker;
 			auto state=worker_marker.make_thread_state(t,threads);
-			std::vector<std::uint64_t> bitset;
 			std::uint64_t cumulative=prefix_total;
+			std::uint64_t local_total=0;
+			std::uint64_t last_count=0;
 			const std::uint32_t batch_segments=
 				performance_worker?performance_batch:efficiency_batch;
 			while(!stop.load(std::memory_order_acquire)){
@@ -849,77 +844,51 @@ calcprime_run_range(const calcprime_range_options*options,
 					if(!queue.segment_bounds(segment_id,seg_low,seg_high)){
 						continue;
 					}
-					worker_marker.sieve_segment(state,segment_id,seg_low,
-												seg_high,bitset);
-					std::size_t bit_count=
-						static_cast<std::size_t>((seg_high-seg_low)>>1);
-					std::uint64_t local_count=
-						calcprime::count_zero_bits(bitset.data(),bit_count);
-					if(segment_id<segment_results.size()){
-						segment_results[segment_id].count=local_count;
-					}
-
+					bool find_nth=need_primes_for_nth&&threads==1&&
+								  !nth_found_flag.load(std::memory_order_acquire);
+					std::uint64_t rank=
+						find_nth&&nth_target>cumulative?nth_target-cumulative
+													   :0;
+					std::uint64_t local_count=0;
+					std::uint64_t value=0;
 					std::vector<std::uint64_t> primes;
-					bool need_primes=
-						need_segment_storage||(need_primes_for_nth&&threads==1);
-					if(need_primes&&local_count>0){
-						primes.reserve(static_cast<std::size_t>(local_count));
-						std::uint64_t value=seg_low;
-						std::size_t produced=0;
-						for(std::size_t word=0;
-							word<bitset.size()&&produced<bit_count;++word){
-							std::uint64_t composite=bitset[word];
-							for(std::size_t bit=0;bit<64&&produced<bit_count;
-								++bit,++produced,value+=2){
-								if(composite&(1ULL<<bit)){
-									continue;
-								}
-								primes.push_back(value);
-							}
+					if(need_segment_storage){
+						// Sized from the previous segment; the tiles grow
+						// the buffer if this one has more primes.
+						std::size_t expected=
+							static_cast<std::size_t>(last_count)+
+							calcprime::kExtractSlack;
+						if(opts.collect_primes){
+							primes.reserve(expected);
+						}else{
+							primes=prime_buffers.acquire(expected);
 						}
-					}
-
-					if(need_primes_for_nth&&threads==1&&
-					   !nth_found_flag.load(std::memory_order_acquire)){
-						std::uint64_t base=cumulative;
-						std::uint64_t new_total=base+local_count;
-						if(nth_target>base&&nth_target<=new_total){
-							if(primes.empty()&&local_count>0){
-								primes.reserve(
-									static_cast<std::size_t>(local_count));
-								std::uint64_t value=seg_low;
-								std::size_t produced=0;
-								for(std::size_t word=0;
-									word<bitset.size()&&produced<bit_count;
-									++word){
-									std::uint64_t composite=bitset[word];
-									for(std::size_t bit=0;
-										bit<64&&produced<bit_count;
-										++bit,++produced,value+=2){
-										if(composite&(1ULL<<bit)){
-											continue;
-										}
-										primes.push_back(value);
-									}
-								}
-							}
-							std::size_t index=
-								static_cast<std::size_t>(nth_target-base-1);
-							if(index<primes.size()){
-								nth_value=primes[index];
-								nth_found_flag.store(
-									true,std::memory_order_release);
-								stop.store(true,std::memory_order_release);
-							}
+						local_count=worker_marker.sieve_segment_primes(
+							state,segment_id,seg_low,seg_high,primes);
+						if(rank>0&&rank<=local_count){
+							value=primes[static_cast<std::size_t>(rank-1)];
 						}
-						cumulative=new_total;
+					}else if(rank>0){
+						local_count=worker_marker.sieve_segment_nth(
+							state,segment_id,seg_low,seg_high,rank,
+							value);
+					}else{
+						local_count=worker_marker.sieve_segment_count(
+							state,segment_id,seg_low,seg_high);
+					}
+					last_count=local_count;
+					local_total+=local_count;
+					if(find_nth){
+						cumulative+=local_count;
+					}
+					if(value!=0){
+						nth_value=value;
+						nth_found_flag.store(true,std::memory_order_release);
+						stop.store(true,std::memory_order_release);
 					}
 
-					if(need_segment_storage&&segment_id<segment_results.size()){
-						segment_results[segment_id].primes=std::move(primes);
-						segment_results[segment_id].ready.store(
-							true,std::memory_order_release);
-						segment_ready_cv.notify_all();
+					if(need_segment_storage){
+						window.put(segment_id,std::move(primes));
 					}
 
 					std::size_t completed=segments_processed.fetch_add(
@@ -957,33 +926,21 @@ calcprime_run_range(const calcprime_range_options*options,
 					}
 				}
 			}
+			sieved_total.fetch_add(local_total,std::memory_order_relaxed);
+			if(stop.load(std::memory_order_acquire)){
+				window.stop();
+			}
 		});
 	}
 
 	std::thread delivery_thread;
 	if(need_segment_storage&&num_segments>0){
 		delivery_thread=std::thread([&](){
-			for(std::size_t idx=0;idx<num_segments;++idx){
-				SegmentResult&seg=segment_results[idx];
-				std::vector<std::uint64_t> primes;
-				{
-					std::unique_lock<std::mutex> lock(segment_ready_mutex);
-					segment_ready_cv.wait(lock,[&](){
-						return seg.ready.load(std::memory_order_acquire)||
-							   stop.load(std::memory_order_acquire);
-					});
-					bool ready=seg.ready.load(std::memory_order_acquire);
-					if(!ready){
-						if(stop.load(std::memory_order_acquire)){
-							break;
-						}
-						continue;
-					}
-					seg.ready.store(false,std::memory_order_release);
-					primes=std::move(seg.primes);
-				}
+			std::vector<std::uint64_t> primes;
+			while(window.take(primes)){
 				if(!deliver_chunk(std::move(primes))){
 					stop.store(true,std::memory_order_release);
+					window.stop();
 					break;
 				}
 			}
@@ -1007,7 +964,7 @@ calcprime_run_range(const calcprime_range_options*options,
 		}
 	}
 
-	segment_ready_cv.notify_all();
+	window.stop();
 
 	if(delivery_thread.joinable()){
 		delivery_thread.join();
@@ -1027,10 +984,8 @@ calcprime_run_range(const calcprime_range_options*options,
 	std::size_t processed=segments_processed.load(std::memory_order_acquire);
 	result->stats.segments_processed=processed;
 
-	std::uint64_t total=prefix_count;
-	for(const auto&seg : segment_results){
-		total+=seg.count;
-	}
+	std::uint64_t total=
+		prefix_count+sieved_total.load(std::memory_order_relaxed);
 	result->total_count=total;
 	result->stats.prime_count=total;
 
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "calcprime/api.h"
+#include "writer.h"
+
+// Mapping between calcprime_output_format and PrimeOutputFormat, shared by
+// the range API and the reader API.
+namespace calcprime::capi{
+
+inline bool is_valid_output_format(calcprime_output_format format){
+	switch(format){
+	case CALCPRIME_OUTPUT_TEXT:
+	case CALCPRIME_OUTPUT_BINARY:
+	case CALCPRIME_OUTPUT_DELTA16:
+	case CALCPRIME_OUTPUT_PARQUET:
+	case CALCPRIME_OUTPUT_GAP8:
+	case CALCPRIME_OUTPUT_WHEEL30:
+	case CALCPRIME_OUTPUT_EF:
+	case CALCPRIME_OUTPUT_CONTAINER:
+	case CALCPRIME_OUTPUT_ARROW:
+		return true;
+	}
+	return false;
+}
+
+inline calcprime::PrimeOutputFormat
+to_cpp_output(calcprime_output_format format){
+	switch(format){
+	case CALCPRIME_OUTPUT_TEXT:
+		return calcprime::PrimeOutputFormat::Text;
+	case CALCPRIME_OUTPUT_BINARY:
+		return calcprime::PrimeOutputFormat::Binary;
+	case CALCPRIME_OUTPUT_DELTA16:
+		return calcprime::PrimeOutputFormat::Delta16;
+	case CALCPRIME_OUTPUT_PARQUET:
+		return calcprime::PrimeOutputFormat::Parquet;
+	case CALCPRIME_OUTPUT_GAP8:
+		return calcprime::PrimeOutputFormat::Gap8;
+	case CALCPRIME_OUTPUT_WHEEL30:
+		return calcprime::PrimeOutputFormat::Wheel30;
+	case CALCPRIME_OUTPUT_EF:
+		return calcprime::PrimeOutputFormat::EliasFano;
+	case CALCPRIME_OUTPUT_CONTAINER:
+		return calcprime::PrimeOutputFormat::Container;
+	case CALCPRIME_OUTPUT_ARROW:
+		return calcprime::PrimeOutputFormat::Arrow;
+	}
+	return calcprime::PrimeOutputFormat::Text;
+}
+
+inline calcprime_output_format
+to_c_output(calcprime::PrimeOutputFormat format){
+	switch(format){
+	case calcprime::PrimeOutputFormat::Text:
+		return CALCPRIME_OUTPUT_TEXT;
+	case calcprime::PrimeOutputFormat::Binary:
+		return CALCPRIME_OUTPUT_BINARY;
+	case calcprime::PrimeOutputFormat::Delta16:
+		return CALCPRIME_OUTPUT_DELTA16;
+	case calcprime::PrimeOutputFormat::Parquet:
+		return CALCPRIME_OUTPUT_PARQUET;
+	case calcprime::PrimeOutputFormat::Gap8:
+		return CALCPRIME_OUTPUT_GAP8;
+	case calcprime::PrimeOutputFormat::Wheel30:
+		return CALCPRIME_OUTPUT_WHEEL30;
+	case calcprime::PrimeOutputFormat::EliasFano:
+		return CALCPRIME_OUTPUT_EF;
+	case calcprime::PrimeOutputFormat::Container:
+		return CALCPRIME_OUTPUT_CONTAINER;
+	case calcprime::PrimeOutputFormat::Arrow:
+		return CALCPRIME_OUTPUT_ARROW;
+	}
+	return CALCPRIME_OUTPUT_TEXT;
+}
+
+} // namespace calcprime::capi
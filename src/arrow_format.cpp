@@ -0,0 +1,649 @@
+#include "arrow_format.h"
+
+#include<algorithm>
+#include<bit>
+#include<cstring>
+#include<stdexcept>
+#include<type_traits>
+#include<utility>
+
+#if defined(CALCPRIME_HAS_ZSTD)
+#include<zstd.h>
+#endif
+
+#if defined(CALCPRIME_HAS_LZ4)
+#include<lz4frame.h>
+#endif
+
+namespace calcprime::arrow{
+
+namespace{
+
+// Format.fbs / Schema.fbs / Message.fbs / File.fbs constants.
+constexpr std::int16_t kMetadataV5=4;
+constexpr std::uint8_t kMessageHeaderSchema=1;
+constexpr std::uint8_t kMessageHeaderRecordBatch=3;
+constexpr std::uint8_t kTypeInt=2;
+constexpr std::int8_t kCompressionLz4Frame=0;
+constexpr std::int8_t kCompressionZstd=1;
+constexpr std::uint32_t kContinuation=0xFFFFFFFFU;
+
+// Minimal back-to-front flatbuffer builder: objects are prepended, so
+// children are created before the tables that reference them and every
+// uoffset points forward, exactly as flatc-generated builders lay them out.
+// Bytes are kept reversed so that prepending is an append.
+class FlatBuilder{
+  public:
+	using Ref=std::uint32_t;
+
+	std::uint32_t size() const{
+		return static_cast<std::uint32_t>(reversed_.size());
+	}
+
+	Ref create_string(const std::string&value){
+		pre_align(value.size()+1U,4);
+		push_zeros(1);
+		push_bytes(value.data(),value.size());
+		push_scalar<std::uint32_t>(static_cast<std::uint32_t>(value.size()));
+		return size();
+	}
+
+	// Vector of structs given as their little-endian bytes.
+	Ref create_struct_vector(const std::string&bytes,std::size_t count,
+							 std::size_t alignment){
+		pre_align(bytes.size(),4);
+		pre_align(bytes.size(),alignment);
+		push_bytes(bytes.data(),bytes.size());
+		push_scalar<std::uint32_t>(static_cast<std::uint32_t>(count));
+		return size();
+	}
+
+	Ref create_offset_vector(const std::vector<Ref>&refs){
+		pre_align(refs.size()*4U,4);
+		for(auto it=refs.rbegin();it!=refs.rend();++it){
+			push_offset(*it);
+		}
+		push_scalar<std::uint32_t>(static_cast<std::uint32_t>(refs.size()));
+		return size();
+	}
+
+	void start_table(){
+		fields_.clear();
+		table_start_=size();
+	}
+
+	template<typename T>
+	void add_scalar(unsigned id,T value){
+		push_scalar<T>(value);
+		fields_.push_back({id,size()});
+	}
+
+	void add_offset(unsigned id,Ref ref){
+		push_offset(ref);
+		fields_.push_back({id,size()});
+	}
+
+	Ref end_table(){
+		push_scalar<std::int32_t>(0); // soffset to the vtable, patched below
+		const std::uint32_t table=size();
+		unsigned field_count=0;
+		for(const Field&field : fields_){
+			field_count=std::max(field_count,field.id+1U);
+		}
+		std::vector<std::uint16_t> offsets(field_count,0);
+		for(const Field&field : fields_){
+			offsets[field.id]=static_cast<std::uint16_t>(table-field.position);
+		}
+		for(auto it=offsets.rbegin();it!=offsets.rend();++it){
+			push_scalar<std::uint16_t>(*it);
+		}
+		push_scalar<std::uint16_t>(static_cast<std::uint16_t>(table-table_start_));
+		push_scalar<std::uint16_t>(
+			static_cast<std::uint16_t>(4U+2U*field_count));
+		patch_i32(table,static_cast<std::int32_t>(size()-table));
+		return table;
+	}
+
+	std::string finish(Ref root){
+		pre_align(4,max_alignment_);
+		push_offset(root);
+		return std::string(reversed_.rbegin(),reversed_.rend());
+	}
+
+  private:
+	struct Field{
+		unsigned id;
+		std::uint32_t position;
+	};
+
+	void push_zeros(std::size_t count){
+		reversed_.append(count,'\0');
+	}
+
+	void push_bytes(const char*data,std::size_t count){
+		for(std::size_t i=count;i>0;--i){
+			reversed_.push_back(data[i-1U]);
+		}
+	}
+
+	// Pads so that the buffer is aligned after `length` more bytes.
+	void pre_align(std::size_t length,std::size_t alignment){
+		max_alignment_=std::max(max_alignment_,alignment);
+		std::size_t padding=
+			(alignment-((reversed_.size()+length)%alignment))%alignment;
+		push_zeros(padding);
+	}
+
+	template<typename T>
+	void push_scalar(T value){
+		pre_align(sizeof(T),sizeof(T));
+		using Unsigned=std::make_unsigned_t<T>;
+		Unsigned bits=static_cast<Unsigned>(value);
+		for(std::size_t i=sizeof(T);i>0;--i){
+			reversed_.push_back(static_cast<char>(
+				(bits>>(8U*(i-1U)))&0xffU));
+		}
+	}
+
+	void push_offset(Ref ref){
+		pre_align(4,4);
+		push_scalar<std::uint32_t>(size()+4U-ref);
+	}
+
+	// Object positions are distances from the end of the buffer; the byte
+	// at distance d-1-j holds byte j of a value starting at distance d.
+	void patch_i32(std::uint32_t position,std::int32_t value){
+		auto bits=static_cast<std::uint32_t>(value);
+		for(std::uint32_t j=0;j<4;++j){
+			reversed_[position-1U-j]=static_cast<char>((bits>>(8U*j))&0xffU);
+		}
+	}
+
+	std::string reversed_;
+	std::vector<Field> fields_;
+	std::uint32_t table_start_=0;
+	std::size_t max_alignment_=1;
+};
+
+void put_i64(std::string&out,std::int64_t value){
+	auto bits=static_cast<std::uint64_t>(value);
+	for(int i=0;i<8;++i){
+		out.push_back(static_cast<char>(bits>>(8*i)));
+	}
+}
+
+void put_i32(std::string&out,std::int32_t value){
+	auto bits=static_cast<std::uint32_t>(value);
+	for(int i=0;i<4;++i){
+		out.push_back(static_cast<char>(bits>>(8*i)));
+	}
+}
+
+void pad_to_8(std::string&out){
+	out.append((8U-out.size()%8U)%8U,'\0');
+}
+
+FlatBuilder::Ref build_schema(FlatBuilder&builder,const SchemaInfo&schema){
+	FlatBuilder::Ref name=builder.create_string("prime");
+	builder.start_table(); // Int
+	builder.add_scalar<std::int32_t>(0,64);
+	builder.add_scalar<std::uint8_t>(1,0);
+	FlatBuilder::Ref int_type=builder.end_table();
+	FlatBuilder::Ref children=builder.create_offset_vector({});
+
+	builder.start_table(); // Field
+	builder.add_offset(0,name);
+	builder.add_scalar<std::uint8_t>(1,0); // nullable
+	builder.add_scalar<std::uint8_t>(2,kTypeInt);
+	builder.add_offset(3,int_type);
+	builder.add_offset(5,children);
+	FlatBuilder::Ref field=builder.end_table();
+	FlatBuilder::Ref fields=builder.create_offset_vector({field});
+
+	std::vector<FlatBuilder::Ref> metadata;
+	if(schema.range_known){
+		const std::pair<const char*,std::uint64_t> entries[]={
+			{"calcprime.from",schema.from},{"calcprime.to",schema.to}};
+		for(const auto&entry : entries){
+			FlatBuilder::Ref key=builder.create_string(entry.first);
+			FlatBuilder::Ref value=
+				builder.create_string(std::to_string(entry.second));
+			builder.start_table(); // KeyValue
+			builder.add_offset(0,key);
+			builder.add_offset(1,value);
+			metadata.push_back(builder.end_table());
+		}
+	}
+	FlatBuilder::Ref custom_metadata=builder.create_offset_vector(metadata);
+
+	builder.start_table(); // Schema
+	builder.add_scalar<std::int16_t>(0,0); // little endian
+	builder.add_offset(1,fields);
+	builder.add_offset(2,custom_metadata);
+	return builder.end_table();
+}
+
+std::string finish_message(FlatBuilder&builder,std::uint8_t header_type,
+						   FlatBuilder::Ref header,std::int64_t body_length){
+	builder.start_table(); // Message
+	builder.add_scalar<std::int16_t>(0,kMetadataV5);
+	builder.add_scalar<std::uint8_t>(1,header_type);
+	builder.add_offset(2,header);
+	builder.add_scalar<std::int64_t>(3,body_length);
+	return builder.finish(builder.end_table());
+}
+
+// Continuation marker, padded metadata size and the metadata itself.
+std::string encapsulate(const std::string&metadata){
+	std::string out;
+	std::size_t padded=metadata.size()+((8U-metadata.size()%8U)%8U);
+	put_i32(out,static_cast<std::int32_t>(kContinuation));
+	put_i32(out,static_cast<std::int32_t>(padded));
+	out.append(metadata);
+	pad_to_8(out);
+	return out;
+}
+
+std::string compress_buffer(const char*data,std::size_t size,Codec codec,
+							void*zstd_cctx){
+	std::string out;
+	put_i64(out,static_cast<std::int64_t>(size));
+	std::size_t header=out.size();
+	switch(codec){
+	case Codec::Zstd:{
+#if defined(CALCPRIME_HAS_ZSTD)
+		if(!zstd_cctx){
+			throw std::runtime_error("zstd context is not initialized");
+		}
+		out.resize(header+ZSTD_compressBound(size));
+		std::size_t written=ZSTD_compress2(static_cast<ZSTD_CCtx*>(zstd_cctx),
+										   out.data()+header,out.size()-header,
+										   data,size);
+		if(ZSTD_isError(written)){
+			throw std::runtime_error(std::string("zstd compress error: ")+
+									 ZSTD_getErrorName(written));
+		}
+		out.resize(header+written);
+		break;
+#else
+		(void)zstd_cctx;
+		throw std::runtime_error("zstd not supported in this build");
+#endif
+	}
+	case Codec::Lz4Frame:{
+#if defined(CALCPRIME_HAS_LZ4)
+		out.resize(header+LZ4F_compressFrameBound(size,nullptr));
+		std::size_t written=LZ4F_compressFrame(out.data()+header,
+											   out.size()-header,data,size,
+											   nullptr);
+		if(LZ4F_isError(written)){
+			throw std::runtime_error(std::string("lz4 compress error: ")+
+									 LZ4F_getErrorName(written));
+		}
+		out.resize(header+written);
+		break;
+#else
+		throw std::runtime_error("lz4 not supported in this build");
+#endif
+	}
+	case Codec::None:
+		out.assign(data,size);
+		break;
+	}
+	return out;
+}
+
+} // namespace
+
+std::string make_lead(){
+	std::string out(kMagic,sizeof(kMagic));
+	out.append(kLeadBytes-sizeof(kMagic),'\0');
+	return out;
+}
+
+std::string encode_schema_message(const SchemaInfo&schema){
+	FlatBuilder builder;
+	FlatBuilder::Ref header=build_schema(builder,schema);
+	return encapsulate(
+		finish_message(builder,kMessageHeaderSchema,header,0));
+}
+
+std::string encode_record_batch(const std::uint64_t*values,std::size_t count,
+								Codec codec,void*zstd_cctx){
+	std::string data(count*sizeof(std::uint64_t),'\0');
+	for(std::size_t i=0;i<count;++i){
+		for(int b=0;b<8;++b){
+			data[i*8U+static_cast<std::size_t>(b)]=
+				static_cast<char>(values[i]>>(8*b));
+		}
+	}
+	std::string body=codec==Codec::None
+						 ?std::move(data)
+						 :compress_buffer(data.data(),data.size(),codec,
+										  zstd_cctx);
+	const std::int64_t buffer_length=static_cast<std::int64_t>(body.size());
+	pad_to_8(body);
+
+	FlatBuilder builder;
+	std::string nodes;
+	put_i64(nodes,static_cast<std::int64_t>(count)); // FieldNode.length
+	put_i64(nodes,0);								  // FieldNode.null_count
+	FlatBuilder::Ref node_vector=builder.create_struct_vector(nodes,1,8);
+	std::string buffers;
+	put_i64(buffers,0); // validity: absent
+	put_i64(buffers,0);
+	put_i64(buffers,0); // values
+	put_i64(buffers,buffer_length);
+	FlatBuilder::Ref buffer_vector=builder.create_struct_vector(buffers,2,8);
+	FlatBuilder::Ref compression=0;
+	if(codec!=Codec::None){
+		builder.start_table(); // BodyCompression
+		builder.add_scalar<std::int8_t>(
+			0,codec==Codec::Zstd?kCompressionZstd:kCompressionLz4Frame);
+		builder.add_scalar<std::int8_t>(1,0); // BUFFER
+		compression=builder.end_table();
+	}
+	builder.start_table(); // RecordBatch
+	builder.add_scalar<std::int64_t>(0,static_cast<std::int64_t>(count));
+	builder.add_offset(1,node_vector);
+	builder.add_offset(2,buffer_vector);
+	if(codec!=Codec::None){
+		builder.add_offset(3,compression);
+	}
+	FlatBuilder::Ref batch=builder.end_table();
+
+	std::string out=encapsulate(finish_message(
+		builder,kMessageHeaderRecordBatch,batch,
+		static_cast<std::int64_t>(body.size())));
+	out.append(body);
+	return out;
+}
+
+std::int32_t encapsulated_metadata_length(const std::string&message){
+	if(message.size()<8U){
+		throw std::runtime_error("truncated Arrow IPC message");
+	}
+	std::uint32_t length=0;
+	for(int i=3;i>=0;--i){
+		length=(length<<8)|static_cast<std::uint8_t>(message[4U+static_cast<std::size_t>(i)]);
+	}
+	return static_cast<std::int32_t>(8U+length);
+}
+
+std::string encode_file_tail(const SchemaInfo&schema,
+							 const std::vector<BlockInfo>&batches){
+	std::string out;
+	put_i32(out,static_cast<std::int32_t>(kContinuation));
+	put_i32(out,0);
+
+	FlatBuilder builder;
+	FlatBuilder::Ref schema_ref=build_schema(builder,schema);
+	FlatBuilder::Ref dictionaries=builder.create_struct_vector({},0,8);
+	std::string blocks;
+	for(const BlockInfo&batch : batches){
+		put_i64(blocks,batch.offset);
+		put_i32(blocks,batch.metadata_length);
+		put_i32(blocks,0); // struct padding
+		put_i64(blocks,batch.body_length);
+	}
+	FlatBuilder::Ref record_batches=
+		builder.create_struct_vector(blocks,batches.size(),8);
+	builder.start_table(); // Footer
+	builder.add_scalar<std::int16_t>(0,kMetadataV5);
+	builder.add_offset(1,schema_ref);
+	builder.add_offset(2,dictionaries);
+	builder.add_offset(3,record_batches);
+	std::string footer=builder.finish(builder.end_table());
+
+	out.append(footer);
+	put_i32(out,static_cast<std::int32_t>(footer.size()));
+	out.append(kMagic,sizeof(kMagic));
+	return out;
+}
+
+namespace{
+
+std::uint64_t load_le(const std::uint8_t*in,unsigned bytes){
+	std::uint64_t value=0;
+	for(unsigned i=bytes;i>0;--i){
+		value=(value<<8)|in[i-1U];
+	}
+	return value;
+}
+
+// Bounds-checked view of one flatbuffer table, enough to walk the Footer,
+// Message and RecordBatch tables written above.
+class FlatTable{
+  public:
+	FlatTable(const std::uint8_t*data,std::size_t size,std::size_t table)
+		: data_(data),size_(size),table_(table){
+		check(table,4);
+		std::int64_t vtable=static_cast<std::int64_t>(table)-
+							static_cast<std::int32_t>(load_le(data+table,4));
+		if(vtable<0){
+			throw_corrupt();
+		}
+		vtable_=static_cast<std::size_t>(vtable);
+		check(vtable_,4);
+		vtable_bytes_=static_cast<std::size_t>(load_le(data+vtable_,2));
+		check(vtable_,vtable_bytes_);
+	}
+
+	static FlatTable root(const std::uint8_t*data,std::size_t size){
+		if(size<4){
+			throw_corrupt();
+		}
+		return FlatTable(data,size,static_cast<std::size_t>(load_le(data,4)));
+	}
+
+	// Absolute position of field `id`, or 0 when it is absent.
+	std::size_t field(unsigned id) const{
+		std::size_t entry=4U+2U*id;
+		if(entry+2U>vtable_bytes_){
+			return 0;
+		}
+		std::size_t offset=static_cast<std::size_t>(
+			load_le(data_+vtable_+entry,2));
+		return offset==0?0:table_+offset;
+	}
+
+	std::uint64_t scalar(unsigned id,unsigned bytes,
+						 std::uint64_t fallback=0) const{
+		std::size_t pos=field(id);
+		if(pos==0){
+			return fallback;
+		}
+		check(pos,bytes);
+		return load_le(data_+pos,bytes);
+	}
+
+	FlatTable table(unsigned id) const{
+		return FlatTable(data_,size_,target(id));
+	}
+
+	// Element count and position of the first element of a vector field.
+	std::pair<std::size_t,std::size_t> vector(unsigned id,
+											  std::size_t element_bytes) const{
+		std::size_t pos=target(id);
+		check(pos,4);
+		std::size_t count=static_cast<std::size_t>(load_le(data_+pos,4));
+		if(element_bytes!=0&&count>(size_-pos-4U)/element_bytes){
+			throw_corrupt();
+		}
+		return {count,pos+4U};
+	}
+
+	bool has(unsigned id) const{ return field(id)!=0; }
+
+	[[noreturn]] static void throw_corrupt(){
+		throw std::runtime_error("corrupt Arrow IPC metadata");
+	}
+
+  private:
+	std::size_t target(unsigned id) const{
+		std::size_t pos=field(id);
+		if(pos==0){
+			throw_corrupt();
+		}
+		check(pos,4);
+		return pos+static_cast<std::size_t>(load_le(data_+pos,4));
+	}
+
+	void check(std::size_t pos,std::size_t bytes) const{
+		if(pos>size_||bytes>size_-pos){
+			throw_corrupt();
+		}
+	}
+
+	const std::uint8_t*data_;
+	std::size_t size_;
+	std::size_t table_;
+	std::size_t vtable_=0;
+	std::size_t vtable_bytes_=0;
+};
+
+void decompress_buffer(const std::uint8_t*data,std::size_t size,
+					   std::int8_t codec,std::uint8_t*out,
+					   std::size_t out_bytes){
+	if(size<8){
+		throw std::runtime_error("truncated compressed Arrow buffer");
+	}
+	std::int64_t raw=static_cast<std::int64_t>(load_le(data,8));
+	data+=8;
+	size-=8;
+	if(raw==-1){ // stored uncompressed
+		if(size<out_bytes){
+			throw std::runtime_error("truncated Arrow buffer");
+		}
+		std::memcpy(out,data,out_bytes);
+		return;
+	}
+	if(raw!=static_cast<std::int64_t>(out_bytes)){
+		throw std::runtime_error("Arrow buffer length mismatch");
+	}
+	if(codec==kCompressionZstd){
+#if defined(CALCPRIME_HAS_ZSTD)
+		std::size_t written=ZSTD_decompress(out,out_bytes,data,size);
+		if(ZSTD_isError(written)||written!=out_bytes){
+			throw std::runtime_error("zstd decompress error in Arrow buffer");
+		}
+		return;
+#else
+		throw std::runtime_error("zstd not supported in this build");
+#endif
+	}
+#if defined(CALCPRIME_HAS_LZ4)
+	LZ4F_dctx*dctx=nullptr;
+	if(LZ4F_isError(LZ4F_createDecompressionContext(&dctx,LZ4F_VERSION))){
+		throw std::runtime_error("failed to create lz4 context");
+	}
+	std::size_t produced=0;
+	std::size_t consumed=0;
+	std::size_t status=1;
+	while(status!=0&&consumed<size&&produced<out_bytes){
+		std::size_t out_size=out_bytes-produced;
+		std::size_t in_size=size-consumed;
+		status=LZ4F_decompress(dctx,out+produced,&out_size,data+consumed,
+							   &in_size,nullptr);
+		if(LZ4F_isError(status)){
+			LZ4F_freeDecompressionContext(dctx);
+			throw std::runtime_error("lz4 decompress error in Arrow buffer");
+		}
+		produced+=out_size;
+		consumed+=in_size;
+	}
+	LZ4F_freeDecompressionContext(dctx);
+	if(produced!=out_bytes){
+		throw std::runtime_error("truncated lz4 Arrow buffer");
+	}
+#else
+	throw std::runtime_error("lz4 not supported in this build");
+#endif
+}
+
+} // namespace
+
+std::vector<BlockInfo> decode_footer(const std::uint8_t*data,std::size_t size){
+	if(size<kLeadBytes+10U||std::memcmp(data,kMagic,sizeof(kMagic))!=0||
+	   std::memcmp(data+size-sizeof(kMagic),kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not an Arrow IPC file");
+	}
+	std::size_t footer_bytes=static_cast<std::size_t>(
+		load_le(data+size-sizeof(kMagic)-4U,4));
+	if(footer_bytes>size-kLeadBytes-sizeof(kMagic)-4U){
+		throw std::runtime_error("invalid Arrow footer length");
+	}
+	const std::uint8_t*footer=data+size-sizeof(kMagic)-4U-footer_bytes;
+	FlatTable table=FlatTable::root(footer,footer_bytes);
+	std::vector<BlockInfo> blocks;
+	if(!table.has(3)){
+		return blocks;
+	}
+	auto [count,first]=table.vector(3,24);
+	blocks.reserve(count);
+	for(std::size_t i=0;i<count;++i){
+		const std::uint8_t*entry=footer+first+24U*i;
+		BlockInfo block;
+		block.offset=static_cast<std::int64_t>(load_le(entry,8));
+		block.metadata_length=static_cast<std::int32_t>(load_le(entry+8,4));
+		block.body_length=static_cast<std::int64_t>(load_le(entry+16,8));
+		if(block.offset<0||block.metadata_length<8||block.body_length<0||
+		   static_cast<std::uint64_t>(block.offset)+
+				   static_cast<std::uint64_t>(block.metadata_length)+
+				   static_cast<std::uint64_t>(block.body_length)>
+			   size){
+			throw std::runtime_error("Arrow record batch outside the file");
+		}
+		blocks.push_back(block);
+	}
+	return blocks;
+}
+
+void decode_record_batch(const std::uint8_t*data,const BlockInfo&block,
+						 std::vector<std::uint64_t>&out){
+	const std::uint8_t*message=data+block.offset;
+	if(load_le(message,4)!=kContinuation){
+		throw std::runtime_error("missing Arrow message continuation marker");
+	}
+	std::size_t metadata_bytes=static_cast<std::size_t>(load_le(message+4,4));
+	if(metadata_bytes+8U>static_cast<std::size_t>(block.metadata_length)){
+		throw std::runtime_error("invalid Arrow message length");
+	}
+	FlatTable envelope=FlatTable::root(message+8,metadata_bytes);
+	if(envelope.scalar(1,1)!=kMessageHeaderRecordBatch){
+		throw std::runtime_error("Arrow block is not a record batch");
+	}
+	FlatTable batch=envelope.table(2);
+	std::size_t rows=static_cast<std::size_t>(batch.scalar(0,8));
+	auto [buffer_count,buffers]=batch.vector(2,16);
+	if(buffer_count!=2){
+		throw std::runtime_error("expected one uint64 column in Arrow batch");
+	}
+	const std::uint8_t*values=message+8+buffers+16U;
+	std::uint64_t offset=load_le(values,8);
+	std::uint64_t length=load_le(values+8,8);
+	if(offset>static_cast<std::uint64_t>(block.body_length)||
+	   length>static_cast<std::uint64_t>(block.body_length)-offset){
+		throw std::runtime_error("Arrow buffer outside the record batch body");
+	}
+	const std::uint8_t*body=message+block.metadata_length+offset;
+	out.resize(rows);
+	std::size_t bytes=rows*sizeof(std::uint64_t);
+	if(batch.has(3)){
+		std::int8_t codec=static_cast<std::int8_t>(batch.table(3).scalar(0,1));
+		decompress_buffer(body,static_cast<std::size_t>(length),codec,
+						  reinterpret_cast<std::uint8_t*>(out.data()),bytes);
+	}else{
+		if(length<bytes){
+			throw std::runtime_error("truncated Arrow value buffer");
+		}
+		std::memcpy(out.data(),body,bytes);
+	}
+	if constexpr(std::endian::native==std::endian::big){
+		for(std::uint64_t&value : out){
+			value=load_le(reinterpret_cast<const std::uint8_t*>(&value),8);
+		}
+	}
+}
+
+} // namespace calcprime::arrow
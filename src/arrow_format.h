@@ -0,0 +1,72 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+namespace calcprime::arrow{
+
+// Arrow IPC file format (Feather v2) with one non-nullable uint64 column
+// named `prime`:
+//
+//   "ARROW1\0\0"
+//   schema message, record batch messages, end-of-stream marker
+//   footer flatbuffer, i32 footer size, "ARROW1"
+//
+// Messages are encapsulated as 0xFFFFFFFF, i32 metadata size, the Message
+// flatbuffer padded to 8 bytes, then the body.  Flatbuffers are built by
+// hand, the same way parquet_format.cpp writes Thrift, so there is no Arrow
+// or flatc dependency.
+constexpr char kMagic[6]={'A','R','R','O','W','1'};
+constexpr std::size_t kLeadBytes=8;
+
+enum class Codec{
+	None,
+	Lz4Frame,
+	Zstd,
+};
+
+// Written to the schema's custom_metadata as calcprime.from/calcprime.to
+// when the range is known.
+struct SchemaInfo{
+	bool range_known=false;
+	std::uint64_t from=0;
+	std::uint64_t to=0;
+};
+
+// Footer entry for one record batch.
+struct BlockInfo{
+	std::int64_t offset=0;
+	std::int32_t metadata_length=0; // prefix, flatbuffer and padding
+	std::int64_t body_length=0;
+};
+
+std::string make_lead();
+
+std::string encode_schema_message(const SchemaInfo&schema);
+
+// Encapsulated record batch message for `count` values.  With a codec the
+// data buffer is stored as its uncompressed length followed by the
+// compressed bytes; `zstd_cctx` (a ZSTD_CCtx*) is required for Zstd.
+std::string encode_record_batch(const std::uint64_t*values,std::size_t count,
+								Codec codec,void*zstd_cctx);
+
+// Metadata length (as recorded in BlockInfo) of an encapsulated message.
+std::int32_t encapsulated_metadata_length(const std::string&message);
+
+// End-of-stream marker, footer, footer size and trailing magic.
+std::string encode_file_tail(const SchemaInfo&schema,
+							 const std::vector<BlockInfo>&batches);
+
+// Reading side, used by PrimeReader.  decode_footer() takes the whole file
+// and returns its record batches, each checked to lie inside the file.
+std::vector<BlockInfo> decode_footer(const std::uint8_t*data,std::size_t size);
+
+// Decodes the uint64 column of one record batch of the file at `data`, as
+// returned by decode_footer(), into `out`, decompressing
+// ZSTD or LZ4_FRAME buffers when the build supports them.
+void decode_record_batch(const std::uint8_t*data,const BlockInfo&block,
+						 std::vector<std::uint64_t>&out);
+
+} // namespace calcprime::arrow
@@ -1,83 +1,40 @@
 #include "bucket.h"
 
-#include<algorithm>
-#include<iterator>
+#include "sieve_arena.h"
 
-namespace calcprime{
-
-BucketRing::BucketRing() : base_segment_(0),mask_(0){}
+#include<new>
 
-void BucketRing::reset(std::uint64_t start_segment){
-	base_segment_=start_segment;
-	mask_=0;
-	buckets_.clear();
-}
+namespace calcprime{
 
-void BucketRing::ensure_capacity(std::uint64_t segment){
-	if(segment<base_segment_){
-		return;
-	}
-	if(buckets_.empty()){
-		buckets_.resize(1024);
-		mask_=buckets_.size()-1;
-		return;
-	}
-	while((segment-base_segment_)>mask_){
-		rehash(buckets_.size()*2);
-	}
-}
+BucketRing::BucketRing(SieveArena*arena)
+	: arena_(arena),mask_(0),near_begin_(1){}
 
-void BucketRing::rehash(std::size_t new_size){
-	if((new_size&(new_size-1))!=0){
-		// ensure power-of-two sizing for mask arithmetic
-		std::size_t pow2=1;
-		while(pow2<new_size){
-			pow2<<=1;
-		}
-		new_size=pow2;
+void BucketRing::reset(std::size_t slots,std::size_t near_slots){
+	std::size_t size=1;
+	while(size<slots){
+		size<<=1;
 	}
-	std::vector<std::vector<BucketEntry>> new_buckets(new_size);
-	std::size_t new_mask=new_size-1;
-	for(auto&bucket : buckets_){
-		for(auto&entry : bucket){
-			new_buckets[entry.next_index&new_mask].push_back(entry);
-		}
+	free_pages_.clear();
+	for(std::uint32_t i=0;i<pages_.size();++i){
+		free_pages_.push_back(i);
 	}
-	buckets_=std::move(new_buckets);
-	mask_=new_mask;
+	heads_.assign(size+near_slots,kNoPage);
+	mask_=size-1;
+	near_begin_=size;
 }
 
-void BucketRing::push(std::uint64_t segment,BucketEntry entry){
-	ensure_capacity(segment);
-	if(buckets_.empty()){
-		buckets_.resize(1024);
-		mask_=buckets_.size()-1;
-	}
-	buckets_[segment&mask_].push_back(entry);
-}
-
-std::vector<BucketEntry> BucketRing::take(std::uint64_t segment){
-	ensure_capacity(segment);
-	std::vector<BucketEntry> hits;
-	if(buckets_.empty()){
-		return hits;
-	}
-	auto&bucket=buckets_[segment&mask_];
-	auto first_hit=std::partition(bucket.begin(),bucket.end(),
-								  [segment](const BucketEntry&entry){
-									  return entry.next_index!=segment;
-								  });
-
-	if(first_hit!=bucket.end()){
-		hits.reserve(static_cast<std::size_t>(bucket.end()-first_hit));
-		hits.insert(hits.end(),std::make_move_iterator(first_hit),
-					std::make_move_iterator(bucket.end()));
-		bucket.erase(first_hit,bucket.end());
-	}
-	if(segment>=base_segment_){
-		base_segment_=segment+1;
-	}
-	return hits;
+std::uint32_t BucketRing::new_page(std::uint32_t next){
+	std::uint32_t index=0;
+	if(!free_pages_.empty()){
+		index=free_pages_.back();
+		free_pages_.pop_back();
+	}else{
+		index=static_cast<std::uint32_t>(pages_.size());
+		pages_.push_back(new(arena_->allocate(sizeof(Page))) Page);
+	}
+	pages_[index]->count=0;
+	pages_[index]->next=next;
+	return index;
 }
 
 } // namespace calcprime
@@ -0,0 +1,340 @@
+#include "container_format.h"
+#include "gap8_format.h"
+
+#include<array>
+#include<cstring>
+#include<limits>
+#include<stdexcept>
+
+#if defined(__SSE4_2__)
+#include<nmmintrin.h>
+#endif
+
+#if defined(CALCPRIME_HAS_ZSTD)
+#include<zstd.h>
+#endif
+
+namespace calcprime::container{
+
+namespace{
+
+void put_u32(std::uint8_t*out,std::uint32_t value){
+	for(int i=0;i<4;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+void put_u64(std::uint8_t*out,std::uint64_t value){
+	for(int i=0;i<8;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+std::uint32_t get_u32(const std::uint8_t*in){
+	return static_cast<std::uint32_t>(in[0])|
+		   (static_cast<std::uint32_t>(in[1])<<8)|
+		   (static_cast<std::uint32_t>(in[2])<<16)|
+		   (static_cast<std::uint32_t>(in[3])<<24);
+}
+
+std::uint64_t get_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+#if !defined(__SSE4_2__)
+std::array<std::uint32_t,256> make_crc32c_table(){
+	std::array<std::uint32_t,256> table{};
+	for(std::uint32_t i=0;i<256;++i){
+		std::uint32_t crc=i;
+		for(int bit=0;bit<8;++bit){
+			crc=(crc>>1)^((crc&1U)?0x82F63B78U:0U);
+		}
+		table[i]=crc;
+	}
+	return table;
+}
+#endif
+
+std::string encode_payload(const std::uint64_t*values,std::size_t count,
+						   bool gap8,Encoding&encoding){
+	std::string payload;
+	if(gap8){
+		encoding=Encoding::Gap8;
+		gap8::append_block(payload,values,count);
+		return payload;
+	}
+	bool narrow=values[count-1]<=std::numeric_limits<std::uint32_t>::max();
+	encoding=narrow?Encoding::U32:Encoding::U64;
+	std::size_t width=narrow?4U:8U;
+	payload.resize(count*width);
+	auto*out=reinterpret_cast<std::uint8_t*>(payload.data());
+	for(std::size_t i=0;i<count;++i){
+		if(i!=0&&values[i]<=values[i-1]){
+			throw std::runtime_error(
+				"container output requires strictly increasing primes");
+		}
+		if(narrow){
+			put_u32(out+i*4U,static_cast<std::uint32_t>(values[i]));
+		}else{
+			put_u64(out+i*8U,values[i]);
+		}
+	}
+	return payload;
+}
+
+} // namespace
+
+std::uint32_t crc32c(const void*data,std::size_t size,
+					 std::uint32_t crc) noexcept{
+	const auto*bytes=static_cast<const std::uint8_t*>(data);
+	crc=~crc;
+#if defined(__SSE4_2__)
+	std::uint64_t wide=crc;
+	for(;size>=8U;bytes+=8,size-=8U){
+		std::uint64_t word;
+		std::memcpy(&word,bytes,sizeof(word));
+		wide=_mm_crc32_u64(wide,word);
+	}
+	crc=static_cast<std::uint32_t>(wide);
+	for(;size>0U;++bytes,--size){
+		crc=_mm_crc32_u8(crc,*bytes);
+	}
+#else
+	static const std::array<std::uint32_t,256> table=make_crc32c_table();
+	for(;size>0U;++bytes,--size){
+		crc=table[(crc^*bytes)&0xffU]^(crc>>8);
+	}
+#endif
+	return ~crc;
+}
+
+std::string encode_file_header(const FileHeader&header){
+	std::string out(kFileHeaderBytes,'\0');
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	std::memcpy(bytes,kMagic,sizeof(kMagic));
+	bytes[4]=static_cast<std::uint8_t>(kVersion);
+	bytes[5]=static_cast<std::uint8_t>(kVersion>>8);
+	bytes[6]=static_cast<std::uint8_t>(kFileHeaderBytes);
+	bytes[7]=header.flags;
+	put_u64(bytes+8,header.from);
+	put_u64(bytes+16,header.to);
+	put_u32(bytes+24,header.wheel);
+	put_u32(bytes+28,header.block_values);
+	bytes[32]=static_cast<std::uint8_t>(header.compression);
+	return out;
+}
+
+FileHeader decode_file_header(const std::uint8_t*data,std::size_t size){
+	if(size<kFileHeaderBytes||std::memcmp(data,kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not a prime container file");
+	}
+	if((data[4]|(data[5]<<8))!=kVersion||data[6]!=kFileHeaderBytes){
+		throw std::runtime_error("unsupported prime container version");
+	}
+	FileHeader header;
+	header.flags=data[7];
+	header.from=get_u64(data+8);
+	header.to=get_u64(data+16);
+	header.wheel=get_u32(data+24);
+	header.block_values=get_u32(data+28);
+	header.compression=static_cast<Compression>(data[32]);
+	return header;
+}
+
+std::string encode_block(const std::uint64_t*values,std::size_t count,
+						 bool gap8,void*zstd_cctx){
+	if(count==0||count>std::numeric_limits<std::uint32_t>::max()){
+		throw std::invalid_argument("container block size out of range");
+	}
+	BlockHeader header;
+	header.first_prime=values[0];
+	header.count=static_cast<std::uint32_t>(count);
+	std::string payload=encode_payload(values,count,gap8,header.encoding);
+	if(payload.size()>std::numeric_limits<std::uint32_t>::max()){
+		throw std::runtime_error("container block payload exceeds 4 GiB");
+	}
+	header.raw_bytes=static_cast<std::uint32_t>(payload.size());
+
+	std::string out(kBlockHeaderBytes,'\0');
+	if(zstd_cctx){
+#if defined(CALCPRIME_HAS_ZSTD)
+		out.resize(kBlockHeaderBytes+ZSTD_compressBound(payload.size()));
+		std::size_t written=ZSTD_compress2(
+			static_cast<ZSTD_CCtx*>(zstd_cctx),out.data()+kBlockHeaderBytes,
+			out.size()-kBlockHeaderBytes,payload.data(),payload.size());
+		if(ZSTD_isError(written)){
+			throw std::runtime_error(std::string("zstd compress error: ")+
+									 ZSTD_getErrorName(written));
+		}
+		out.resize(kBlockHeaderBytes+written);
+		header.compression=Compression::Zstd;
+#else
+		throw std::runtime_error("zstd not supported in this build");
+#endif
+	}else{
+		out.append(payload);
+	}
+	header.stored_bytes=
+		static_cast<std::uint32_t>(out.size()-kBlockHeaderBytes);
+
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	put_u64(bytes,header.first_prime);
+	put_u32(bytes+8,header.count);
+	bytes[12]=static_cast<std::uint8_t>(header.encoding);
+	bytes[13]=static_cast<std::uint8_t>(header.compression);
+	put_u32(bytes+16,header.stored_bytes);
+	put_u32(bytes+20,header.raw_bytes);
+	std::uint32_t checksum=crc32c(bytes,24);
+	checksum=crc32c(bytes+kBlockHeaderBytes,header.stored_bytes,checksum);
+	put_u32(bytes+24,checksum);
+	return out;
+}
+
+BlockHeader read_block_header(const std::uint8_t*data,std::size_t size){
+	if(size<kBlockHeaderBytes){
+		throw std::runtime_error("truncated container block header");
+	}
+	BlockHeader header;
+	header.first_prime=get_u64(data);
+	header.count=get_u32(data+8);
+	header.encoding=static_cast<Encoding>(data[12]);
+	header.compression=static_cast<Compression>(data[13]);
+	header.stored_bytes=get_u32(data+16);
+	header.raw_bytes=get_u32(data+20);
+	header.checksum=get_u32(data+24);
+	if(size-kBlockHeaderBytes<header.stored_bytes){
+		throw std::runtime_error("truncated container block payload");
+	}
+	return header;
+}
+
+void decode_block(const BlockHeader&header,const std::uint8_t*header_bytes,
+				  const std::uint8_t*payload,std::uint64_t*out){
+	std::uint32_t checksum=crc32c(header_bytes,24);
+	checksum=crc32c(payload,header.stored_bytes,checksum);
+	if(checksum!=header.checksum){
+		throw std::runtime_error("container block checksum mismatch");
+	}
+
+	std::string decompressed;
+	const std::uint8_t*raw=payload;
+	if(header.compression==Compression::Zstd){
+#if defined(CALCPRIME_HAS_ZSTD)
+		decompressed.resize(header.raw_bytes);
+		std::size_t size=ZSTD_decompress(decompressed.data(),header.raw_bytes,
+										 payload,header.stored_bytes);
+		if(ZSTD_isError(size)||size!=header.raw_bytes){
+			throw std::runtime_error("container block failed to decompress");
+		}
+		raw=reinterpret_cast<const std::uint8_t*>(decompressed.data());
+#else
+		throw std::runtime_error("zstd not supported in this build");
+#endif
+	}else if(header.compression!=Compression::None||
+			 header.stored_bytes!=header.raw_bytes){
+		throw std::runtime_error("unsupported container block compression");
+	}
+
+	switch(header.encoding){
+	case Encoding::U64:
+	case Encoding::U32:{
+		std::size_t width=header.encoding==Encoding::U32?4U:8U;
+		if(header.raw_bytes!=static_cast<std::uint64_t>(header.count)*width){
+			throw std::runtime_error("container block size mismatch");
+		}
+		for(std::uint32_t i=0;i<header.count;++i){
+			out[i]=width==4U?get_u32(raw+i*4U):get_u64(raw+i*8U);
+		}
+		break;
+	}
+	case Encoding::Gap8:{
+		gap8::BlockHeader inner=gap8::read_block_header(raw,header.raw_bytes);
+		if(inner.count!=header.count||inner.first_prime!=header.first_prime||
+		   inner.payload_bytes+gap8::kBlockHeaderBytes!=header.raw_bytes){
+			throw std::runtime_error("container gap8 block is inconsistent");
+		}
+		gap8::decode_block(inner,raw+gap8::kBlockHeaderBytes,out);
+		break;
+	}
+	default:
+		throw std::runtime_error("unsupported container block encoding");
+	}
+	if(header.count!=0&&out[0]!=header.first_prime){
+		throw std::runtime_error("container block first prime mismatch");
+	}
+}
+
+void append_index_entry(std::string&out,const IndexEntry&entry){
+	std::uint8_t bytes[kIndexEntryBytes];
+	put_u64(bytes,entry.offset);
+	put_u64(bytes+8,entry.first_prime);
+	put_u32(bytes+16,entry.count);
+	put_u32(bytes+20,entry.block_bytes);
+	out.append(reinterpret_cast<const char*>(bytes),sizeof(bytes));
+}
+
+std::string encode_footer(const Footer&footer){
+	std::string out(kFooterBytes,'\0');
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	put_u64(bytes,footer.index_offset);
+	put_u64(bytes+8,footer.block_count);
+	put_u64(bytes+16,footer.prime_count);
+	put_u32(bytes+24,footer.index_checksum);
+	std::memcpy(bytes+28,kMagic,sizeof(kMagic));
+	return out;
+}
+
+Footer decode_footer(const std::uint8_t*data,std::size_t size){
+	if(size<kFileHeaderBytes+kFooterBytes||
+	   std::memcmp(data+size-sizeof(kMagic),kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("prime container footer is missing");
+	}
+	const std::uint8_t*bytes=data+size-kFooterBytes;
+	Footer footer;
+	footer.index_offset=get_u64(bytes);
+	footer.block_count=get_u64(bytes+8);
+	footer.prime_count=get_u64(bytes+16);
+	footer.index_checksum=get_u32(bytes+24);
+	std::uint64_t index_end=size-kFooterBytes;
+	if(footer.index_offset<kFileHeaderBytes||footer.index_offset>index_end||
+	   (index_end-footer.index_offset)!=footer.block_count*kIndexEntryBytes){
+		throw std::runtime_error("prime container footer is inconsistent");
+	}
+	if(crc32c(data+footer.index_offset,
+			  static_cast<std::size_t>(index_end-footer.index_offset))!=
+	   footer.index_checksum){
+		throw std::runtime_error("prime container index checksum mismatch");
+	}
+	return footer;
+}
+
+std::vector<IndexEntry> decode_index(const std::uint8_t*data,std::size_t size,
+									 const Footer&footer){
+	std::vector<IndexEntry> entries(
+		static_cast<std::size_t>(footer.block_count));
+	const std::uint8_t*bytes=data+footer.index_offset;
+	std::uint64_t total=0;
+	for(IndexEntry&entry : entries){
+		entry.offset=get_u64(bytes);
+		entry.first_prime=get_u64(bytes+8);
+		entry.count=get_u32(bytes+16);
+		entry.block_bytes=get_u32(bytes+20);
+		bytes+=kIndexEntryBytes;
+		if(entry.offset<kFileHeaderBytes||
+		   entry.offset+entry.block_bytes>footer.index_offset||
+		   entry.offset+entry.block_bytes>size){
+			throw std::runtime_error("prime container index entry is invalid");
+		}
+		total+=entry.count;
+	}
+	if(total!=footer.prime_count){
+		throw std::runtime_error("prime container index count mismatch");
+	}
+	return entries;
+}
+
+} // namespace calcprime::container
@@ -0,0 +1,109 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+namespace calcprime::container{
+
+// File layout (all integers little-endian):
+//
+//   header  kFileHeaderBytes, see FileHeader
+//   block*  kBlockHeaderBytes, see BlockHeader, then the stored payload
+//   index   one IndexEntry (kIndexEntryBytes) per block
+//   footer  u64 index offset, u64 block count, u64 prime count,
+//           u32 CRC-32C of the index, "CPBC"                (32 bytes)
+//
+// Every block carries its own first prime, count, encoding and checksum, so
+// any block range can be fetched, verified and decoded without the rest of
+// the file.  The checksum is CRC-32C over the first 24 header bytes followed
+// by the stored payload.
+constexpr char kMagic[4]={'C','P','B','C'};
+constexpr std::uint16_t kVersion=1;
+constexpr std::size_t kFileHeaderBytes=64;
+constexpr std::size_t kBlockHeaderBytes=32;
+constexpr std::size_t kIndexEntryBytes=24;
+constexpr std::size_t kFooterBytes=32;
+constexpr std::uint32_t kDefaultBlockValues=1u<<16;
+
+// Payload encodings.  Width picks U32 for blocks whose values fit in 32 bits
+// and U64 otherwise.
+enum class Encoding : std::uint8_t{
+	U64=0,
+	U32=1,
+	Gap8=2,
+};
+
+enum class Compression : std::uint8_t{
+	None=0,
+	Zstd=1,
+};
+
+constexpr std::uint8_t kFlagRangeKnown=1;
+
+struct FileHeader{
+	std::uint64_t from=0;
+	std::uint64_t to=0;
+	std::uint32_t wheel=0;
+	std::uint32_t block_values=kDefaultBlockValues;
+	Compression compression=Compression::None;
+	std::uint8_t flags=0;
+};
+
+struct BlockHeader{
+	std::uint64_t first_prime=0;
+	std::uint32_t count=0;
+	Encoding encoding=Encoding::U64;
+	Compression compression=Compression::None;
+	std::uint32_t stored_bytes=0;
+	std::uint32_t raw_bytes=0;
+	std::uint32_t checksum=0;
+};
+
+struct IndexEntry{
+	std::uint64_t offset=0;
+	std::uint64_t first_prime=0;
+	std::uint32_t count=0;
+	std::uint32_t block_bytes=0;
+};
+
+struct Footer{
+	std::uint64_t index_offset=0;
+	std::uint64_t block_count=0;
+	std::uint64_t prime_count=0;
+	std::uint32_t index_checksum=0;
+};
+
+std::uint32_t crc32c(const void*data,std::size_t size,
+					 std::uint32_t crc=0) noexcept;
+
+std::string encode_file_header(const FileHeader&header);
+FileHeader decode_file_header(const std::uint8_t*data,std::size_t size);
+
+// Encodes one block (header and payload) for `count` strictly increasing
+// values.  `gap8` selects the gap8 payload instead of the width-adaptive
+// one; `zstd_cctx` (a ZSTD_CCtx*) compresses the payload when non-null.
+std::string encode_block(const std::uint64_t*values,std::size_t count,
+						 bool gap8,void*zstd_cctx);
+
+// Reads the block header at `data`; throws if fewer than kBlockHeaderBytes
+// remain.
+BlockHeader read_block_header(const std::uint8_t*data,std::size_t size);
+
+// Verifies the checksum and decodes the stored payload into `out`, which
+// must hold header.count values.  `header_bytes` are the raw header bytes
+// the checksum covers.  Throws on corruption.
+void decode_block(const BlockHeader&header,const std::uint8_t*header_bytes,
+				  const std::uint8_t*payload,std::uint64_t*out);
+
+void append_index_entry(std::string&out,const IndexEntry&entry);
+std::string encode_footer(const Footer&footer);
+
+// Reads the footer and index at the end of a whole file and checks the
+// index checksum.
+Footer decode_footer(const std::uint8_t*data,std::size_t size);
+std::vector<IndexEntry> decode_index(const std::uint8_t*data,std::size_t size,
+									 const Footer&footer);
+
+} // namespace calcprime::container
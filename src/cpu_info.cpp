@@ -226,6 +226,13 @@ CpuInfo detect_windows_cpu_info(){
 							have_eff_l1=true;
 						}
 					}
+				}else if(cache.Level==3&&cache.Type==CacheUnified){
+					if(!info.l3_bytes||
+					   static_cast<std::size_t>(cache.CacheSize)<info.l3_bytes){
+						info.l3_bytes=static_cast<std::size_t>(cache.CacheSize);
+						info.l3_shared_cpus=static_cast<unsigned>(logical_count);
+						info.l3_per_core_bytes=per_core;
+					}
 				}else if(cache.Level==2&&
 						 (cache.Type==CacheUnified||cache.Type==CacheData)){
 					min_l2=std::min(min_l2,per_core);
@@ -750,6 +757,12 @@ CpuInfo detect_linux_cpu_info(){
 					have_eff_l2=true;
 				}
 				info.l2_total_bytes+=size_bytes;
+			}else if(level==3&&type_lower=="unified"){
+				if(!info.l3_bytes||size_bytes<info.l3_bytes){
+					info.l3_bytes=size_bytes;
+					info.l3_shared_cpus=static_cast<unsigned>(shared_cpus.size());
+					info.l3_per_core_bytes=per_core;
+				}
 			}
 		}
 		closedir(cache_dir);
@@ -0,0 +1,237 @@
+#include "elias_fano_format.h"
+
+#include<bit>
+#include<cstring>
+#include<stdexcept>
+#include<vector>
+
+#if defined(__BMI2__)
+#include<immintrin.h>
+#endif
+
+namespace calcprime::ef{
+
+namespace{
+
+void put_u64(std::string&out,std::uint64_t value){
+	char bytes[8];
+	for(int i=0;i<8;++i){
+		bytes[i]=static_cast<char>(value>>(8*i));
+	}
+	out.append(bytes,sizeof(bytes));
+}
+
+void put_u64(std::uint8_t*out,std::uint64_t value){
+	for(int i=0;i<8;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+std::uint64_t get_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+constexpr std::uint64_t kOnesStep4=0x1111111111111111ULL;
+constexpr std::uint64_t kOnesStep8=0x0101010101010101ULL;
+constexpr std::uint64_t kMsbsStep8=0x80ULL*kOnesStep8;
+constexpr std::uint64_t kIncrStep8=0x8040201008040201ULL;
+
+// Per byte: 1 where x <= y, for bytes holding values below 128.
+constexpr std::uint64_t leq_step8(std::uint64_t x,std::uint64_t y){
+	return ((((y|kMsbsStep8)-(x&~kMsbsStep8))^x^y)&kMsbsStep8)>>7;
+}
+
+// Per byte: 1 where the byte is non-zero.
+constexpr std::uint64_t nonzero_step8(std::uint64_t x){
+	return ((x|((x|kMsbsStep8)-kOnesStep8))&kMsbsStep8)>>7;
+}
+
+} // namespace
+
+std::string make_lead(){
+	std::string out(kMagic,sizeof(kMagic));
+	out.push_back(static_cast<char>(kVersion));
+	out.push_back(static_cast<char>(kVersion>>8));
+	out.append(2,'\0');
+	return out;
+}
+
+unsigned append_block(std::string&out,const std::uint64_t*values,
+					  std::size_t count){
+	if(count==0){
+		throw std::invalid_argument("Elias-Fano block must not be empty");
+	}
+	const std::uint64_t first=values[0];
+	const std::uint64_t universe=values[count-1]-first;
+	unsigned lower_bits=0;
+	if(universe>count){
+		lower_bits=static_cast<unsigned>(std::bit_width(universe/count))-1U;
+	}
+	const std::uint64_t lower_mask=
+		lower_bits==0?0:(~0ULL>>(64U-lower_bits));
+	const std::size_t lower_words=
+		(count*lower_bits+63U)/64U;
+	const std::size_t upper_words=
+		static_cast<std::size_t>(((universe>>lower_bits)+count+63U)/64U);
+	std::vector<std::uint64_t> words(lower_words+upper_words,0);
+	std::uint64_t*lower=words.data();
+	std::uint64_t*upper=words.data()+lower_words;
+
+	std::uint64_t previous=first;
+	for(std::size_t i=0;i<count;++i){
+		std::uint64_t value=values[i];
+		if(i!=0&&value<=previous){
+			throw std::runtime_error(
+				"Elias-Fano output requires strictly increasing primes");
+		}
+		previous=value;
+		std::uint64_t delta=value-first;
+		if(lower_bits!=0){
+			std::uint64_t low=delta&lower_mask;
+			std::size_t bit=i*lower_bits;
+			lower[bit/64U]|=low<<(bit%64U);
+			if(bit%64U+lower_bits>64U){
+				lower[bit/64U+1U]|=low>>(64U-bit%64U);
+			}
+		}
+		std::uint64_t position=(delta>>lower_bits)+i;
+		upper[position/64U]|=1ULL<<(position%64U);
+	}
+
+	for(std::uint64_t word : words){
+		put_u64(out,word);
+	}
+	return lower_bits;
+}
+
+void append_directory_entry(std::string&out,std::uint64_t first,
+							std::uint64_t offset,unsigned lower_bits){
+	if((offset>>56)!=0){
+		throw std::runtime_error("Elias-Fano block offset is too large");
+	}
+	put_u64(out,first);
+	put_u64(out,(offset<<8)|lower_bits);
+}
+
+unsigned bucket_shift_for(std::uint64_t from,std::uint64_t to,
+						  std::uint64_t block_count){
+	std::uint64_t span=to>from?to-from:0;
+	unsigned shift=0;
+	while(shift<63U&&(span>>shift)>block_count){
+		++shift;
+	}
+	return shift;
+}
+
+void append_buckets(std::string&out,const std::uint64_t*firsts,
+					std::uint64_t block_count,std::uint64_t from,
+					std::uint64_t to,unsigned bucket_shift){
+	if(block_count==0){
+		return;
+	}
+	std::uint64_t span=to>from?to-from:0;
+	std::uint64_t buckets=(span>>bucket_shift)+1U;
+	std::uint64_t block=0;
+	for(std::uint64_t j=0;j<buckets;++j){
+		std::uint64_t start=from+(j<<bucket_shift);
+		while(block+1U<block_count&&firsts[block+1U]<=start){
+			++block;
+		}
+		put_u64(out,block);
+	}
+}
+
+std::string encode_footer(const Footer&footer){
+	std::string out(kFooterBytes,'\0');
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	put_u64(bytes,footer.from);
+	put_u64(bytes+8,footer.to);
+	put_u64(bytes+16,footer.count);
+	put_u64(bytes+24,footer.directory_offset);
+	put_u64(bytes+32,footer.block_count);
+	put_u64(bytes+40,footer.bucket_offset);
+	for(int i=0;i<4;++i){
+		bytes[48+i]=static_cast<std::uint8_t>(footer.block_values>>(8*i));
+	}
+	bytes[52]=footer.bucket_shift;
+	bytes[56]=static_cast<std::uint8_t>(kVersion);
+	bytes[57]=static_cast<std::uint8_t>(kVersion>>8);
+	std::memcpy(bytes+60,kMagic,sizeof(kMagic));
+	return out;
+}
+
+Footer decode_footer(const std::uint8_t*data,std::size_t size){
+	if(size<kLeadBytes+kFooterBytes||
+	   std::memcmp(data,kMagic,sizeof(kMagic))!=0||
+	   std::memcmp(data+size-sizeof(kMagic),kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not an Elias-Fano prime file");
+	}
+	const std::uint8_t*bytes=data+size-kFooterBytes;
+	if((data[4]|(data[5]<<8))!=kVersion||(bytes[56]|(bytes[57]<<8))!=kVersion){
+		throw std::runtime_error("unsupported Elias-Fano file version");
+	}
+	Footer footer;
+	footer.from=get_u64(bytes);
+	footer.to=get_u64(bytes+8);
+	footer.count=get_u64(bytes+16);
+	footer.directory_offset=get_u64(bytes+24);
+	footer.block_count=get_u64(bytes+32);
+	footer.bucket_offset=get_u64(bytes+40);
+	footer.block_values=static_cast<std::uint32_t>(bytes[48])|
+						(static_cast<std::uint32_t>(bytes[49])<<8)|
+						(static_cast<std::uint32_t>(bytes[50])<<16)|
+						(static_cast<std::uint32_t>(bytes[51])<<24);
+	footer.bucket_shift=bytes[52];
+
+	if(footer.block_values==0||footer.bucket_shift>63U){
+		throw std::runtime_error("Elias-Fano footer is inconsistent");
+	}
+	std::uint64_t expected_blocks=
+		(footer.count+footer.block_values-1U)/footer.block_values;
+	if(footer.count!=0){
+		footer.bucket_count=
+			((footer.to-footer.from)>>footer.bucket_shift)+1U;
+	}
+	if(footer.to<footer.from||footer.block_count!=expected_blocks||
+	   footer.directory_offset<kLeadBytes||
+	   footer.bucket_offset!=footer.directory_offset+
+								 footer.block_count*kDirectoryEntryBytes||
+	   footer.bucket_offset+footer.bucket_count*8U+kFooterBytes!=size){
+		throw std::runtime_error("Elias-Fano footer is inconsistent");
+	}
+	return footer;
+}
+
+unsigned select_in_word(std::uint64_t word,unsigned k) noexcept{
+#if defined(__BMI2__)
+	return static_cast<unsigned>(
+		std::countr_zero(_pdep_u64(1ULL<<k,word)));
+#else
+	// Byte-wise popcounts, then prefix sums in every byte.
+	std::uint64_t byte_sums=word-((word&(0xaULL*kOnesStep4))>>1);
+	byte_sums=(byte_sums&(3ULL*kOnesStep4))+
+			  ((byte_sums>>2)&(3ULL*kOnesStep4));
+	byte_sums=(byte_sums+(byte_sums>>4))&(0x0fULL*kOnesStep8);
+	byte_sums*=kOnesStep8;
+	// Count the bytes whose prefix sum is still <= k to find the byte that
+	// holds the bit, then repeat inside that byte.
+	const std::uint64_t k_step8=static_cast<std::uint64_t>(k)*kOnesStep8;
+	const unsigned place=static_cast<unsigned>(
+		((leq_step8(byte_sums,k_step8)*kOnesStep8)>>53)&~0x7ULL);
+	const unsigned byte_rank=
+		k-static_cast<unsigned>(((byte_sums<<8)>>place)&0xffU);
+	const std::uint64_t spread=
+		(((word>>place)&0xffU)*kOnesStep8)&kIncrStep8;
+	const std::uint64_t bit_sums=nonzero_step8(spread)*kOnesStep8;
+	const std::uint64_t rank_step8=
+		static_cast<std::uint64_t>(byte_rank)*kOnesStep8;
+	return place+static_cast<unsigned>(
+					 (leq_step8(bit_sums,rank_step8)*kOnesStep8)>>56);
+#endif
+}
+
+} // namespace calcprime::ef
@@ -0,0 +1,72 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace calcprime::ef{
+
+// File layout (all integers little-endian, every section 8-byte aligned):
+//
+//   lead       "CPEF", u16 version, u16 zero
+//   blocks     Elias-Fano blocks of `block_values` primes (the last block
+//              may be shorter); each holds the lower bits of value-first as
+//              u64 words followed by the unary-coded upper bits
+//   directory  per block: u64 first value, u64 (byte offset << 8 | lower bit
+//              width)
+//   buckets    global upper-bits directory: entry j is the last block whose
+//              first value is <= from + (j << bucket_shift)
+//   footer     kFooterBytes, see Footer, ending in "CPEF"
+//
+// Blocks are independent, so the writer encodes them on worker threads and a
+// reader reaches any block through the directory without touching the
+// others.
+constexpr char kMagic[4]={'C','P','E','F'};
+constexpr std::uint16_t kVersion=1;
+constexpr std::size_t kLeadBytes=8;
+constexpr std::size_t kFooterBytes=64;
+constexpr std::size_t kDirectoryEntryBytes=16;
+constexpr std::uint32_t kDefaultBlockValues=4096;
+
+struct Footer{
+	std::uint64_t from=0;
+	std::uint64_t to=0;
+	std::uint64_t count=0;
+	std::uint64_t directory_offset=0;
+	std::uint64_t block_count=0;
+	std::uint64_t bucket_offset=0;
+	std::uint64_t bucket_count=0;
+	std::uint32_t block_values=kDefaultBlockValues;
+	std::uint8_t bucket_shift=0;
+};
+
+std::string make_lead();
+
+// Appends one block encoding `count` strictly increasing values and returns
+// its lower bit width.
+unsigned append_block(std::string&out,const std::uint64_t*values,
+					  std::size_t count);
+
+void append_directory_entry(std::string&out,std::uint64_t first,
+							std::uint64_t offset,unsigned lower_bits);
+
+// Smallest shift that leaves at most one bucket per block for [from, to).
+unsigned bucket_shift_for(std::uint64_t from,std::uint64_t to,
+						  std::uint64_t block_count);
+
+// Appends the bucket table for blocks whose first values are `firsts`.
+void append_buckets(std::string&out,const std::uint64_t*firsts,
+					std::uint64_t block_count,std::uint64_t from,
+					std::uint64_t to,unsigned bucket_shift);
+
+std::string encode_footer(const Footer&footer);
+
+// Throws if the data does not end in a consistent footer for `size` bytes.
+Footer decode_footer(const std::uint8_t*data,std::size_t size);
+
+// Position of the k-th (0-based) set bit of `word`; k must be below
+// popcount(word).  Broadword (SWAR) implementation after Vigna, "Broadword
+// implementation of rank/select queries".
+unsigned select_in_word(std::uint64_t word,unsigned k) noexcept;
+
+} // namespace calcprime::ef
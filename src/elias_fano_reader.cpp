@@ -0,0 +1,229 @@
+#include "elias_fano_reader.h"
+#include "elias_fano_format.h"
+#include "popcnt.h"
+
+#include<algorithm>
+#include<bit>
+#include<cstring>
+#include<stdexcept>
+
+namespace calcprime{
+
+namespace{
+
+std::uint64_t get_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+// Block words are 8-byte aligned in the file, so on little-endian hosts they
+// are read in place.
+inline std::uint64_t load_word(const std::uint64_t*words,std::uint64_t i){
+#if defined(__BYTE_ORDER__)&&(__BYTE_ORDER__==__ORDER_BIG_ENDIAN__)
+	return __builtin_bswap64(words[i]);
+#else
+	return words[i];
+#endif
+}
+
+// Position of the k-th (0-based) set bit, scanning whole words first.
+std::uint64_t select_one(const std::uint64_t*words,std::uint64_t k){
+	for(std::uint64_t w=0;;++w){
+		std::uint64_t word=load_word(words,w);
+		std::uint64_t ones=popcount_u64(word);
+		if(k<ones){
+			return w*64U+ef::select_in_word(word,static_cast<unsigned>(k));
+		}
+		k-=ones;
+	}
+}
+
+} // namespace
+
+EliasFanoReader::EliasFanoReader(const std::string&path) : file_(path){
+	ef::Footer footer=ef::decode_footer(file_.data(),file_.size());
+	from_=footer.from;
+	to_=footer.to;
+	count_=footer.count;
+	block_values_=footer.block_values;
+	block_count_=footer.block_count;
+	bucket_count_=footer.bucket_count;
+	bucket_shift_=footer.bucket_shift;
+	directory_=file_.data()+footer.directory_offset;
+	buckets_=file_.data()+footer.bucket_offset;
+}
+
+std::uint64_t EliasFanoReader::block_first(std::uint64_t index) const{
+	return get_u64(directory_+index*ef::kDirectoryEntryBytes);
+}
+
+EliasFanoReader::Block EliasFanoReader::block(std::uint64_t index) const{
+	const std::uint8_t*entry=directory_+index*ef::kDirectoryEntryBytes;
+	std::uint64_t packed=get_u64(entry+8);
+	Block result;
+	result.first=get_u64(entry);
+	result.lower_bits=static_cast<unsigned>(packed&0xffU);
+	result.count=(index+1U<block_count_)?block_values_
+										   :count_-index*block_values_;
+	std::uint64_t offset=packed>>8;
+	std::uint64_t lower_words=(result.count*result.lower_bits+63U)/64U;
+	result.lower=reinterpret_cast<const std::uint64_t*>(file_.data()+offset);
+	result.upper=result.lower+lower_words;
+	std::uint64_t end=(index+1U<block_count_)
+						  ?(get_u64(entry+ef::kDirectoryEntryBytes+8)>>8)
+						  :static_cast<std::uint64_t>(directory_-file_.data());
+	result.upper_words=(end-offset)/8U-lower_words;
+	return result;
+}
+
+std::uint64_t EliasFanoReader::lower_value(const Block&block,std::uint64_t i){
+	if(block.lower_bits==0){
+		return 0;
+	}
+	std::uint64_t bit=i*block.lower_bits;
+	std::uint64_t shift=bit%64U;
+	std::uint64_t value=load_word(block.lower,bit/64U)>>shift;
+	if(shift+block.lower_bits>64U){
+		value|=load_word(block.lower,bit/64U+1U)<<(64U-shift);
+	}
+	return value&(~0ULL>>(64U-block.lower_bits));
+}
+
+std::uint64_t EliasFanoReader::select(std::uint64_t k) const{
+	if(k>=count_){
+		throw std::out_of_range("Elias-Fano select index out of range");
+	}
+	Block b=block(k/block_values_);
+	std::uint64_t i=k%block_values_;
+	std::uint64_t high=select_one(b.upper,i)-i;
+	return b.first+((high<<b.lower_bits)|lower_value(b,i));
+}
+
+std::uint64_t EliasFanoReader::rank(std::uint64_t x) const{
+	if(count_==0||x<=block_first(0)){
+		return 0;
+	}
+	// The bucket narrows the directory search to the blocks whose first
+	// values share x's upper bits.
+	std::uint64_t lo=0;
+	std::uint64_t hi=block_count_-1U;
+	if(x>=from_){
+		std::uint64_t j=std::min((x-from_)>>bucket_shift_,bucket_count_-1U);
+		lo=get_u64(buckets_+j*8U);
+		if(j+1U<bucket_count_){
+			hi=get_u64(buckets_+(j+1U)*8U);
+		}
+		if(lo!=0&&block_first(lo)>=x){
+			--lo;
+		}
+	}
+	// Last block whose first value is below x.
+	while(lo<hi){
+		std::uint64_t mid=lo+(hi-lo+1U)/2U;
+		if(block_first(mid)<x){
+			lo=mid;
+		}else{
+			hi=mid-1U;
+		}
+	}
+	Block b=block(lo);
+	std::uint64_t before=lo*block_values_;
+	std::uint64_t delta=x-b.first;
+	std::uint64_t high=delta>>b.lower_bits;
+	std::uint64_t low=b.lower_bits==0?0:
+									 delta&(~0ULL>>(64U-b.lower_bits));
+
+	// Elements with a smaller upper part end at the high-th zero.
+	std::uint64_t i=0;
+	std::uint64_t position=0;
+	if(high!=0){
+		std::uint64_t zeros=high-1U;
+		std::uint64_t w=0;
+		for(;w<b.upper_words;++w){
+			std::uint64_t word=~load_word(b.upper,w);
+			std::uint64_t count=popcount_u64(word);
+			if(zeros<count){
+				position=w*64U+
+						 ef::select_in_word(word,static_cast<unsigned>(zeros))+1U;
+				break;
+			}
+			zeros-=count;
+		}
+		if(w==b.upper_words){
+			return before+b.count;
+		}
+		i=position-high;
+	}
+	// Then elements sharing x's upper part with smaller lower bits.
+	while(i<b.count&&
+		  ((load_word(b.upper,position/64U)>>(position%64U))&1U)!=0&&
+		  lower_value(b,i)<low){
+		++i;
+		++position;
+	}
+	return before+i;
+}
+
+EliasFanoReader::const_iterator EliasFanoReader::begin() const{
+	return const_iterator(this,0);
+}
+
+EliasFanoReader::const_iterator EliasFanoReader::end() const{
+	return const_iterator(this,count_);
+}
+
+EliasFanoReader::const_iterator EliasFanoReader::iterator_at(
+	std::uint64_t k) const{
+	return const_iterator(this,std::min(k,count_));
+}
+
+EliasFanoReader::const_iterator::const_iterator(const EliasFanoReader*reader,
+												std::uint64_t index)
+	: reader_(reader),index_(index){
+	if(index_<reader_->count_){
+		load_block(index_/reader_->block_values_,
+				   index_%reader_->block_values_);
+	}
+}
+
+void EliasFanoReader::const_iterator::load_block(std::uint64_t block,
+												 std::uint64_t offset){
+	block_=reader_->block(block);
+	block_index_=block;
+	in_block_=offset;
+	std::uint64_t position=select_one(block_.upper,offset);
+	word_index_=position/64U;
+	word_=load_word(block_.upper,word_index_)&(~0ULL<<(position%64U));
+	decode();
+}
+
+void EliasFanoReader::const_iterator::decode(){
+	std::uint64_t position=word_index_*64U+
+						   static_cast<std::uint64_t>(std::countr_zero(word_));
+	value_=block_.first+(((position-in_block_)<<block_.lower_bits)|
+						 EliasFanoReader::lower_value(block_,in_block_));
+}
+
+EliasFanoReader::const_iterator&
+EliasFanoReader::const_iterator::operator++(){
+	++index_;
+	if(index_>=reader_->count_){
+		index_=reader_->count_;
+		return *this;
+	}
+	if(++in_block_==block_.count){
+		load_block(block_index_+1U,0);
+		return *this;
+	}
+	word_&=word_-1U;
+	while(word_==0){
+		word_=load_word(block_.upper,++word_index_);
+	}
+	decode();
+	return *this;
+}
+
+} // namespace calcprime
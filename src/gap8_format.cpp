@@ -0,0 +1,218 @@
+#include "gap8_format.h"
+
+#include<cstring>
+#include<limits>
+#include<stdexcept>
+
+#if defined(__AVX2__)
+#include<immintrin.h>
+#endif
+
+namespace calcprime::gap8{
+
+namespace{
+
+void put_u16(std::uint8_t*out,std::uint16_t value){
+	out[0]=static_cast<std::uint8_t>(value);
+	out[1]=static_cast<std::uint8_t>(value>>8);
+}
+
+void put_u32(std::uint8_t*out,std::uint32_t value){
+	for(int i=0;i<4;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+void put_u64(std::uint8_t*out,std::uint64_t value){
+	for(int i=0;i<8;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+std::uint32_t get_u32(const std::uint8_t*in){
+	std::uint32_t value=0;
+	for(int i=3;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+std::uint64_t get_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+// Decodes one code starting at payload[pos]; advances pos.
+std::uint64_t read_gap(const std::uint8_t*payload,std::size_t size,
+					   std::size_t&pos){
+	if(pos>=size){
+		throw std::runtime_error("gap8 block payload is truncated");
+	}
+	std::uint8_t code=payload[pos++];
+	if(code!=kEscape){
+		return static_cast<std::uint64_t>(code)*2U;
+	}
+	std::uint64_t gap=0;
+	for(unsigned shift=0;;shift+=7){
+		if(pos>=size||shift>=64){
+			throw std::runtime_error("gap8 escape varint is malformed");
+		}
+		std::uint8_t byte=payload[pos++];
+		gap|=static_cast<std::uint64_t>(byte&0x7fU)<<shift;
+		if((byte&0x80U)==0){
+			break;
+		}
+	}
+	if(gap==0){
+		throw std::runtime_error("gap8 escape encodes a zero gap");
+	}
+	return gap;
+}
+
+void finish_block(const BlockHeader&header,std::size_t pos){
+	if(pos!=header.payload_bytes){
+		throw std::runtime_error("gap8 block payload has trailing bytes");
+	}
+}
+
+} // namespace
+
+std::string make_file_header(std::uint32_t restart_interval){
+	std::string out(kFileHeaderBytes,'\0');
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	std::memcpy(bytes,kMagic,sizeof(kMagic));
+	bytes[4]=kVersion;
+	bytes[5]=kEscape;
+	put_u16(bytes+6,0);
+	put_u32(bytes+8,restart_interval);
+	put_u32(bytes+12,0);
+	return out;
+}
+
+std::uint32_t parse_file_header(const std::uint8_t*data,std::size_t size){
+	if(size<kFileHeaderBytes||std::memcmp(data,kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not a gap8 file");
+	}
+	if(data[4]!=kVersion||data[5]!=kEscape){
+		throw std::runtime_error("unsupported gap8 version");
+	}
+	return get_u32(data+8);
+}
+
+void append_block(std::string&out,const std::uint64_t*values,
+				  std::size_t count){
+	if(count==0){
+		return;
+	}
+	if(count>std::numeric_limits<std::uint32_t>::max()){
+		throw std::invalid_argument("gap8 block holds too many primes");
+	}
+	std::size_t header_offset=out.size();
+	// One byte per gap is the common case; escapes grow the string.
+	out.reserve(out.size()+kBlockHeaderBytes+count+16U);
+	out.resize(header_offset+kBlockHeaderBytes);
+	for(std::size_t i=1;i<count;++i){
+		if(values[i]<=values[i-1]){
+			throw std::runtime_error(
+				"Primes must be strictly increasing for gap8 encoding");
+		}
+		std::uint64_t gap=values[i]-values[i-1];
+		if((gap&1U)==0&&gap<=510U){
+			out.push_back(static_cast<char>(gap/2U));
+			continue;
+		}
+		out.push_back(static_cast<char>(kEscape));
+		while(gap>=0x80U){
+			out.push_back(static_cast<char>((gap&0x7fU)|0x80U));
+			gap>>=7U;
+		}
+		out.push_back(static_cast<char>(gap));
+	}
+	std::size_t payload_bytes=out.size()-header_offset-kBlockHeaderBytes;
+	if(payload_bytes>std::numeric_limits<std::uint32_t>::max()){
+		throw std::runtime_error("gap8 block payload exceeds 4 GiB");
+	}
+	auto*header=reinterpret_cast<std::uint8_t*>(out.data()+header_offset);
+	put_u64(header,values[0]);
+	put_u32(header+8,static_cast<std::uint32_t>(count));
+	put_u32(header+12,static_cast<std::uint32_t>(payload_bytes));
+}
+
+BlockHeader read_block_header(const std::uint8_t*data,std::size_t size){
+	if(size<kBlockHeaderBytes){
+		throw std::runtime_error("gap8 block header is truncated");
+	}
+	BlockHeader header;
+	header.first_prime=get_u64(data);
+	header.count=get_u32(data+8);
+	header.payload_bytes=get_u32(data+12);
+	if(header.count==0){
+		throw std::runtime_error("gap8 block is empty");
+	}
+	return header;
+}
+
+void decode_block_scalar(const BlockHeader&header,const std::uint8_t*payload,
+						 std::uint64_t*out){
+	std::uint64_t current=header.first_prime;
+	out[0]=current;
+	std::size_t pos=0;
+	for(std::uint32_t i=1;i<header.count;++i){
+		current+=read_gap(payload,header.payload_bytes,pos);
+		out[i]=current;
+	}
+	finish_block(header,pos);
+}
+
+void decode_block(const BlockHeader&header,const std::uint8_t*payload,
+				  std::uint64_t*out){
+#if defined(__AVX2__)
+	std::uint64_t current=header.first_prime;
+	out[0]=current;
+	std::size_t pos=0;
+	std::size_t size=header.payload_bytes;
+	std::uint32_t i=1;
+	const __m256i zero=_mm256_setzero_si256();
+	while(i<header.count){
+		// Sixteen plain codes at a time: widen to u64, double, and add an
+		// in-register inclusive prefix sum on top of the running prime.
+		if(header.count-i>=16U&&size-pos>=16U){
+			__m128i codes=_mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(payload+pos));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(codes,_mm_setzero_si128()))==
+			   0){
+				__m256i base=_mm256_set1_epi64x(static_cast<long long>(current));
+				for(int group=0;group<4;++group){
+					__m256i gaps=_mm256_slli_epi64(_mm256_cvtepu8_epi64(codes),1);
+					codes=_mm_srli_si128(codes,4);
+					__m256i shifted=_mm256_blend_epi32(
+						_mm256_permute4x64_epi64(gaps,_MM_SHUFFLE(2,1,0,0)),zero,
+						0x03);
+					gaps=_mm256_add_epi64(gaps,shifted);
+					shifted=_mm256_blend_epi32(
+						_mm256_permute4x64_epi64(gaps,_MM_SHUFFLE(1,0,0,0)),zero,
+						0x0f);
+					gaps=_mm256_add_epi64(gaps,shifted);
+					__m256i primes=_mm256_add_epi64(gaps,base);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out+i),primes);
+					base=_mm256_permute4x64_epi64(primes,_MM_SHUFFLE(3,3,3,3));
+					i+=4;
+				}
+				current=out[i-1];
+				pos+=16;
+				continue;
+			}
+		}
+		current+=read_gap(payload,size,pos);
+		out[i++]=current;
+	}
+	finish_block(header,pos);
+#else
+	decode_block_scalar(header,payload,out);
+#endif
+}
+
+} // namespace calcprime::gap8
@@ -0,0 +1,57 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace calcprime::gap8{
+
+// File layout (all integers little-endian):
+//
+//   header   "CPG8", u8 version, u8 escape, u16 reserved,
+//            u32 restart interval, u32 reserved               (16 bytes)
+//   block*   u64 first prime, u32 prime count, u32 payload bytes,
+//            then one code per gap after the first prime
+//
+// A gap g is stored as the byte g/2 when g is even and g/2 fits in 1..255.
+// Any other gap (the odd 2->3 step or gaps above 510) is the escape byte
+// followed by g as a LEB128 varint.  Every block restarts from an absolute
+// prime, so blocks decode independently.
+constexpr char kMagic[4]={'C','P','G','8'};
+constexpr std::uint8_t kVersion=1;
+constexpr std::uint8_t kEscape=0;
+constexpr std::size_t kFileHeaderBytes=16;
+constexpr std::size_t kBlockHeaderBytes=16;
+constexpr std::uint32_t kDefaultRestartInterval=1u<<16;
+
+struct BlockHeader{
+	std::uint64_t first_prime=0;
+	std::uint32_t count=0;
+	std::uint32_t payload_bytes=0;
+};
+
+std::string make_file_header(std::uint32_t restart_interval);
+
+// Returns the restart interval; throws if the header is not a gap8 header.
+std::uint32_t parse_file_header(const std::uint8_t*data,std::size_t size);
+
+// Appends one block (header and payload) for `count` strictly increasing
+// values.
+void append_block(std::string&out,const std::uint64_t*values,
+				  std::size_t count);
+
+// Reads the block header at `data`; throws if fewer than kBlockHeaderBytes
+// remain.
+BlockHeader read_block_header(const std::uint8_t*data,std::size_t size);
+
+// Decodes the payload of one block into `out`, which must hold header.count
+// values.  Runs of ordinary gap bytes are expanded with an AVX2 prefix sum
+// when available.  Throws on malformed payloads.
+void decode_block(const BlockHeader&header,const std::uint8_t*payload,
+				  std::uint64_t*out);
+
+// Portable decoder with the same contract, kept for verification.
+void decode_block_scalar(const BlockHeader&header,const std::uint8_t*payload,
+						 std::uint64_t*out);
+
+} // namespace calcprime::gap8
@@ -3,7 +3,12 @@
 #include "marker.h"
 #include "popcnt.h"
 #include "prime_count.h"
+#include "prime_extract.h"
+#include "prime_reader.h"
+#include "segment_window.h"
 #include "segmenter.h"
+#include "sieve_arena.h"
+#include "uring_file.h"
 #include "wheel_bitmap_count.h"
 #include "wheel.h"
 #include "writer.h"
@@ -20,8 +25,10 @@
 #include<cstddef>
 #include<cstdint>
 #include<exception>
+#include<filesystem>
 #include<fstream>
 #include<cstdio>
+#include<deque>
 #include<iomanip>
 #include<iostream>
 #include<limits>
@@ -45,6 +52,13 @@
 
 namespace calcprime{
 
+// An additional --out sink with its own format.
+struct OutputSpec{
+	std::string path;
+	PrimeOutputFormat format=PrimeOutputFormat::Text;
+	bool use_zstd=false;
+};
+
 struct Options{
 	std::uint64_t from=0;
 	std::uint64_t to=0;
@@ -60,9 +74,15 @@ struct Options{
 	std::string output_index_path;
 	PrimeOutputFormat output_format=PrimeOutputFormat::Text;
 	bool use_zstd=false;
+	bool use_lz4=false;
 	ParquetEncoding parquet_encoding=ParquetEncoding::Plain;
 	std::size_t parquet_delta_block_values=128;
 	bool parquet_delta_block_values_set=false;
+	std::size_t parquet_row_group_bytes=kDefaultParquetRowGroupBytes;
+	bool parquet_row_group_bytes_set=false;
+	unsigned encode_threads=0;
+	ContainerEncoding container_encoding=ContainerEncoding::Width;
+	bool container_encoding_set=false;
 	std::uint64_t output_group_count=0;
 	std::uint64_t output_group_primes=0;
 	std::uint64_t output_group_range=0;
@@ -72,11 +92,39 @@ struct Options{
 	bool show_stats=false;
 	bool use_ml=false;
 	bool use_wheel_bitmap=false;
+	bool huge_pages=false;
 	bool self_test=false;
 	bool help=false;
 	std::optional<std::uint64_t> test_value;
+	std::string decode_path;
+	std::string decode_format;
+	std::string verify_path;
+	std::string extend_path;
+	std::optional<std::uint64_t> extend_after;
+	bool output_format_set=false;
+	// Sinks after the first --out, which stays in output_path,
+	// output_format and use_zstd.
+	std::vector<OutputSpec> extra_outputs;
+	std::string unordered_dir;
+	FileIoOptions io_options;
 };
 
+// Writer settings for the first --out; callers adjust the format and codecs
+// for further sinks and set extend_after or synchronous where they apply.
+PrimeWriterOptions make_writer_options(const Options&opts){
+	PrimeWriterOptions options;
+	options.format=opts.output_format;
+	options.use_zstd=opts.use_zstd;
+	options.use_lz4=opts.use_lz4;
+	options.parquet_encoding=opts.parquet_encoding;
+	options.parquet_delta_block_values=opts.parquet_delta_block_values;
+	options.parquet_row_group_bytes=opts.parquet_row_group_bytes;
+	options.encode_threads=opts.encode_threads;
+	options.container_encoding=opts.container_encoding;
+	options.io=opts.io_options;
+	return options;
+}
+
 std::uint64_t parse_u64(const std::string&value){
 	if(value.empty()){
 		throw std::invalid_argument("invalid integer: "+value);
@@ -193,41 +241,56 @@ std::size_t parse_size(const std::string&value){
 	return static_cast<std::size_t>(result);
 }
 
-static void extract_segment_primes(const std::vector<std::uint64_t>&bitset,
-								   std::uint64_t seg_low,
-								   std::size_t bit_count,
-								   std::vector<std::uint64_t>&primes){
-	std::size_t remaining=bit_count;
-	for(std::size_t word=0;word<bitset.size()&&remaining>0;++word){
-		std::uint64_t valid_mask=std::numeric_limits<std::uint64_t>::max();
-		if(remaining<64){
-			valid_mask=(1ULL<<remaining)-1ULL;
-		}
-		std::uint64_t prime_bits=(~bitset[word])&valid_mask;
-		while(prime_bits){
-			unsigned bit=std::countr_zero(prime_bits);
-			std::uint64_t index=(static_cast<std::uint64_t>(word)<<6)+
-								static_cast<std::uint64_t>(bit);
-			primes.push_back(seg_low+(index<<1));
-			prime_bits&=(prime_bits-1);
-		}
-		if(remaining>=64){
-			remaining-=64;
-		}else{
-			remaining=0;
-		}
-	}
+const char*output_format_name(PrimeOutputFormat format){
+	switch(format){
+	case PrimeOutputFormat::Text:
+		return "text";
+	case PrimeOutputFormat::Binary:
+		return "binary";
+	case PrimeOutputFormat::Delta16:
+		return "delta16";
+	case PrimeOutputFormat::Parquet:
+		return "parquet";
+	case PrimeOutputFormat::Gap8:
+		return "gap8";
+	case PrimeOutputFormat::Wheel30:
+		return "wheel30";
+	case PrimeOutputFormat::EliasFano:
+		return "ef";
+	case PrimeOutputFormat::Container:
+		return "container";
+	case PrimeOutputFormat::Arrow:
+		return "arrow";
+	}
+	return "unknown";
 }
 
-void parse_output_format(Options&opts,const std::string&fmt){
+std::optional<PrimeOutputFormat> output_format_by_name(const std::string&fmt){
 	if(fmt=="text"){
-		opts.output_format=PrimeOutputFormat::Text;
+		return PrimeOutputFormat::Text;
 	}else if(fmt=="binary"){
-		opts.output_format=PrimeOutputFormat::Binary;
+		return PrimeOutputFormat::Binary;
 	}else if(fmt=="delta16"){
-		opts.output_format=PrimeOutputFormat::Delta16;
+		return PrimeOutputFormat::Delta16;
 	}else if(fmt=="parquet"){
-		opts.output_format=PrimeOutputFormat::Parquet;
+		return PrimeOutputFormat::Parquet;
+	}else if(fmt=="gap8"){
+		return PrimeOutputFormat::Gap8;
+	}else if(fmt=="wheel30"){
+		return PrimeOutputFormat::Wheel30;
+	}else if(fmt=="ef"){
+		return PrimeOutputFormat::EliasFano;
+	}else if(fmt=="container"){
+		return PrimeOutputFormat::Container;
+	}else if(fmt=="arrow"||fmt=="feather"){
+		return PrimeOutputFormat::Arrow;
+	}
+	return std::nullopt;
+}
+
+void parse_output_format(Options&opts,const std::string&fmt){
+	if(std::optional<PrimeOutputFormat> format=output_format_by_name(fmt)){
+		opts.output_format=*format;
 	}else if(fmt=="zstd"||fmt=="zstd+delta"){
 		opts.output_format=PrimeOutputFormat::Delta16;
 		opts.use_zstd=true;
@@ -240,6 +303,42 @@ void parse_output_format(Options&opts,const std::string&fmt){
 	}
 }
 
+// --out PATH[:FORMAT[:zstd]].  The suffix is only split off when it names
+// a format, so paths containing ':' (C:\...) still work.
+struct OutputArgument{
+	std::string path;
+	std::optional<PrimeOutputFormat> format;
+	bool use_zstd=false;
+};
+
+OutputArgument parse_output_argument(const std::string&value){
+	OutputArgument out;
+	out.path=value;
+	std::string rest=value;
+	bool zstd=false;
+	std::size_t colon=rest.rfind(':');
+	if(colon!=std::string::npos&&rest.compare(colon+1,std::string::npos,
+											  "zstd")==0){
+		rest.erase(colon);
+		zstd=true;
+		colon=rest.rfind(':');
+	}
+	if(colon!=std::string::npos&&colon!=0){
+		if(std::optional<PrimeOutputFormat> format=
+			   output_format_by_name(rest.substr(colon+1))){
+			out.path=rest.substr(0,colon);
+			out.format=format;
+			out.use_zstd=zstd;
+			return out;
+		}
+	}
+	if(zstd){
+		throw std::invalid_argument("--out "+value+
+									": ':zstd' must follow a format");
+	}
+	return out;
+}
+
 void parse_parquet_encoding(Options&opts,const std::string&encoding){
 	if(encoding=="plain"){
 		opts.parquet_encoding=ParquetEncoding::Plain;
@@ -251,8 +350,21 @@ void parse_parquet_encoding(Options&opts,const std::string&encoding){
 	}
 }
 
+void parse_container_encoding(Options&opts,const std::string&encoding){
+	if(encoding=="width"){
+		opts.container_encoding=ContainerEncoding::Width;
+	}else if(encoding=="gap8"){
+		opts.container_encoding=ContainerEncoding::Gap8;
+	}else{
+		throw std::invalid_argument("unsupported container encoding: "+
+									encoding);
+	}
+	opts.container_encoding_set=true;
+}
+
 Options parse_options(int argc,char**argv){
 	Options opts;
+	std::vector<OutputArgument> outputs;
 	for(int i=1;i<argc;++i){
 		std::string arg=argv[i];
 		static const std::string out_format_prefix="--out-format=";
@@ -352,7 +464,12 @@ Options parse_options(int argc,char**argv){
 			if(i+1>=argc){
 				throw std::invalid_argument("--out requires a path");
 			}
-			opts.output_path=argv[++i];
+			outputs.push_back(parse_output_argument(argv[++i]));
+		}else if(arg=="--out-unordered"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--out-unordered requires a directory");
+			}
+			opts.unordered_dir=argv[++i];
 		}else if(arg=="--out-index"){
 			if(i+1>=argc){
 				throw std::invalid_argument("--out-index requires a path");
@@ -380,8 +497,51 @@ Options parse_options(int argc,char**argv){
 				throw std::invalid_argument("--out-format requires a value");
 			}
 			parse_output_format(opts,argv[++i]);
+			opts.output_format_set=true;
 		}else if(arg=="--zstd"){
 			opts.use_zstd=true;
+		}else if(arg=="--lz4"){
+			opts.use_lz4=true;
+		}else if(arg=="--io-backend"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--io-backend requires a value");
+			}
+			std::string value=argv[++i];
+			if(value=="stdio"){
+				opts.io_options.backend=FileIoBackend::Stdio;
+			}else if(value=="uring"||value=="io_uring"){
+				opts.io_options.backend=FileIoBackend::IoUring;
+			}else{
+				throw std::invalid_argument("unknown --io-backend: "+value);
+			}
+		}else if(arg=="--direct"){
+			opts.io_options.direct=true;
+		}else if(arg=="--io-depth"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--io-depth requires a value");
+			}
+			std::uint64_t value=parse_u64(argv[++i]);
+			if(value==0||value>UringFile::kMaxQueueDepth){
+				throw std::invalid_argument(
+					"--io-depth must be between 1 and "+
+					std::to_string(UringFile::kMaxQueueDepth));
+			}
+			opts.io_options.queue_depth=static_cast<unsigned>(value);
+		}else if(arg=="--shm-timeout"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--shm-timeout requires a value");
+			}
+			std::uint64_t value=parse_u64(argv[++i]);
+			if(value>std::numeric_limits<unsigned>::max()){
+				throw std::invalid_argument("--shm-timeout is too large");
+			}
+			opts.io_options.shm_timeout_ms=static_cast<unsigned>(value);
+		}else if(arg=="--container-encoding"){
+			if(i+1>=argc){
+				throw std::invalid_argument(
+					"--container-encoding requires a value");
+			}
+			parse_container_encoding(opts,argv[++i]);
 		}else if(arg=="--parquet-encoding"){
 			if(i+1>=argc){
 				throw std::invalid_argument(
@@ -400,6 +560,22 @@ Options parse_options(int argc,char**argv){
 			}
 			opts.parquet_delta_block_values=static_cast<std::size_t>(value);
 			opts.parquet_delta_block_values_set=true;
+		}else if(arg=="--parquet-row-group-bytes"){
+			if(i+1>=argc){
+				throw std::invalid_argument(
+					"--parquet-row-group-bytes requires a value");
+			}
+			opts.parquet_row_group_bytes=parse_size(argv[++i]);
+			opts.parquet_row_group_bytes_set=true;
+		}else if(arg=="--encode-threads"||arg=="--parquet-threads"){
+			if(i+1>=argc){
+				throw std::invalid_argument(arg+" requires a value");
+			}
+			std::uint64_t value=parse_u64(argv[++i]);
+			if(value>std::numeric_limits<unsigned>::max()){
+				throw std::invalid_argument(arg+" is too large");
+			}
+			opts.encode_threads=static_cast<unsigned>(value);
 		}else if(arg=="--progress"){
 			opts.show_progress=true;
 		}else if(arg=="--time"){
@@ -410,6 +586,8 @@ Options parse_options(int argc,char**argv){
 			opts.use_ml=true;
 		}else if(arg=="--wheel-bitmap"){
 			opts.use_wheel_bitmap=true;
+		}else if(arg=="--hugepages"){
+			opts.huge_pages=true;
 		}else if(arg=="--stest"){
 			opts.self_test=true;
 		}else if(arg=="--test"){
@@ -417,13 +595,69 @@ Options parse_options(int argc,char**argv){
 				throw std::invalid_argument("--test requires a value");
 			}
 			opts.test_value=parse_u64(argv[++i]);
+		}else if(arg=="--decode"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--decode requires a file");
+			}
+			opts.decode_path=argv[++i];
+		}else if(arg=="--verify"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--verify requires a file");
+			}
+			opts.verify_path=argv[++i];
+		}else if(arg=="--extend"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--extend requires a file");
+			}
+			opts.extend_path=argv[++i];
+		}else if(arg=="--in-format"){
+			if(i+1>=argc){
+				throw std::invalid_argument("--in-format requires a value");
+			}
+			opts.decode_format=argv[++i];
 		}else{
 			throw std::invalid_argument("unknown option: "+arg);
 		}
 	}
+	// Sinks without a suffix use --out-format and --zstd.
+	for(std::size_t i=0;i<outputs.size();++i){
+		OutputSpec spec;
+		spec.path=outputs[i].path;
+		spec.format=outputs[i].format.value_or(opts.output_format);
+		spec.use_zstd=outputs[i].format?outputs[i].use_zstd:opts.use_zstd;
+		for(std::size_t j=0;j<i;++j){
+			if(outputs[j].path==spec.path){
+				throw std::invalid_argument("--out "+spec.path+
+											" is given twice");
+			}
+		}
+		if(i==0){
+			opts.output_path=spec.path;
+			opts.output_format=spec.format;
+			opts.use_zstd=spec.use_zstd;
+		}else{
+			opts.extra_outputs.push_back(std::move(spec));
+		}
+	}
 	return opts;
 }
 
+// Every sink of the run, the primary --out (or stdout) first.
+std::vector<OutputSpec> output_sinks(const Options&opts){
+	std::vector<OutputSpec> sinks;
+	sinks.push_back({opts.output_path,opts.output_format,opts.use_zstd});
+	sinks.insert(sinks.end(),opts.extra_outputs.begin(),
+				 opts.extra_outputs.end());
+	return sinks;
+}
+
+bool has_output_format(const std::vector<OutputSpec>&sinks,
+					   PrimeOutputFormat format){
+	return std::any_of(sinks.begin(),sinks.end(),[&](const OutputSpec&sink){
+		return sink.format==format;
+	});
+}
+
 void print_usage(){
 	std::cout
 		<<"prime-sieve --from A --to B [options]\n"
@@ -437,17 +671,42 @@ void print_usage(){
 		<<"  --wheel 30|210|1155 Select wheel factorisation (default 30)\n"
 		<<"  --segment BYTES     Override segment size\n"
 		<<"  --tile BYTES        Override tile size\n"
+		<<"  --hugepages         Back segment bitsets and bucket pages with 2 MiB\n"
+		<<"                       pages where available (Linux)\n"
 		<<"  --out PATH          Write primes to file\n"
+		<<"  --out PATH:FMT[:zstd]  Add an output sink with its own format;\n"
+		<<"                       repeat to write several formats in one pass\n"
+		<<"  --out shm:NAME      Stream binary primes into a shared-memory ring\n"
+		<<"                       for calcprime_shm_reader consumers (Linux)\n"
+		<<"  --shm-timeout MS    Fail a shm: export once no consumer has released\n"
+		<<"                       a block for MS ms (default "
+		<<FileIoOptions{}.shm_timeout_ms<<", 0 waits forever)\n"
+		<<"  --out-unordered DIR Write one shard per worker plus manifest.tsv\n"
 		<<"  --out-index PATH    Write grouped-export index file path\n"
 		<<"  --out-groups N      Split export into N range groups\n"
 		<<"  --out-group-primes X  Split export by X primes per group\n"
 		<<"  --out-group-range Y  Split export by Y natural numbers per group\n"
-		<<"  --out-format FMT    Output: text (default), binary, delta16, parquet\n"
+		<<"  --out-format FMT    Output: text (default), binary, delta16, gap8,\n"
+		<<"                       wheel30, ef, container, arrow, parquet\n"
 		<<"                    Deprecated aliases: zstd, zstd+delta\n"
 		<<"  --zstd              Use zstd (Parquet pages or whole output stream)\n"
+		<<"  --lz4               Compress Arrow buffers with LZ4 frames\n"
+		<<"  --io-backend B      File output: stdio (default) or uring (Linux\n"
+		<<"                       io_uring; falls back to stdio if unavailable)\n"
+		<<"  --io-depth N        io_uring writes in flight per file (default "
+		<<UringFile::kDefaultQueueDepth<<", max "<<UringFile::kMaxQueueDepth
+		<<")\n"
+		<<"  --direct            Open io_uring outputs with O_DIRECT\n"
+		<<"  --container-encoding E  Container blocks: width (u32/u64, default)\n"
+		<<"                       or gap8\n"
 		<<"  --parquet-encoding E  Parquet values: plain (default) or delta\n"
 		<<"  --parquet-delta-block-values N\n"
 		<<"                       Delta values per block; multiple of 128\n"
+		<<"  --parquet-row-group-bytes BYTES\n"
+		<<"                       Target compressed row group size (default 128M)\n"
+		<<"  --encode-threads N   Encode threads for Parquet, Elias-Fano, container\n"
+		<<"                       and Arrow (default: auto, max 8; alias\n"
+		<<"                       --parquet-threads)\n"
 		<<"  --progress          Show segment progress and ETA on stderr\n"
 		<<"  --time              Print elapsed time\n"
 		<<"  --stats             Print configuration statistics\n"
@@ -455,15 +714,19 @@ void print_usage(){
 		<<"  --wheel-bitmap      Force wheel-compressed count path\n"
 		<<"                       (auto-enabled for large wheel=30 counts)\n"
 		<<"  --stest             Run built-in benchmark (1e6..1e11, 10 runs)\n"
-		<<"  --test N           Run a Miller-Rabin primality check for N\n";
+		<<"  --test N           Run a Miller-Rabin primality check for N\n"
+		<<"  --decode FILE       Count the primes of an exported file, or re-export\n"
+		<<"                       them with --print [--out PATH --out-format FMT];\n"
+		<<"                       --from/--to select a sub-range\n"
+		<<"  --verify FILE       Re-sieve [--from, --to) and check that FILE holds\n"
+		<<"                       exactly those primes\n"
+		<<"  --extend FILE       Append the primes in [last prime of FILE, --to) to\n"
+		<<"                       FILE (text, binary, delta16, parquet) or to the\n"
+		<<"                       grouped export whose index TSV is FILE\n"
+		<<"  --in-format FMT     Format of the --decode/--verify/--extend file\n"
+		<<"                       (default: detected)\n";
 }
 
-struct SegmentResult{
-	std::uint64_t count=0;
-	std::vector<std::uint64_t> primes;
-	std::atomic<bool> ready{false};
-};
-
 std::string trim_copy(const std::string&value){
 	std::size_t first=0;
 	while(first<value.size()&&
@@ -565,6 +828,36 @@ WorkerSievePlans build_worker_sieve_plans(const CpuInfo&info,
 	return plans;
 }
 
+// The largest per-thread sieve state and the tables all threads share.
+// Per-thread sieve memory, filled in by each worker when it finishes.
+struct ThreadSieveStats{
+	std::size_t state_bytes=0;
+	ArenaPages pages=ArenaPages::Normal;
+};
+
+ThreadSieveStats thread_sieve_stats(const PrimeMarker&marker,
+									const PrimeMarker::ThreadState&state){
+	return ThreadSieveStats{marker.thread_state_bytes(state),
+							state.arena->pages()};
+}
+
+void print_sieve_state_stats(const PrimeMarker&marker,
+							 const std::vector<ThreadSieveStats>&threads){
+	std::size_t peak=0;
+	ArenaPages pages=ArenaPages::HugeTlb;
+	for(const ThreadSieveStats&thread : threads){
+		peak=std::max(peak,thread.state_bytes);
+		if(static_cast<int>(thread.pages)<static_cast<int>(pages)){
+			pages=thread.pages;
+		}
+	}
+	std::cout<<"Sieve state: "<<peak<<" bytes per thread (max), "
+			 <<marker.shared_bytes()<<" bytes shared\n";
+	if(marker.config().huge_pages){
+		std::cout<<"Huge pages: "<<arena_pages_name(pages)<<"\n";
+	}
+}
+
 void print_schedule_stats(const CpuInfo&info,unsigned threads,
 						  CoreSchedulingMode core_schedule,
 						  const SegmentConfig&base_config,
@@ -592,7 +885,21 @@ void print_schedule_stats(const CpuInfo&info,unsigned threads,
 		std::cout<<"Effective segment bytes (P/E): "<<perf_effective<<'/'
 				 <<eff_effective<<"\n";
 	}
+	if(base_config.super_segment_segments>1){
+		std::cout<<"Super-segment: "<<base_config.super_segment_segments
+				 <<" segments ("
+				 <<saturating_mul_u64(
+						static_cast<std::uint64_t>(base_config.segment_bytes),
+						base_config.super_segment_segments)
+				 <<" bytes)\n";
+	}else{
+		std::cout<<"Super-segment: off\n";
+	}
 	std::cout<<"L1d: "<<info.l1_data_bytes<<"  L2: "<<info.l2_bytes<<"\n";
+	if(info.l3_bytes){
+		std::cout<<"L3: "<<info.l3_bytes<<" shared by "<<info.l3_shared_cpus
+				 <<" CPUs ("<<info.l3_per_core_bytes<<" per core)\n";
+	}
 	if(info.has_hybrid){
 		std::cout<<"L1d (P/E): "<<info.performance_l1_data_bytes<<'/'
 				 <<info.efficiency_l1_data_bytes<<"\n";
@@ -601,6 +908,47 @@ void print_schedule_stats(const CpuInfo&info,unsigned threads,
 	}
 }
 
+// `elapsed_us` covers the whole run, so the rate is what the output kept up
+// with rather than raw device speed.
+void print_io_stats(const FileIoStats&stats,std::int64_t elapsed_us){
+	std::ostringstream oss;
+	oss<<std::fixed<<std::setprecision(1);
+	if(stats.backend==FileIoBackend::IoUring){
+		oss<<"io_uring (depth "<<stats.queue_depth
+		   <<(stats.direct?", O_DIRECT":"")<<")";
+	}else if(stats.backend==FileIoBackend::Pipe){
+		oss<<"write into pipe";
+	}else if(stats.backend==FileIoBackend::SharedMemory){
+		oss<<"shared memory ring";
+	}else{
+		oss<<"stdio";
+	}
+	oss<<", "<<static_cast<double>(stats.bytes)/(1024.0*1024.0)<<" MiB";
+	if(elapsed_us>0){
+		oss<<" at "
+		   <<static_cast<double>(stats.bytes)/static_cast<double>(elapsed_us)
+		   <<" MB/s";
+	}
+	if(stats.backend==FileIoBackend::IoUring){
+		oss<<", queue "<<stats.queue_utilization()*100.0<<"% busy over "
+		   <<stats.submissions<<" writes";
+	}
+	if(stats.backend==FileIoBackend::SharedMemory){
+		oss<<", "<<stats.submissions<<" blocks, ring full "<<stats.waits
+		   <<" times";
+	}
+	if(stats.backend==FileIoBackend::Pipe){
+		oss<<", "<<stats.submissions<<" writes";
+	}
+	std::cout<<"Output I/O: "<<oss.str()<<"\n";
+}
+
+std::int64_t microseconds_since(std::chrono::steady_clock::time_point start){
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			   std::chrono::steady_clock::now()-start)
+		.count();
+}
+
 std::string format_hms(double seconds){
 	if(!std::isfinite(seconds)||seconds<0.0){
 		return "--:--:--";
@@ -732,10 +1080,26 @@ enum class OutputGroupingMode{
 	ByNaturalRange,
 };
 
+// One row of a grouped export's index TSV.
+struct GroupIndexRecord{
+	std::uint64_t id=0;
+	std::string file_path;
+	std::uint64_t range_begin=0;
+	std::uint64_t range_end=0;
+	std::uint64_t prime_count=0;
+	std::uint64_t first_prime=0;
+	std::uint64_t last_prime=0;
+	bool has_prime=false;
+};
+
 struct OutputGroupingConfig{
 	OutputGroupingMode mode=OutputGroupingMode::None;
 	std::uint64_t value=0;
 	std::string index_path;
+	// --extend: groups already listed in the index, kept ahead of the new
+	// ones, and the zero-padded width of their file ids.
+	std::vector<GroupIndexRecord> existing_records;
+	std::size_t id_width=0;
 };
 
 constexpr std::uint64_t kMaxGroupedExportFiles=1000000ULL;
@@ -758,6 +1122,69 @@ std::string sanitize_tsv_field(std::string value){
 	return value;
 }
 
+// File extension of a shard written by --out-unordered.
+std::string output_format_extension(PrimeOutputFormat format,bool use_zstd){
+	std::string extension;
+	switch(format){
+	case PrimeOutputFormat::Text:
+		extension="txt";
+		break;
+	case PrimeOutputFormat::Binary:
+		extension="bin";
+		break;
+	default:
+		extension=output_format_name(format);
+		break;
+	}
+	if(use_zstd&&format!=PrimeOutputFormat::Parquet&&
+	   format!=PrimeOutputFormat::Container&&
+	   format!=PrimeOutputFormat::Arrow){
+		extension+=".zst";
+	}
+	return extension;
+}
+
+// One run of consecutive segments that a worker sieved into its shard.
+// Rows sorted by segment_begin list the primes in global order.
+struct ShardChunkRecord{
+	std::size_t shard=0;
+	std::uint64_t segment_begin=0;
+	std::uint64_t segment_end=0;
+	std::uint64_t range_begin=0;
+	std::uint64_t range_end=0;
+	std::uint64_t shard_offset=0;
+	std::uint64_t prime_count=0;
+	std::uint64_t first_prime=0;
+	std::uint64_t last_prime=0;
+};
+
+void write_shard_manifest(const std::string&path,
+						  const std::vector<std::string>&shard_paths,
+						  const std::vector<ShardChunkRecord>&records){
+	std::ofstream manifest(path,std::ios::out|std::ios::trunc);
+	if(!manifest){
+		throw std::runtime_error("failed to open manifest file: "+path);
+	}
+	manifest<<"shard_id\tfile_path\tsegment_begin\tsegment_end\tchunk_from\t"
+			<<"chunk_to\tshard_offset\tprime_count\tfirst_prime\tlast_prime\n";
+	for(const ShardChunkRecord&record : records){
+		manifest<<record.shard<<'\t'
+				<<sanitize_tsv_field(shard_paths[record.shard])<<'\t'
+				<<record.segment_begin<<'\t'<<record.segment_end<<'\t'
+				<<record.range_begin<<'\t'<<record.range_end<<'\t'
+				<<record.shard_offset<<'\t'<<record.prime_count<<'\t';
+		if(record.prime_count!=0){
+			manifest<<record.first_prime<<'\t'<<record.last_prime;
+		}else{
+			manifest<<"-\t-";
+		}
+		manifest<<'\n';
+	}
+	if(!manifest){
+		throw std::runtime_error("failed to write manifest file: "+path);
+	}
+}
+
 struct OutputPathParts{
 	std::string directory;
 	std::string stem;
@@ -801,18 +1228,15 @@ std::uint64_t add_clamped_u64(std::uint64_t value,std::uint64_t delta,
 class GroupedPrimeExporter{
   public:
 	GroupedPrimeExporter(const std::string&base_output_path,
-						 PrimeOutputFormat output_format,bool use_zstd,
-						 ParquetEncoding parquet_encoding,
-						 std::size_t parquet_delta_block_values,
+						 const PrimeWriterOptions&writer_options,
+						 std::uint32_t wheel_modulus,
 						 std::uint64_t range_from,std::uint64_t range_to,
 						 const OutputGroupingConfig&config)
 		: base_output_path_(base_output_path),
 		  index_path_(config.index_path.empty()
 						  ?(base_output_path+".index.tsv")
 						  :config.index_path),
-		  output_format_(output_format),use_zstd_(use_zstd),
-		  parquet_encoding_(parquet_encoding),
-		  parquet_delta_block_values_(parquet_delta_block_values),
+		  writer_options_(writer_options),wheel_modulus_(wheel_modulus),
 		  range_from_(range_from),range_to_(range_to),mode_(config.mode){
 		if(base_output_path_.empty()){
 			throw std::invalid_argument("grouped export requires --out PATH");
@@ -823,6 +1247,11 @@ class GroupedPrimeExporter{
 		if(range_to_<=range_from_){
 			throw std::invalid_argument("invalid grouped export range");
 		}
+		if(mode_==OutputGroupingMode::ByPrimeCount&&
+		   writer_options_.format==PrimeOutputFormat::Wheel30){
+			throw std::invalid_argument(
+				"wheel30 output needs range groups, not --out-group-primes");
+		}
 		path_parts_=split_output_path(base_output_path_);
 
 		switch(mode_){
@@ -871,6 +1300,11 @@ class GroupedPrimeExporter{
 			(mode_==OutputGroupingMode::ByPrimeCount)
 				?6
 				:std::max<std::size_t>(4,decimal_width_u64(total_groups_));
+		if(config.id_width!=0){
+			index_width_=config.id_width;
+		}
+		records_=config.existing_records;
+		max_active_groups_=std::max(2u,std::thread::hardware_concurrency());
 		if(mode_!=OutputGroupingMode::ByPrimeCount){
 			next_group_begin_=range_from_;
 			open_next_range_group();
@@ -883,12 +1317,17 @@ class GroupedPrimeExporter{
 		}catch(...){
 			// avoid exceptions escaping destructor
 		}
+		join_lanes();
 	}
 
-	void write_segment(const std::vector<std::uint64_t>&primes){
+	// Splits `primes` at group boundaries and queues each slice on its
+	// group's writer; only blocks once kMaxQueuedValues are pending or
+	// every group writer slot is busy.
+	void write_segment(std::vector<std::uint64_t> primes){
 		if(finished_||primes.empty()){
 			return;
 		}
+		rethrow_lane_error();
 		switch(mode_){
 		case OutputGroupingMode::ByPrimeCount:
 			write_by_prime_count(primes);
@@ -906,11 +1345,13 @@ class GroupedPrimeExporter{
 		if(finished_){
 			return;
 		}
-		if(current_writer_){
-			current_writer_->flush();
+		if(current_lane_){
+			push_entry(*current_lane_,{},true);
 		}
 	}
 
+	// Closes the remaining groups, waits for every group writer and then
+	// writes the index in group order.
 	void finish(){
 		if(finished_){
 			return;
@@ -923,30 +1364,50 @@ class GroupedPrimeExporter{
 				close_current_group();
 			}
 		}
+		join_lanes();
+		rethrow_lane_error();
 
 		write_index_file();
 		finished_=true;
 	}
 
-  private:
-	struct GroupIndexRecord{
-		std::uint64_t id=0;
-		std::string file_path;
-		std::uint64_t range_begin=0;
-		std::uint64_t range_end=0;
-		std::uint64_t prime_count=0;
-		std::uint64_t first_prime=0;
-		std::uint64_t last_prime=0;
-		bool has_prime=false;
-	};
+	// Most group writers that were running at the same time.
+	std::size_t peak_active_groups() const{ return peak_active_groups_; }
+	// Summed over the group files written so far.
+	FileIoStats io_stats(){
+		std::lock_guard<std::mutex> lock(lane_mutex_);
+		return io_stats_;
+	}
+	BufferPoolStats buffer_stats(){
+		std::lock_guard<std::mutex> lock(lane_mutex_);
+		return buffer_stats_;
+	}
 
+  private:
 	static constexpr std::size_t kNoCurrentGroup=
 		std::numeric_limits<std::size_t>::max();
+	// Primes queued across all group writers before write_segment() waits.
+	static constexpr std::size_t kMaxQueuedValues=std::size_t{1}<<25;
 
-	void write_by_prime_count(const std::vector<std::uint64_t>&primes){
+	struct LaneEntry{
+		std::vector<std::uint64_t> primes;
+		bool flush=false;
+	};
+
+	// One open group: its writer, fed in order by a thread of its own
+	// until the group is closed.
+	struct GroupLane{
+		std::unique_ptr<PrimeWriter> writer;
+		std::deque<LaneEntry> queue;
+		bool closing=false;
+		bool done=false;
+		std::thread thread;
+	};
+
+	void write_by_prime_count(std::vector<std::uint64_t>&primes){
 		std::size_t offset=0;
 		while(offset<primes.size()){
-			if(!current_writer_){
+			if(!current_lane_){
 				open_group(0,0);
 			}
 			std::size_t remain=primes.size()-offset;
@@ -963,7 +1424,7 @@ class GroupedPrimeExporter{
 		}
 	}
 
-	void write_by_range(const std::vector<std::uint64_t>&primes){
+	void write_by_range(std::vector<std::uint64_t>&primes){
 		std::size_t offset=0;
 		while(offset<primes.size()){
 			ensure_range_group_for_value(primes[offset]);
@@ -979,7 +1440,7 @@ class GroupedPrimeExporter{
 
 	void ensure_range_group_for_value(std::uint64_t value){
 		while(true){
-			if(!current_writer_){
+			if(!current_lane_){
 				if(groups_created_>=total_groups_){
 					throw std::runtime_error(
 						"group export range exhausted unexpectedly");
@@ -1030,9 +1491,23 @@ class GroupedPrimeExporter{
 	void open_group(std::uint64_t group_begin,std::uint64_t group_end){
 		std::uint64_t id=static_cast<std::uint64_t>(records_.size())+1ULL;
 		std::string file_path=build_group_file_path(id);
-		current_writer_=std::make_unique<PrimeWriter>(
-			true,file_path,output_format_,use_zstd_,parquet_encoding_,
-			parquet_delta_block_values_);
+		wait_for_lane_slot();
+		auto lane=std::make_unique<GroupLane>();
+		lane->writer=
+			std::make_unique<PrimeWriter>(true,file_path,writer_options_);
+		lane->writer->set_wheel(wheel_modulus_);
+		if(mode_!=OutputGroupingMode::ByPrimeCount){
+			lane->writer->set_range(group_begin,group_end);
+		}
+		GroupLane&started=*lane;
+		{
+			std::lock_guard<std::mutex> lock(lane_mutex_);
+			lanes_.push_back(std::move(lane));
+			++active_groups_;
+			peak_active_groups_=std::max(peak_active_groups_,active_groups_);
+		}
+		started.thread=std::thread([this,&started](){ run_lane(started); });
+		current_lane_=&started;
 		GroupIndexRecord record;
 		record.id=id;
 		record.file_path=file_path;
@@ -1045,30 +1520,25 @@ class GroupedPrimeExporter{
 		}
 	}
 
+	// The lane flushes and finishes the writer once its queue is drained.
 	void close_current_group(){
-		if(!current_writer_){
+		if(!current_lane_){
 			return;
 		}
-		current_writer_->flush();
-		current_writer_->finish();
-		current_writer_.reset();
+		{
+			std::lock_guard<std::mutex> lock(lane_mutex_);
+			current_lane_->closing=true;
+		}
+		lane_data_cv_.notify_all();
+		current_lane_=nullptr;
 		current_group_index_=kNoCurrentGroup;
 	}
 
-	void write_slice_to_current(const std::vector<std::uint64_t>&primes,
+	void write_slice_to_current(std::vector<std::uint64_t>&primes,
 								std::size_t offset,std::size_t count){
-		if(count==0||!current_writer_||current_group_index_==kNoCurrentGroup){
+		if(count==0||!current_lane_||current_group_index_==kNoCurrentGroup){
 			return;
 		}
-		if(offset==0&&count==primes.size()){
-			current_writer_->write_segment(primes);
-		}else{
-			scratch_.assign(primes.begin()+
-								static_cast<std::ptrdiff_t>(offset),
-							primes.begin()+static_cast<std::ptrdiff_t>(offset+
-															   count));
-			current_writer_->write_segment(scratch_);
-		}
 
 		GroupIndexRecord&record=records_[current_group_index_];
 		std::uint64_t first=primes[offset];
@@ -1087,6 +1557,123 @@ class GroupedPrimeExporter{
 					?std::numeric_limits<std::uint64_t>::max()
 					:(record.last_prime+1ULL);
 		}
+
+		if(offset==0&&count==primes.size()){
+			push_entry(*current_lane_,std::move(primes),false);
+		}else{
+			push_entry(*current_lane_,
+					   std::vector<std::uint64_t>(
+						   primes.begin()+static_cast<std::ptrdiff_t>(offset),
+						   primes.begin()+
+							   static_cast<std::ptrdiff_t>(offset+count)),
+					   false);
+		}
+	}
+
+	void push_entry(GroupLane&lane,std::vector<std::uint64_t> primes,
+					bool flush){
+		std::unique_lock<std::mutex> lock(lane_mutex_);
+		lane_space_cv_.wait(lock,[&]{
+			return lane_error_||queued_values_<kMaxQueuedValues;
+		});
+		if(lane_error_){
+			std::rethrow_exception(lane_error_);
+		}
+		queued_values_+=primes.size();
+		lane.queue.push_back({std::move(primes),flush});
+		lock.unlock();
+		lane_data_cv_.notify_all();
+	}
+
+	void run_lane(GroupLane&lane){
+		try{
+			for(;;){
+				LaneEntry entry;
+				{
+					std::unique_lock<std::mutex> lock(lane_mutex_);
+					lane_data_cv_.wait(lock,[&]{
+						return !lane.queue.empty()||lane.closing||lane_error_;
+					});
+					if(lane_error_){
+						break;
+					}
+					if(lane.queue.empty()){
+						lock.unlock();
+						lane.writer->flush();
+						lane.writer->finish();
+						std::lock_guard<std::mutex> stats_lock(lane_mutex_);
+						io_stats_+=lane.writer->io_stats();
+						buffer_stats_+=lane.writer->buffer_stats();
+						break;
+					}
+					entry=std::move(lane.queue.front());
+					lane.queue.pop_front();
+					queued_values_-=entry.primes.size();
+				}
+				lane_space_cv_.notify_all();
+				if(entry.flush){
+					lane.writer->flush();
+				}else{
+					lane.writer->write_segment(entry.primes);
+				}
+			}
+		}catch(...){
+			std::lock_guard<std::mutex> lock(lane_mutex_);
+			if(!lane_error_){
+				lane_error_=std::current_exception();
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(lane_mutex_);
+			for(const LaneEntry&entry : lane.queue){
+				queued_values_-=entry.primes.size();
+			}
+			lane.queue.clear();
+			lane.done=true;
+			--active_groups_;
+		}
+		lane_space_cv_.notify_all();
+		lane_data_cv_.notify_all();
+	}
+
+	// Blocks while max_active_groups_ group writers are still running and
+	// joins the ones that have finished.
+	void wait_for_lane_slot(){
+		{
+			std::unique_lock<std::mutex> lock(lane_mutex_);
+			lane_space_cv_.wait(lock,[&]{
+				return lane_error_||active_groups_<max_active_groups_;
+			});
+		}
+		rethrow_lane_error();
+		auto finished=std::remove_if(
+			lanes_.begin(),lanes_.end(),[&](std::unique_ptr<GroupLane>&lane){
+				{
+					std::lock_guard<std::mutex> lock(lane_mutex_);
+					if(!lane->done){
+						return false;
+					}
+				}
+				lane->thread.join();
+				return true;
+			});
+		lanes_.erase(finished,lanes_.end());
+	}
+
+	void join_lanes(){
+		close_current_group();
+		for(auto&lane : lanes_){
+			if(lane->thread.joinable()){
+				lane->thread.join();
+			}
+		}
+	}
+
+	void rethrow_lane_error(){
+		std::lock_guard<std::mutex> lock(lane_mutex_);
+		if(lane_error_){
+			std::rethrow_exception(lane_error_);
+		}
 	}
 
 	std::string build_group_file_path(std::uint64_t id) const{
@@ -1132,13 +1719,13 @@ class GroupedPrimeExporter{
 	std::string base_output_path_;
 	std::string index_path_;
 	OutputPathParts path_parts_;
-	PrimeOutputFormat output_format_=PrimeOutputFormat::Text;
-	bool use_zstd_=false;
-	ParquetEncoding parquet_encoding_=ParquetEncoding::Plain;
-	std::size_t parquet_delta_block_values_=128;
+	PrimeWriterOptions writer_options_;
+	std::uint32_t wheel_modulus_=0;
 	std::uint64_t range_from_=0;
 	std::uint64_t range_to_=0;
 	OutputGroupingMode mode_=OutputGroupingMode::None;
+	FileIoStats io_stats_;
+	BufferPoolStats buffer_stats_;
 
 	std::uint64_t total_groups_=0;
 	std::uint64_t groups_created_=0;
@@ -1151,10 +1738,189 @@ class GroupedPrimeExporter{
 	std::size_t index_width_=6;
 	bool finished_=false;
 
-	std::unique_ptr<PrimeWriter> current_writer_;
 	std::vector<GroupIndexRecord> records_;
 	std::size_t current_group_index_=kNoCurrentGroup;
-	std::vector<std::uint64_t> scratch_;
+
+	std::vector<std::unique_ptr<GroupLane>> lanes_;
+	GroupLane*current_lane_=nullptr;
+	std::mutex lane_mutex_;
+	std::condition_variable lane_data_cv_;
+	std::condition_variable lane_space_cv_;
+	std::size_t queued_values_=0;
+	std::size_t active_groups_=0;
+	std::size_t max_active_groups_=2;
+	std::size_t peak_active_groups_=0;
+	std::exception_ptr lane_error_;
+};
+
+// Feeds the primes of one sieve pass to several PrimeWriters (repeated
+// --out).  Every sink has its own feeder thread and a bounded queue of
+// shared, read-only segments, so a slow encoder only delays the others
+// once its queue is full; write_segment() then blocks the sieve's feeder
+// like a single writer would.
+class PrimeSinkFanout{
+  public:
+	static constexpr std::size_t kQueueSegments=8;
+
+	explicit PrimeSinkFanout(std::vector<std::unique_ptr<PrimeWriter>> writers)
+		: sinks_(writers.size()){
+		for(std::size_t i=0;i<sinks_.size();++i){
+			sinks_[i].writer=std::move(writers[i]);
+		}
+		for(std::size_t i=0;i<sinks_.size();++i){
+			sinks_[i].thread=std::thread([this,i](){ run_sink(i); });
+		}
+	}
+
+	~PrimeSinkFanout(){
+		stop_threads();
+	}
+
+	PrimeSinkFanout(const PrimeSinkFanout&)=delete;
+	PrimeSinkFanout&operator=(const PrimeSinkFanout&)=delete;
+
+	std::size_t size() const{ return sinks_.size(); }
+
+	void write_segment(std::vector<std::uint64_t> primes){
+		if(primes.empty()){
+			return;
+		}
+		push(std::make_shared<const std::vector<std::uint64_t>>(
+			std::move(primes)));
+	}
+
+	// Queues a flush marker; each sink flushes its writer when it gets there.
+	void flush(){
+		push(nullptr);
+	}
+
+	// Drains the queues and finishes every writer; rethrows the first error
+	// of any sink.
+	void finish(){
+		stop_threads();
+		for(Sink&sink : sinks_){
+			try{
+				sink.writer->finish();
+			}catch(...){
+				record_error(std::current_exception());
+			}
+		}
+		if(error_){
+			std::rethrow_exception(error_);
+		}
+	}
+
+	// Summed over all sinks; complete after finish().
+	FileIoStats io_stats() const{
+		FileIoStats stats;
+		for(const Sink&sink : sinks_){
+			stats+=sink.writer->io_stats();
+		}
+		return stats;
+	}
+
+	BufferPoolStats buffer_stats() const{
+		BufferPoolStats stats;
+		for(const Sink&sink : sinks_){
+			stats+=sink.writer->buffer_stats();
+		}
+		return stats;
+	}
+
+  private:
+	using Segment=std::shared_ptr<const std::vector<std::uint64_t>>;
+
+	struct Entry{
+		Segment primes;
+		bool flush=false;
+	};
+
+	struct Sink{
+		std::unique_ptr<PrimeWriter> writer;
+		std::deque<Entry> queue;
+		std::thread thread;
+	};
+
+	void push(Segment primes){
+		std::unique_lock<std::mutex> lock(mutex_);
+		space_cv_.wait(lock,[&]{
+			if(error_){
+				return true;
+			}
+			return std::all_of(sinks_.begin(),sinks_.end(),
+							   [](const Sink&sink){
+								   return sink.queue.size()<kQueueSegments;
+							   });
+		});
+		if(error_){
+			std::rethrow_exception(error_);
+		}
+		for(Sink&sink : sinks_){
+			sink.queue.push_back({primes,primes==nullptr});
+		}
+		lock.unlock();
+		data_cv_.notify_all();
+	}
+
+	void run_sink(std::size_t index){
+		Sink&sink=sinks_[index];
+		for(;;){
+			Entry entry;
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				data_cv_.wait(lock,[&]{
+					return !sink.queue.empty()||closing_||error_;
+				});
+				if(error_||sink.queue.empty()){
+					return;
+				}
+				entry=std::move(sink.queue.front());
+				sink.queue.pop_front();
+			}
+			space_cv_.notify_all();
+			try{
+				if(entry.flush){
+					sink.writer->flush();
+				}else{
+					sink.writer->write_segment(*entry.primes);
+				}
+			}catch(...){
+				record_error(std::current_exception());
+				return;
+			}
+		}
+	}
+
+	void record_error(std::exception_ptr error){
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if(!error_){
+				error_=error;
+			}
+		}
+		space_cv_.notify_all();
+		data_cv_.notify_all();
+	}
+
+	void stop_threads(){
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			closing_=true;
+		}
+		data_cv_.notify_all();
+		for(Sink&sink : sinks_){
+			if(sink.thread.joinable()){
+				sink.thread.join();
+			}
+		}
+	}
+
+	std::vector<Sink> sinks_;
+	std::mutex mutex_;
+	std::condition_variable space_cv_;
+	std::condition_variable data_cv_;
+	bool closing_=false;
+	std::exception_ptr error_;
 };
 
 double median_seconds(std::vector<double>samples){
@@ -1414,9 +2180,12 @@ void validate_self_test_options(const Options&opts){
 		throw std::invalid_argument(
 			"--stest supports count benchmarking only");
 	}
-	if(opts.use_zstd||opts.output_format!=PrimeOutputFormat::Text||
+	if(opts.use_zstd||opts.use_lz4||
+	   opts.output_format!=PrimeOutputFormat::Text||
 	   opts.parquet_encoding!=ParquetEncoding::Plain||
-	   opts.parquet_delta_block_values_set){
+	   opts.parquet_delta_block_values_set||
+	   opts.parquet_row_group_bytes_set||opts.encode_threads!=0||
+	   opts.container_encoding_set){
 		throw std::invalid_argument(
 			"--stest does not support output-format, zstd, or Parquet options");
 	}
@@ -1460,6 +2229,9 @@ TimedCountResult run_timed_count_once(const Options&opts,const CpuInfo&info,
 	std::uint64_t length=(range.end>range.begin)?(range.end-range.begin):0;
 	SegmentConfig config=choose_segment_config(
 		info,threads,opts.segment_bytes,opts.tile_bytes,length);
+	config.super_segment_segments=choose_super_segment_segments(
+		info,config,threads,range.end,length);
+	config.huge_pages=opts.huge_pages;
 	WorkerSievePlans worker_plans=build_worker_sieve_plans(
 		info,config,threads,opts.tile_bytes,span,opts.core_schedule);
 
@@ -1508,8 +2280,7 @@ TimedCountResult run_timed_count_once(const Options&opts,const CpuInfo&info,
 	std::unique_ptr<PrimeMarker> efficiency_marker;
 	if(worker_plans.has_efficiency_workers&&worker_plans.split_tile){
 		efficiency_marker=std::make_unique<PrimeMarker>(
-			wheel,worker_plans.efficiency_config,range.begin,range.end,
-			base_primes,small_limit);
+			performance_marker,worker_plans.efficiency_config);
 	}
 	SegmentWorkQueue queue(range,config);
 
@@ -1537,7 +2308,6 @@ TimedCountResult run_timed_count_once(const Options&opts,const CpuInfo&info,
 					?*efficiency_marker
 					:performance_marker;
 			auto state=worker_marker.make_thread_state(t,threads);
-			std::vector<std::uint64_t> bitset;
 			std::uint64_t local_total=0;
 			const std::uint32_t batch_segments=performance_worker
 												   ?worker_plans.performance_batch
@@ -1555,11 +2325,8 @@ TimedCountResult run_timed_count_once(const Options&opts,const CpuInfo&info,
 					if(!queue.segment_bounds(segment_id,seg_low,seg_high)){
 						continue;
 					}
-					worker_marker.sieve_segment(state,segment_id,seg_low,
-												seg_high,bitset);
-					std::size_t bit_count=
-						static_cast<std::size_t>((seg_high-seg_low)>>1);
-					local_total+=count_zero_bits(bitset.data(),bit_count);
+					local_total+=worker_marker.sieve_segment_count(
+						state,segment_id,seg_low,seg_high);
 				}
 			}
 			total.fetch_add(local_total,std::memory_order_relaxed);
@@ -1657,18 +2424,642 @@ int run_self_test(const Options&opts){
 	return 0;
 }
 
-int run_cli(int argc,char**argv){
-	try{
-		Options opts=parse_options(argc,argv);
-		if(opts.help){
-			print_usage();
-			return 0;
+// --decode: streams an exported file through PrimeReader, counting it or
+// feeding it to a PrimeWriter, optionally restricted to [--from, --to).
+int run_decode(const Options&opts){
+	if(opts.nth.has_value()||opts.test_value.has_value()||opts.use_ml||
+	   opts.output_group_count!=0||opts.output_group_primes!=0||
+	   opts.output_group_range!=0||!opts.output_index_path.empty()){
+		throw std::invalid_argument(
+			"--decode supports --from, --to, --print and output options only");
+	}
+	if(opts.has_to&&opts.to<=opts.from){
+		throw std::invalid_argument("invalid range");
+	}
+	std::optional<PrimeOutputFormat> input_format;
+	if(!opts.decode_format.empty()){
+		Options parsed;
+		parse_output_format(parsed,opts.decode_format);
+		input_format=parsed.output_format;
+	}
+	if(opts.print_primes&&!opts.has_to&&
+	   opts.output_format==PrimeOutputFormat::Wheel30){
+		throw std::invalid_argument("re-exporting to wheel30 requires --to");
+	}
+
+	auto start_time=std::chrono::steady_clock::now();
+	PrimeReader reader(opts.decode_path,input_format,opts.threads);
+	std::unique_ptr<PrimeWriter> writer;
+	if(opts.print_primes){
+		writer=std::make_unique<PrimeWriter>(true,opts.output_path,
+											 make_writer_options(opts));
+		if(opts.has_to){
+			writer->set_range(opts.from,opts.to);
+		}
+	}
+	if(opts.from!=0){
+		reader.seek(opts.from);
+	}
+
+	std::uint64_t total=0;
+	std::vector<std::uint64_t> block;
+	while(reader.next_block(block)){
+		bool last=false;
+		if(opts.has_to&&block.back()>=opts.to){
+			block.erase(std::lower_bound(block.begin(),block.end(),opts.to),
+						block.end());
+			last=true;
+		}
+		total+=block.size();
+		if(writer&&!block.empty()){
+			writer->write_segment(block);
+		}
+		if(last){
+			break;
+		}
+	}
+	if(writer){
+		writer->finish();
+	}
+	auto end_time=std::chrono::steady_clock::now();
+	auto elapsed=std::chrono::duration_cast<std::chrono::microseconds>(
+					 end_time-start_time)
+					 .count();
+
+	if(!opts.print_primes){
+		std::cout<<total<<"\n";
+	}
+	if(opts.show_stats){
+		std::uint64_t bytes=std::filesystem::file_size(opts.decode_path);
+		std::cout<<"Decode format: "<<output_format_name(reader.format())
+				 <<(reader.zstd_stream()?" (zstd stream)":"")<<"\n";
+		std::cout<<"Decode threads: "<<reader.threads()<<"\n";
+		std::cout<<"Input bytes: "<<bytes<<"\n";
+		if(writer){
+			print_io_stats(writer->io_stats(),elapsed);
+		}
+		if(elapsed>0){
+			std::cout<<"Decode rate: "<<std::fixed<<std::setprecision(1)
+					 <<static_cast<double>(bytes)/static_cast<double>(elapsed)
+					 <<" MB/s, "
+					 <<static_cast<double>(total)/static_cast<double>(elapsed)
+					 <<" Mprimes/s\n";
+		}
+	}
+	if(opts.show_time){
+		std::cout<<"Elapsed: "<<elapsed<<" us\n";
+	}
+	return 0;
+}
+
+// Reads the index TSV written by GroupedPrimeExporter.
+std::vector<GroupIndexRecord> read_group_index(const std::string&path){
+	std::ifstream in(path);
+	if(!in){
+		throw std::runtime_error("failed to open index file: "+path);
+	}
+	std::string line;
+	if(!std::getline(in,line)||line.rfind("group_id\tfile_path\t",0)!=0){
+		throw std::runtime_error("not a grouped export index: "+path);
+	}
+	std::vector<GroupIndexRecord> records;
+	while(std::getline(in,line)){
+		if(line.empty()){
+			continue;
+		}
+		std::vector<std::string> fields;
+		std::size_t begin=0;
+		while(true){
+			std::size_t tab=line.find('\t',begin);
+			fields.push_back(line.substr(begin,tab-begin));
+			if(tab==std::string::npos){
+				break;
+			}
+			begin=tab+1;
+		}
+		if(fields.size()!=7){
+			throw std::runtime_error("malformed index line: "+line);
+		}
+		GroupIndexRecord record;
+		record.id=parse_u64(fields[0]);
+		record.file_path=fields[1];
+		record.range_begin=parse_u64(fields[2]);
+		record.range_end=parse_u64(fields[3]);
+		record.prime_count=parse_u64(fields[4]);
+		record.has_prime=fields[5]!="-";
+		if(record.has_prime){
+			record.first_prime=parse_u64(fields[5]);
+			record.last_prime=parse_u64(fields[6]);
+		}
+		records.push_back(std::move(record));
+	}
+	if(records.empty()){
+		throw std::runtime_error("grouped export index lists no groups: "+path);
+	}
+	return records;
+}
+
+// Groups of a grouped export that --extend keeps in its index.
+struct ExtendTarget{
+	std::vector<GroupIndexRecord> records;
+	std::size_t id_width=0;
+};
+
+// Turns --extend FILE into an ordinary --print run over (last prime, --to).
+// A single export is appended to in place, in its own format and encoding.
+// For a grouped export's index TSV, new group files follow the listed
+// ones (one group unless a grouping option is given) and the index is
+// rewritten; the format comes from the last group file.
+ExtendTarget prepare_extend(Options&opts){
+	if(!opts.has_to){
+		throw std::invalid_argument("--extend requires --to");
+	}
+	if(opts.from!=0||opts.nth.has_value()||opts.test_value.has_value()||
+	   opts.use_ml||!opts.output_path.empty()||
+	   !opts.output_index_path.empty()||opts.output_format_set||
+	   !opts.decode_path.empty()||!opts.verify_path.empty()){
+		throw std::invalid_argument(
+			"--extend takes the start, output path and format from FILE");
+	}
+	std::optional<PrimeOutputFormat> input_format;
+	if(!opts.decode_format.empty()){
+		Options parsed;
+		parse_output_format(parsed,opts.decode_format);
+		input_format=parsed.output_format;
+	}
+
+	bool grouped=false;
+	{
+		std::ifstream probe(opts.extend_path,std::ios::binary);
+		std::string head(18,'\0');
+		probe.read(head.data(),static_cast<std::streamsize>(head.size()));
+		grouped=probe&&head=="group_id\tfile_path";
+	}
+	bool grouping=opts.output_group_count!=0||opts.output_group_primes!=0||
+				  opts.output_group_range!=0;
+
+	ExtendTarget target;
+	std::string data_path=opts.extend_path;
+	std::uint64_t resume_from=0;
+	if(grouped){
+		target.records=read_group_index(opts.extend_path);
+		const GroupIndexRecord&last=target.records.back();
+		data_path=last.file_path;
+		resume_from=last.range_end;
+		// Group files are named <stem>.g<id><extension>.
+		OutputPathParts parts=split_output_path(last.file_path);
+		std::string stem=parts.stem;
+		std::string extension=parts.extension;
+		if(stem.find(".g")==std::string::npos&&extension.rfind(".g",0)==0){
+			stem+=extension;
+			extension.clear();
+		}
+		std::size_t marker=stem.rfind(".g");
+		std::size_t digits=marker==std::string::npos?0:stem.size()-marker-2U;
+		if(digits==0||stem.find_first_not_of("0123456789",marker+2U)!=
+						   std::string::npos){
+			throw std::runtime_error("unexpected group file name: "+
+									 last.file_path);
+		}
+		target.id_width=digits;
+		opts.output_path=parts.directory+stem.substr(0,marker)+extension;
+		opts.output_index_path=opts.extend_path;
+		if(!grouping){
+			opts.output_group_count=1;
+		}
+	}else{
+		if(grouping){
+			throw std::invalid_argument(
+				"grouping options with --extend need a grouped export index");
+		}
+		if(opts.use_zstd||opts.use_lz4||
+		   opts.parquet_encoding!=ParquetEncoding::Plain||
+		   opts.container_encoding_set){
+			throw std::invalid_argument(
+				"--extend keeps the encoding of the existing file");
+		}
+		opts.output_path=opts.extend_path;
+	}
+
+	PrimeReader reader(data_path,input_format,1);
+	opts.output_format=reader.format();
+	opts.use_zstd=opts.use_zstd||reader.zstd_stream();
+	if(!grouped){
+		std::vector<std::uint64_t> block;
+		if(!reader.last_block(block)){
+			throw std::runtime_error("cannot extend an empty export: "+
+									 opts.extend_path);
+		}
+		opts.extend_after=block.back();
+		resume_from=block.back()+1U;
+	}
+	if(opts.to<=resume_from){
+		throw std::invalid_argument(
+			"--to must exceed the end of the existing export ("+
+			std::to_string(resume_from)+")");
+	}
+	opts.from=resume_from;
+	opts.print_primes=true;
+	opts.count_only=false;
+	return target;
+}
+
+// First difference found by --verify.  `value` orders mismatches found by
+// different workers; `segment`/`index` locate it for the prime offset.
+struct VerifyMismatch{
+	std::uint64_t value=std::numeric_limits<std::uint64_t>::max();
+	std::uint64_t segment=0;
+	std::size_t index=0;
+	std::optional<std::uint64_t> expected;
+	std::optional<std::uint64_t> actual;
+};
+
+// Walks a PrimeReader value by value on behalf of one --verify worker.
+class VerifyCursor{
+  public:
+	VerifyCursor(const std::string&path,
+				 std::optional<PrimeOutputFormat> format)
+		: reader_(path,format,1){}
+
+	void seek(std::uint64_t value){
+		reader_.seek(value);
+		block_.clear();
+		position_=0;
+	}
+
+	const std::uint64_t*peek(){
+		if(position_==block_.size()){
+			position_=0;
+			if(!reader_.next_block(block_)){
+				return nullptr;
+			}
+		}
+		return &block_[position_];
+	}
+
+	// Checks the file against `expected` and then that no further value
+	// lies below `limit`; returns the position of the first difference.
+	std::optional<std::size_t> match(const std::vector<std::uint64_t>&expected,
+									 std::uint64_t limit,
+									 VerifyMismatch&mismatch){
+		std::size_t done=0;
+		while(done<expected.size()){
+			if(peek()==nullptr){
+				mismatch.expected=expected[done];
+				mismatch.value=expected[done];
+				return done;
+			}
+			std::size_t run=std::min(expected.size()-done,
+									 block_.size()-position_);
+			auto file_begin=block_.begin()+
+							static_cast<std::ptrdiff_t>(position_);
+			auto differ=std::mismatch(
+				expected.begin()+static_cast<std::ptrdiff_t>(done),
+				expected.begin()+static_cast<std::ptrdiff_t>(done+run),
+				file_begin);
+			std::size_t equal=static_cast<std::size_t>(
+				differ.second-file_begin);
+			position_+=equal;
+			done+=equal;
+			if(equal<run){
+				mismatch.expected=*differ.first;
+				mismatch.actual=*differ.second;
+				mismatch.value=std::min(*differ.first,*differ.second);
+				return done;
+			}
+		}
+		const std::uint64_t*next=peek();
+		if(next!=nullptr&&*next<limit){
+			mismatch.actual=*next;
+			mismatch.value=*next;
+			return done;
+		}
+		return std::nullopt;
+	}
+
+  private:
+	PrimeReader reader_;
+	std::vector<std::uint64_t> block_;
+	std::size_t position_=0;
+};
+
+// --verify: re-sieves [--from, --to) and checks that FILE holds exactly
+// those primes.  Workers take chunks of whole segments, sieve them with
+// PrimeMarker and compare each segment against their own PrimeReader
+// positioned at the chunk, so neither stream is ever held in full.
+// Formats without a block index rescan from the start on every seek, so
+// they are cut into one chunk per worker instead.
+int run_verify(const Options&opts){
+	if(opts.print_primes||opts.nth.has_value()||
+	   opts.test_value.has_value()||opts.use_ml||
+	   !opts.output_path.empty()||opts.output_group_count!=0||
+	   opts.output_group_primes!=0||opts.output_group_range!=0||
+	   !opts.output_index_path.empty()||!opts.decode_path.empty()){
+		throw std::invalid_argument(
+			"--verify supports --from, --to, --in-format and sieve options only");
+	}
+	if(!opts.has_to){
+		throw std::invalid_argument("--verify requires --to");
+	}
+	if(opts.to<=opts.from||opts.to<2){
+		throw std::invalid_argument("invalid range");
+	}
+	std::optional<PrimeOutputFormat> input_format;
+	if(!opts.decode_format.empty()){
+		Options parsed;
+		parse_output_format(parsed,opts.decode_format);
+		input_format=parsed.output_format;
+	}
+
+	auto start_time=std::chrono::steady_clock::now();
+	bool indexed=false;
+	bool zstd_stream=false;
+	{
+		PrimeReader probe(opts.verify_path,input_format,1);
+		input_format=probe.format();
+		indexed=probe.indexed();
+		zstd_stream=probe.zstd_stream();
+	}
+
+	CpuInfo info=detect_cpu_info();
+	std::uint64_t span=opts.to-opts.from;
+	unsigned threads=
+		choose_thread_count(info,opts.threads,span,opts.core_schedule);
+	if(threads==0){
+		threads=1;
+	}
+
+	std::uint64_t odd_begin=opts.from<=3?3:opts.from;
+	if((odd_begin&1ULL)==0){
+		++odd_begin;
+	}
+	std::uint64_t odd_end=opts.to;
+	if((odd_end&1ULL)==0){
+		++odd_end;
+	}
+	if(odd_begin>=opts.to||odd_end<=odd_begin){
+		odd_end=odd_begin;
+	}
+	SieveRange range{odd_begin,odd_end};
+	std::uint64_t length=range.end-range.begin;
+	SegmentConfig config=choose_segment_config(
+		info,threads,opts.segment_bytes,opts.tile_bytes,length);
+	config.super_segment_segments=choose_super_segment_segments(
+		info,config,threads,range.end,length);
+	config.huge_pages=opts.huge_pages;
+	WorkerSievePlans worker_plans=build_worker_sieve_plans(
+		info,config,threads,opts.tile_bytes,span,opts.core_schedule);
+	const Wheel&wheel=get_wheel(opts.wheel);
+	std::uint32_t small_limit=opts.wheel==WheelType::Mod30?19u:47u;
+	std::size_t num_segments=
+		length?static_cast<std::size_t>((length+config.segment_span-1)/
+										config.segment_span)
+			  :0;
+	std::uint64_t sqrt_limit=static_cast<std::uint64_t>(std::sqrt(
+								 static_cast<long double>(opts.to)))+
+							 1;
+	auto base_primes=simple_sieve(sqrt_limit);
+
+	std::vector<std::uint64_t> prefix_primes;
+	if(opts.from<=2){
+		prefix_primes.push_back(2);
+	}
+	for(std::uint16_t p16 : wheel.presieved_primes){
+		std::uint64_t p=static_cast<std::uint64_t>(p16);
+		if(p>=opts.from&&p<opts.to){
+			prefix_primes.push_back(p);
+		}
+	}
+
+	// Segment 0 also checks the presieved primes and that nothing precedes
+	// them; the last segment checks that nothing follows.
+	std::size_t chunk_segments=indexed?std::clamp<std::size_t>(
+										   num_segments/(4U*threads),1U,16U)
+									  :(num_segments+threads-1U)/threads;
+	std::vector<std::uint64_t> segment_counts(num_segments,0);
+	std::atomic<std::uint64_t> mismatch_limit{
+		std::numeric_limits<std::uint64_t>::max()};
+	std::mutex mismatch_mutex;
+	VerifyMismatch first_mismatch;
+	bool found_mismatch=false;
+	std::exception_ptr worker_exception;
+
+	auto report=[&](const VerifyMismatch&mismatch){
+		std::lock_guard<std::mutex> lock(mismatch_mutex);
+		if(!found_mismatch||mismatch.value<first_mismatch.value){
+			first_mismatch=mismatch;
+			found_mismatch=true;
+			mismatch_limit.store(mismatch.value,std::memory_order_relaxed);
+		}
+	};
+
+	if(num_segments==0){
+		VerifyCursor cursor(opts.verify_path,input_format);
+		VerifyMismatch mismatch;
+		if(auto index=cursor.match(prefix_primes,
+								   std::numeric_limits<std::uint64_t>::max(),
+								   mismatch)){
+			mismatch.index=*index;
+			report(mismatch);
+		}
+	}
+
+	PrimeMarker performance_marker(wheel,worker_plans.performance_config,
+								   range.begin,range.end,base_primes,
+								   small_limit);
+	std::unique_ptr<PrimeMarker> efficiency_marker;
+	if(worker_plans.has_efficiency_workers&&worker_plans.split_tile){
+		efficiency_marker=std::make_unique<PrimeMarker>(
+			performance_marker,worker_plans.efficiency_config);
+	}
+	SegmentWorkQueue queue(range,config);
+	ProgressReporter progress(opts.show_progress,num_segments);
+	progress.start();
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	std::vector<ThreadSieveStats> sieve_stats(threads);
+	for(unsigned t=0;t<threads&&num_segments!=0;++t){
+		workers.emplace_back([&,t](){
+			try{
+				bool performance_worker=
+					is_performance_worker(info,t,threads,opts.core_schedule);
+				const PrimeMarker&worker_marker=
+					(efficiency_marker&&!performance_worker)
+						?*efficiency_marker
+						:performance_marker;
+				auto state=worker_marker.make_thread_state(t,threads);
+				VerifyCursor cursor(opts.verify_path,input_format);
+				std::vector<std::uint64_t> expected;
+				std::uint64_t segment_begin=0;
+				std::uint64_t segment_end=0;
+				while(queue.next_chunk(chunk_segments,segment_begin,
+									   segment_end)){
+					std::uint64_t seg_low=0;
+					std::uint64_t seg_high=0;
+					if(!queue.segment_bounds(segment_begin,seg_low,seg_high)||
+					   seg_low>=mismatch_limit.load(
+									std::memory_order_relaxed)){
+						continue;
+					}
+					cursor.seek(segment_begin==0?0:seg_low);
+					for(std::uint64_t segment_id=segment_begin;
+						segment_id<segment_end;++segment_id){
+						if(!queue.segment_bounds(segment_id,seg_low,
+												 seg_high)||
+						   seg_low>=mismatch_limit.load(
+										std::memory_order_relaxed)){
+							break;
+						}
+						expected.clear();
+						if(segment_id==0){
+							expected=prefix_primes;
+						}
+						worker_marker.sieve_segment_primes(
+							state,segment_id,seg_low,seg_high,expected);
+						segment_counts[segment_id]=expected.size();
+						bool last=segment_id+1U==num_segments;
+						VerifyMismatch mismatch;
+						if(auto index=cursor.match(
+							   expected,
+							   last?std::numeric_limits<std::uint64_t>::max()
+								   :seg_high,
+							   mismatch)){
+							mismatch.segment=segment_id;
+							mismatch.index=*index;
+							report(mismatch);
+							break;
+						}
+						progress.on_segment_complete();
+					}
+				}
+				sieve_stats[t]=thread_sieve_stats(worker_marker,state);
+			}catch(...){
+				std::lock_guard<std::mutex> lock(mismatch_mutex);
+				if(!worker_exception){
+					worker_exception=std::current_exception();
+				}
+				mismatch_limit.store(0,std::memory_order_relaxed);
+			}
+		});
+	}
+	for(auto&thread : workers){
+		thread.join();
+	}
+	progress.stop();
+	if(worker_exception){
+		std::rethrow_exception(worker_exception);
+	}
+	auto end_time=std::chrono::steady_clock::now();
+	auto elapsed=std::chrono::duration_cast<std::chrono::microseconds>(
+					 end_time-start_time)
+					 .count();
+
+	std::uint64_t total=num_segments==0?prefix_primes.size():0;
+	for(std::uint64_t count : segment_counts){
+		total+=count;
+	}
+	if(found_mismatch){
+		std::uint64_t offset=first_mismatch.index;
+		for(std::uint64_t s=0;s<first_mismatch.segment;++s){
+			offset+=segment_counts[s];
+		}
+		std::cerr<<"Verify failed at prime #"<<offset<<": expected ";
+		if(first_mismatch.expected){
+			std::cerr<<*first_mismatch.expected;
+		}else{
+			std::cerr<<"end of range";
+		}
+		std::cerr<<", file has ";
+		if(first_mismatch.actual){
+			std::cerr<<*first_mismatch.actual;
+		}else{
+			std::cerr<<"end of file";
+		}
+		std::cerr<<"\n";
+	}else{
+		std::cout<<"Verified: "<<total<<" primes\n";
+	}
+	if(opts.show_stats){
+		std::cout<<"Verify format: "<<output_format_name(*input_format)
+				 <<(zstd_stream?" (zstd stream)":"")<<"\n";
+		std::cout<<"Verify chunks: "<<chunk_segments<<" segments"
+				 <<(indexed?"":" (sequential input)")<<"\n";
+		print_schedule_stats(info,threads,opts.core_schedule,config,
+							 worker_plans);
+		print_sieve_state_stats(performance_marker,sieve_stats);
+	}
+	if(opts.show_time){
+		std::cout<<"Elapsed: "<<elapsed<<" us\n";
+	}
+	return found_mismatch?1:0;
+}
+
+int run_cli(int argc,char**argv){
+	try{
+		Options opts=parse_options(argc,argv);
+		if(opts.help){
+			print_usage();
+			return 0;
 		}
 		if(opts.self_test){
 			return run_self_test(opts);
 		}
+		ExtendTarget extend_target;
+		if(!opts.extend_path.empty()){
+			extend_target=prepare_extend(opts);
+		}
+		if(!opts.extra_outputs.empty()){
+			if(!opts.print_primes){
+				throw std::invalid_argument(
+					"multiple --out sinks require --print");
+			}
+			if(opts.output_group_count!=0||opts.output_group_primes!=0||
+			   opts.output_group_range!=0){
+				throw std::invalid_argument(
+					"multiple --out sinks cannot be combined with grouped export");
+			}
+			if(!opts.extend_path.empty()||!opts.decode_path.empty()||
+			   !opts.verify_path.empty()){
+				throw std::invalid_argument(
+					"multiple --out sinks cannot be combined with --decode, "
+					"--verify or --extend");
+			}
+		}
+		if(!opts.unordered_dir.empty()){
+			if(!opts.print_primes||opts.nth.has_value()){
+				throw std::invalid_argument("--out-unordered requires --print");
+			}
+			if(!opts.output_path.empty()){
+				throw std::invalid_argument(
+					"--out-unordered cannot be combined with --out");
+			}
+			if(opts.output_group_count!=0||opts.output_group_primes!=0||
+			   opts.output_group_range!=0){
+				throw std::invalid_argument(
+					"--out-unordered cannot be combined with grouped export");
+			}
+			if(!opts.extend_path.empty()||!opts.decode_path.empty()||
+			   !opts.verify_path.empty()){
+				throw std::invalid_argument(
+					"--out-unordered cannot be combined with --decode, "
+					"--verify or --extend");
+			}
+			if(opts.output_format==PrimeOutputFormat::Wheel30){
+				throw std::invalid_argument(
+					"wheel30 output needs the whole range and cannot be "
+					"written unordered");
+			}
+			// A shard skips the chunks of other workers, and delta16 has
+			// no escape for the resulting gaps.
+			if(opts.output_format==PrimeOutputFormat::Delta16){
+				throw std::invalid_argument(
+					"delta16 output cannot be written unordered; use gap8");
+			}
+		}
+		std::vector<OutputSpec> sinks=output_sinks(opts);
 		if(opts.parquet_encoding!=ParquetEncoding::Plain&&
-		   opts.output_format!=PrimeOutputFormat::Parquet){
+		   !has_output_format(sinks,PrimeOutputFormat::Parquet)){
 			throw std::invalid_argument(
 				"--parquet-encoding=delta requires --out-format parquet");
 		}
@@ -1684,11 +3075,76 @@ int run_cli(int argc,char**argv){
 			throw std::invalid_argument(
 				"Parquet delta block values must be a multiple of 128 between 128 and 1048576");
 		}
+		if(opts.parquet_row_group_bytes_set&&
+		   !has_output_format(sinks,PrimeOutputFormat::Parquet)){
+			throw std::invalid_argument(
+				"--parquet-row-group-bytes requires --out-format parquet");
+		}
+		if(opts.encode_threads!=0&&
+		   !has_output_format(sinks,PrimeOutputFormat::Parquet)&&
+		   !has_output_format(sinks,PrimeOutputFormat::EliasFano)&&
+		   !has_output_format(sinks,PrimeOutputFormat::Container)&&
+		   !has_output_format(sinks,PrimeOutputFormat::Arrow)){
+			throw std::invalid_argument(
+				"--encode-threads requires --out-format parquet, ef, "
+				"container or arrow");
+		}
+		if(opts.container_encoding_set&&
+		   !has_output_format(sinks,PrimeOutputFormat::Container)){
+			throw std::invalid_argument(
+				"--container-encoding requires --out-format container");
+		}
+		if(opts.use_lz4&&!has_output_format(sinks,PrimeOutputFormat::Arrow)){
+			throw std::invalid_argument("--lz4 requires --out-format arrow");
+		}
+		for(const OutputSpec&sink : sinks){
+			if(is_shm_output(sink.path)&&
+			   (sink.format!=PrimeOutputFormat::Binary||sink.use_zstd)){
+				throw std::invalid_argument(
+					"--out shm:NAME requires --out-format binary without "
+					"--zstd");
+			}
+			if((sink.format==PrimeOutputFormat::Wheel30||
+				sink.format==PrimeOutputFormat::EliasFano)&&
+			   sink.use_zstd){
+				throw std::invalid_argument(
+					"--out-format wheel30 and ef cannot be combined with --zstd");
+			}
+			if(opts.use_lz4&&sink.format==PrimeOutputFormat::Arrow&&
+			   sink.use_zstd){
+				throw std::invalid_argument(
+					"--lz4 and --zstd cannot be combined");
+			}
 #if !defined(CALCPRIME_HAS_ZSTD)
-		if(opts.use_zstd){
-			throw std::invalid_argument("zstd not supported in this build");
+			if(sink.use_zstd){
+				throw std::invalid_argument("zstd not supported in this build");
+			}
+#endif
+		}
+		if(opts.parquet_row_group_bytes==0){
+			throw std::invalid_argument(
+				"--parquet-row-group-bytes must be positive");
+		}
+#if !defined(CALCPRIME_HAS_LZ4)
+		if(opts.use_lz4){
+			throw std::invalid_argument("lz4 not supported in this build");
 		}
 #endif
+		if((opts.io_options.direct||opts.io_options.queue_depth!=0)&&
+		   opts.io_options.backend!=FileIoBackend::IoUring){
+			throw std::invalid_argument(
+				"--direct and --io-depth require --io-backend uring");
+		}
+		if(!opts.verify_path.empty()){
+			return run_verify(opts);
+		}
+		if(!opts.decode_path.empty()){
+			return run_decode(opts);
+		}
+		if(!opts.decode_format.empty()&&opts.extend_path.empty()){
+			throw std::invalid_argument(
+				"--in-format requires --decode, --verify or --extend");
+		}
 		if(opts.test_value.has_value()&&!opts.has_to){
 			bool is_prime=miller_rabin_is_prime(opts.test_value.value());
 			std::cout<<(is_prime?"prime":"composite")<<"\n";
@@ -1736,10 +3192,17 @@ int run_cli(int argc,char**argv){
 				throw std::invalid_argument(
 					"grouped export requires --out PATH");
 			}
+			if(is_shm_output(opts.output_path)){
+				throw std::invalid_argument(
+					"grouped export writes files; it cannot use --out shm:NAME");
+			}
 			grouping_config.index_path=
 				opts.output_index_path.empty()
 					?(opts.output_path+".index.tsv")
 					:opts.output_index_path;
+			grouping_config.existing_records=
+				std::move(extend_target.records);
+			grouping_config.id_width=extend_target.id_width;
 		}else if(!opts.output_index_path.empty()){
 			throw std::invalid_argument(
 				"--out-index requires one grouped export option");
@@ -1774,6 +3237,9 @@ int run_cli(int argc,char**argv){
 
 		SegmentConfig config=choose_segment_config(
 			info,threads,opts.segment_bytes,opts.tile_bytes,length);
+		config.super_segment_segments=choose_super_segment_segments(
+			info,config,threads,range.end,length);
+		config.huge_pages=opts.huge_pages;
 		WorkerSievePlans worker_plans=build_worker_sieve_plans(
 			info,config,threads,opts.tile_bytes,span,opts.core_schedule);
 		const Wheel&wheel=get_wheel(opts.wheel);
@@ -1878,14 +3344,10 @@ int run_cli(int argc,char**argv){
 		std::unique_ptr<PrimeMarker> efficiency_marker;
 		if(worker_plans.has_efficiency_workers&&worker_plans.split_tile){
 			efficiency_marker=std::make_unique<PrimeMarker>(
-				wheel,worker_plans.efficiency_config,range.begin,range.end,
-				base_primes,small_limit);
+				performance_marker,worker_plans.efficiency_config);
 		}
 		SegmentWorkQueue queue(range,config);
 
-		std::vector<SegmentResult> segment_results(num_segments);
-		std::mutex segment_ready_mutex;
-		std::condition_variable segment_ready_cv;
 		std::atomic<bool> stop{false};
 		std::atomic<bool> nth_found{false};
 		std::uint64_t nth_value=0;
@@ -1893,6 +3355,8 @@ int run_cli(int argc,char**argv){
 
 		std::vector<std::thread> workers;
 		workers.reserve(threads);
+		// Each worker's sieve state once it is done, for --stats.
+		std::vector<ThreadSieveStats> sieve_stats(threads);
 
 		bool include_two=opts.from<=2&&opts.to>2;
 		std::vector<std::uint64_t> prefix_primes;
@@ -1925,7 +3389,6 @@ int run_cli(int argc,char**argv){
 							?*efficiency_marker
 							:performance_marker;
 					auto state=worker_marker.make_thread_state(t,threads);
-					std::vector<std::uint64_t> bitset;
 					std::uint64_t local_total=0;
 					const std::uint32_t batch_segments=
 						performance_worker?worker_plans.performance_batch
@@ -1945,17 +3408,13 @@ int run_cli(int argc,char**argv){
 													 seg_high)){
 								continue;
 							}
-							worker_marker.sieve_segment(
-								state,segment_id,seg_low,seg_high,bitset);
-							std::size_t bit_count=
-								static_cast<std::size_t>((seg_high-seg_low)>>
-												 1);
-							local_total+=
-								count_zero_bits(bitset.data(),bit_count);
+							local_total+=worker_marker.sieve_segment_count(
+								state,segment_id,seg_low,seg_high);
 							progress.on_segment_complete();
 						}
 					}
 					total.fetch_add(local_total,std::memory_order_relaxed);
+					sieve_stats[t]=thread_sieve_stats(worker_marker,state);
 				});
 			}
 			for(auto&th : workers){
@@ -1969,6 +3428,7 @@ int run_cli(int argc,char**argv){
 			if(opts.show_stats){
 				print_schedule_stats(info,threads,opts.core_schedule,config,
 									 worker_plans);
+				print_sieve_state_stats(performance_marker,sieve_stats);
 			}
 
 			if(opts.show_time){
@@ -1982,25 +3442,231 @@ int run_cli(int argc,char**argv){
 			return 0;
 		}
 
+		if(!opts.unordered_dir.empty()){
+			// Every worker owns a synchronous writer and appends its
+			// segments to its shard as it sieves them; the manifest
+			// records where each chunk of segments went.
+			std::filesystem::create_directories(opts.unordered_dir);
+			std::string extension=
+				output_format_extension(opts.output_format,opts.use_zstd);
+			std::vector<std::string> shard_paths(threads);
+			std::vector<std::unique_ptr<PrimeWriter>> shards(threads);
+			PrimeWriterOptions shard_options=make_writer_options(opts);
+			shard_options.synchronous=true;
+			std::size_t shard_width=
+				std::max<std::size_t>(4,decimal_width_u64(threads));
+			for(unsigned t=0;t<threads;++t){
+				std::ostringstream name;
+				name<<"shard-"<<std::setfill('0')
+					<<std::setw(static_cast<int>(shard_width))<<t<<'.'
+					<<extension;
+				shard_paths[t]=
+					(std::filesystem::path(opts.unordered_dir)/name.str())
+						.string();
+				shards[t]=std::make_unique<PrimeWriter>(
+					true,shard_paths[t],shard_options);
+				shards[t]->set_wheel(get_wheel(opts.wheel).modulus);
+			}
+			std::vector<std::vector<ShardChunkRecord>> shard_records(threads);
+			std::vector<std::uint64_t> shard_totals(threads,0);
+			if(!prefix_primes.empty()){
+				ShardChunkRecord record;
+				record.range_begin=opts.from;
+				record.range_end=prefix_primes.back()+1;
+				record.prime_count=prefix_primes.size();
+				record.first_prime=prefix_primes.front();
+				record.last_prime=prefix_primes.back();
+				shard_records[0].push_back(record);
+				shard_totals[0]=prefix_primes.size();
+				shards[0]->write_segment(prefix_primes);
+			}
+			std::mutex shard_error_mutex;
+			std::exception_ptr shard_error;
+			ProgressReporter progress(opts.show_progress,num_segments);
+			progress.start();
+			for(unsigned t=0;t<threads;++t){
+				workers.emplace_back([&,t](){
+					bool performance_worker=
+						is_performance_worker(info,t,threads,opts.core_schedule);
+					const PrimeMarker&worker_marker=
+						(efficiency_marker&&!performance_worker)
+							?*efficiency_marker
+							:performance_marker;
+					auto state=worker_marker.make_thread_state(t,threads);
+					PrimeWriter&shard=*shards[t];
+					std::vector<ShardChunkRecord>&records=shard_records[t];
+					std::vector<std::uint64_t> primes;
+					const std::uint32_t batch_segments=
+						performance_worker?worker_plans.performance_batch
+										  :worker_plans.efficiency_batch;
+					try{
+						while(!stop.load(std::memory_order_relaxed)){
+							std::uint64_t segment_begin=0;
+							std::uint64_t segment_end=0;
+							if(!queue.next_chunk(batch_segments,segment_begin,
+												 segment_end)){
+								break;
+							}
+							ShardChunkRecord record;
+							record.shard=t;
+							record.segment_begin=segment_begin;
+							record.segment_end=segment_end;
+							record.shard_offset=shard_totals[t];
+							bool have_bounds=false;
+							for(std::uint64_t segment_id=segment_begin;
+								segment_id<segment_end;++segment_id){
+								std::uint64_t seg_low=0;
+								std::uint64_t seg_high=0;
+								if(!queue.segment_bounds(segment_id,seg_low,
+														 seg_high)){
+									continue;
+								}
+								if(!have_bounds){
+									record.range_begin=seg_low;
+									have_bounds=true;
+								}
+								record.range_end=seg_high;
+								primes.clear();
+								worker_marker.sieve_segment_primes(
+									state,segment_id,seg_low,seg_high,
+									primes);
+								if(!primes.empty()){
+									if(record.prime_count==0){
+										record.first_prime=primes.front();
+									}
+									record.last_prime=primes.back();
+									record.prime_count+=primes.size();
+									shard.write_segment(primes);
+								}
+								progress.on_segment_complete();
+							}
+							shard_totals[t]+=record.prime_count;
+							records.push_back(record);
+						}
+						sieve_stats[t]=thread_sieve_stats(worker_marker,state);
+					}catch(...){
+						std::lock_guard<std::mutex> lock(shard_error_mutex);
+						if(!shard_error){
+							shard_error=std::current_exception();
+						}
+						stop.store(true,std::memory_order_relaxed);
+					}
+				});
+			}
+			for(auto&th : workers){
+				th.join();
+			}
+			progress.stop();
+			for(auto&shard : shards){
+				try{
+					shard->finish();
+				}catch(...){
+					if(!shard_error){
+						shard_error=std::current_exception();
+					}
+				}
+			}
+			if(shard_error){
+				std::rethrow_exception(shard_error);
+			}
+
+			std::vector<ShardChunkRecord> manifest;
+			std::uint64_t total=0;
+			for(unsigned t=0;t<threads;++t){
+				manifest.insert(manifest.end(),shard_records[t].begin(),
+								shard_records[t].end());
+				total+=shard_totals[t];
+			}
+			std::sort(manifest.begin(),manifest.end(),
+					  [](const ShardChunkRecord&a,const ShardChunkRecord&b){
+						  return a.segment_begin!=b.segment_begin
+									 ?a.segment_begin<b.segment_begin
+									 :a.segment_end<b.segment_end;
+					  });
+			std::string manifest_path=
+				(std::filesystem::path(opts.unordered_dir)/"manifest.tsv")
+					.string();
+			write_shard_manifest(manifest_path,shard_paths,manifest);
+			auto end_time=std::chrono::steady_clock::now();
+
+			if(is_count_mode){
+				std::cout<<total<<"\n";
+			}
+			if(opts.show_stats){
+				print_schedule_stats(info,threads,opts.core_schedule,config,
+									 worker_plans);
+				print_sieve_state_stats(performance_marker,sieve_stats);
+				std::cout<<"Unordered shards: "<<threads<<" ("
+						 <<manifest.size()<<" chunks)\n";
+				FileIoStats io_stats;
+				for(const auto&shard : shards){
+					io_stats+=shard->io_stats();
+				}
+				print_io_stats(io_stats,microseconds_since(start_time));
+			}
+			if(opts.show_time){
+				auto elapsed=
+					std::chrono::duration_cast<std::chrono::microseconds>(
+						end_time-start_time)
+						.count();
+				std::cout<<"Elapsed: "<<elapsed<<" us\n";
+			}
+			return 0;
+		}
+
 		std::unique_ptr<PrimeWriter> writer;
 		std::unique_ptr<GroupedPrimeExporter> grouped_exporter;
 		if(grouping_config.mode!=OutputGroupingMode::None){
 			grouped_exporter=std::make_unique<GroupedPrimeExporter>(
-				opts.output_path,opts.output_format,opts.use_zstd,
-				opts.parquet_encoding,opts.parquet_delta_block_values,
-				opts.from,opts.to,grouping_config);
+				opts.output_path,make_writer_options(opts),
+				get_wheel(opts.wheel).modulus,opts.from,opts.to,
+				grouping_config);
 		}else{
-			writer=std::make_unique<PrimeWriter>(opts.print_primes,
-										 opts.output_path,
-										 opts.output_format,opts.use_zstd,
-										 opts.parquet_encoding,
-										 opts.parquet_delta_block_values);
+			PrimeWriterOptions writer_options=make_writer_options(opts);
+			writer_options.extend_after=opts.extend_after;
+			writer=std::make_unique<PrimeWriter>(
+				opts.print_primes,opts.output_path,writer_options);
+			writer->set_wheel(get_wheel(opts.wheel).modulus);
+			writer->set_range(opts.from,opts.to);
+		}
+		std::unique_ptr<PrimeSinkFanout> fanout;
+		if(!opts.extra_outputs.empty()){
+			std::vector<std::unique_ptr<PrimeWriter>> sink_writers;
+			sink_writers.push_back(std::move(writer));
+			for(const OutputSpec&sink : opts.extra_outputs){
+				PrimeWriterOptions sink_options=make_writer_options(opts);
+				sink_options.format=sink.format;
+				sink_options.use_zstd=sink.use_zstd;
+				sink_options.use_lz4=
+					opts.use_lz4&&sink.format==PrimeOutputFormat::Arrow;
+				sink_writers.push_back(std::make_unique<PrimeWriter>(
+					true,sink.path,sink_options));
+				sink_writers.back()->set_wheel(get_wheel(opts.wheel).modulus);
+				sink_writers.back()->set_range(opts.from,opts.to);
+			}
+			fanout=std::make_unique<PrimeSinkFanout>(std::move(sink_writers));
 		}
 		std::mutex writer_exception_mutex;
 		std::exception_ptr writer_exception;
 		std::thread writer_feeder;
 		ProgressReporter progress(opts.show_progress,num_segments);
 		progress.start();
+		// Sieved segments wait here for the feeder; workers that get too
+		// far ahead of it block, which bounds memory for any range.
+		SegmentReorderWindow window(
+			num_segments,SegmentReorderWindow::choose_capacity(
+							  threads,
+							  std::max(worker_plans.performance_batch,
+									   worker_plans.efficiency_batch)*
+								  config.super_segment_segments,
+							  num_segments));
+		std::atomic<std::uint64_t> sieved_total{0};
+		// Prime buffers cycle from the workers through the window to the
+		// feeder and back, so a steady export allocates none.  Fan-out and
+		// grouped export keep the vectors and never hand them back.
+		BufferPool<std::vector<std::uint64_t>> prime_buffers(
+			window.capacity()+threads+1);
+		const bool recycle_primes=!fanout&&!grouped_exporter;
 
 		for(unsigned t=0;t<threads;++t){
 			workers.emplace_back([&,t](){
@@ -2011,8 +3677,9 @@ int run_cli(int argc,char**argv){
 						?*efficiency_marker
 						:performance_marker;
 				auto state=worker_marker.make_thread_state(t,threads);
-				std::vector<std::uint64_t> bitset;
 				std::uint64_t cumulative=prefix_count;
+				std::uint64_t local_total=0;
+				std::uint64_t last_count=0;
 				const std::uint32_t batch_segments=
 					performance_worker?worker_plans.performance_batch
 									  :worker_plans.efficiency_batch;
@@ -2033,92 +3700,59 @@ int run_cli(int argc,char**argv){
 						if(!queue.segment_bounds(segment_id,seg_low,seg_high)){
 							continue;
 						}
-						worker_marker.sieve_segment(state,segment_id,seg_low,
-													seg_high,bitset);
-						std::size_t bit_count=
-							static_cast<std::size_t>((seg_high-seg_low)>>1);
-						std::uint64_t local_count=
-							count_zero_bits(bitset.data(),bit_count);
-						if(segment_id<segment_results.size()){
-							segment_results[segment_id].count=local_count;
-						}
-						bool need_primes=
-							opts.print_primes||
-							(opts.nth.has_value()&&threads==1);
-						if(need_primes&&segment_id<segment_results.size()){
+						bool find_nth=opts.nth.has_value()&&threads==1&&
+									  !nth_found.load(std::memory_order_relaxed);
+						std::uint64_t base=cumulative;
+						std::uint64_t rank=
+							find_nth&&nth_target>base?nth_target-base:0;
+						std::uint64_t local_count=0;
+						if(opts.print_primes){
+							// Sized from the previous segment; the tiles
+							// grow the buffer if this one has more primes.
+							std::size_t expected=
+								static_cast<std::size_t>(last_count)+
+								kExtractSlack;
 							std::vector<std::uint64_t> primes;
-							primes.reserve(static_cast<std::size_t>(local_count));
-							extract_segment_primes(bitset,seg_low,bit_count,
-												   primes);
-							segment_results[segment_id].primes=
-								std::move(primes);
-							{
-								std::lock_guard<std::mutex> lock(
-									segment_ready_mutex);
-								segment_results[segment_id].ready.store(
-									true,std::memory_order_release);
+							if(recycle_primes){
+								primes=prime_buffers.acquire(expected);
+							}else{
+								primes.reserve(expected);
 							}
-							segment_ready_cv.notify_one();
-							if(opts.nth.has_value()&&threads==1&&
-							   !nth_found.load(std::memory_order_relaxed)){
-								std::uint64_t base=cumulative;
-								std::uint64_t new_total=base+local_count;
-								if(nth_target>base&&nth_target<=new_total){
-									std::size_t index=static_cast<std::size_t>(
-										nth_target-base-1);
-									if(index<segment_results[segment_id]
-												   .primes.size()){
-										nth_value=segment_results[segment_id]
-													  .primes[index];
-										nth_found.store(
-											true,std::memory_order_relaxed);
-										stop.store(true,
-												   std::memory_order_relaxed);
-									}
-								}
-								cumulative=new_total;
+							local_count=worker_marker.sieve_segment_primes(
+								state,segment_id,seg_low,seg_high,
+								primes);
+							if(rank>0&&rank<=local_count){
+								nth_value=primes[static_cast<std::size_t>(
+									rank-1)];
+								nth_found.store(true,std::memory_order_relaxed);
+								stop.store(true,std::memory_order_relaxed);
 							}
-						}else{
-							if(opts.nth.has_value()&&threads==1&&
-							   !nth_found.load(std::memory_order_relaxed)){
-								std::uint64_t base=cumulative;
-								std::uint64_t new_total=base+local_count;
-								if(nth_target>base&&nth_target<=new_total){
-									// Need to extract primes to find nth
-									std::vector<std::uint64_t> primes;
-									primes.reserve(
-										static_cast<std::size_t>(local_count));
-									extract_segment_primes(bitset,seg_low,
-														   bit_count,primes);
-									std::size_t index=static_cast<std::size_t>(
-										nth_target-base-1);
-									if(index<primes.size()){
-										nth_value=primes[index];
-										nth_found.store(
-											true,std::memory_order_relaxed);
-										stop.store(true,
-												   std::memory_order_relaxed);
-									}
-									if(segment_id<segment_results.size()){
-										segment_results[segment_id].primes=
-											std::move(primes);
-										{
-											std::lock_guard<std::mutex> lock(
-												segment_ready_mutex);
-											segment_results[segment_id].ready
-												.store(
-													true,
-													std::memory_order_release);
-										}
-										segment_ready_cv.notify_one();
-									}
-								}
-								cumulative=new_total;
+							window.put(segment_id,std::move(primes));
+						}else if(rank>0){
+							std::uint64_t value=0;
+							local_count=worker_marker.sieve_segment_nth(
+								state,segment_id,seg_low,seg_high,rank,
+								value);
+							if(value!=0){
+								nth_value=value;
+								nth_found.store(true,std::memory_order_relaxed);
+								stop.store(true,std::memory_order_relaxed);
 							}
+						}else{
+							local_count=worker_marker.sieve_segment_count(
+								state,segment_id,seg_low,seg_high);
+						}
+						last_count=local_count;
+						local_total+=local_count;
+						cumulative+=local_count;
+						if(stop.load(std::memory_order_relaxed)){
+							window.stop();
 						}
 						progress.on_segment_complete();
 					}
 				}
+				sieved_total.fetch_add(local_total,std::memory_order_relaxed);
+				sieve_stats[t]=thread_sieve_stats(worker_marker,state);
 			});
 		}
 
@@ -2127,33 +3761,31 @@ int run_cli(int argc,char**argv){
 			writer_feeder=std::thread([&,prefix_copy]() mutable{
 				try{
 					if(!prefix_copy.empty()){
-						if(grouped_exporter){
-							grouped_exporter->write_segment(prefix_copy);
+						if(fanout){
+							fanout->write_segment(std::move(prefix_copy));
+						}else if(grouped_exporter){
+							grouped_exporter->write_segment(
+								std::move(prefix_copy));
 						}else if(writer){
 							writer->write_segment(prefix_copy);
 						}
 					}
-					for(std::size_t next=0;next<segment_results.size();++next){
-						SegmentResult&res=segment_results[next];
-						std::unique_lock<std::mutex> lock(segment_ready_mutex);
-						segment_ready_cv.wait(lock,[&]{
-							return res.ready.load(std::memory_order_acquire)||
-								   stop.load(std::memory_order_relaxed);
-						});
-						bool ready=res.ready.load(std::memory_order_acquire);
-						if(!ready){
-							break;
-						}
-						res.ready.store(false,std::memory_order_relaxed);
-						std::vector<std::uint64_t> primes=std::move(res.primes);
-						lock.unlock();
-						if(grouped_exporter){
-							grouped_exporter->write_segment(primes);
+					std::vector<std::uint64_t> primes;
+					while(window.take(primes)){
+						// Fan-out and grouped export keep the vector until
+						// every writer is done with it.
+						if(fanout){
+							fanout->write_segment(std::move(primes));
+						}else if(grouped_exporter){
+							grouped_exporter->write_segment(std::move(primes));
 						}else if(writer){
 							writer->write_segment(primes);
+							prime_buffers.release(std::move(primes));
 						}
 					}
-					if(grouped_exporter){
+					if(fanout){
+						fanout->flush();
+					}else if(grouped_exporter){
 						grouped_exporter->flush();
 					}else if(writer){
 						writer->flush();
@@ -2163,7 +3795,7 @@ int run_cli(int argc,char**argv){
 						writer_exception_mutex);
 					writer_exception=std::current_exception();
 					stop.store(true,std::memory_order_relaxed);
-					segment_ready_cv.notify_all();
+					window.stop();
 				}
 			});
 		}
@@ -2172,15 +3804,14 @@ int run_cli(int argc,char**argv){
 			th.join();
 		}
 		progress.stop();
-
-		segment_ready_cv.notify_all();
+		// Every put has returned, so a segment the feeder has not got yet
+		// will never arrive.
+		window.stop();
 
 		auto end_time=std::chrono::steady_clock::now();
 
-		std::uint64_t total=prefix_count;
-		for(const auto&res : segment_results){
-			total+=res.count;
-		}
+		std::uint64_t total=
+			prefix_count+sieved_total.load(std::memory_order_relaxed);
 
 		if(is_count_mode){
 			std::cout<<total<<"\n";
@@ -2197,7 +3828,9 @@ int run_cli(int argc,char**argv){
 		}
 
 		try{
-			if(grouped_exporter){
+			if(fanout){
+				fanout->finish();
+			}else if(grouped_exporter){
 				grouped_exporter->finish();
 			}else if(writer){
 				writer->finish();
@@ -2235,6 +3868,35 @@ int run_cli(int argc,char**argv){
 				std::cout<<"Grouped export: "<<grouping_config.value
 						 <<" numbers/group\n";
 			}
+			if(grouped_exporter){
+				std::cout<<"Group writers: "
+						 <<grouped_exporter->peak_active_groups()
+						 <<" concurrent\n";
+			}
+			if(fanout){
+				std::cout<<"Output sinks: "<<fanout->size()<<"\n";
+			}
+			print_sieve_state_stats(performance_marker,sieve_stats);
+			if(opts.print_primes){
+				std::cout<<"Reorder window: "<<window.capacity()
+						 <<" segments (peak "<<window.peak_buffered()
+						 <<" buffered, "<<window.producer_waits()
+						 <<" worker waits)\n";
+				BufferPoolStats chunk_stats=
+					fanout?fanout->buffer_stats()
+						  :grouped_exporter?grouped_exporter->buffer_stats()
+										  :writer->buffer_stats();
+				BufferPoolStats prime_stats=prime_buffers.stats();
+				std::cout<<"Buffer allocations: "<<prime_stats.allocated<<'/'
+						 <<prime_stats.acquired<<" prime buffers, "
+						 <<chunk_stats.allocated<<'/'<<chunk_stats.acquired
+						 <<" output chunks\n";
+				FileIoStats io_stats=
+					fanout?fanout->io_stats()
+						  :grouped_exporter?grouped_exporter->io_stats()
+										  :writer->io_stats();
+				print_io_stats(io_stats,microseconds_since(start_time));
+			}
 		}
 
 		if(opts.show_time){
@@ -0,0 +1,96 @@
+#include "mapped_file.h"
+
+#include<stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+namespace calcprime{
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string&path){
+	HANDLE file=CreateFileA(path.c_str(),GENERIC_READ,FILE_SHARE_READ,nullptr,
+							OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+	if(file==INVALID_HANDLE_VALUE){
+		throw std::runtime_error("Failed to open "+path);
+	}
+	LARGE_INTEGER size{};
+	if(!GetFileSizeEx(file,&size)){
+		CloseHandle(file);
+		throw std::runtime_error("Failed to stat "+path);
+	}
+	file_handle_=file;
+	size_=static_cast<std::size_t>(size.QuadPart);
+	if(size_==0){
+		return;
+	}
+	HANDLE mapping=
+		CreateFileMappingA(file,nullptr,PAGE_READONLY,0,0,nullptr);
+	if(!mapping){
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map "+path);
+	}
+	void*view=MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+	if(!view){
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map "+path);
+	}
+	mapping_handle_=mapping;
+	data_=static_cast<const std::uint8_t*>(view);
+}
+
+MappedFile::~MappedFile(){
+	if(data_){
+		UnmapViewOfFile(data_);
+	}
+	if(mapping_handle_){
+		CloseHandle(static_cast<HANDLE>(mapping_handle_));
+	}
+	if(file_handle_){
+		CloseHandle(static_cast<HANDLE>(file_handle_));
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string&path){
+	int fd=::open(path.c_str(),O_RDONLY);
+	if(fd<0){
+		throw std::runtime_error("Failed to open "+path);
+	}
+	struct stat st{};
+	if(::fstat(fd,&st)!=0){
+		::close(fd);
+		throw std::runtime_error("Failed to stat "+path);
+	}
+	size_=static_cast<std::size_t>(st.st_size);
+	if(size_==0){
+		::close(fd);
+		return;
+	}
+	void*view=::mmap(nullptr,size_,PROT_READ,MAP_SHARED,fd,0);
+	::close(fd);
+	if(view==MAP_FAILED){
+		throw std::runtime_error("Failed to map "+path);
+	}
+	data_=static_cast<const std::uint8_t*>(view);
+}
+
+MappedFile::~MappedFile(){
+	if(data_){
+		::munmap(const_cast<std::uint8_t*>(data_),size_);
+	}
+}
+
+#endif
+
+} // namespace calcprime
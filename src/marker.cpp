@@ -1,13 +1,25 @@
 #include "marker.h"
 
+#include "popcnt.h"
+#include "prime_extract.h"
+
 #include<algorithm>
+#include<limits>
+#include<stdexcept>
 
 namespace calcprime{
 namespace{
 
 std::size_t words_for_bits(std::size_t bits){ return (bits+63)/64; }
-std::uint64_t ceil_div_u64(std::uint64_t value,std::uint64_t divisor){
-	return value/divisor+((value%divisor)!=0ULL?1ULL:0ULL);
+
+// a + b, or UINT64_MAX when the sum does not fit.  Hits are odd multiples
+// and UINT64_MAX is at or past every range end, so a saturated hit reads
+// as "beyond the range" wherever hits are compared against range_end_.
+std::uint64_t saturating_add(std::uint64_t a,std::uint64_t b){
+	if(a>std::numeric_limits<std::uint64_t>::max()-b){
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+	return a+b;
 }
 
 const SmallPrimePattern*find_small_pattern(const Wheel&wheel,
@@ -30,10 +42,10 @@ std::uint64_t PrimeMarker::first_hit(std::uint32_t prime,std::uint64_t start){
 	}
 	std::uint64_t remainder=begin%prime;
 	if(remainder){
-		begin+=prime-remainder;
+		begin=saturating_add(begin,prime-remainder);
 	}
 	if((begin&1ULL)==0){
-		begin+=prime;
+		begin=saturating_add(begin,prime);
 	}
 	return begin;
 }
@@ -44,7 +56,10 @@ PrimeMarker::PrimeMarker(const Wheel&wheel,SegmentConfig config,
 						 std::uint32_t small_prime_limit)
 	: wheel_(wheel),config_(config),range_begin_(range_begin),
 	  range_end_(range_end){
-	std::uint64_t large_threshold=config_.segment_span/2ULL;
+	auto tables=std::make_shared<Tables>();
+	// Up to one segment span a prime is cheaper as a 4-byte medium cursor
+	// scanned every segment than as an 8-byte bucket entry.
+	std::uint64_t large_threshold=config_.segment_span;
 	for(std::uint32_t prime : primes){
 		if(prime<2){
 			continue;
@@ -56,61 +71,89 @@ PrimeMarker::PrimeMarker(const Wheel&wheel,SegmentConfig config,
 			continue; // already removed by wheel presieve
 		}
 		if(prime<=small_prime_limit){
-			small_primes_.push_back(prime);
-			small_initial_.push_back(first_hit(prime,range_begin_));
-			small_prime_patterns_.push_back(find_small_pattern(wheel_,prime));
+			tables->small_primes.push_back(prime);
+			tables->small_initial.push_back(first_hit(prime,range_begin_));
+			tables->small_prime_patterns.push_back(
+				find_small_pattern(wheel_,prime));
 		}else if(static_cast<std::uint64_t>(prime)<=large_threshold){
-			medium_primes_.push_back(prime);
-			medium_initial_.push_back(first_hit(prime,range_begin_));
+			tables->medium_primes.push_back(prime);
 		}else{
-			LargePrimeState state;
-			state.prime=prime;
-			state.stride=static_cast<std::uint64_t>(prime)*2ULL;
-			state.next_value=first_hit(prime,range_begin_);
-			large_primes_template_.push_back(state);
+			tables->large_primes.push_back(prime);
 		}
 	}
+	tables->medium_primes.shrink_to_fit();
+	tables->large_primes.shrink_to_fit();
+	tables_=std::move(tables);
+	init_layout();
 }
 
+PrimeMarker::PrimeMarker(const PrimeMarker&other,SegmentConfig config)
+	: wheel_(other.wheel_),config_(config),range_begin_(other.range_begin_),
+	  range_end_(other.range_end_),tables_(other.tables_){
+	if(config_.segment_span!=other.config_.segment_span||
+	   config_.super_segment_segments!=
+		   other.config_.super_segment_segments){
+		throw std::invalid_argument(
+			"shared sieving tables need the same segment size");
+	}
+	init_layout();
+}
+
+void PrimeMarker::init_layout(){
+	const auto&medium=tables_->medium_primes;
+	tile_medium_count_=static_cast<std::size_t>(
+		std::upper_bound(medium.begin(),medium.end(),
+						 static_cast<std::uint64_t>(config_.tile_bits))-
+		medium.begin());
+	std::uint64_t group=
+		config_.super_segment_segments?config_.super_segment_segments:1;
+	super_span_=config_.segment_span*group;
+	// A hit is at most two primes ahead of the previous one.
+	ring_slots_=1;
+	if(!tables_->large_primes.empty()){
+		if(super_span_/2ULL>(1ULL<<32)){
+			throw std::invalid_argument(
+				"super-segment too large for 32-bit bucket offsets");
+		}
+		ring_slots_=static_cast<std::size_t>(
+			2ULL*tables_->large_primes.back()/super_span_+2ULL);
+	}
+}
+
+// The tables stay shared; a thread only gets cursors, and medium primes
+// get theirs once the sieve reaches p*p.
 PrimeMarker::ThreadState
 PrimeMarker::make_thread_state(std::size_t thread_index,
 							   std::size_t thread_count) const{
-	if(thread_count==0){
-		thread_count=1;
-	}
+	(void)thread_index;
+	(void)thread_count;
 	ThreadState state;
-	state.bucket.reset(0);
-	state.small_positions=small_initial_;
-	state.medium_positions=medium_initial_;
-	state.medium_next.assign(medium_primes_.size(),-1);
-	std::size_t count=0;
-	for(std::size_t i=0;i<large_primes_template_.size();++i){
-		if(i%thread_count==thread_index){
-			++count;
-		}
-	}
-	state.large_states.reserve(count);
-	for(std::size_t i=0;i<large_primes_template_.size();++i){
-		if(i%thread_count!=thread_index){
-			continue;
-		}
-		state.large_states.push_back(large_primes_template_[i]);
-		auto&lp=state.large_states.back();
-		if(lp.next_value>=range_end_){
-			continue;
-		}
-		std::uint64_t segment=(lp.next_value-range_begin_)/config_.segment_span;
-		std::uint64_t base=range_begin_+segment*config_.segment_span;
-		if((base&1ULL)==0){
-			++base;
-		}
-		std::uint64_t offset=(lp.next_value-base)>>1;
-		state.bucket.push(
-			segment,BucketEntry{lp.prime,segment,offset,lp.next_value,&lp});
-	}
+	state.arena=std::make_unique<SieveArena>(config_.huge_pages);
+	state.bits=static_cast<std::uint64_t*>(state.arena->allocate(
+		words_for_bits(static_cast<std::size_t>(config_.segment_span>>1))*
+		sizeof(std::uint64_t)));
+	state.bucket=BucketRing(state.arena.get());
+	state.small_positions=tables_->small_initial;
+	state.medium_offsets.reserve(tables_->medium_primes.size());
 	return state;
 }
 
+std::size_t PrimeMarker::shared_bytes() const{
+	return tables_->small_primes.capacity()*sizeof(std::uint32_t)+
+		   tables_->small_initial.capacity()*sizeof(std::uint64_t)+
+		   tables_->small_prime_patterns.capacity()*
+			   sizeof(const SmallPrimePattern*)+
+		   tables_->medium_primes.capacity()*sizeof(std::uint32_t)+
+		   tables_->large_primes.capacity()*sizeof(std::uint32_t);
+}
+
+std::size_t PrimeMarker::thread_state_bytes(const ThreadState&state) const{
+	return state.arena->reserved_bytes()+state.bucket.index_bytes()+
+		   state.carried.capacity()*sizeof(BucketEntry)+
+		   state.small_positions.capacity()*sizeof(std::uint64_t)+
+		   state.medium_offsets.capacity()*sizeof(std::uint32_t);
+}
+
 void PrimeMarker::apply_small_primes(ThreadState&state,
 									 const TileView&tile) const{
 	if(tile.bit_count==0){
@@ -118,8 +161,9 @@ void PrimeMarker::apply_small_primes(ThreadState&state,
 	}
 	const std::uint32_t tile_bits=static_cast<std::uint32_t>(tile.bit_count);
 	std::uint64_t tile_end=tile.start_value+tile.bit_count*2ULL;
-	for(std::size_t i=0;i<small_primes_.size();++i){
-		std::uint32_t prime=small_primes_[i];
+	const Tables&tables=*tables_;
+	for(std::size_t i=0;i<tables.small_primes.size();++i){
+		std::uint32_t prime=tables.small_primes[i];
 		std::uint64_t step=static_cast<std::uint64_t>(prime)*2ULL;
 		std::uint64_t pos=state.small_positions[i];
 		if(pos<tile.start_value){
@@ -131,7 +175,7 @@ void PrimeMarker::apply_small_primes(ThreadState&state,
 			state.small_positions[i]=pos;
 			continue;
 		}
-		const SmallPrimePattern*pattern=small_prime_patterns_[i];
+		const SmallPrimePattern*pattern=tables.small_prime_patterns[i];
 		if(pattern){
 			std::size_t bit_index=
 				static_cast<std::size_t>((pos-tile.start_value)>>1);
@@ -154,7 +198,7 @@ void PrimeMarker::apply_small_primes(ThreadState&state,
 			}
 			std::uint64_t delta=tile_end-pos;
 			std::uint64_t skip=(delta+step-1)/step;
-			pos+=skip*step;
+			pos=saturating_add(pos,skip*step);
 			state.small_positions[i]=pos;
 		}else{
 			std::uint32_t bit_index=
@@ -170,164 +214,353 @@ void PrimeMarker::apply_small_primes(ThreadState&state,
 	}
 }
 
-void PrimeMarker::apply_medium_primes(ThreadState&state,
-									  const TileView&tile,
+// Brings the medium-prime cursors to `segment_low` and starts the primes
+// whose square is below `segment_high`.  A thread's segments ascend, so
+// after a segment that ends at segment_low there is nothing to do; after a
+// jump every cursor takes one division, and going back starts over.
+void PrimeMarker::start_medium_primes(ThreadState&state,
 									  std::uint64_t segment_low,
-									  std::uint64_t segment_high,
-									  std::size_t tile_index,
-									  std::size_t tile_count) const{
-	if(tile.bit_count==0){
-		return;
+									  std::uint64_t segment_high) const{
+	const auto&medium=tables_->medium_primes;
+	auto&offsets=state.medium_offsets;
+	if(state.medium_base!=segment_low){
+		if(state.medium_base==kNoPosition||segment_low<state.medium_base){
+			offsets.clear();
+		}else{
+			std::uint64_t delta=(segment_low-state.medium_base)>>1;
+			for(std::size_t i=0;i<offsets.size();++i){
+				std::uint64_t prime=medium[i];
+				std::uint64_t offset=offsets[i];
+				if(offset<delta){
+					offset+=(delta-offset+prime-1)/prime*prime;
+				}
+				offsets[i]=static_cast<std::uint32_t>(offset-delta);
+			}
+		}
+		state.medium_base=segment_low;
 	}
-	if(tile_index>=state.medium_tile_heads.size()){
-		return;
+	while(offsets.size()<medium.size()){
+		std::uint32_t prime=medium[offsets.size()];
+		if(static_cast<std::uint64_t>(prime)*prime>=segment_high){
+			break;
+		}
+		offsets.push_back(static_cast<std::uint32_t>(
+			(first_hit(prime,segment_low)-segment_low)>>1));
 	}
-	std::int32_t head=state.medium_tile_heads[tile_index];
-	state.medium_tile_heads[tile_index]=-1;
-	if(head<0){
+}
+
+// Marks the hits of medium primes [first, last) below bit `end_bit` of the
+// segment starting at `bits`.  Cursors count bits from the segment start;
+// `rebase_bits` is subtracted from the stored ones.
+void PrimeMarker::apply_medium_primes(ThreadState&state,std::size_t first,
+									  std::size_t last,std::uint64_t*bits,
+									  std::uint32_t end_bit,
+									  std::uint32_t rebase_bits) const{
+	const auto&medium=tables_->medium_primes;
+	std::uint32_t*offsets=state.medium_offsets.data();
+	for(std::size_t i=first;i<last;++i){
+		std::uint32_t prime=medium[i];
+		std::uint32_t bit_index=offsets[i];
+		while(bit_index<end_bit){
+			bits[bit_index>>6]|=(1ULL<<(bit_index&63U));
+			bit_index+=prime;
+		}
+		offsets[i]=bit_index-rebase_bits;
+	}
+}
+
+void PrimeMarker::file_large_prime(ThreadState&state,
+								   std::uint32_t prime_index,
+								   std::uint64_t value) const{
+	if(value>=range_end_){
 		return;
 	}
-	const std::uint32_t tile_bits=static_cast<std::uint32_t>(tile.bit_count);
-	std::uint64_t tile_end=tile.start_value+tile.bit_count*2ULL;
-	while(head>=0){
-		std::size_t i=static_cast<std::size_t>(head);
-		head=state.medium_next[i];
-		std::uint32_t prime=medium_primes_[i];
-		std::uint64_t step=static_cast<std::uint64_t>(prime)*2ULL;
-		std::uint64_t pos=state.medium_positions[i];
-		if(pos<tile.start_value){
-			std::uint64_t delta=tile.start_value-pos;
-			std::uint64_t skip=(delta+step-1)/step;
-			pos+=skip*step;
+	std::uint64_t super_segment=(value-range_begin_)/super_span_;
+	std::uint64_t offset=
+		(value-range_begin_-super_segment*super_span_)>>1;
+	state.bucket.push(super_segment,
+					  BucketEntry{prime_index,
+								  static_cast<std::uint32_t>(offset)});
+}
+
+// Files the large primes that start hitting before `horizon`, at their
+// first hit from `low` on.  Primes are ascending, so once p*p is past the
+// horizon so is that of every later prime.  `horizon` is at least two
+// primes past `low` unless it is the end of the range.
+void PrimeMarker::file_new_large_primes(ThreadState&state,std::uint64_t low,
+										std::uint64_t horizon) const{
+	for(;state.unfiled_large<tables_->large_primes.size();++state.unfiled_large){
+		std::uint64_t prime=tables_->large_primes[state.unfiled_large];
+		if(prime*prime>=horizon){
+			break;
 		}
-		if(pos<tile_end){
-			std::uint32_t bit_index=
-				static_cast<std::uint32_t>((pos-tile.start_value)>>1);
-			std::uint32_t bit_step=prime;
-			while(bit_index<tile_bits){
-				tile.word_ptr[bit_index>>6]|=(1ULL<<(bit_index&63ULL));
-				bit_index+=bit_step;
+		file_large_prime(state,static_cast<std::uint32_t>(state.unfiled_large),
+						 first_hit(static_cast<std::uint32_t>(prime),low));
+	}
+}
+
+// Drops the ring so that primes are filed afresh from the next
+// super-segment: O(large primes), so done when a thread starts or jumps
+// further than the ring reaches.
+void PrimeMarker::seed_large_primes(ThreadState&state) const{
+	state.bucket.reset(ring_slots_,config_.super_segment_segments?
+									   config_.super_segment_segments:1);
+	state.unfiled_large=0;
+	++state.super_segment_seeds;
+}
+
+// Moves the primes filed under super-segments [first, last), which other
+// threads sieved, to their first hit at or after `last`.  Only primes with
+// a hit in the skipped span are touched.  A prime whose new bucket is one
+// still to be drained here is held back (offset relative to `last`, below
+// one prime) and filed at the end.
+void PrimeMarker::skip_large_primes(ThreadState&state,std::uint64_t first,
+									std::uint64_t last) const{
+	std::uint64_t target=range_begin_+last*super_span_;
+	std::uint64_t mask=state.bucket.slot_count()-1;
+	state.carried.clear();
+	for(std::uint64_t super_segment=first;super_segment<last;
+		++super_segment){
+		std::uint64_t low=range_begin_+super_segment*super_span_;
+		std::uint64_t unvisited=last-super_segment-1;
+		state.bucket.drain(super_segment,[&](const BucketEntry&entry){
+			std::uint64_t stride=
+				static_cast<std::uint64_t>(tables_->large_primes[entry.prime_index])*
+				2ULL;
+			std::uint64_t value=
+				low+(static_cast<std::uint64_t>(entry.offset)<<1);
+			value=saturating_add(value,(target-value+stride-1)/stride*stride);
+			if(value>=range_end_){
+				return;
 			}
-			pos=tile.start_value+(static_cast<std::uint64_t>(bit_index)<<1);
-		}
-		state.medium_positions[i]=pos;
-		if(pos<segment_high){
-			std::size_t next_tile=static_cast<std::size_t>(
-				(pos-segment_low)/config_.tile_span);
-			if(next_tile>=tile_count){
-				next_tile=tile_count-1;
+			std::uint64_t next=(value-range_begin_)/super_span_;
+			if(((next-super_segment-1)&mask)<unvisited){
+				state.carried.push_back(BucketEntry{
+					entry.prime_index,
+					static_cast<std::uint32_t>((value-target)>>1)});
+			}else{
+				file_large_prime(state,entry.prime_index,value);
 			}
-			state.medium_next[i]=state.medium_tile_heads[next_tile];
-			state.medium_tile_heads[next_tile]=static_cast<std::int32_t>(i);
-		}else{
-			state.medium_next[i]=-1;
-		}
+		});
+	}
+	for(const auto&entry : state.carried){
+		file_large_prime(state,entry.prime_index,
+						 target+(static_cast<std::uint64_t>(entry.offset)<<1));
 	}
 }
 
-void PrimeMarker::apply_large_primes(ThreadState&state,std::uint64_t segment_id,
-									 std::uint64_t segment_low,
-									 std::uint64_t segment_high,
-									 std::vector<std::uint64_t>&bitset) const{
-	auto hits=state.bucket.take(segment_id);
-	for(auto&entry : hits){
-		if(entry.value>=segment_low&&entry.value<segment_high){
-			std::size_t bit_index=(entry.value-segment_low)>>1;
-			bitset[bit_index/64]|=(1ULL<<(bit_index%64));
-		}
-		if(!entry.owner){
-			continue;
-		}
-		std::uint64_t next=entry.value+entry.owner->stride;
-		entry.owner->next_value=next;
-		if(next>=range_end_){
-			continue;
+// Moves the primes still in the near buckets of the loaded super-segment,
+// those of segments this thread did not sieve, past its end.
+void PrimeMarker::finish_super_segment(ThreadState&state) const{
+	std::uint64_t low=range_begin_+state.loaded_super_segment*super_span_;
+	std::uint64_t high=
+		range_end_-low>super_span_?low+super_span_:range_end_;
+	std::size_t group=
+		config_.super_segment_segments?config_.super_segment_segments:1;
+	for(std::size_t segment=state.next_near_segment;segment<group;
+		++segment){
+		state.bucket.drain_near(segment,[&](const BucketEntry&entry){
+			std::uint64_t stride=static_cast<std::uint64_t>(
+									 tables_->large_primes[entry.prime_index])*
+								 2ULL;
+			std::uint64_t value=
+				low+(static_cast<std::uint64_t>(entry.offset)<<1);
+			while(value<high){
+				value=saturating_add(value,stride);
+			}
+			file_large_prime(state,entry.prime_index,value);
+		});
+	}
+	state.next_near_segment=group;
+}
+
+// Spreads the primes due in the super-segment over the near buckets of its
+// segments.  Near buckets hold the same entries, so a prime that hits
+// several segments of the group moves between them without going back to
+// the ring.
+void PrimeMarker::load_super_segment(ThreadState&state,
+									 std::uint64_t super_segment) const{
+	if(state.loaded_super_segment!=kNoSuperSegment&&
+	   super_segment>state.loaded_super_segment){
+		finish_super_segment(state);
+	}
+	std::uint64_t expected=state.next_super_segment;
+	if(expected==kNoSuperSegment||super_segment<expected||
+	   super_segment-expected>=state.bucket.slot_count()){
+		seed_large_primes(state);
+	}else if(super_segment>expected){
+		skip_large_primes(state,expected,super_segment);
+	}
+	std::uint64_t low=range_begin_+super_segment*super_span_;
+	std::uint64_t reach=(state.bucket.slot_count()-1)*super_span_;
+	file_new_large_primes(state,low,
+						  range_end_-low>reach?low+reach:range_end_);
+	std::uint64_t segment_bits=config_.segment_span>>1;
+	state.bucket.drain(super_segment,[&](const BucketEntry&entry){
+		state.bucket.push_near(
+			static_cast<std::size_t>(entry.offset/segment_bits),entry);
+	});
+	state.loaded_super_segment=super_segment;
+	state.next_super_segment=super_segment+1;
+	state.next_near_segment=0;
+}
+
+// Marks the hit of every prime in the near bucket of `segment` of the
+// loaded super-segment, or only advances them when `bits` is null, and
+// files each under the segment or super-segment of its next hit.  Large
+// primes exceed a segment span, so they hit a segment at most once.
+void PrimeMarker::apply_near_bucket(ThreadState&state,std::size_t segment,
+									std::uint64_t*bits) const{
+	std::uint64_t low=range_begin_+state.loaded_super_segment*super_span_;
+	std::uint64_t segment_bits=config_.segment_span>>1;
+	std::uint64_t super_bits=super_span_>>1;
+	std::uint64_t first_bit=static_cast<std::uint64_t>(segment)*segment_bits;
+	state.bucket.drain_near(segment,[&](const BucketEntry&entry){
+		std::uint64_t offset=entry.offset;
+		if(bits){
+			std::uint64_t bit_index=offset-first_bit;
+			bits[bit_index>>6]|=(1ULL<<(bit_index&63U));
 		}
-		std::uint64_t seg=(next-range_begin_)/config_.segment_span;
-		std::uint64_t base=range_begin_+seg*config_.segment_span;
-		if((base&1ULL)==0){
-			++base;
+		offset+=tables_->large_primes[entry.prime_index];
+		std::uint64_t value=saturating_add(low,offset<<1);
+		if(offset>=super_bits){
+			file_large_prime(state,entry.prime_index,value);
+		}else if(value<range_end_){
+			state.bucket.push_near(
+				static_cast<std::size_t>(offset/segment_bits),
+				BucketEntry{entry.prime_index,
+							static_cast<std::uint32_t>(offset)});
 		}
-		std::uint64_t offset=(next-base)>>1;
-		state.bucket.push(
-			seg,BucketEntry{entry.owner->prime,seg,offset,next,entry.owner});
+	});
+}
+
+void PrimeMarker::apply_large_primes(ThreadState&state,std::uint64_t segment_id,
+									 std::uint64_t*bits) const{
+	if(tables_->large_primes.empty()){
+		return;
+	}
+	std::uint64_t group=
+		config_.super_segment_segments?config_.super_segment_segments:1;
+	std::uint64_t super_segment=segment_id/group;
+	std::size_t segment=static_cast<std::size_t>(segment_id%group);
+	if(super_segment==state.loaded_super_segment&&
+	   segment<state.next_near_segment){
+		// Back within the super-segment: start over.
+		state.loaded_super_segment=kNoSuperSegment;
+		state.next_super_segment=kNoSuperSegment;
+	}
+	if(super_segment!=state.loaded_super_segment){
+		load_super_segment(state,super_segment);
+	}
+	for(;state.next_near_segment<segment;++state.next_near_segment){
+		apply_near_bucket(state,state.next_near_segment,nullptr);
 	}
+	apply_near_bucket(state,segment,bits);
+	state.next_near_segment=segment+1;
 }
 
-void PrimeMarker::sieve_segment(ThreadState&state,std::uint64_t segment_id,
-								std::uint64_t segment_low,
-								std::uint64_t segment_high,
-								std::vector<std::uint64_t>&bitset) const{
+// Large primes and the medium primes that do not hit every tile are
+// applied to the whole segment before the tile loop, so a tile is final
+// once its small and dense medium passes are done.
+template<typename OnTile>
+void PrimeMarker::sieve_tiles(ThreadState&state,std::uint64_t segment_id,
+							  std::uint64_t segment_low,
+							  std::uint64_t segment_high,
+							  OnTile&&on_tile) const{
 	if(segment_high<=segment_low){
-		bitset.clear();
 		return;
 	}
 	std::size_t bit_count=
 		static_cast<std::size_t>((segment_high-segment_low)>>1);
 	if(bit_count==0){
-		bitset.clear();
 		return;
 	}
-	std::size_t word_count=words_for_bits(bit_count);
-	bitset.resize(word_count);
+	std::uint64_t*bits=state.bits;
 
-	wheel_.fill_presieve(segment_low,bit_count,bitset.data());
-	apply_large_primes(state,segment_id,segment_low,segment_high,bitset);
+	wheel_.fill_presieve(segment_low,bit_count,bits);
+	apply_large_primes(state,segment_id,bits);
 
-	std::size_t tile_count=
-		static_cast<std::size_t>(ceil_div_u64(
-			segment_high-segment_low,config_.tile_span));
-	if(tile_count==0){
-		tile_count=1;
-	}
-	state.medium_tile_heads.assign(tile_count,-1);
-	if(state.medium_next.size()!=medium_primes_.size()){
-		state.medium_next.assign(medium_primes_.size(),-1);
-	}
-	for(std::size_t i=0;i<medium_primes_.size();++i){
-		std::uint32_t prime=medium_primes_[i];
-		std::uint64_t step=static_cast<std::uint64_t>(prime)*2ULL;
-		std::uint64_t pos=state.medium_positions[i];
-		if(pos<segment_low){
-			std::uint64_t delta=segment_low-pos;
-			std::uint64_t skip=(delta+step-1)/step;
-			pos+=skip*step;
-			state.medium_positions[i]=pos;
-		}
-		if(pos>=segment_high){
-			state.medium_next[i]=-1;
-			continue;
-		}
-		std::size_t next_tile=static_cast<std::size_t>(
-			(pos-segment_low)/config_.tile_span);
-		if(next_tile>=tile_count){
-			next_tile=tile_count-1;
-		}
-		state.medium_next[i]=state.medium_tile_heads[next_tile];
-		state.medium_tile_heads[next_tile]=static_cast<std::int32_t>(i);
-	}
+	start_medium_primes(state,segment_low,segment_high);
+	std::size_t started=state.medium_offsets.size();
+	std::size_t tile_medium=std::min(tile_medium_count_,started);
+	std::uint32_t segment_bits=static_cast<std::uint32_t>(bit_count);
+	apply_medium_primes(state,tile_medium,started,bits,segment_bits,
+						segment_bits);
 
 	std::uint64_t tile_low=segment_low;
 	std::size_t bit_offset=0;
-	std::size_t tile_index=0;
 	while(tile_low<segment_high){
-		std::uint64_t tile_high=
-			std::min<std::uint64_t>(segment_high,tile_low+config_.tile_span);
+		std::uint64_t tile_high=segment_high-tile_low>config_.tile_span
+									?tile_low+config_.tile_span
+									:segment_high;
 		std::size_t tile_bits=static_cast<std::size_t>((tile_high-tile_low)>>1);
 		std::size_t tile_words=words_for_bits(tile_bits);
 		TileView tile{tile_low,bit_offset,tile_bits,
-					  bitset.data()+(bit_offset/64),tile_words};
+					  bits+(bit_offset/64),tile_words};
 		apply_small_primes(state,tile);
-		apply_medium_primes(state,tile,segment_low,segment_high,tile_index,
-							tile_count);
+		apply_medium_primes(state,0,tile_medium,bits,
+							static_cast<std::uint32_t>(bit_offset+tile_bits),
+							tile_high==segment_high?segment_bits:0U);
 		if(tile_bits%64!=0&&tile_words>0){
 			std::uint64_t mask=(1ULL<<(tile_bits%64))-1;
 			tile.word_ptr[tile_words-1]&=mask;
 		}
+		on_tile(tile);
 		tile_low=tile_high;
 		bit_offset+=tile_bits;
-		++tile_index;
 	}
+	state.medium_base=segment_high;
+}
+
+const std::uint64_t*PrimeMarker::sieve_segment(
+	ThreadState&state,std::uint64_t segment_id,std::uint64_t segment_low,
+	std::uint64_t segment_high) const{
+	sieve_tiles(state,segment_id,segment_low,segment_high,
+				[](const TileView&){});
+	return state.bits;
+}
+
+std::uint64_t PrimeMarker::sieve_segment_count(
+	ThreadState&state,std::uint64_t segment_id,std::uint64_t segment_low,
+	std::uint64_t segment_high) const{
+	std::uint64_t count=0;
+	sieve_tiles(state,segment_id,segment_low,segment_high,
+				[&](const TileView&tile){
+					count+=count_zero_bits(tile.word_ptr,tile.bit_count);
+				});
+	return count;
+}
+
+std::uint64_t PrimeMarker::sieve_segment_primes(
+	ThreadState&state,std::uint64_t segment_id,std::uint64_t segment_low,
+	std::uint64_t segment_high,std::vector<std::uint64_t>&primes) const{
+	std::size_t old_size=primes.size();
+	sieve_tiles(state,segment_id,segment_low,segment_high,
+				[&](const TileView&tile){
+					append_primes(tile.word_ptr,tile.bit_count,
+								  tile.start_value,primes);
+				});
+	return static_cast<std::uint64_t>(primes.size()-old_size);
+}
+
+std::uint64_t PrimeMarker::sieve_segment_nth(
+	ThreadState&state,std::uint64_t segment_id,std::uint64_t segment_low,
+	std::uint64_t segment_high,std::uint64_t rank,
+	std::uint64_t&nth_value) const{
+	std::uint64_t count=0;
+	nth_value=0;
+	sieve_tiles(state,segment_id,segment_low,segment_high,
+				[&](const TileView&tile){
+					std::uint64_t tile_count=
+						count_zero_bits(tile.word_ptr,tile.bit_count);
+					if(rank>count&&rank<=count+tile_count){
+						nth_value=select_prime(tile.word_ptr,tile.bit_count,
+											   tile.start_value,
+											   rank-count-1);
+					}
+					count+=tile_count;
+				});
+	return count;
 }
 
 } // namespace calcprime
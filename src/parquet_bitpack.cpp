@@ -0,0 +1,222 @@
+#include "parquet_bitpack.h"
+
+#include<algorithm>
+#include<cstddef>
+#include<cstdint>
+#include<cstring>
+
+#if defined(__AVX2__)
+#include<immintrin.h>
+#endif
+
+namespace calcprime::parquet{
+
+namespace{
+
+// Generic LSB-first packer through a 64-bit accumulator.  Handles every width
+// from 1 to 64 and only writes the 4*width payload bytes.
+template<class T>
+std::size_t pack_scalar(const T*values,T base,unsigned width,
+						std::uint8_t*out) noexcept{
+	std::uint8_t*dest=out;
+	std::uint64_t buffer=0;
+	unsigned buffered_bits=0;
+	for(std::size_t i=0;i<kMiniBlockValues;++i){
+		std::uint64_t value=static_cast<std::uint64_t>(
+			static_cast<T>(values[i]-base));
+		buffer|=value<<buffered_bits;
+		unsigned total=buffered_bits+width;
+		if(total>=64U){
+			std::memcpy(dest,&buffer,sizeof(buffer));
+			dest+=sizeof(buffer);
+			unsigned consumed=64U-buffered_bits;
+			buffer=(consumed==64U)?0:(value>>consumed);
+			total-=64U;
+		}
+		buffered_bits=total;
+	}
+	while(buffered_bits>0){
+		*dest++=static_cast<std::uint8_t>(buffer);
+		buffer>>=8U;
+		buffered_bits=buffered_bits>8U?buffered_bits-8U:0U;
+	}
+	return static_cast<std::size_t>(dest-out);
+}
+
+#if defined(__AVX2__)
+
+std::uint16_t horizontal_min_u16(__m128i v) noexcept{
+	return static_cast<std::uint16_t>(
+		_mm_cvtsi128_si32(_mm_minpos_epu16(v)));
+}
+
+// Packs 32 values already reduced to `width` bits (1..16).  Adjacent lanes
+// are merged pairwise (16->32->64->128 bits) so that every 128-bit lane ends
+// up holding eight consecutive values in exactly `width` bytes; the four
+// lanes are then stored back to back with overlapping 16-byte writes.
+std::size_t pack_u16_avx2(__m256i lo,__m256i hi,unsigned width,
+						  std::uint8_t*out) noexcept{
+	const __m128i shift1=_mm_cvtsi32_si128(static_cast<int>(width));
+	const __m128i shift2=_mm_cvtsi32_si128(static_cast<int>(2U*width));
+	const __m128i shift4=_mm_cvtsi32_si128(static_cast<int>(4U*width));
+	const __m128i shift4_rev=
+		_mm_cvtsi32_si128(static_cast<int>(64U-4U*width));
+	const __m256i mask16=_mm256_set1_epi32(0x0000ffff);
+	const __m256i mask32=_mm256_set1_epi64x(0x00000000ffffffffLL);
+	const __m256i mask64=_mm256_setr_epi64x(-1,0,-1,0);
+
+	auto merge=[&](__m256i v){
+		v=_mm256_or_si256(_mm256_and_si256(v,mask16),
+						  _mm256_sll_epi32(_mm256_srli_epi32(v,16),shift1));
+		v=_mm256_or_si256(_mm256_and_si256(v,mask32),
+						  _mm256_sll_epi64(_mm256_srli_epi64(v,32),shift2));
+		__m256i upper=_mm256_srli_si256(v,8);
+		__m256i carry=_mm256_slli_si256(_mm256_srl_epi64(upper,shift4_rev),8);
+		return _mm256_or_si256(
+			_mm256_or_si256(_mm256_and_si256(v,mask64),
+							_mm256_sll_epi64(upper,shift4)),
+			carry);
+	};
+
+	__m256i a=merge(lo);
+	__m256i b=merge(hi);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+					 _mm256_castsi256_si128(a));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out+width),
+					 _mm256_extracti128_si256(a,1));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out+2U*width),
+					 _mm256_castsi256_si128(b));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out+3U*width),
+					 _mm256_extracti128_si256(b,1));
+	return 4U*width;
+}
+
+#endif
+
+} // namespace
+
+bool bitpack_uses_avx2() noexcept{
+#if defined(__AVX2__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void miniblock_min_max_u16_scalar(const std::uint16_t*values,
+								  std::uint16_t&min_value,
+								  std::uint16_t&max_value) noexcept{
+	std::uint16_t lo=values[0];
+	std::uint16_t hi=values[0];
+	for(std::size_t i=1;i<kMiniBlockValues;++i){
+		lo=std::min(lo,values[i]);
+		hi=std::max(hi,values[i]);
+	}
+	min_value=lo;
+	max_value=hi;
+}
+
+std::size_t pack_miniblock_u16_scalar(const std::uint16_t*values,
+									  std::uint16_t base,unsigned width,
+									  std::uint8_t*out) noexcept{
+	if(width==0){
+		return 0;
+	}
+	return pack_scalar(values,base,width,out);
+}
+
+void miniblock_min_max_u16(const std::uint16_t*values,std::uint16_t&min_value,
+						   std::uint16_t&max_value) noexcept{
+#if defined(__AVX2__)
+	__m256i lo=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+	__m256i hi=_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values+16));
+	__m256i mins=_mm256_min_epu16(lo,hi);
+	__m256i maxs=_mm256_max_epu16(lo,hi);
+	__m128i min128=_mm_min_epu16(_mm256_castsi256_si128(mins),
+								 _mm256_extracti128_si256(mins,1));
+	__m128i max128=_mm_max_epu16(_mm256_castsi256_si128(maxs),
+								 _mm256_extracti128_si256(maxs,1));
+	// PHMINPOSUW only finds minima; max(x) == ~min(~x).
+	min_value=horizontal_min_u16(min128);
+	max_value=static_cast<std::uint16_t>(
+		~horizontal_min_u16(_mm_xor_si128(max128,_mm_set1_epi32(-1))));
+#else
+	miniblock_min_max_u16_scalar(values,min_value,max_value);
+#endif
+}
+
+void miniblock_min_max_u64(const std::uint64_t*values,std::uint64_t&min_value,
+						   std::uint64_t&max_value) noexcept{
+#if defined(__AVX2__)
+	// AVX2 only has signed 64-bit compares; flipping the sign bit maps the
+	// unsigned order onto the signed one.
+	const __m256i bias=_mm256_set1_epi64x(
+		static_cast<long long>(0x8000000000000000ULL));
+	__m256i mins=_mm256_xor_si256(
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)),bias);
+	__m256i maxs=mins;
+	for(std::size_t i=4;i<kMiniBlockValues;i+=4){
+		__m256i v=_mm256_xor_si256(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values+i)),
+			bias);
+		mins=_mm256_blendv_epi8(mins,v,_mm256_cmpgt_epi64(mins,v));
+		maxs=_mm256_blendv_epi8(maxs,v,_mm256_cmpgt_epi64(v,maxs));
+	}
+	alignas(32) std::uint64_t min_lanes[4];
+	alignas(32) std::uint64_t max_lanes[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(min_lanes),
+					   _mm256_xor_si256(mins,bias));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(max_lanes),
+					   _mm256_xor_si256(maxs,bias));
+	min_value=std::min(std::min(min_lanes[0],min_lanes[1]),
+					   std::min(min_lanes[2],min_lanes[3]));
+	max_value=std::max(std::max(max_lanes[0],max_lanes[1]),
+					   std::max(max_lanes[2],max_lanes[3]));
+#else
+	std::uint64_t lo=values[0];
+	std::uint64_t hi=values[0];
+	for(std::size_t i=1;i<kMiniBlockValues;++i){
+		lo=std::min(lo,values[i]);
+		hi=std::max(hi,values[i]);
+	}
+	min_value=lo;
+	max_value=hi;
+#endif
+}
+
+std::size_t pack_miniblock_u16(const std::uint16_t*values,std::uint16_t base,
+							   unsigned width,std::uint8_t*out) noexcept{
+	if(width==0){
+		return 0;
+	}
+#if defined(__AVX2__)
+	const __m256i base_vec=_mm256_set1_epi16(static_cast<short>(base));
+	__m256i lo=_mm256_sub_epi16(
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)),base_vec);
+	__m256i hi=_mm256_sub_epi16(
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values+16)),
+		base_vec);
+	return pack_u16_avx2(lo,hi,width,out);
+#else
+	return pack_scalar(values,base,width,out);
+#endif
+}
+
+std::size_t pack_miniblock_u64(const std::uint64_t*values,std::uint64_t base,
+							   unsigned width,std::uint8_t*out) noexcept{
+	if(width==0){
+		return 0;
+	}
+	if(width<=16U){
+		// Blocks that only fall back to 64-bit deltas because of a single
+		// large gap still have mostly narrow miniblocks.
+		alignas(32) std::uint16_t narrow[kMiniBlockValues];
+		for(std::size_t i=0;i<kMiniBlockValues;++i){
+			narrow[i]=static_cast<std::uint16_t>(values[i]-base);
+		}
+		return pack_miniblock_u16(narrow,0,width,out);
+	}
+	return pack_scalar(values,base,width,out);
+}
+
+} // namespace calcprime::parquet
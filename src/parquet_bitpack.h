@@ -0,0 +1,42 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+
+namespace calcprime::parquet{
+
+// DELTA_BINARY_PACKED miniblocks always hold 32 values in this encoder.
+constexpr std::size_t kMiniBlockValues=32;
+
+// Packing kernels store whole 16-byte vectors, so the destination must have
+// this many writable bytes past the packed payload.
+constexpr std::size_t kBitPackSlack=16;
+
+// True when the kernels below were compiled with AVX2.
+bool bitpack_uses_avx2() noexcept;
+
+// Minimum and maximum of one full miniblock.
+void miniblock_min_max_u16(const std::uint16_t*values,std::uint16_t&min_value,
+						   std::uint16_t&max_value) noexcept;
+void miniblock_min_max_u64(const std::uint64_t*values,std::uint64_t&min_value,
+						   std::uint64_t&max_value) noexcept;
+
+// Packs (values[i]-base) for one full miniblock LSB-first at `width` bits,
+// as required by the Parquet bit-packed layout.  Every value minus `base`
+// must fit in `width` bits.  Writes exactly 4*width bytes of payload
+// (plus up to kBitPackSlack scratch bytes) and returns 4*width.
+std::size_t pack_miniblock_u16(const std::uint16_t*values,std::uint16_t base,
+							   unsigned width,std::uint8_t*out) noexcept;
+std::size_t pack_miniblock_u64(const std::uint64_t*values,std::uint64_t base,
+							   unsigned width,std::uint8_t*out) noexcept;
+
+// Portable reference implementations; the public kernels dispatch to these
+// when AVX2 is not available at compile time.
+void miniblock_min_max_u16_scalar(const std::uint16_t*values,
+								  std::uint16_t&min_value,
+								  std::uint16_t&max_value) noexcept;
+std::size_t pack_miniblock_u16_scalar(const std::uint16_t*values,
+									  std::uint16_t base,unsigned width,
+									  std::uint8_t*out) noexcept;
+
+} // namespace calcprime::parquet
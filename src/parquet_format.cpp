@@ -1,9 +1,12 @@
 #include "parquet_format.h"
+#include "parquet_bitpack.h"
+#include "prefix_sum.h"
 
 #include<algorithm>
 #include<bit>
 #include<cstddef>
 #include<cstdint>
+#include<cstring>
 #include<limits>
 #include<stdexcept>
 #include<string>
@@ -85,6 +88,19 @@ void append_binary_field(std::string&out,std::int16_t&last_field,
 	out.append(value);
 }
 
+void append_plain_u64(std::string&out,std::uint64_t value){
+	for(unsigned shift=0;shift<64U;shift+=8U){
+		out.push_back(static_cast<char>((value>>shift)&0xffU));
+	}
+}
+
+void append_u64_binary_field(std::string&out,std::int16_t&last_field,
+							 std::int16_t field,std::uint64_t value){
+	append_field_header(out,last_field,field,CompactBinary);
+	append_uvarint(out,sizeof(std::uint64_t));
+	append_plain_u64(out,value);
+}
+
 void append_list_header(std::string&out,std::size_t size,
 						CompactType element_type){
 	if(size<=14){
@@ -131,6 +147,19 @@ void append_prime_schema(std::string&out){
 	append_stop(out);
 }
 
+// Only min_value/max_value (fields 5/6) are written: the deprecated min/max
+// fields use signed ordering, which is wrong for the UINT_64 column.
+void append_statistics(std::string&out,std::uint64_t min_value,
+					   std::uint64_t max_value){
+	std::int16_t last=0;
+	append_i64_field(out,last,3,0); // null_count
+	append_u64_binary_field(out,last,5,max_value);
+	append_u64_binary_field(out,last,6,min_value);
+	append_bool_field(out,last,7,true); // is_max_value_exact
+	append_bool_field(out,last,8,true); // is_min_value_exact
+	append_stop(out);
+}
+
 void append_column_metadata(std::string&out,const RowGroupMetadata&row_group,
 							bool use_zstd,ValueEncoding encoding){
 	std::int16_t last=0;
@@ -151,6 +180,8 @@ void append_column_metadata(std::string&out,const RowGroupMetadata&row_group,
 	append_i64_field(out,last,6,row_group.total_uncompressed_size);
 	append_i64_field(out,last,7,row_group.total_compressed_size);
 	append_i64_field(out,last,9,row_group.data_page_offset);
+	append_field_header(out,last,12,CompactStruct);
+	append_statistics(out,row_group.min_value,row_group.max_value);
 	append_stop(out);
 }
 
@@ -162,6 +193,14 @@ void append_column_chunk(std::string&out,const RowGroupMetadata&row_group,
 	append_i64_field(out,last,2,0);
 	append_field_header(out,last,3,CompactStruct);
 	append_column_metadata(out,row_group,use_zstd,encoding);
+	if(row_group.offset_index_offset>=0){
+		append_i64_field(out,last,4,row_group.offset_index_offset);
+		append_i32_field(out,last,5,row_group.offset_index_length);
+	}
+	if(row_group.column_index_offset>=0){
+		append_i64_field(out,last,6,row_group.column_index_offset);
+		append_i32_field(out,last,7,row_group.column_index_length);
+	}
 	append_stop(out);
 }
 
@@ -173,18 +212,31 @@ void append_row_group(std::string&out,const RowGroupMetadata&row_group,
 	append_column_chunk(out,row_group,use_zstd,encoding);
 	append_i64_field(out,last,2,row_group.total_uncompressed_size);
 	append_i64_field(out,last,3,row_group.num_values);
+	// SortingColumn{column_idx=0, descending=false, nulls_first=false}
+	append_field_header(out,last,4,CompactList);
+	append_list_header(out,1,CompactStruct);
+	{
+		std::int16_t sort_last=0;
+		append_i32_field(out,sort_last,1,0);
+		append_bool_field(out,sort_last,2,false);
+		append_bool_field(out,sort_last,3,false);
+		append_stop(out);
+	}
 	append_i64_field(out,last,5,row_group.data_page_offset);
 	append_i64_field(out,last,6,row_group.total_compressed_size);
 	append_stop(out);
 }
 
 void append_data_page_header(std::string&out,std::int32_t num_values,
-							 ValueEncoding encoding){
+							 ValueEncoding encoding,std::uint64_t min_value,
+							 std::uint64_t max_value){
 	std::int16_t last=0;
 	append_i32_field(out,last,1,num_values);
 	append_i32_field(out,last,2,static_cast<std::int32_t>(encoding));
 	append_i32_field(out,last,3,3); // Encoding::RLE
 	append_i32_field(out,last,4,3); // Encoding::RLE
+	append_field_header(out,last,5,CompactStruct);
+	append_statistics(out,min_value,max_value);
 	append_stop(out);
 }
 
@@ -192,73 +244,83 @@ unsigned bit_width(std::uint64_t value){
 	return value==0?0U:64U-std::countl_zero(value);
 }
 
-void append_bit_packed(std::string&out,const std::uint64_t*values,
-					   std::size_t count,unsigned width){
-	if(width==0){
-		return;
-	}
-	std::uint64_t buffer=0;
-	unsigned buffered_bits=0;
-	for(std::size_t i=0;i<count;++i){
-		std::uint64_t value=values[i];
-		unsigned remaining=width;
-		while(remaining>0){
-			unsigned room=64U-buffered_bits;
-			unsigned take=std::min(remaining,room);
-			std::uint64_t mask=
-				(take==64U)?std::numeric_limits<std::uint64_t>::max()
-						   :((std::uint64_t{1}<<take)-1U);
-			buffer|=(value&mask)<<buffered_bits;
-			if(take<64U){
-				value>>=take;
-			}
-			buffered_bits+=take;
-			remaining-=take;
-			while(buffered_bits>=8U){
-				out.push_back(static_cast<char>(buffer&0xffU));
-				buffer>>=8U;
-				buffered_bits-=8U;
-			}
-		}
-	}
-	if(buffered_bits!=0U){
-		out.push_back(static_cast<char>(buffer&0xffU));
+std::size_t put_uvarint(std::uint8_t*out,std::uint64_t value){
+	std::size_t written=0;
+	while(value>=0x80U){
+		out[written++]=static_cast<std::uint8_t>((value&0x7fU)|0x80U);
+		value>>=7U;
 	}
+	out[written++]=static_cast<std::uint8_t>(value);
+	return written;
+}
+
+// Upper bound for one encoded block: min_delta varint, the bit-width bytes
+// and every used miniblock packed at the widest width a Delta can need.
+template<class Delta>
+std::size_t max_delta_block_bytes(std::size_t mini_block_count){
+	return 10U+mini_block_count+mini_block_count*4U*(sizeof(Delta)*8U)+
+		   kBitPackSlack;
 }
 
+// Writes one DELTA_BINARY_PACKED block for `count` deltas into `out`, which
+// must hold max_delta_block_bytes<Delta>() bytes.  `max_values` is scratch
+// space for mini_block_count entries.  Returns the bytes written.
 template<class Delta>
-void append_delta_block(std::string&out,const std::vector<Delta>&deltas,
-						std::size_t mini_block_count,
-						std::size_t values_per_mini_block){
-	Delta min_delta=*std::min_element(deltas.begin(),deltas.end());
-	append_uvarint(out,zigzag_i64(static_cast<std::int64_t>(min_delta)));
-
-	std::vector<std::uint8_t> widths(mini_block_count,0);
-	std::size_t used_mini_blocks=
-		(deltas.size()+values_per_mini_block-1U)/values_per_mini_block;
+std::size_t write_delta_block(std::uint8_t*out,const Delta*deltas,
+							  std::size_t count,std::size_t mini_block_count,
+							  std::uint64_t*max_values){
+	std::size_t full_mini_blocks=count/kMiniBlockValues;
+	std::size_t tail_count=count-full_mini_blocks*kMiniBlockValues;
+	std::size_t used_mini_blocks=full_mini_blocks+(tail_count!=0U?1U:0U);
+
+	// The final miniblock of a page is usually partial; pad it with one of
+	// its own values so the min/max kernels always see 32 entries.
+	alignas(32) Delta tail[kMiniBlockValues];
+	if(tail_count!=0U){
+		const Delta*src=deltas+full_mini_blocks*kMiniBlockValues;
+		std::copy(src,src+tail_count,tail);
+		std::fill(tail+tail_count,tail+kMiniBlockValues,src[0]);
+	}
+	auto mini_block=[&](std::size_t mini)->const Delta*{
+		return mini<full_mini_blocks?deltas+mini*kMiniBlockValues:tail;
+	};
+
+	Delta min_delta=std::numeric_limits<Delta>::max();
 	for(std::size_t mini=0;mini<used_mini_blocks;++mini){
-		std::size_t begin=mini*values_per_mini_block;
-		std::size_t end=std::min(begin+values_per_mini_block,deltas.size());
-		std::uint64_t max_adjusted=0;
-		for(std::size_t i=begin;i<end;++i){
-			max_adjusted=std::max(
-				max_adjusted,static_cast<std::uint64_t>(deltas[i]-min_delta));
+		Delta lo;
+		Delta hi;
+		if constexpr(sizeof(Delta)==sizeof(std::uint16_t)){
+			miniblock_min_max_u16(mini_block(mini),lo,hi);
+		}else{
+			miniblock_min_max_u64(mini_block(mini),lo,hi);
 		}
-		widths[mini]=static_cast<std::uint8_t>(bit_width(max_adjusted));
+		min_delta=std::min(min_delta,lo);
+		max_values[mini]=hi;
+	}
+	if(tail_count!=0U){
+		// Padding packs as zero once min_delta is subtracted.
+		std::fill(tail+tail_count,tail+kMiniBlockValues,min_delta);
 	}
-	out.append(reinterpret_cast<const char*>(widths.data()),widths.size());
 
-	std::vector<std::uint64_t> adjusted(values_per_mini_block,0);
+	std::uint8_t*dest=out;
+	dest+=put_uvarint(dest,zigzag_i64(static_cast<std::int64_t>(min_delta)));
+	std::uint8_t*widths=dest;
+	std::fill(widths,widths+mini_block_count,0);
 	for(std::size_t mini=0;mini<used_mini_blocks;++mini){
-		std::fill(adjusted.begin(),adjusted.end(),0);
-		std::size_t begin=mini*values_per_mini_block;
-		std::size_t end=std::min(begin+values_per_mini_block,deltas.size());
-		for(std::size_t i=begin;i<end;++i){
-			adjusted[i-begin]=
-				static_cast<std::uint64_t>(deltas[i]-min_delta);
+		widths[mini]=static_cast<std::uint8_t>(
+			bit_width(max_values[mini]-static_cast<std::uint64_t>(min_delta)));
+	}
+	dest+=mini_block_count;
+	for(std::size_t mini=0;mini<used_mini_blocks;++mini){
+		if constexpr(sizeof(Delta)==sizeof(std::uint16_t)){
+			dest+=pack_miniblock_u16(mini_block(mini),min_delta,widths[mini],
+									 dest);
+		}else{
+			dest+=pack_miniblock_u64(mini_block(mini),min_delta,widths[mini],
+									 dest);
 		}
-		append_bit_packed(out,adjusted.data(),adjusted.size(),widths[mini]);
 	}
+	return static_cast<std::size_t>(dest-out);
 }
 
 } // namespace
@@ -266,15 +328,65 @@ void append_delta_block(std::string&out,const std::vector<Delta>&deltas,
 std::string make_data_page_header(std::int32_t num_values,
 								  std::int32_t uncompressed_size,
 								  std::int32_t compressed_size,
-								  ValueEncoding encoding){
+								  ValueEncoding encoding,
+								  std::uint64_t min_value,
+								  std::uint64_t max_value){
 	std::string out;
-	out.reserve(32);
+	out.reserve(64);
 	std::int16_t last=0;
 	append_i32_field(out,last,1,0); // PageType::DATA_PAGE
 	append_i32_field(out,last,2,uncompressed_size);
 	append_i32_field(out,last,3,compressed_size);
 	append_field_header(out,last,5,CompactStruct);
-	append_data_page_header(out,num_values,encoding);
+	append_data_page_header(out,num_values,encoding,min_value,max_value);
+	append_stop(out);
+	return out;
+}
+
+std::string make_column_index(const std::vector<PageMetadata>&pages){
+	std::string out;
+	out.reserve(16+pages.size()*24);
+	std::int16_t last=0;
+	append_field_header(out,last,1,CompactList); // null_pages
+	append_list_header(out,pages.size(),CompactBooleanTrue);
+	for(std::size_t i=0;i<pages.size();++i){
+		out.push_back(static_cast<char>(CompactBooleanFalse));
+	}
+	append_field_header(out,last,2,CompactList); // min_values
+	append_list_header(out,pages.size(),CompactBinary);
+	for(const PageMetadata&page : pages){
+		append_uvarint(out,sizeof(std::uint64_t));
+		append_plain_u64(out,page.min_value);
+	}
+	append_field_header(out,last,3,CompactList); // max_values
+	append_list_header(out,pages.size(),CompactBinary);
+	for(const PageMetadata&page : pages){
+		append_uvarint(out,sizeof(std::uint64_t));
+		append_plain_u64(out,page.max_value);
+	}
+	append_i32_field(out,last,4,1); // BoundaryOrder::ASCENDING
+	append_field_header(out,last,5,CompactList); // null_counts
+	append_list_header(out,pages.size(),CompactI64);
+	for(std::size_t i=0;i<pages.size();++i){
+		append_uvarint(out,zigzag_i64(0));
+	}
+	append_stop(out);
+	return out;
+}
+
+std::string make_offset_index(const std::vector<PageMetadata>&pages){
+	std::string out;
+	out.reserve(8+pages.size()*16);
+	std::int16_t last=0;
+	append_field_header(out,last,1,CompactList);
+	append_list_header(out,pages.size(),CompactStruct);
+	for(const PageMetadata&page : pages){
+		std::int16_t location_last=0;
+		append_i64_field(out,location_last,1,page.offset);
+		append_i32_field(out,location_last,2,page.compressed_page_size);
+		append_i64_field(out,location_last,3,page.first_row_index);
+		append_stop(out);
+	}
 	append_stop(out);
 	return out;
 }
@@ -283,7 +395,7 @@ std::string make_file_metadata(const std::vector<RowGroupMetadata>&row_groups,
 							   std::int64_t num_rows,bool use_zstd,
 							   ValueEncoding encoding){
 	std::string out;
-	out.reserve(128+row_groups.size()*64);
+	out.reserve(128+row_groups.size()*128);
 	std::int16_t last=0;
 	append_i32_field(out,last,1,1); // File format version: always 1
 
@@ -300,19 +412,29 @@ std::string make_file_metadata(const std::vector<RowGroupMetadata>&row_groups,
 	}
 
 	append_binary_field(out,last,6,"calcprimelist-cpp");
+	// ColumnOrder::TYPE_ORDER tells readers min_value/max_value follow the
+	// unsigned ordering of the UINT_64 logical type.
+	append_field_header(out,last,7,CompactList);
+	append_list_header(out,1,CompactStruct);
+	{
+		std::int16_t order_last=0;
+		append_field_header(out,order_last,1,CompactStruct);
+		append_stop(out); // TypeDefinedOrder
+		append_stop(out);
+	}
 	append_stop(out);
 	return out;
 }
 
-std::string encode_delta_binary_packed(const std::uint64_t*values,
-									   std::size_t count,
-									   std::size_t block_value_count){
+void encode_delta_binary_packed(std::string&out,const std::uint64_t*values,
+								std::size_t count,
+								std::size_t block_value_count){
 	if(block_value_count==0||(block_value_count%128U)!=0U){
 		throw std::invalid_argument(
 			"Parquet delta block value count must be a positive multiple of 128");
 	}
 	if(count==0){
-		return {};
+		return;
 	}
 	if(!values){
 		throw std::invalid_argument("Parquet delta values pointer is null");
@@ -323,21 +445,25 @@ std::string encode_delta_binary_packed(const std::uint64_t*values,
 			"DELTA_BINARY_PACKED requires values within signed INT64 range");
 	}
 
-	constexpr std::size_t values_per_mini_block=32;
-	std::size_t mini_block_count=block_value_count/values_per_mini_block;
-	std::string out;
-	out.reserve(count*2U+32U);
+	std::size_t mini_block_count=block_value_count/kMiniBlockValues;
 	append_uvarint(out,static_cast<std::uint64_t>(block_value_count));
 	append_uvarint(out,static_cast<std::uint64_t>(mini_block_count));
 	append_uvarint(out,static_cast<std::uint64_t>(count));
 	append_uvarint(out,zigzag_i64(static_cast<std::int64_t>(values[0])));
 
+	// Blocks are packed straight into a presized buffer that only grows when
+	// the worst case of the next block would not fit.
+	std::size_t pos=out.size();
+	out.resize(pos+count*2U+max_delta_block_bytes<std::uint16_t>(
+								   mini_block_count));
+	std::vector<std::uint16_t> deltas16(block_value_count);
+	std::vector<std::uint64_t> deltas64;
+	std::vector<std::uint64_t> max_values(mini_block_count);
+
 	std::size_t offset=1;
 	while(offset<count){
 		std::size_t delta_count=std::min(block_value_count,count-offset);
 		bool fits_u16=true;
-		std::vector<std::uint16_t> deltas16;
-		deltas16.reserve(delta_count);
 		std::uint64_t previous=values[offset-1U];
 		for(std::size_t i=0;i<delta_count;++i){
 			std::uint64_t current=values[offset+i];
@@ -351,38 +477,427 @@ std::string encode_delta_binary_packed(const std::uint64_t*values,
 					"Parquet DELTA_BINARY_PACKED values must be non-decreasing");
 			}
 			std::uint64_t delta=current-previous;
-			if(delta>static_cast<std::uint64_t>(
-						 std::numeric_limits<std::int64_t>::max())){
-				throw std::overflow_error(
-					"Parquet DELTA_BINARY_PACKED delta exceeds INT64 range");
-			}
 			if(delta>std::numeric_limits<std::uint16_t>::max()){
 				fits_u16=false;
 			}
-			if(fits_u16){
-				deltas16.push_back(static_cast<std::uint16_t>(delta));
-			}
+			deltas16[i]=static_cast<std::uint16_t>(delta);
 			previous=current;
 		}
 
+		std::size_t bound=
+			fits_u16?max_delta_block_bytes<std::uint16_t>(mini_block_count)
+					:max_delta_block_bytes<std::uint64_t>(mini_block_count);
+		if(out.size()-pos<bound){
+			out.resize(std::max(pos+bound,out.size()*2U));
+		}
+		std::uint8_t*dest=reinterpret_cast<std::uint8_t*>(out.data())+pos;
 		if(fits_u16){
-			append_delta_block(out,deltas16,mini_block_count,
-							   values_per_mini_block);
+			pos+=write_delta_block(dest,deltas16.data(),delta_count,
+								   mini_block_count,max_values.data());
 		}else{
-			std::vector<std::uint64_t> deltas64;
-			deltas64.reserve(delta_count);
+			deltas64.resize(delta_count);
 			previous=values[offset-1U];
 			for(std::size_t i=0;i<delta_count;++i){
 				std::uint64_t current=values[offset+i];
-				deltas64.push_back(current-previous);
+				deltas64[i]=current-previous;
 				previous=current;
 			}
-			append_delta_block(out,deltas64,mini_block_count,
-							   values_per_mini_block);
+			pos+=write_delta_block(dest,deltas64.data(),delta_count,
+								   mini_block_count,max_values.data());
 		}
 		offset+=delta_count;
 	}
-	return out;
+	out.resize(pos);
+}
+
+namespace{
+
+// Reading counterpart of the compact encoder above.  Unknown fields are
+// skipped, so files written by other tools parse as long as they use the
+// same single-column layout.
+class CompactReader{
+  public:
+	CompactReader(const std::uint8_t*data,std::size_t size)
+		: data_(data),size_(size){}
+
+	std::size_t position() const{ return pos_; }
+	void seek(std::size_t pos){
+		if(pos>size_){
+			throw std::runtime_error("truncated Parquet metadata");
+		}
+		pos_=pos;
+	}
+
+	std::uint8_t read_byte(){
+		if(pos_>=size_){
+			throw std::runtime_error("truncated Parquet metadata");
+		}
+		return data_[pos_++];
+	}
+
+	std::uint64_t read_uvarint(){
+		std::uint64_t value=0;
+		for(unsigned shift=0;shift<64U;shift+=7U){
+			std::uint8_t byte=read_byte();
+			value|=static_cast<std::uint64_t>(byte&0x7fU)<<shift;
+			if((byte&0x80U)==0){
+				return value;
+			}
+		}
+		throw std::runtime_error("invalid varint in Parquet metadata");
+	}
+
+	std::int64_t read_zigzag(){
+		std::uint64_t value=read_uvarint();
+		return static_cast<std::int64_t>((value>>1U)^(~(value&1U)+1U));
+	}
+
+	// Returns false at the end of a struct.
+	bool read_field(std::int16_t&last_field,std::int16_t&field,
+					std::uint8_t&type){
+		std::uint8_t header=read_byte();
+		if(header==CompactStop){
+			return false;
+		}
+		type=header&0x0fU;
+		std::uint8_t delta=header>>4U;
+		field=delta!=0?static_cast<std::int16_t>(last_field+delta)
+					   :static_cast<std::int16_t>(read_zigzag());
+		last_field=field;
+		return true;
+	}
+
+	std::size_t read_list_header(std::uint8_t&element_type){
+		std::uint8_t header=read_byte();
+		element_type=header&0x0fU;
+		std::size_t size=header>>4U;
+		if(size==15U){
+			size=static_cast<std::size_t>(read_uvarint());
+		}
+		return size;
+	}
+
+	void skip(std::uint8_t type,bool in_collection=false){
+		switch(type){
+		case CompactBooleanTrue:
+		case CompactBooleanFalse:
+			if(in_collection){
+				read_byte();
+			}
+			return;
+		case CompactByte:
+			read_byte();
+			return;
+		case CompactI16:
+		case CompactI32:
+		case CompactI64:
+			read_uvarint();
+			return;
+		case 0x07: // double
+			advance(8);
+			return;
+		case CompactBinary:
+			advance(static_cast<std::size_t>(read_uvarint()));
+			return;
+		case CompactList:
+		case 0x0a:{ // set
+			std::uint8_t element_type=0;
+			std::size_t size=read_list_header(element_type);
+			for(std::size_t i=0;i<size;++i){
+				skip(element_type,true);
+			}
+			return;
+		}
+		case 0x0b:{ // map
+			std::size_t size=static_cast<std::size_t>(read_uvarint());
+			if(size==0){
+				return;
+			}
+			std::uint8_t types=read_byte();
+			for(std::size_t i=0;i<size;++i){
+				skip(types>>4U,true);
+				skip(types&0x0fU,true);
+			}
+			return;
+		}
+		case CompactStruct:{
+			std::int16_t last=0;
+			std::int16_t field=0;
+			std::uint8_t field_type=0;
+			while(read_field(last,field,field_type)){
+				skip(field_type);
+			}
+			return;
+		}
+		default:
+			throw std::runtime_error("unknown Thrift type in Parquet metadata");
+		}
+	}
+
+  private:
+	void advance(std::size_t bytes){
+		if(bytes>size_-pos_){
+			throw std::runtime_error("truncated Parquet metadata");
+		}
+		pos_+=bytes;
+	}
+
+	const std::uint8_t*data_;
+	std::size_t size_;
+	std::size_t pos_=0;
+};
+
+ColumnChunkInfo read_column_metadata(CompactReader&in,bool&zstd){
+	ColumnChunkInfo chunk;
+	std::int16_t last=0;
+	std::int16_t field=0;
+	std::uint8_t type=0;
+	while(in.read_field(last,field,type)){
+		if(field==4&&type==CompactI32){
+			std::int64_t codec=in.read_zigzag();
+			if(codec!=0&&codec!=6){
+				throw std::runtime_error(
+					"unsupported Parquet codec (only UNCOMPRESSED and ZSTD)");
+			}
+			zstd=codec==6;
+		}else if(field==5&&type==CompactI64){
+			chunk.num_values=in.read_zigzag();
+		}else if(field==6&&type==CompactI64){
+			chunk.total_uncompressed_size=in.read_zigzag();
+		}else if(field==7&&type==CompactI64){
+			chunk.total_compressed_size=in.read_zigzag();
+		}else if(field==9&&type==CompactI64){
+			chunk.data_page_offset=in.read_zigzag();
+		}else{
+			in.skip(type);
+		}
+	}
+	return chunk;
+}
+
+// RowGroup.columns[0].meta_data; further columns are rejected.
+ColumnChunkInfo read_row_group(CompactReader&in,bool&zstd){
+	ColumnChunkInfo chunk;
+	bool found=false;
+	std::int16_t last=0;
+	std::int16_t field=0;
+	std::uint8_t type=0;
+	while(in.read_field(last,field,type)){
+		if(field!=1||type!=CompactList){
+			in.skip(type);
+			continue;
+		}
+		std::uint8_t element_type=0;
+		std::size_t columns=in.read_list_header(element_type);
+		if(columns!=1||element_type!=CompactStruct){
+			throw std::runtime_error("expected a single Parquet column");
+		}
+		std::int16_t column_last=0;
+		std::int16_t column_field=0;
+		std::uint8_t column_type=0;
+		while(in.read_field(column_last,column_field,column_type)){
+			if(column_field==3&&column_type==CompactStruct){
+				chunk=read_column_metadata(in,zstd);
+				found=true;
+			}else{
+				in.skip(column_type);
+			}
+		}
+	}
+	if(!found){
+		throw std::runtime_error("Parquet row group without column metadata");
+	}
+	return chunk;
+}
+
+std::uint64_t load_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+// Statistics.max_value/min_value as written by append_statistics().
+void read_statistics(CompactReader&in,PageInfo&page){
+	std::int16_t last=0;
+	std::int16_t field=0;
+	std::uint8_t type=0;
+	while(in.read_field(last,field,type)){
+		if((field==5||field==6)&&type==CompactBinary){
+			if(in.read_uvarint()!=sizeof(std::uint64_t)){
+				throw std::runtime_error("unexpected Parquet statistics width");
+			}
+			std::uint64_t value=0;
+			for(unsigned i=0;i<8U;++i){
+				value|=static_cast<std::uint64_t>(in.read_byte())<<(8U*i);
+			}
+			(field==5?page.max_value:page.min_value)=value;
+			page.has_statistics=true;
+		}else{
+			in.skip(type);
+		}
+	}
+}
+
+// Unpacks one miniblock of kMiniBlockValues LSB-first values of `width` bits.
+void unpack_miniblock(const std::uint8_t*in,unsigned width,
+					  std::uint64_t*out){
+	if(width==0){
+		std::fill(out,out+kMiniBlockValues,0);
+		return;
+	}
+	// Every value is read through a 16-byte window, so copy the miniblock
+	// into a zero-padded buffer first.
+	std::uint8_t padded[4U*64U+16U]={};
+	std::memcpy(padded,in,4U*width);
+	std::uint64_t mask=width==64U?~std::uint64_t{0}
+								 :(std::uint64_t{1}<<width)-1U;
+	for(std::size_t i=0;i<kMiniBlockValues;++i){
+		std::size_t bit=i*width;
+		unsigned shift=static_cast<unsigned>(bit%8U);
+		const std::uint8_t*word=padded+bit/8U;
+		std::uint64_t value=load_u64(word)>>shift;
+		if(shift!=0&&width+shift>64U){
+			value|=static_cast<std::uint64_t>(word[8])<<(64U-shift);
+		}
+		out[i]=value&mask;
+	}
+}
+
+} // namespace
+
+FileInfo decode_file_info(const std::uint8_t*data,std::size_t size){
+	if(size<12||std::memcmp(data,"PAR1",4)!=0||
+	   std::memcmp(data+size-4U,"PAR1",4)!=0){
+		throw std::runtime_error("not a Parquet file");
+	}
+	std::uint32_t metadata_length=0;
+	for(int i=3;i>=0;--i){
+		metadata_length=(metadata_length<<8)|data[size-8U+i];
+	}
+	if(metadata_length>size-12U){
+		throw std::runtime_error("invalid Parquet footer length");
+	}
+	CompactReader in(data+size-8U-metadata_length,metadata_length);
+	FileInfo info;
+	std::int16_t last=0;
+	std::int16_t field=0;
+	std::uint8_t type=0;
+	while(in.read_field(last,field,type)){
+		if(field==3&&type==CompactI64){
+			info.num_rows=in.read_zigzag();
+		}else if(field==4&&type==CompactList){
+			std::uint8_t element_type=0;
+			std::size_t count=in.read_list_header(element_type);
+			for(std::size_t i=0;i<count;++i){
+				info.row_groups.push_back(read_row_group(in,info.zstd));
+			}
+		}else{
+			in.skip(type);
+		}
+	}
+	for(const ColumnChunkInfo&chunk : info.row_groups){
+		if(chunk.data_page_offset<4||chunk.total_compressed_size<0||
+		   static_cast<std::uint64_t>(chunk.data_page_offset)+
+				   static_cast<std::uint64_t>(chunk.total_compressed_size)>
+			   size){
+			throw std::runtime_error("Parquet column chunk outside the file");
+		}
+	}
+	return info;
+}
+
+PageInfo read_page_header(const std::uint8_t*data,std::size_t size){
+	CompactReader in(data,size);
+	PageInfo page;
+	std::int16_t last=0;
+	std::int16_t field=0;
+	std::uint8_t type=0;
+	while(in.read_field(last,field,type)){
+		if(field==1&&type==CompactI32){
+			page.data_page=in.read_zigzag()==0; // PageType::DATA_PAGE
+		}else if(field==2&&type==CompactI32){
+			page.uncompressed_size=static_cast<std::int32_t>(in.read_zigzag());
+		}else if(field==3&&type==CompactI32){
+			page.compressed_size=static_cast<std::int32_t>(in.read_zigzag());
+		}else if(field==5&&type==CompactStruct){
+			std::int16_t page_last=0;
+			while(in.read_field(page_last,field,type)){
+				if(field==1&&type==CompactI32){
+					page.num_values=static_cast<std::int32_t>(in.read_zigzag());
+				}else if(field==2&&type==CompactI32){
+					std::int64_t encoding=in.read_zigzag();
+					if(encoding!=static_cast<std::int64_t>(ValueEncoding::Plain)&&
+					   encoding!=static_cast<std::int64_t>(
+									 ValueEncoding::DeltaBinaryPacked)){
+						throw std::runtime_error("unsupported Parquet encoding");
+					}
+					page.encoding=static_cast<ValueEncoding>(encoding);
+				}else if(field==5&&type==CompactStruct){
+					read_statistics(in,page);
+				}else{
+					in.skip(type);
+				}
+			}
+		}else{
+			in.skip(type);
+		}
+	}
+	if(page.compressed_size<0||page.uncompressed_size<0||
+	   page.num_values<0){
+		throw std::runtime_error("invalid Parquet page header");
+	}
+	page.header_bytes=in.position();
+	return page;
+}
+
+void decode_delta_binary_packed(const std::uint8_t*data,std::size_t size,
+								std::size_t count,std::uint64_t*out){
+	CompactReader in(data,size);
+	std::uint64_t block_values=in.read_uvarint();
+	std::uint64_t mini_blocks=in.read_uvarint();
+	std::uint64_t total=in.read_uvarint();
+	std::uint64_t first=static_cast<std::uint64_t>(in.read_zigzag());
+	if(block_values==0||mini_blocks==0||block_values%mini_blocks!=0||
+	   block_values/mini_blocks!=kMiniBlockValues||total!=count){
+		throw std::runtime_error("unsupported DELTA_BINARY_PACKED layout");
+	}
+	if(count==0){
+		return;
+	}
+	out[0]=first;
+	std::size_t produced=1;
+	std::vector<std::uint8_t> widths(static_cast<std::size_t>(mini_blocks));
+	std::uint64_t deltas[kMiniBlockValues];
+	while(produced<count){
+		std::uint64_t min_delta=static_cast<std::uint64_t>(in.read_zigzag());
+		for(std::uint8_t&width : widths){
+			width=in.read_byte();
+			if(width>64U){
+				throw std::runtime_error("invalid DELTA_BINARY_PACKED width");
+			}
+		}
+		std::size_t pos=in.position();
+		for(std::uint8_t width : widths){
+			if(produced>=count){
+				break;
+			}
+			if(4U*width>size-pos){
+				throw std::runtime_error("truncated DELTA_BINARY_PACKED page");
+			}
+			unpack_miniblock(data+pos,width,deltas);
+			pos+=4U*width;
+			std::size_t take=std::min(kMiniBlockValues,count-produced);
+			for(std::size_t i=0;i<take;++i){
+				deltas[i]+=min_delta;
+			}
+			std::memcpy(out+produced,deltas,take*sizeof(std::uint64_t));
+			prefix_sum_u64(out+produced,take,out[produced-1U]);
+			produced+=take;
+		}
+		in.seek(pos);
+	}
 }
 
 } // namespace calcprime::parquet
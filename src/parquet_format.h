@@ -12,24 +12,88 @@ enum class ValueEncoding : std::int32_t{
 	DeltaBinaryPacked=5,
 };
 
+// Primes are written in ascending order, so the min/max of a page or row
+// group are simply its first and last values.
+struct PageMetadata{
+	std::int64_t offset=0;
+	std::int32_t compressed_page_size=0; // page header + payload
+	std::int64_t first_row_index=0;		 // relative to the row group
+	std::int64_t num_values=0;
+	std::uint64_t min_value=0;
+	std::uint64_t max_value=0;
+};
+
 struct RowGroupMetadata{
 	std::int64_t data_page_offset=0;
 	std::int64_t num_values=0;
 	std::int64_t total_uncompressed_size=0;
 	std::int64_t total_compressed_size=0;
+	std::uint64_t min_value=0;
+	std::uint64_t max_value=0;
+	std::int64_t column_index_offset=-1;
+	std::int32_t column_index_length=0;
+	std::int64_t offset_index_offset=-1;
+	std::int32_t offset_index_length=0;
 };
 
 std::string make_data_page_header(std::int32_t num_values,
 								  std::int32_t uncompressed_size,
 								  std::int32_t compressed_size,
-								  ValueEncoding encoding);
+								  ValueEncoding encoding,
+								  std::uint64_t min_value,
+								  std::uint64_t max_value);
+
+// Page index structures (parquet.thrift ColumnIndex/OffsetIndex) for the
+// single prime column of one row group.
+std::string make_column_index(const std::vector<PageMetadata>&pages);
+std::string make_offset_index(const std::vector<PageMetadata>&pages);
 
 std::string make_file_metadata(const std::vector<RowGroupMetadata>&row_groups,
 							   std::int64_t num_rows,bool use_zstd,
 							   ValueEncoding encoding);
 
-std::string encode_delta_binary_packed(
-	const std::uint64_t*values,std::size_t count,
-	std::size_t block_value_count);
+// Appends the DELTA_BINARY_PACKED encoding of `values` to `out`, so that
+// callers can reuse its storage from page to page.
+void encode_delta_binary_packed(std::string&out,const std::uint64_t*values,
+								std::size_t count,
+								std::size_t block_value_count);
+
+// Reading side, used by PrimeReader.  Only the layout written above is
+// understood: one required INT64 column, v1 data pages, PLAIN or
+// DELTA_BINARY_PACKED values, uncompressed or ZSTD.
+struct ColumnChunkInfo{
+	std::int64_t data_page_offset=0;
+	std::int64_t total_uncompressed_size=0;
+	std::int64_t total_compressed_size=0;
+	std::int64_t num_values=0;
+};
+
+struct FileInfo{
+	bool zstd=false;
+	std::int64_t num_rows=0;
+	std::vector<ColumnChunkInfo> row_groups;
+};
+
+struct PageInfo{
+	std::size_t header_bytes=0;
+	std::int32_t uncompressed_size=0;
+	std::int32_t compressed_size=0;
+	std::int32_t num_values=0;
+	ValueEncoding encoding=ValueEncoding::Plain;
+	bool data_page=false;
+	// Page statistics, present in every page PrimeWriter writes.
+	bool has_statistics=false;
+	std::uint64_t min_value=0;
+	std::uint64_t max_value=0;
+};
+
+// Parses the footer of a whole file; throws on anything unexpected.
+FileInfo decode_file_info(const std::uint8_t*data,std::size_t size);
+
+PageInfo read_page_header(const std::uint8_t*data,std::size_t size);
+
+// Decodes a DELTA_BINARY_PACKED page of exactly `count` values into `out`.
+void decode_delta_binary_packed(const std::uint8_t*data,std::size_t size,
+								std::size_t count,std::uint64_t*out);
 
 } // namespace calcprime::parquet
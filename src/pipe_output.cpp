@@ -0,0 +1,126 @@
+#include "pipe_output.h"
+
+#include<stdexcept>
+#include<string>
+
+#if defined(__linux__)
+#include<algorithm>
+#include<cerrno>
+#include<cstring>
+
+#include<fcntl.h>
+#include<poll.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+namespace calcprime{
+
+#if defined(__linux__)
+
+namespace{
+
+std::string errno_message(const char*what,int error){
+	return std::string(what)+": "+std::strerror(error);
+}
+
+} // namespace
+
+std::unique_ptr<PipeOutput> PipeOutput::open(int fd){
+	struct stat info{};
+	if(fstat(fd,&info)!=0||!S_ISFIFO(info.st_mode)){
+		return nullptr;
+	}
+	// Grow the pipe so that each write moves a useful amount; an existing
+	// larger pipe is kept.  The limit for unprivileged users is usually
+	// 1 MiB (/proc/sys/fs/pipe-max-size).
+	int capacity=fcntl(fd,F_GETPIPE_SZ);
+	if(capacity<=0){
+		return nullptr;
+	}
+	if(static_cast<std::size_t>(capacity)<kPipeBytes){
+		int grown=fcntl(fd,F_SETPIPE_SZ,static_cast<int>(kPipeBytes));
+		if(grown>0){
+			capacity=grown;
+		}
+	}
+	return std::unique_ptr<PipeOutput>(
+		new PipeOutput(fd,static_cast<std::size_t>(capacity)));
+}
+
+PipeOutput::PipeOutput(int fd,std::size_t pipe_bytes)
+	: fd_(fd),pipe_bytes_(pipe_bytes){
+	buffer_.reserve(pipe_bytes_);
+}
+
+void PipeOutput::write(const char*data,std::size_t size){
+	// Large pieces skip the buffer once it has been emptied.
+	if(!buffer_.empty()){
+		std::size_t take=std::min(size,pipe_bytes_-buffer_.size());
+		buffer_.append(data,take);
+		data+=take;
+		size-=take;
+		if(buffer_.size()<pipe_bytes_){
+			return;
+		}
+		flush();
+	}
+	std::size_t whole=size-size%pipe_bytes_;
+	write_out(data,whole);
+	buffer_.append(data+whole,size-whole);
+}
+
+void PipeOutput::flush(){
+	write_out(buffer_.data(),buffer_.size());
+	buffer_.clear();
+}
+
+void PipeOutput::close(){
+	flush();
+}
+
+void PipeOutput::write_out(const char*data,std::size_t size){
+	std::size_t done=0;
+	while(done<size){
+		ssize_t written=::write(fd_,data+done,size-done);
+		if(written<0){
+			if(errno==EINTR){
+				continue;
+			}
+			if(errno==EAGAIN){
+				wait_writable();
+				continue;
+			}
+			throw std::runtime_error(errno_message("write",errno));
+		}
+		done+=static_cast<std::size_t>(written);
+		++writes_;
+	}
+	bytes_written_+=size;
+}
+
+// Standard output may have been left non-blocking by the parent.
+void PipeOutput::wait_writable(){
+	pollfd entry{fd_,POLLOUT,0};
+	while(poll(&entry,1,-1)<0&&errno==EINTR){
+	}
+}
+
+#else
+
+std::unique_ptr<PipeOutput> PipeOutput::open(int){
+	return nullptr;
+}
+
+PipeOutput::PipeOutput(int fd,std::size_t pipe_bytes)
+	: fd_(fd),pipe_bytes_(pipe_bytes){}
+
+void PipeOutput::write(const char*,std::size_t){
+	throw std::runtime_error("pipe output not supported on this platform");
+}
+void PipeOutput::flush(){}
+void PipeOutput::close(){}
+
+#endif
+
+} // namespace calcprime
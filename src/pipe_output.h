@@ -0,0 +1,52 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<string>
+
+namespace calcprime{
+
+// Streams into a pipe with write(2) in pipe-sized pieces.  The pipe is
+// grown to kPipeBytes when allowed, so that a reader is woken once per
+// megabyte rather than per 64 KiB.
+//
+// Pages are not spliced: vmsplice(2) lends our pages to the pipe, where a
+// reader may keep them indefinitely, so every buffer would have to be
+// replaced after each splice.  Remapping and faulting in fresh pages cost
+// more than the copy they saved.
+//
+// Linux only; open() returns null elsewhere and when `fd` is not a pipe.
+class PipeOutput{
+  public:
+	static constexpr std::size_t kPipeBytes=std::size_t{1}<<20;
+
+	static std::unique_ptr<PipeOutput> open(int fd);
+
+	PipeOutput(const PipeOutput&)=delete;
+	PipeOutput&operator=(const PipeOutput&)=delete;
+
+	// Errors are reported as std::runtime_error.
+	void write(const char*data,std::size_t size);
+	void flush();
+	void close();
+
+	std::size_t pipe_bytes() const{ return pipe_bytes_; }
+	std::uint64_t bytes_written() const{ return bytes_written_; }
+	// write(2) calls, counting each retry after a partial write.
+	std::uint64_t writes() const{ return writes_; }
+
+  private:
+	PipeOutput(int fd,std::size_t pipe_bytes);
+
+	void write_out(const char*data,std::size_t size);
+	void wait_writable();
+
+	int fd_=-1;
+	std::size_t pipe_bytes_=0;
+	std::string buffer_;
+	std::uint64_t bytes_written_=0;
+	std::uint64_t writes_=0;
+};
+
+} // namespace calcprime
@@ -0,0 +1,106 @@
+#include "prefix_sum.h"
+
+#include<cstdint>
+#include<stdexcept>
+
+#if defined(__AVX2__)
+#include<immintrin.h>
+#endif
+
+namespace calcprime{
+
+namespace{
+
+#if defined(__AVX2__)
+// Inclusive prefix sum of four u64 lanes on top of `base` (broadcast).
+inline __m256i prefix_sum_lanes(__m256i values,__m256i base){
+	const __m256i zero=_mm256_setzero_si256();
+	__m256i shifted=_mm256_blend_epi32(
+		_mm256_permute4x64_epi64(values,_MM_SHUFFLE(2,1,0,0)),zero,0x03);
+	values=_mm256_add_epi64(values,shifted);
+	shifted=_mm256_blend_epi32(
+		_mm256_permute4x64_epi64(values,_MM_SHUFFLE(1,0,0,0)),zero,0x0f);
+	values=_mm256_add_epi64(values,shifted);
+	return _mm256_add_epi64(values,base);
+}
+#endif
+
+std::uint16_t get_u16(const std::uint8_t*in){
+	return static_cast<std::uint16_t>(in[0]|(in[1]<<8));
+}
+
+[[noreturn]] void throw_bad_gap(){
+	throw std::runtime_error("delta16 gap outside 1..32767");
+}
+
+} // namespace
+
+std::uint64_t prefix_sum_u64(std::uint64_t*values,std::size_t count,
+							 std::uint64_t base) noexcept{
+	std::size_t i=0;
+#if defined(__AVX2__)
+	__m256i running=_mm256_set1_epi64x(static_cast<long long>(base));
+	for(;i+4U<=count;i+=4U){
+		__m256i sums=prefix_sum_lanes(
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values+i)),
+			running);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(values+i),sums);
+		running=_mm256_permute4x64_epi64(sums,_MM_SHUFFLE(3,3,3,3));
+	}
+	if(i>0){
+		base=values[i-1U];
+	}
+#endif
+	for(;i<count;++i){
+		base+=values[i];
+		values[i]=base;
+	}
+	return base;
+}
+
+std::uint64_t decode_delta16(const std::uint8_t*gaps,std::size_t count,
+							 std::uint64_t previous,std::uint64_t*out){
+	std::size_t i=0;
+#if defined(__AVX2__)
+	// Sixteen gaps per step: reject zero gaps and gaps with the sign bit set,
+	// then widen to u64 and prefix-sum four lanes at a time.
+	__m256i running=_mm256_set1_epi64x(static_cast<long long>(previous));
+	const __m256i zero=_mm256_setzero_si256();
+	for(;i+16U<=count;i+=16U){
+		__m256i raw=_mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(gaps+2U*i));
+		__m256i bad=_mm256_or_si256(_mm256_cmpeq_epi16(raw,zero),
+									_mm256_cmpgt_epi16(zero,raw));
+		if(!_mm256_testz_si256(bad,bad)){
+			throw_bad_gap();
+		}
+		__m128i halves[2]={_mm256_castsi256_si128(raw),
+						   _mm256_extracti128_si256(raw,1)};
+		for(int half=0;half<2;++half){
+			__m128i words=halves[half];
+			for(int group=0;group<2;++group){
+				__m256i sums=prefix_sum_lanes(_mm256_cvtepu16_epi64(words),
+											  running);
+				_mm256_storeu_si256(
+					reinterpret_cast<__m256i*>(out+i+8U*half+4U*group),sums);
+				running=_mm256_permute4x64_epi64(sums,_MM_SHUFFLE(3,3,3,3));
+				words=_mm_srli_si128(words,8);
+			}
+		}
+	}
+	if(i>0){
+		previous=out[i-1U];
+	}
+#endif
+	for(;i<count;++i){
+		std::uint16_t gap=get_u16(gaps+2U*i);
+		if(gap==0||gap>0x7fffU){
+			throw_bad_gap();
+		}
+		previous+=gap;
+		out[i]=previous;
+	}
+	return previous;
+}
+
+} // namespace calcprime
@@ -0,0 +1,20 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+
+namespace calcprime{
+
+// In-place inclusive prefix sum: values[i] becomes base+values[0]+...+
+// values[i].  Returns the last sum, or base when count is 0.  Uses AVX2
+// when available.
+std::uint64_t prefix_sum_u64(std::uint64_t*values,std::size_t count,
+							 std::uint64_t base) noexcept;
+
+// Expands `count` little-endian delta16 gaps that follow `previous` into
+// absolute values.  Throws std::runtime_error when a gap is outside
+// 1..INT16_MAX, i.e. when the data was not written by the delta16 encoder.
+std::uint64_t decode_delta16(const std::uint8_t*gaps,std::size_t count,
+							 std::uint64_t previous,std::uint64_t*out);
+
+} // namespace calcprime
@@ -0,0 +1,273 @@
+#include "prime_extract.h"
+
+#include "popcnt.h"
+
+#include<algorithm>
+#include<array>
+#include<bit>
+
+#if defined(__AVX512F__)||defined(__AVX2__)
+#include<immintrin.h>
+#endif
+
+namespace calcprime{
+namespace{
+
+// Word `word` of the segment with a bit set for every prime in it.
+inline std::uint64_t prime_mask(const std::uint64_t*bits,std::size_t word,
+								std::size_t bit_count) noexcept{
+	std::uint64_t mask=~bits[word];
+	std::size_t tail=bit_count-word*64;
+	if(tail<64){
+		mask&=(1ULL<<tail)-1ULL;
+	}
+	return mask;
+}
+
+// tzcnt/blsr over words [first, last), writing to out[n...].  Primes are
+// sparse enough (about one odd number in 11 near 1e9) that this beats the
+// table on most segments.
+template<typename Emit>
+std::size_t extract_scalar(const std::uint64_t*bits,std::size_t bit_count,
+						   std::size_t first,std::size_t last,std::size_t n,
+						   Emit emit) noexcept{
+	for(std::size_t word=first;word<last;++word){
+		std::uint64_t mask=prime_mask(bits,word,bit_count);
+		std::uint64_t base=static_cast<std::uint64_t>(word)*64;
+		while(mask){
+			emit(n++,base+static_cast<std::uint64_t>(std::countr_zero(mask)));
+			mask&=mask-1;
+		}
+	}
+	return n;
+}
+
+#if defined(__AVX512F__)
+
+// VPCOMPRESSD packs the indices of the set bits of 16 lanes into the low
+// lanes.  The full vector is stored and the cursor advanced by the count;
+// there is no branch on the data, so sparse and dense words cost the same.
+template<typename Emit>
+std::size_t extract_avx512(const std::uint64_t*bits,std::size_t bit_count,
+						   Emit emit) noexcept{
+	const __m512i lanes=_mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,
+										  14,15);
+	const __m512i step=_mm512_set1_epi32(16);
+	std::size_t word_count=(bit_count+63)/64;
+	std::size_t n=0;
+	__m512i index=lanes;
+	for(std::size_t word=0;word<word_count;++word){
+		std::uint64_t mask=prime_mask(bits,word,bit_count);
+		for(unsigned part=0;part<4;++part){
+			__mmask16 lane_mask=static_cast<__mmask16>(mask>>(16*part));
+			emit(n,_mm512_maskz_compress_epi32(lane_mask,index));
+			n+=static_cast<std::size_t>(std::popcount(
+				static_cast<unsigned>(lane_mask)));
+			index=_mm512_add_epi32(index,step);
+		}
+	}
+	return n;
+}
+
+#elif defined(__AVX2__)
+
+// Byte k of entry b is the position of the k-th set bit of b.
+constexpr std::array<std::uint64_t,256> make_bit_index_table(){
+	std::array<std::uint64_t,256> table{};
+	for(unsigned byte=0;byte<256;++byte){
+		std::uint64_t packed=0;
+		unsigned count=0;
+		for(unsigned bit=0;bit<8;++bit){
+			if(byte&(1U<<bit)){
+				packed|=static_cast<std::uint64_t>(bit)<<(8*count);
+				++count;
+			}
+		}
+		table[byte]=packed;
+	}
+	return table;
+}
+
+constexpr std::array<std::uint64_t,256> kBitIndexTable=
+	make_bit_index_table();
+
+// The table costs the same for every byte, the scalar loop grows with the
+// number of primes; the table wins from about one set bit in seven, which
+// only segments below ~1e6 reach.  The choice is made per block of words.
+constexpr std::size_t kTableBlockWords=64;
+
+template<typename EmitTable,typename EmitScalar>
+std::size_t extract_avx2(const std::uint64_t*bits,std::size_t bit_count,
+						 EmitTable emit_table,EmitScalar emit_scalar) noexcept{
+	std::size_t word_count=(bit_count+63)/64;
+	std::size_t n=0;
+	for(std::size_t first=0;first<word_count;first+=kTableBlockWords){
+		std::size_t last=std::min(first+kTableBlockWords,word_count);
+		std::size_t block_bits=std::min(bit_count,last*64)-first*64;
+		std::uint64_t primes=count_zero_bits(bits+first,block_bits);
+		if(primes*7<block_bits){
+			n=extract_scalar(bits,bit_count,first,last,n,emit_scalar);
+			continue;
+		}
+		for(std::size_t word=first;word<last;++word){
+			std::uint64_t mask=prime_mask(bits,word,bit_count);
+			for(unsigned part=0;part<8;++part){
+				unsigned byte=static_cast<unsigned>((mask>>(8*part))&0xFFU);
+				__m128i packed=_mm_cvtsi64_si128(
+					static_cast<long long>(kBitIndexTable[byte]));
+				emit_table(n,packed,
+						   static_cast<std::uint32_t>(word*64+part*8));
+				n+=static_cast<std::size_t>(std::popcount(byte));
+			}
+		}
+	}
+	return n;
+}
+
+#endif
+
+} // namespace
+
+std::size_t extract_primes_u64(const std::uint64_t*bits,std::size_t bit_count,
+							   std::uint64_t seg_low,
+							   std::uint64_t*out) noexcept{
+	auto emit_scalar=[&](std::size_t n,std::uint64_t index){
+		out[n]=seg_low+(index<<1);
+	};
+#if defined(__AVX512F__)
+	(void)emit_scalar;
+	const __m512i base=_mm512_set1_epi64(static_cast<long long>(seg_low));
+	return extract_avx512(bits,bit_count,[&](std::size_t n,__m512i index){
+		__m512i low=_mm512_cvtepu32_epi64(_mm512_castsi512_si256(index));
+		__m512i high=
+			_mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(index,1));
+		_mm512_storeu_si512(out+n,
+							_mm512_add_epi64(base,_mm512_slli_epi64(low,1)));
+		_mm512_storeu_si512(out+n+8,
+							_mm512_add_epi64(base,_mm512_slli_epi64(high,1)));
+	});
+#elif defined(__AVX2__)
+	return extract_avx2(
+		bits,bit_count,
+		[&](std::size_t n,__m128i packed,std::uint32_t first_bit){
+			__m256i base=_mm256_set1_epi64x(static_cast<long long>(
+				seg_low+2*static_cast<std::uint64_t>(first_bit)));
+			__m256i low=_mm256_cvtepu8_epi64(packed);
+			__m256i high=_mm256_cvtepu8_epi64(_mm_srli_si128(packed,4));
+			_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(out+n),
+				_mm256_add_epi64(base,_mm256_slli_epi64(low,1)));
+			_mm256_storeu_si256(
+				reinterpret_cast<__m256i*>(out+n+4),
+				_mm256_add_epi64(base,_mm256_slli_epi64(high,1)));
+		},
+		emit_scalar);
+#else
+	(void)emit_scalar;
+	return extract_primes_u64_scalar(bits,bit_count,seg_low,out);
+#endif
+}
+
+std::size_t extract_prime_offsets_u32(const std::uint64_t*bits,
+									  std::size_t bit_count,
+									  std::uint32_t*out) noexcept{
+	auto emit_scalar=[&](std::size_t n,std::uint64_t index){
+		out[n]=static_cast<std::uint32_t>(index);
+	};
+#if defined(__AVX512F__)
+	(void)emit_scalar;
+	return extract_avx512(bits,bit_count,[&](std::size_t n,__m512i index){
+		_mm512_storeu_si512(out+n,index);
+	});
+#elif defined(__AVX2__)
+	return extract_avx2(
+		bits,bit_count,
+		[&](std::size_t n,__m128i packed,std::uint32_t first_bit){
+			__m256i index=_mm256_add_epi32(
+				_mm256_cvtepu8_epi32(packed),
+				_mm256_set1_epi32(static_cast<int>(first_bit)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out+n),index);
+		},
+		emit_scalar);
+#else
+	(void)emit_scalar;
+	return extract_prime_offsets_u32_scalar(bits,bit_count,out);
+#endif
+}
+
+const char*prime_extract_kernel() noexcept{
+#if defined(__AVX512F__)
+	return "avx512";
+#elif defined(__AVX2__)
+	return "avx2";
+#else
+	return "scalar";
+#endif
+}
+
+std::size_t extract_primes_u64_scalar(const std::uint64_t*bits,
+									  std::size_t bit_count,
+									  std::uint64_t seg_low,
+									  std::uint64_t*out) noexcept{
+	return extract_scalar(bits,bit_count,0,(bit_count+63)/64,0,
+						  [&](std::size_t n,std::uint64_t index){
+							  out[n]=seg_low+(index<<1);
+						  });
+}
+
+std::size_t extract_prime_offsets_u32_scalar(const std::uint64_t*bits,
+											 std::size_t bit_count,
+											 std::uint32_t*out) noexcept{
+	return extract_scalar(bits,bit_count,0,(bit_count+63)/64,0,
+						  [&](std::size_t n,std::uint64_t index){
+							  out[n]=static_cast<std::uint32_t>(index);
+						  });
+}
+
+// Sized and filled one block of words at a time, so that the zero fill of
+// resize() stays in L1 right before the kernel overwrites it.
+void append_primes(const std::uint64_t*bits,std::size_t bit_count,
+				   std::uint64_t seg_low,std::vector<std::uint64_t>&primes){
+	constexpr std::size_t kBlockBits=4096;
+	for(std::size_t first=0;first<bit_count;first+=kBlockBits){
+		std::size_t block_bits=std::min(kBlockBits,bit_count-first);
+		const std::uint64_t*block=bits+first/64;
+		std::size_t old_size=primes.size();
+		std::size_t count=
+			static_cast<std::size_t>(count_zero_bits(block,block_bits));
+		primes.resize(old_size+count+kExtractSlack);
+		std::size_t written=extract_primes_u64(
+			block,block_bits,seg_low+2*static_cast<std::uint64_t>(first),
+			primes.data()+old_size);
+		primes.resize(old_size+written);
+	}
+}
+
+void extract_segment_primes(const std::vector<std::uint64_t>&bits,
+							std::uint64_t seg_low,std::size_t bit_count,
+							std::vector<std::uint64_t>&primes){
+	append_primes(bits.data(),std::min(bit_count,bits.size()*64),seg_low,
+				  primes);
+}
+
+std::uint64_t select_prime(const std::uint64_t*bits,std::size_t bit_count,
+						   std::uint64_t seg_low,std::uint64_t rank) noexcept{
+	std::size_t word_count=(bit_count+63)/64;
+	for(std::size_t word=0;word<word_count;++word){
+		std::uint64_t mask=prime_mask(bits,word,bit_count);
+		std::uint64_t count=static_cast<std::uint64_t>(std::popcount(mask));
+		if(rank>=count){
+			rank-=count;
+			continue;
+		}
+		for(;rank>0;--rank){
+			mask&=mask-1;
+		}
+		std::uint64_t index=static_cast<std::uint64_t>(word)*64+
+							static_cast<std::uint64_t>(std::countr_zero(mask));
+		return seg_low+(index<<1);
+	}
+	return 0;
+}
+
+} // namespace calcprime
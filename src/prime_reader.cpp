@@ -0,0 +1,992 @@
+#include "prime_reader.h"
+
+#include "arrow_format.h"
+#include "container_format.h"
+#include "elias_fano_reader.h"
+#include "gap8_format.h"
+#include "mapped_file.h"
+#include "parquet_format.h"
+#include "prefix_sum.h"
+#include "wheel30_format.h"
+
+#include<algorithm>
+#include<bit>
+#include<charconv>
+#include<condition_variable>
+#include<cstring>
+#include<exception>
+#include<limits>
+#include<mutex>
+#include<stdexcept>
+#include<thread>
+
+#if defined(CALCPRIME_HAS_ZSTD)
+#include<zstd.h>
+#endif
+
+namespace calcprime{
+
+namespace{
+
+// Values per block for formats without blocks of their own (binary, ef,
+// text, delta16, zstd streams).
+constexpr std::size_t kBlockValues=1u<<16;
+// wheel30 bitmap bytes per block: 65536 bytes cover 1966080 integers.
+constexpr std::size_t kWheel30BlockBytes=1u<<16;
+// Decompressed bytes kept in memory for zstd streams.
+constexpr std::size_t kStreamWindowBytes=1u<<20;
+constexpr unsigned kMaxDecodeThreads=8;
+constexpr std::uint8_t kZstdMagic[4]={0x28,0xB5,0x2F,0xFD};
+
+std::uint64_t load_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+void load_u64_array(const std::uint8_t*in,std::size_t count,
+					std::uint64_t*out){
+	if constexpr(std::endian::native==std::endian::little){
+		std::memcpy(out,in,count*sizeof(std::uint64_t));
+	}else{
+		for(std::size_t i=0;i<count;++i){
+			out[i]=load_u64(in+8U*i);
+		}
+	}
+}
+
+bool has_prefix(const std::uint8_t*data,std::size_t size,const void*magic,
+				std::size_t magic_bytes){
+	return size>=magic_bytes&&std::memcmp(data,magic,magic_bytes)==0;
+}
+
+// A leading run of digits terminated by '\n'.
+bool looks_like_text(const std::uint8_t*data,std::size_t size){
+	std::size_t digits=0;
+	while(digits<size&&digits<21U&&data[digits]>='0'&&data[digits]<='9'){
+		++digits;
+	}
+	return digits>0&&digits<size&&data[digits]=='\n';
+}
+
+// binary and delta16 share a leading u64.  In binary the next u64 is a
+// nearby prime; in delta16 it packs four positive gaps, so it is at least
+// 2^48 and never a small step up from the first value.
+PrimeOutputFormat guess_binary_or_delta16(const std::uint8_t*data,
+										  std::size_t size){
+	if(size%8U!=0){
+		return PrimeOutputFormat::Delta16;
+	}
+	if(size<16U){
+		return PrimeOutputFormat::Binary;
+	}
+	std::uint64_t first=load_u64(data);
+	std::uint64_t second=load_u64(data+8);
+	return second>first&&second-first<(std::uint64_t{1}<<32)
+			   ?PrimeOutputFormat::Binary
+			   :PrimeOutputFormat::Delta16;
+}
+
+PrimeOutputFormat detect_plain_format(const std::uint8_t*data,
+									  std::size_t size){
+	if(has_prefix(data,size,"PAR1",4)){
+		return PrimeOutputFormat::Parquet;
+	}
+	if(has_prefix(data,size,arrow::kMagic,sizeof(arrow::kMagic))){
+		return PrimeOutputFormat::Arrow;
+	}
+	if(has_prefix(data,size,container::kMagic,sizeof(container::kMagic))){
+		return PrimeOutputFormat::Container;
+	}
+	if(has_prefix(data,size,"CPEF",4)){
+		return PrimeOutputFormat::EliasFano;
+	}
+	if(has_prefix(data,size,wheel30::kMagic,sizeof(wheel30::kMagic))){
+		return PrimeOutputFormat::Wheel30;
+	}
+	if(has_prefix(data,size,gap8::kMagic,sizeof(gap8::kMagic))){
+		return PrimeOutputFormat::Gap8;
+	}
+	if(looks_like_text(data,size)){
+		return PrimeOutputFormat::Text;
+	}
+	return guess_binary_or_delta16(data,size);
+}
+
+// ---------------------------------------------------------------------------
+// Indexed formats: blocks are located up front and decoded independently,
+// so they can be decoded on several threads and found by binary search.
+
+class IndexedSource{
+  public:
+	virtual ~IndexedSource()=default;
+	virtual std::size_t block_count() const=0;
+	// Must be safe to call concurrently for different blocks.
+	virtual void decode(std::size_t index,
+						std::vector<std::uint64_t>&out) const=0;
+	// A lower bound on the primes of block `index`, non-decreasing in
+	// `index`.  Formats that store the first prime override this; the
+	// default decodes the block.
+	virtual std::uint64_t block_lower_bound(std::size_t index) const{
+		std::vector<std::uint64_t> values;
+		decode(index,values);
+		return values.empty()?0:values.front();
+	}
+};
+
+class BinarySource final : public IndexedSource{
+  public:
+	BinarySource(const std::uint8_t*data,std::size_t size)
+		: data_(data),count_(size/8U){
+		if(size%8U!=0){
+			throw std::runtime_error("binary file size is not a multiple of 8");
+		}
+	}
+
+	std::size_t block_count() const override{
+		return (count_+kBlockValues-1U)/kBlockValues;
+	}
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		std::size_t begin=index*kBlockValues;
+		std::size_t count=std::min(kBlockValues,count_-begin);
+		out.resize(count);
+		load_u64_array(data_+8U*begin,count,out.data());
+	}
+
+	std::uint64_t block_lower_bound(std::size_t index) const override{
+		return load_u64(data_+8U*index*kBlockValues);
+	}
+
+  private:
+	const std::uint8_t*data_;
+	std::size_t count_;
+};
+
+class Gap8Source final : public IndexedSource{
+  public:
+	Gap8Source(const std::uint8_t*data,std::size_t size): data_(data){
+		gap8::parse_file_header(data,size);
+		std::size_t pos=gap8::kFileHeaderBytes;
+		while(pos<size){
+			gap8::BlockHeader header=
+				gap8::read_block_header(data+pos,size-pos);
+			if(header.payload_bytes>size-pos-gap8::kBlockHeaderBytes){
+				throw std::runtime_error("truncated gap8 block payload");
+			}
+			blocks_.push_back({pos,header});
+			pos+=gap8::kBlockHeaderBytes+header.payload_bytes;
+		}
+	}
+
+	std::size_t block_count() const override{ return blocks_.size(); }
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		const Block&block=blocks_[index];
+		out.resize(block.header.count);
+		gap8::decode_block(block.header,
+						   data_+block.offset+gap8::kBlockHeaderBytes,
+						   out.data());
+	}
+
+	std::uint64_t block_lower_bound(std::size_t index) const override{
+		return blocks_[index].header.first_prime;
+	}
+
+  private:
+	struct Block{
+		std::size_t offset;
+		gap8::BlockHeader header;
+	};
+
+	const std::uint8_t*data_;
+	std::vector<Block> blocks_;
+};
+
+class Wheel30Source final : public IndexedSource{
+  public:
+	Wheel30Source(const std::uint8_t*data,std::size_t size)
+		: header_(wheel30::decode_header(data,size)),
+		  bitmap_(data+wheel30::kHeaderBytes){}
+
+	std::size_t block_count() const override{
+		std::size_t blocks=static_cast<std::size_t>(
+			(header_.bitmap_bytes+kWheel30BlockBytes-1U)/kWheel30BlockBytes);
+		return std::max<std::size_t>(blocks,header_.small_primes!=0?1U:0U);
+	}
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		out.clear();
+		if(index==0){
+			static constexpr std::uint64_t kSmall[3]={2,3,5};
+			for(unsigned i=0;i<3;++i){
+				if((header_.small_primes>>i)&1U){
+					out.push_back(kSmall[i]);
+				}
+			}
+		}
+		std::uint64_t begin=static_cast<std::uint64_t>(index)*
+							kWheel30BlockBytes;
+		std::uint64_t end=std::min<std::uint64_t>(begin+kWheel30BlockBytes,
+												  header_.bitmap_bytes);
+		for(std::uint64_t byte=begin;byte<end;++byte){
+			unsigned bits=bitmap_[byte];
+			std::uint64_t base=header_.base+30U*byte;
+			while(bits!=0){
+				out.push_back(base+wheel30::kResidues[std::countr_zero(bits)]);
+				bits&=bits-1U;
+			}
+		}
+	}
+
+	std::uint64_t block_lower_bound(std::size_t index) const override{
+		return index==0?0
+					   :header_.base+30U*static_cast<std::uint64_t>(index)*
+										 kWheel30BlockBytes;
+	}
+
+  private:
+	wheel30::Header header_;
+	const std::uint8_t*bitmap_;
+};
+
+class EliasFanoSource final : public IndexedSource{
+  public:
+	explicit EliasFanoSource(const std::string&path): reader_(path){}
+
+	std::size_t block_count() const override{
+		return static_cast<std::size_t>((reader_.size()+kBlockValues-1U)/
+										kBlockValues);
+	}
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		std::uint64_t begin=static_cast<std::uint64_t>(index)*kBlockValues;
+		std::uint64_t count=std::min<std::uint64_t>(kBlockValues,
+													reader_.size()-begin);
+		out.resize(static_cast<std::size_t>(count));
+		auto it=reader_.iterator_at(begin);
+		for(std::uint64_t&value : out){
+			value=*it;
+			++it;
+		}
+	}
+
+	std::uint64_t block_lower_bound(std::size_t index) const override{
+		return reader_.select(static_cast<std::uint64_t>(index)*kBlockValues);
+	}
+
+  private:
+	EliasFanoReader reader_;
+};
+
+class ContainerSource final : public IndexedSource{
+  public:
+	ContainerSource(const std::uint8_t*data,std::size_t size): data_(data){
+		container::decode_file_header(data,size);
+		container::Footer footer=container::decode_footer(data,size);
+		index_=container::decode_index(data,size,footer);
+	}
+
+	std::size_t block_count() const override{ return index_.size(); }
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		const container::IndexEntry&entry=index_[index];
+		const std::uint8_t*block=data_+entry.offset;
+		container::BlockHeader header=
+			container::read_block_header(block,entry.block_bytes);
+		if(header.count!=entry.count){
+			throw std::runtime_error("container block disagrees with index");
+		}
+		out.resize(header.count);
+		container::decode_block(header,block,
+								block+container::kBlockHeaderBytes,out.data());
+	}
+
+	std::uint64_t block_lower_bound(std::size_t index) const override{
+		return index_[index].first_prime;
+	}
+
+  private:
+	const std::uint8_t*data_;
+	std::vector<container::IndexEntry> index_;
+};
+
+class ArrowSource final : public IndexedSource{
+  public:
+	ArrowSource(const std::uint8_t*data,std::size_t size)
+		: data_(data),blocks_(arrow::decode_footer(data,size)){}
+
+	std::size_t block_count() const override{ return blocks_.size(); }
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		arrow::decode_record_batch(data_,blocks_[index],out);
+	}
+
+  private:
+	const std::uint8_t*data_;
+	std::vector<arrow::BlockInfo> blocks_;
+};
+
+class ParquetSource final : public IndexedSource{
+  public:
+	ParquetSource(const std::uint8_t*data,std::size_t size): data_(data){
+		parquet::FileInfo info=parquet::decode_file_info(data,size);
+		zstd_=info.zstd;
+#if !defined(CALCPRIME_HAS_ZSTD)
+		if(zstd_){
+			throw std::runtime_error("zstd not supported in this build");
+		}
+#endif
+		for(const parquet::ColumnChunkInfo&chunk : info.row_groups){
+			std::size_t pos=static_cast<std::size_t>(chunk.data_page_offset);
+			std::size_t end=pos+static_cast<std::size_t>(
+									chunk.total_compressed_size);
+			std::int64_t values=0;
+			while(pos<end){
+				parquet::PageInfo page=
+					parquet::read_page_header(data+pos,end-pos);
+				std::size_t payload=pos+page.header_bytes;
+				if(static_cast<std::size_t>(page.compressed_size)>
+				   end-payload){
+					throw std::runtime_error("truncated Parquet page");
+				}
+				if(page.data_page){
+					pages_.push_back({payload,page});
+					values+=page.num_values;
+				}
+				pos=payload+static_cast<std::size_t>(page.compressed_size);
+			}
+			if(values!=chunk.num_values){
+				throw std::runtime_error(
+					"Parquet pages disagree with the column chunk");
+			}
+		}
+	}
+
+	std::size_t block_count() const override{ return pages_.size(); }
+
+	void decode(std::size_t index,
+				std::vector<std::uint64_t>&out) const override{
+		const Page&page=pages_[index];
+		const std::uint8_t*payload=data_+page.payload;
+		std::size_t size=static_cast<std::size_t>(page.info.compressed_size);
+		std::vector<std::uint8_t> decompressed;
+		if(zstd_){
+#if defined(CALCPRIME_HAS_ZSTD)
+			decompressed.resize(
+				static_cast<std::size_t>(page.info.uncompressed_size));
+			std::size_t written=ZSTD_decompress(
+				decompressed.data(),decompressed.size(),payload,size);
+			if(ZSTD_isError(written)||written!=decompressed.size()){
+				throw std::runtime_error("Parquet page failed to decompress");
+			}
+			payload=decompressed.data();
+			size=decompressed.size();
+#endif
+		}
+		std::size_t count=static_cast<std::size_t>(page.info.num_values);
+		out.resize(count);
+		if(page.info.encoding==parquet::ValueEncoding::DeltaBinaryPacked){
+			parquet::decode_delta_binary_packed(payload,size,count,out.data());
+		}else{
+			if(size<count*sizeof(std::uint64_t)){
+				throw std::runtime_error("truncated Parquet PLAIN page");
+			}
+			load_u64_array(payload,count,out.data());
+		}
+	}
+
+  private:
+	struct Page{
+		std::size_t payload;
+		parquet::PageInfo info;
+	};
+
+	const std::uint8_t*data_;
+	bool zstd_=false;
+	std::vector<Page> pages_;
+};
+
+// ---------------------------------------------------------------------------
+// Sequential formats read through a ByteStream, which is either the mapped
+// file or a zstd decompression window over it.
+
+class ByteStream{
+  public:
+	ByteStream(const std::uint8_t*data,std::size_t size,bool zstd)
+		: data_(data),size_(size),zstd_(zstd){
+#if defined(CALCPRIME_HAS_ZSTD)
+		if(zstd_){
+			dctx_=ZSTD_createDCtx();
+			if(!dctx_){
+				throw std::runtime_error("failed to create zstd context");
+			}
+			window_.resize(kStreamWindowBytes);
+		}
+#else
+		if(zstd_){
+			throw std::runtime_error("zstd not supported in this build");
+		}
+#endif
+	}
+
+	~ByteStream(){
+#if defined(CALCPRIME_HAS_ZSTD)
+		ZSTD_freeDCtx(dctx_);
+#endif
+	}
+
+	ByteStream(const ByteStream&)=delete;
+	ByteStream&operator=(const ByteStream&)=delete;
+
+	void rewind(){
+		pos_=0;
+		input_pos_=0;
+		begin_=end_=0;
+#if defined(CALCPRIME_HAS_ZSTD)
+		if(zstd_){
+			ZSTD_DCtx_reset(dctx_,ZSTD_reset_session_only);
+		}
+#endif
+	}
+
+	// Makes at least `bytes` bytes available unless the stream ends first,
+	// and returns how many are available.  `bytes` must not exceed the
+	// window for zstd streams.
+	std::size_t fill(std::size_t bytes){
+		if(!zstd_){
+			return size_-pos_;
+		}
+#if defined(CALCPRIME_HAS_ZSTD)
+		if(end_-begin_>=bytes){
+			return end_-begin_;
+		}
+		std::memmove(window_.data(),window_.data()+begin_,end_-begin_);
+		end_-=begin_;
+		begin_=0;
+		while(end_<bytes&&(input_pos_<size_||frame_open_)){
+			ZSTD_inBuffer in{data_,size_,input_pos_};
+			ZSTD_outBuffer out{window_.data(),window_.size(),end_};
+			std::size_t result=ZSTD_decompressStream(dctx_,&out,&in);
+			if(ZSTD_isError(result)){
+				throw std::runtime_error(std::string("zstd decompress error: ")+
+										 ZSTD_getErrorName(result));
+			}
+			bool progressed=in.pos!=input_pos_||out.pos!=end_;
+			input_pos_=in.pos;
+			end_=out.pos;
+			frame_open_=result!=0;
+			if(!progressed){
+				if(input_pos_>=size_&&frame_open_){
+					throw std::runtime_error("truncated zstd stream");
+				}
+				break;
+			}
+		}
+		return end_-begin_;
+#else
+		(void)bytes;
+		return 0;
+#endif
+	}
+
+	const std::uint8_t*data() const{
+		return zstd_?window_.data()+begin_:data_+pos_;
+	}
+
+	void consume(std::size_t bytes){
+		if(zstd_){
+			begin_+=bytes;
+		}else{
+			pos_+=bytes;
+		}
+	}
+
+  private:
+	const std::uint8_t*data_;
+	std::size_t size_;
+	bool zstd_;
+	std::size_t pos_=0;
+	std::size_t input_pos_=0;
+	bool frame_open_=false;
+	std::vector<std::uint8_t> window_;
+	std::size_t begin_=0;
+	std::size_t end_=0;
+#if defined(CALCPRIME_HAS_ZSTD)
+	ZSTD_DCtx*dctx_=nullptr;
+#endif
+};
+
+class SequentialSource{
+  public:
+	explicit SequentialSource(ByteStream&stream): stream_(stream){}
+	virtual ~SequentialSource()=default;
+	// Fills `out` with up to kBlockValues primes; false at the end.
+	virtual bool next(std::vector<std::uint64_t>&out)=0;
+	virtual void rewind(){ stream_.rewind(); }
+
+  protected:
+	ByteStream&stream_;
+};
+
+class TextSource final : public SequentialSource{
+  public:
+	using SequentialSource::SequentialSource;
+
+	bool next(std::vector<std::uint64_t>&out) override{
+		out.clear();
+		while(out.size()<kBlockValues){
+			std::size_t available=stream_.fill(kStreamWindowBytes/2U);
+			if(available==0){
+				break;
+			}
+			const char*begin=reinterpret_cast<const char*>(stream_.data());
+			const char*end=begin+available;
+			const char*line=begin;
+			while(out.size()<kBlockValues){
+				const char*newline=static_cast<const char*>(
+					std::memchr(line,'\n',static_cast<std::size_t>(end-line)));
+				if(!newline){
+					break;
+				}
+				std::uint64_t value=0;
+				auto result=std::from_chars(line,newline,value);
+				if(result.ec!=std::errc()||result.ptr!=newline){
+					throw std::runtime_error("invalid line in text output");
+				}
+				out.push_back(value);
+				line=newline+1;
+			}
+			if(line==begin){
+				throw std::runtime_error("unterminated line in text output");
+			}
+			stream_.consume(static_cast<std::size_t>(line-begin));
+		}
+		return !out.empty();
+	}
+};
+
+class BinaryStreamSource final : public SequentialSource{
+  public:
+	using SequentialSource::SequentialSource;
+
+	bool next(std::vector<std::uint64_t>&out) override{
+		std::size_t available=stream_.fill(kBlockValues*8U);
+		std::size_t count=std::min(kBlockValues,available/8U);
+		if(count==0&&available!=0){
+			throw std::runtime_error("truncated binary output");
+		}
+		out.resize(count);
+		load_u64_array(stream_.data(),count,out.data());
+		stream_.consume(count*8U);
+		return count!=0;
+	}
+};
+
+class Delta16Source final : public SequentialSource{
+  public:
+	using SequentialSource::SequentialSource;
+
+	bool next(std::vector<std::uint64_t>&out) override{
+		out.clear();
+		if(!started_){
+			std::size_t available=stream_.fill(8);
+			if(available==0){
+				return false;
+			}
+			if(available<8){
+				throw std::runtime_error("truncated delta16 output");
+			}
+			previous_=load_u64(stream_.data());
+			stream_.consume(8);
+			started_=true;
+			out.push_back(previous_);
+		}
+		std::size_t available=stream_.fill(2U*kBlockValues);
+		std::size_t count=std::min(kBlockValues-out.size(),available/2U);
+		if(count==0&&available!=0&&out.empty()){
+			throw std::runtime_error("truncated delta16 output");
+		}
+		std::size_t offset=out.size();
+		out.resize(offset+count);
+		previous_=decode_delta16(stream_.data(),count,previous_,
+								 out.data()+offset);
+		stream_.consume(2U*count);
+		return !out.empty();
+	}
+
+	void rewind() override{
+		SequentialSource::rewind();
+		started_=false;
+	}
+
+  private:
+	bool started_=false;
+	std::uint64_t previous_=0;
+};
+
+// gap8 inside a zstd stream; plain gap8 files use Gap8Source.
+class Gap8StreamSource final : public SequentialSource{
+  public:
+	using SequentialSource::SequentialSource;
+
+	bool next(std::vector<std::uint64_t>&out) override{
+		if(!started_){
+			std::size_t available=stream_.fill(gap8::kFileHeaderBytes);
+			gap8::parse_file_header(stream_.data(),available);
+			stream_.consume(gap8::kFileHeaderBytes);
+			started_=true;
+		}
+		std::size_t available=stream_.fill(gap8::kBlockHeaderBytes);
+		if(available==0){
+			out.clear();
+			return false;
+		}
+		gap8::BlockHeader header=
+			gap8::read_block_header(stream_.data(),available);
+		std::size_t bytes=gap8::kBlockHeaderBytes+header.payload_bytes;
+		if(bytes>kStreamWindowBytes){
+			throw std::runtime_error("gap8 block exceeds the stream window");
+		}
+		if(stream_.fill(bytes)<bytes){
+			throw std::runtime_error("truncated gap8 block payload");
+		}
+		out.resize(header.count);
+		gap8::decode_block(header,stream_.data()+gap8::kBlockHeaderBytes,
+						   out.data());
+		stream_.consume(bytes);
+		return true;
+	}
+
+	void rewind() override{
+		SequentialSource::rewind();
+		started_=false;
+	}
+
+  private:
+	bool started_=false;
+};
+
+unsigned default_thread_count(){
+	unsigned threads=std::thread::hardware_concurrency();
+	return std::clamp(threads,1U,kMaxDecodeThreads);
+}
+
+void trim_below(std::vector<std::uint64_t>&values,std::uint64_t value){
+	auto first=std::lower_bound(values.begin(),values.end(),value);
+	values.erase(values.begin(),first);
+}
+
+} // namespace
+
+struct PrimeReader::Impl{
+	MappedFile file;
+	PrimeOutputFormat format=PrimeOutputFormat::Binary;
+	bool zstd_stream=false;
+	unsigned threads=1;
+
+	std::unique_ptr<IndexedSource> indexed;
+	std::unique_ptr<ByteStream> stream;
+	std::unique_ptr<SequentialSource> sequential;
+
+	// Block left over from seek(), handed out before anything else.
+	std::vector<std::uint64_t> pending;
+	bool has_pending=false;
+
+	// Decode-ahead window for indexed sources.  Workers claim block
+	// `issued` while it is less than `next`+slots.size(); next_block()
+	// waits for slot `next`.  seek() bumps `generation` so that results of
+	// in-flight blocks from before the seek are dropped.
+	struct Slot{
+		std::vector<std::uint64_t> values;
+		std::exception_ptr error;
+		bool ready=false;
+	};
+	std::vector<Slot> slots;
+	std::size_t next=0;
+	std::size_t issued=0;
+	std::size_t active=0;
+	std::uint64_t generation=0;
+	bool stop=false;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<std::thread> workers;
+
+	explicit Impl(const std::string&path): file(path){}
+
+	~Impl(){
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop=true;
+		}
+		cv.notify_all();
+		for(std::thread&worker : workers){
+			worker.join();
+		}
+	}
+
+	void open(std::optional<PrimeOutputFormat> requested,
+			  unsigned requested_threads,const std::string&path){
+		const std::uint8_t*data=file.data();
+		std::size_t size=file.size();
+		zstd_stream=has_prefix(data,size,kZstdMagic,sizeof(kZstdMagic));
+		if(zstd_stream){
+			stream=std::make_unique<ByteStream>(data,size,true);
+			std::size_t available=stream->fill(64);
+			format=requested.value_or(
+				detect_plain_format(stream->data(),available));
+			stream->rewind();
+			switch(format){
+			case PrimeOutputFormat::Text:
+				sequential=std::make_unique<TextSource>(*stream);
+				break;
+			case PrimeOutputFormat::Binary:
+				sequential=std::make_unique<BinaryStreamSource>(*stream);
+				break;
+			case PrimeOutputFormat::Delta16:
+				sequential=std::make_unique<Delta16Source>(*stream);
+				break;
+			case PrimeOutputFormat::Gap8:
+				sequential=std::make_unique<Gap8StreamSource>(*stream);
+				break;
+			default:
+				throw std::runtime_error(
+					"only text, binary, delta16 and gap8 can be zstd streams");
+			}
+			return;
+		}
+
+		format=requested.value_or(detect_plain_format(data,size));
+		switch(format){
+		case PrimeOutputFormat::Text:
+			stream=std::make_unique<ByteStream>(data,size,false);
+			sequential=std::make_unique<TextSource>(*stream);
+			return;
+		case PrimeOutputFormat::Delta16:
+			stream=std::make_unique<ByteStream>(data,size,false);
+			sequential=std::make_unique<Delta16Source>(*stream);
+			return;
+		case PrimeOutputFormat::Binary:
+			indexed=std::make_unique<BinarySource>(data,size);
+			break;
+		case PrimeOutputFormat::Gap8:
+			indexed=std::make_unique<Gap8Source>(data,size);
+			break;
+		case PrimeOutputFormat::Wheel30:
+			indexed=std::make_unique<Wheel30Source>(data,size);
+			break;
+		case PrimeOutputFormat::EliasFano:
+			indexed=std::make_unique<EliasFanoSource>(path);
+			break;
+		case PrimeOutputFormat::Container:
+			indexed=std::make_unique<ContainerSource>(data,size);
+			break;
+		case PrimeOutputFormat::Arrow:
+			indexed=std::make_unique<ArrowSource>(data,size);
+			break;
+		case PrimeOutputFormat::Parquet:
+			indexed=std::make_unique<ParquetSource>(data,size);
+			break;
+		}
+
+		threads=requested_threads==0?default_thread_count()
+									:requested_threads;
+		threads=static_cast<unsigned>(std::min<std::size_t>(
+			threads,std::max<std::size_t>(indexed->block_count(),1U)));
+		if(threads>1){
+			slots.resize(2U*threads);
+			for(unsigned i=0;i<threads;++i){
+				workers.emplace_back([this]{ worker_loop(); });
+			}
+		}
+	}
+
+	void worker_loop(){
+		std::unique_lock<std::mutex> lock(mutex);
+		std::size_t end=indexed->block_count();
+		while(true){
+			cv.wait(lock,[&]{
+				return stop||(issued<end&&issued<next+slots.size());
+			});
+			if(stop){
+				return;
+			}
+			std::size_t index=issued++;
+			std::uint64_t claimed_generation=generation;
+			++active;
+			lock.unlock();
+
+			std::vector<std::uint64_t> values;
+			std::exception_ptr error;
+			try{
+				indexed->decode(index,values);
+			}catch(...){
+				error=std::current_exception();
+			}
+
+			lock.lock();
+			--active;
+			if(claimed_generation==generation){
+				Slot&slot=slots[index%slots.size()];
+				slot.values=std::move(values);
+				slot.error=error;
+				slot.ready=true;
+			}
+			cv.notify_all();
+		}
+	}
+
+	bool next_indexed(std::vector<std::uint64_t>&out){
+		if(workers.empty()){
+			if(next>=indexed->block_count()){
+				return false;
+			}
+			indexed->decode(next++,out);
+			return true;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		if(next>=indexed->block_count()){
+			return false;
+		}
+		Slot&slot=slots[next%slots.size()];
+		cv.wait(lock,[&]{ return slot.ready; });
+		slot.ready=false;
+		std::exception_ptr error=std::move(slot.error);
+		slot.error=nullptr;
+		out.swap(slot.values);
+		++next;
+		cv.notify_all();
+		if(error){
+			std::rethrow_exception(error);
+		}
+		return true;
+	}
+
+	// Restarts decoding at block `index`, discarding decoded-ahead blocks.
+	void restart_at(std::size_t index){
+		std::unique_lock<std::mutex> lock(mutex);
+		++generation;
+		cv.wait(lock,[&]{ return active==0; });
+		for(Slot&slot : slots){
+			slot.ready=false;
+			slot.error=nullptr;
+			slot.values.clear();
+		}
+		next=issued=index;
+		cv.notify_all();
+	}
+
+	void seek_indexed(std::uint64_t value){
+		if(indexed->block_count()==0){
+			restart_at(0);
+			return;
+		}
+		// Last block whose lower bound is <= value; the value's successors
+		// start there or later.
+		std::size_t low=0;
+		std::size_t high=indexed->block_count();
+		while(high-low>1U){
+			std::size_t mid=low+(high-low)/2U;
+			if(indexed->block_lower_bound(mid)<=value){
+				low=mid;
+			}else{
+				high=mid;
+			}
+		}
+		indexed->decode(low,pending);
+		trim_below(pending,value);
+		has_pending=!pending.empty();
+		restart_at(low+1U);
+	}
+
+	void seek_sequential(std::uint64_t value){
+		sequential->rewind();
+		while(sequential->next(pending)){
+			if(pending.back()>=value){
+				trim_below(pending,value);
+				has_pending=true;
+				return;
+			}
+		}
+	}
+};
+
+PrimeReader::PrimeReader(const std::string&path,
+						 std::optional<PrimeOutputFormat> format,
+						 unsigned threads)
+	: impl_(std::make_unique<Impl>(path)){
+	impl_->open(format,threads,path);
+}
+
+PrimeReader::~PrimeReader()=default;
+
+PrimeOutputFormat PrimeReader::format() const{ return impl_->format; }
+
+bool PrimeReader::zstd_stream() const{ return impl_->zstd_stream; }
+
+unsigned PrimeReader::threads() const{ return impl_->threads; }
+
+bool PrimeReader::indexed() const{ return impl_->indexed!=nullptr; }
+
+bool PrimeReader::next_block(std::vector<std::uint64_t>&out){
+	if(impl_->has_pending){
+		impl_->has_pending=false;
+		out.swap(impl_->pending);
+		impl_->pending.clear();
+		return true;
+	}
+	// wheel30 blocks over long prime-free stretches can be empty.
+	while(impl_->indexed?impl_->next_indexed(out)
+						:impl_->sequential->next(out)){
+		if(!out.empty()){
+			return true;
+		}
+	}
+	out.clear();
+	return false;
+}
+
+bool PrimeReader::last_block(std::vector<std::uint64_t>&out){
+	impl_->has_pending=false;
+	impl_->pending.clear();
+	out.clear();
+	if(impl_->indexed){
+		std::size_t count=impl_->indexed->block_count();
+		impl_->restart_at(count);
+		for(std::size_t index=count;index>0;--index){
+			impl_->indexed->decode(index-1U,out);
+			if(!out.empty()){
+				return true;
+			}
+		}
+		return false;
+	}
+	impl_->sequential->rewind();
+	std::vector<std::uint64_t> block;
+	while(impl_->sequential->next(block)){
+		if(!block.empty()){
+			out.swap(block);
+		}
+	}
+	return !out.empty();
+}
+
+void PrimeReader::seek(std::uint64_t value){
+	impl_->has_pending=false;
+	impl_->pending.clear();
+	if(impl_->indexed){
+		impl_->seek_indexed(value);
+	}else{
+		impl_->seek_sequential(value);
+	}
+}
+
+} // namespace calcprime
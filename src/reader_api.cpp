@@ -0,0 +1,201 @@
+#include "calcprime/reader.h"
+
+#include "api_output_format.h"
+#include "prime_reader.h"
+#include "shm_ring.h"
+
+#include<exception>
+#include<memory>
+#include<new>
+#include<optional>
+#include<string>
+#include<vector>
+
+struct calcprime_reader{
+	std::unique_ptr<calcprime::PrimeReader> reader;
+	std::vector<std::uint64_t> block;
+	std::string error_message;
+};
+
+struct calcprime_shm_reader{
+	std::unique_ptr<calcprime::ShmRingReader> ring;
+	std::string error_message;
+};
+
+namespace{
+
+template<class Reader>
+calcprime_status fail(Reader&reader,const std::exception_ptr&error){
+	try{
+		std::rethrow_exception(error);
+	}catch(const std::exception&ex){
+		reader.error_message=ex.what();
+	}catch(...){
+		reader.error_message="unknown error";
+	}
+	return CALCPRIME_STATUS_IO_ERROR;
+}
+
+} // namespace
+
+extern "C" int calcprime_reader_options_init(calcprime_reader_options*options){
+	if(!options){
+		return -1;
+	}
+	options->detect_format=1;
+	options->format=CALCPRIME_OUTPUT_BINARY;
+	options->threads=0;
+	return 0;
+}
+
+extern "C" calcprime_status
+calcprime_reader_open(const char*path,const calcprime_reader_options*options,
+					  calcprime_reader**out_reader){
+	if(!out_reader){
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	*out_reader=new(std::nothrow) calcprime_reader();
+	if(!*out_reader){
+		return CALCPRIME_STATUS_INTERNAL_ERROR;
+	}
+	calcprime_reader&reader=**out_reader;
+	if(!path){
+		reader.error_message="path is null";
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	calcprime_reader_options defaults{};
+	calcprime_reader_options_init(&defaults);
+	if(!options){
+		options=&defaults;
+	}
+	std::optional<calcprime::PrimeOutputFormat> format;
+	if(!options->detect_format){
+		if(!calcprime::capi::is_valid_output_format(options->format)){
+			reader.error_message="invalid output format";
+			return CALCPRIME_STATUS_INVALID_ARGUMENT;
+		}
+		format=calcprime::capi::to_cpp_output(options->format);
+	}
+	try{
+		reader.reader=std::make_unique<calcprime::PrimeReader>(
+			path,format,options->threads);
+	}catch(...){
+		return fail(reader,std::current_exception());
+	}
+	return CALCPRIME_STATUS_SUCCESS;
+}
+
+extern "C" const char*
+calcprime_reader_error_message(const calcprime_reader*reader){
+	if(!reader||reader->error_message.empty()){
+		return nullptr;
+	}
+	return reader->error_message.c_str();
+}
+
+extern "C" calcprime_output_format
+calcprime_reader_format(const calcprime_reader*reader){
+	if(!reader||!reader->reader){
+		return CALCPRIME_OUTPUT_BINARY;
+	}
+	return calcprime::capi::to_c_output(reader->reader->format());
+}
+
+extern "C" calcprime_status
+calcprime_reader_next_block(calcprime_reader*reader,
+							const std::uint64_t**out_primes,
+							std::size_t*out_count){
+	if(!reader||!reader->reader||!out_primes||!out_count){
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	*out_primes=nullptr;
+	*out_count=0;
+	try{
+		if(reader->reader->next_block(reader->block)){
+			*out_primes=reader->block.data();
+			*out_count=reader->block.size();
+		}
+	}catch(...){
+		return fail(*reader,std::current_exception());
+	}
+	return CALCPRIME_STATUS_SUCCESS;
+}
+
+extern "C" calcprime_status calcprime_reader_seek(calcprime_reader*reader,
+												  std::uint64_t value){
+	if(!reader||!reader->reader){
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	try{
+		reader->reader->seek(value);
+	}catch(...){
+		return fail(*reader,std::current_exception());
+	}
+	return CALCPRIME_STATUS_SUCCESS;
+}
+
+extern "C" void calcprime_reader_close(calcprime_reader*reader){
+	delete reader;
+}
+
+extern "C" calcprime_status
+calcprime_shm_reader_open(const char*name,unsigned timeout_ms,
+						  calcprime_shm_reader**out_reader){
+	if(!out_reader){
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	*out_reader=new(std::nothrow) calcprime_shm_reader();
+	if(!*out_reader){
+		return CALCPRIME_STATUS_INTERNAL_ERROR;
+	}
+	calcprime_shm_reader&reader=**out_reader;
+	if(!name){
+		reader.error_message="name is null";
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	try{
+		reader.ring=std::make_unique<calcprime::ShmRingReader>(name,timeout_ms);
+	}catch(...){
+		return fail(reader,std::current_exception());
+	}
+	return CALCPRIME_STATUS_SUCCESS;
+}
+
+extern "C" const char*
+calcprime_shm_reader_error_message(const calcprime_shm_reader*reader){
+	if(!reader||reader->error_message.empty()){
+		return nullptr;
+	}
+	return reader->error_message.c_str();
+}
+
+extern "C" calcprime_status
+calcprime_shm_reader_next_block(calcprime_shm_reader*reader,
+								const std::uint64_t**out_primes,
+								std::size_t*out_count,
+								std::uint64_t*out_sequence){
+	if(!reader||!reader->ring||!out_primes||!out_count){
+		return CALCPRIME_STATUS_INVALID_ARGUMENT;
+	}
+	*out_primes=nullptr;
+	*out_count=0;
+	std::uint64_t sequence=0;
+	try{
+		const std::uint64_t*primes=nullptr;
+		std::size_t count=0;
+		if(reader->ring->next_block(primes,count,sequence)){
+			*out_primes=primes;
+			*out_count=count;
+		}
+	}catch(...){
+		return fail(*reader,std::current_exception());
+	}
+	if(out_sequence){
+		*out_sequence=sequence;
+	}
+	return CALCPRIME_STATUS_SUCCESS;
+}
+
+extern "C" void calcprime_shm_reader_close(calcprime_shm_reader*reader){
+	delete reader;
+}
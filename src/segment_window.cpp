@@ -0,0 +1,90 @@
+#include "segment_window.h"
+
+#include<algorithm>
+#include<stdexcept>
+
+namespace calcprime{
+
+SegmentReorderWindow::SegmentReorderWindow(std::uint64_t segment_count,
+										   std::size_t capacity)
+	: slots_(std::max<std::size_t>(capacity,1)),segment_count_(segment_count){}
+
+std::size_t SegmentReorderWindow::choose_capacity(unsigned threads,
+												  std::uint32_t batch_segments,
+												  std::uint64_t segment_count){
+	std::uint64_t capacity=2ull*std::max(threads,1u)*
+						   std::max<std::uint32_t>(batch_segments,1);
+	capacity=std::max<std::uint64_t>(capacity,4);
+	capacity=std::min<std::uint64_t>(capacity,std::max<std::uint64_t>(
+												  segment_count,1));
+	return static_cast<std::size_t>(capacity);
+}
+
+bool SegmentReorderWindow::put(std::uint64_t segment_id,
+							   std::vector<std::uint64_t>&&primes){
+	if(segment_id>=segment_count_){
+		throw std::invalid_argument("segment id outside the reorder window");
+	}
+	Slot&slot=slots_[static_cast<std::size_t>(segment_id%slots_.size())];
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if(segment_id>=next_+slots_.size()&&!stopped_){
+			++producer_waits_;
+			space_cv_.wait(lock,[&]{
+				return segment_id<next_+slots_.size()||stopped_;
+			});
+		}
+		if(stopped_){
+			return false;
+		}
+		// The consumer is at most `capacity - 1` segments behind, so the
+		// slot was emptied for this segment and nobody else writes it.
+		slot.primes=std::move(primes);
+		slot.ready=true;
+		++buffered_;
+		peak_buffered_=std::max(peak_buffered_,buffered_);
+	}
+	ready_cv_.notify_one();
+	return true;
+}
+
+bool SegmentReorderWindow::take(std::vector<std::uint64_t>&primes){
+	std::unique_lock<std::mutex> lock(mutex_);
+	if(next_>=segment_count_){
+		return false;
+	}
+	Slot&slot=slots_[static_cast<std::size_t>(next_%slots_.size())];
+	ready_cv_.wait(lock,[&]{ return slot.ready||stopped_; });
+	if(!slot.ready){
+		return false;
+	}
+	primes=std::move(slot.primes);
+	slot.primes=std::vector<std::uint64_t>();
+	slot.ready=false;
+	--buffered_;
+	++next_;
+	lock.unlock();
+	space_cv_.notify_all();
+	return true;
+}
+
+void SegmentReorderWindow::stop(){
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopped_=true;
+	}
+	ready_cv_.notify_all();
+	space_cv_.notify_all();
+}
+
+std::size_t SegmentReorderWindow::peak_buffered() const{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return peak_buffered_;
+}
+
+std::uint64_t SegmentReorderWindow::producer_waits() const{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return producer_waits_;
+}
+
+} // namespace calcprime
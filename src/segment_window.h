@@ -0,0 +1,64 @@
+#pragma once
+
+#include<condition_variable>
+#include<cstddef>
+#include<cstdint>
+#include<mutex>
+#include<vector>
+
+namespace calcprime{
+
+// Hands sieved segments from the workers to the one thread that writes
+// them, in segment order, while holding at most `capacity` of them.
+// Segment `id` lives in slot `id % capacity`; a worker that finishes a
+// segment `capacity` or more ahead of the consumer waits for it to catch
+// up.  Segments are handed out in increasing order and a worker sieves its
+// chunk in order, so the worker holding the consumer's next segment never
+// waits and the window cannot deadlock.
+class SegmentReorderWindow{
+  public:
+	SegmentReorderWindow(std::uint64_t segment_count,std::size_t capacity);
+
+	SegmentReorderWindow(const SegmentReorderWindow&)=delete;
+	SegmentReorderWindow&operator=(const SegmentReorderWindow&)=delete;
+
+	// Two slots per segment a worker can hold at once, so that workers
+	// rarely wait on a consumer that keeps up.
+	static std::size_t choose_capacity(unsigned threads,
+									   std::uint32_t batch_segments,
+									   std::uint64_t segment_count);
+
+	// Returns false, dropping the primes, once stop() has been called.
+	bool put(std::uint64_t segment_id,std::vector<std::uint64_t>&&primes);
+	// Moves the next segment in order into `primes`.  Returns false after
+	// the last segment, or after stop() once the next one is not ready.
+	bool take(std::vector<std::uint64_t>&primes);
+	// Wakes every waiter; the run is ending early.
+	void stop();
+
+	std::size_t capacity() const{ return slots_.size(); }
+	// Most segments sieved but not yet taken at any one time.
+	std::size_t peak_buffered() const;
+	// Times a worker had to wait for the consumer.
+	std::uint64_t producer_waits() const;
+
+  private:
+	// Guarded by mutex_ like the rest of the window.
+	struct Slot{
+		bool ready=false;
+		std::vector<std::uint64_t> primes;
+	};
+
+	std::vector<Slot> slots_;
+	std::uint64_t segment_count_;
+	mutable std::mutex mutex_;
+	std::condition_variable ready_cv_;
+	std::condition_variable space_cv_;
+	std::uint64_t next_=0;
+	std::size_t buffered_=0;
+	std::size_t peak_buffered_=0;
+	std::uint64_t producer_waits_=0;
+	bool stopped_=false;
+};
+
+} // namespace calcprime
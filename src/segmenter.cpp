@@ -180,6 +180,38 @@ SegmentConfig choose_segment_config(const CpuInfo&info,unsigned threads,
 	return config;
 }
 
+std::uint32_t choose_super_segment_segments(const CpuInfo&info,
+											const SegmentConfig&config,
+											unsigned threads,
+											std::uint64_t range_end,
+											std::uint64_t range_length){
+	// Caps the segments a worker holds at once, which the reorder window
+	// multiplies by the thread count.
+	constexpr std::uint64_t kMaxSuperSegmentSegments=8;
+	// Whole super-segments each thread should get for load balance.
+	constexpr std::uint64_t kMinSuperSegmentsPerThread=4;
+	if(config.segment_bytes==0||config.segment_span==0||
+	   info.l3_per_core_bytes==0){
+		return 1;
+	}
+	// PrimeMarker buckets primes above a segment span; below that the
+	// grouping buys nothing and only coarsens the work split.
+	long double root=std::sqrt(static_cast<long double>(range_end));
+	if(root<=static_cast<long double>(config.segment_span)){
+		return 1;
+	}
+	std::uint64_t segments=
+		static_cast<std::uint64_t>(info.l3_per_core_bytes/config.segment_bytes);
+	segments=std::min(segments,kMaxSuperSegmentSegments);
+	std::uint64_t total_segments=
+		range_length/config.segment_span+
+		((range_length%config.segment_span)!=0ULL?1ULL:0ULL);
+	std::uint64_t thread_count=threads?threads:1;
+	segments=std::min(segments,
+					  total_segments/(kMinSuperSegmentsPerThread*thread_count));
+	return static_cast<std::uint32_t>(std::max<std::uint64_t>(segments,1));
+}
+
 SegmentConfig choose_worker_segment_config(const CpuInfo&info,
 										   const SegmentConfig&base_config,
 										   unsigned worker_index,
@@ -259,12 +291,9 @@ SegmentWorkQueue::SegmentWorkQueue(SieveRange range,const SegmentConfig&config)
 
 bool SegmentWorkQueue::next(std::uint64_t&segment_id,std::uint64_t&segment_low,
 							std::uint64_t&segment_high){
-	std::uint64_t begin_id=0;
-	std::uint64_t end_id=0;
-	if(!next_chunk(1,begin_id,end_id)||begin_id>=end_id){
-		return false;
-	}
-	segment_id=begin_id;
+	// A single segment, so threads may share a super-segment; each then
+	// loads its large-prime hits separately.
+	segment_id=next_segment_.fetch_add(1,std::memory_order_relaxed);
 	return segment_bounds(segment_id,segment_low,segment_high);
 }
 
@@ -279,6 +308,12 @@ bool SegmentWorkQueue::next_chunk(std::uint64_t requested_segments,
 	if(requested_segments==0){
 		requested_segments=1;
 	}
+	std::uint64_t group=config_.super_segment_segments?
+							config_.super_segment_segments:1;
+	if(requested_segments>std::numeric_limits<std::uint64_t>::max()/group){
+		requested_segments=std::numeric_limits<std::uint64_t>::max()/group;
+	}
+	requested_segments*=group;
 	std::uint64_t begin=
 		next_segment_.fetch_add(requested_segments,std::memory_order_relaxed);
 	if(begin>=total_segments_){
@@ -0,0 +1,448 @@
+#include "shm_ring.h"
+
+#include<stdexcept>
+
+#if defined(__linux__)
+#include<algorithm>
+#include<atomic>
+#include<cerrno>
+#include<chrono>
+#include<climits>
+#include<cstring>
+#include<thread>
+
+#include<fcntl.h>
+#include<linux/futex.h>
+#include<signal.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/syscall.h>
+#include<time.h>
+#include<unistd.h>
+#endif
+
+namespace calcprime{
+
+namespace shm{
+
+std::string object_name(const std::string&name){
+	std::string bare=name;
+	if(!bare.empty()&&bare.front()=='/'){
+		bare.erase(0,1);
+	}
+	if(bare.empty()||bare.size()>200||bare.find('/')!=std::string::npos){
+		throw std::invalid_argument("invalid shared memory name: "+name);
+	}
+	return "/"+bare;
+}
+
+} // namespace shm
+
+#if defined(__linux__)
+
+namespace{
+
+using shm::RingHeader;
+using shm::SlotHeader;
+
+// Consumers look for a vanished producer this often while they wait.
+constexpr long kWaitSliceNs=200000000L;
+
+template<class T>
+std::atomic_ref<T> shared(T&value){
+	return std::atomic_ref<T>(value);
+}
+
+std::string errno_message(const std::string&what,int error){
+	return what+": "+std::strerror(error);
+}
+
+void futex_wait(std::uint32_t&word,std::uint32_t expected,bool sliced){
+	timespec slice{0,kWaitSliceNs};
+	syscall(SYS_futex,&word,FUTEX_WAIT,expected,sliced?&slice:nullptr,
+			nullptr,0);
+}
+
+// Makes a change visible to waiters on `seq`: the change itself must be
+// stored before this is called.
+void bump(std::uint32_t&seq,std::uint32_t&waiters){
+	shared(seq).fetch_add(1,std::memory_order_seq_cst);
+	if(shared(waiters).load(std::memory_order_seq_cst)!=0){
+		syscall(SYS_futex,&seq,FUTEX_WAKE,INT_MAX,nullptr,nullptr,0);
+	}
+}
+
+// Sleeps on `seq` until `ready()` holds.  `check()` runs after every
+// timed-out slice when `sliced` is set.
+template<class Ready,class Check>
+void wait_until(std::uint32_t&seq,std::uint32_t&waiters,Ready ready,
+				bool sliced,Check check){
+	while(!ready()){
+		std::uint32_t observed=shared(seq).load(std::memory_order_seq_cst);
+		shared(waiters).fetch_add(1,std::memory_order_seq_cst);
+		if(!ready()){
+			futex_wait(seq,observed,sliced);
+		}
+		shared(waiters).fetch_sub(1,std::memory_order_seq_cst);
+		if(sliced){
+			check();
+		}
+	}
+}
+
+std::uint64_t slot_stride(std::uint32_t block_bytes){
+	return (sizeof(SlotHeader)+block_bytes+63U)&~std::uint64_t{63};
+}
+
+} // namespace
+
+ShmRingWriter::ShmRingWriter(const std::string&name,std::uint32_t block_count,
+							 std::uint32_t block_bytes,
+							 unsigned consumer_timeout_ms)
+	: object_name_(shm::object_name(name)),block_count_(block_count),
+	  block_bytes_(block_bytes),consumer_timeout_ms_(consumer_timeout_ms){
+	if(block_count_<2||(block_count_&(block_count_-1U))!=0){
+		throw std::invalid_argument(
+			"shared memory ring needs a power-of-two block count");
+	}
+	if(block_bytes_<8||block_bytes_%8U!=0){
+		throw std::invalid_argument(
+			"shared memory blocks must hold whole primes");
+	}
+	std::uint64_t stride=slot_stride(block_bytes_);
+	std::uint64_t offset=sizeof(RingHeader);
+	mapping_bytes_=static_cast<std::size_t>(offset+stride*block_count_);
+
+	// A ring left behind by a crashed run is replaced, not reused.
+	shm_unlink(object_name_.c_str());
+	int fd=shm_open(object_name_.c_str(),O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC,0600);
+	if(fd<0){
+		throw std::runtime_error(
+			errno_message("shm_open "+object_name_,errno));
+	}
+	if(ftruncate(fd,static_cast<off_t>(mapping_bytes_))!=0){
+		int error=errno;
+		::close(fd);
+		shm_unlink(object_name_.c_str());
+		throw std::runtime_error(errno_message("ftruncate "+object_name_,error));
+	}
+	mapping_=mmap(nullptr,mapping_bytes_,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	int map_error=errno;
+	::close(fd);
+	if(mapping_==MAP_FAILED){
+		mapping_=nullptr;
+		shm_unlink(object_name_.c_str());
+		throw std::runtime_error(errno_message("mmap "+object_name_,map_error));
+	}
+	header_=static_cast<RingHeader*>(mapping_);
+	header_->version=shm::kShmVersion;
+	header_->block_count=block_count_;
+	header_->block_bytes=block_bytes_;
+	header_->slot_stride=stride;
+	header_->slots_offset=offset;
+	header_->producer_pid=static_cast<std::uint32_t>(getpid());
+	for(std::uint64_t pos=0;pos<block_count_;++pos){
+		slot(pos).state=pos;
+	}
+	shared(header_->magic).store(shm::kShmMagic,std::memory_order_release);
+}
+
+ShmRingWriter::~ShmRingWriter(){
+	if(header_&&!closed_){
+		// Abandoned on an error path: let consumers see the end, but do
+		// not wait for them.
+		shared(header_->closed).store(1,std::memory_order_release);
+		bump(header_->data_seq,header_->data_waiters);
+	}
+	release_mapping();
+}
+
+void ShmRingWriter::release_mapping(){
+	if(mapping_){
+		munmap(mapping_,mapping_bytes_);
+		mapping_=nullptr;
+		header_=nullptr;
+		shm_unlink(object_name_.c_str());
+	}
+}
+
+SlotHeader&ShmRingWriter::slot(std::uint64_t pos){
+	return *reinterpret_cast<SlotHeader*>(
+		static_cast<char*>(mapping_)+header_->slots_offset+
+		(pos&(block_count_-1U))*header_->slot_stride);
+}
+
+char*ShmRingWriter::payload(std::uint64_t pos){
+	return reinterpret_cast<char*>(&slot(pos)+1);
+}
+
+template<class Ready>
+void ShmRingWriter::wait_for_consumers(Ready ready){
+	if(consumer_timeout_ms_==0){
+		wait_until(header_->space_seq,header_->space_waiters,ready,false,
+				   []{});
+		return;
+	}
+	auto timeout=std::chrono::milliseconds(consumer_timeout_ms_);
+	auto deadline=std::chrono::steady_clock::now()+timeout;
+	std::uint64_t released=
+		shared(header_->released).load(std::memory_order_acquire);
+	wait_until(header_->space_seq,header_->space_waiters,ready,true,[&]{
+		std::uint64_t now_released=
+			shared(header_->released).load(std::memory_order_acquire);
+		auto now=std::chrono::steady_clock::now();
+		if(now_released!=released){
+			released=now_released;
+			deadline=now+timeout;
+		}else if(now>=deadline){
+			throw std::runtime_error(
+				"no consumer released a block of shared memory ring "+
+				object_name_+" for "+std::to_string(consumer_timeout_ms_)+
+				" ms");
+		}
+	});
+}
+
+void ShmRingWriter::acquire_slot(){
+	SlotHeader&target=slot(next_block_);
+	auto ready=[&]{
+		return shared(target.state).load(std::memory_order_acquire)==
+			   next_block_;
+	};
+	if(!ready()){
+		++waits_;
+		wait_for_consumers(ready);
+	}
+	have_slot_=true;
+	used_=0;
+}
+
+void ShmRingWriter::publish(std::size_t bytes){
+	SlotHeader&target=slot(next_block_);
+	target.sequence=next_block_;
+	target.count=bytes/8U;
+	shared(target.state).store(next_block_+1U,std::memory_order_release);
+	++next_block_;
+	shared(header_->write_pos).store(next_block_,std::memory_order_release);
+	bump(header_->data_seq,header_->data_waiters);
+	have_slot_=false;
+	used_=0;
+}
+
+void ShmRingWriter::write(const char*data,std::size_t size){
+	if(!header_||closed_){
+		throw std::runtime_error("shared memory ring is closed");
+	}
+	while(size>0){
+		if(!have_slot_){
+			acquire_slot();
+		}
+		std::size_t take=std::min<std::size_t>(size,block_bytes_-used_);
+		std::memcpy(payload(next_block_)+used_,data,take);
+		used_+=take;
+		data+=take;
+		size-=take;
+		bytes_written_+=take;
+		if(used_==block_bytes_){
+			publish(used_);
+		}
+	}
+}
+
+void ShmRingWriter::flush(){
+	if(!have_slot_||used_==0){
+		return;
+	}
+	if(used_%8U!=0){
+		throw std::runtime_error(
+			"shared memory output must end on a whole prime");
+	}
+	publish(used_);
+}
+
+void ShmRingWriter::close(){
+	if(!header_||closed_){
+		return;
+	}
+	flush();
+	closed_=true;
+	shared(header_->closed).store(1,std::memory_order_release);
+	bump(header_->data_seq,header_->data_waiters);
+	wait_for_consumers([&]{
+		return shared(header_->released).load(std::memory_order_acquire)==
+			   next_block_;
+	});
+	release_mapping();
+}
+
+ShmRingReader::ShmRingReader(const std::string&name,unsigned timeout_ms)
+	: object_name_(shm::object_name(name)){
+	const std::string&object=object_name_;
+	auto deadline=std::chrono::steady_clock::now()+
+				  std::chrono::milliseconds(timeout_ms);
+	for(;;){
+		int fd=shm_open(object.c_str(),O_RDWR|O_CLOEXEC,0);
+		if(fd>=0){
+			struct stat info{};
+			if(fstat(fd,&info)==0&&
+			   static_cast<std::size_t>(info.st_size)>=sizeof(RingHeader)){
+				object_inode_=static_cast<std::uint64_t>(info.st_ino);
+				mapping_bytes_=static_cast<std::size_t>(info.st_size);
+				mapping_=mmap(nullptr,mapping_bytes_,PROT_READ|PROT_WRITE,
+							  MAP_SHARED,fd,0);
+				if(mapping_==MAP_FAILED){
+					mapping_=nullptr;
+				}
+			}
+			::close(fd);
+			if(mapping_){
+				header_=static_cast<RingHeader*>(mapping_);
+				if(shared(header_->magic).load(std::memory_order_acquire)==
+				   shm::kShmMagic){
+					break;
+				}
+				munmap(mapping_,mapping_bytes_);
+				mapping_=nullptr;
+				header_=nullptr;
+			}
+		}else if(errno!=ENOENT){
+			throw std::runtime_error(errno_message("shm_open "+object,errno));
+		}
+		if(std::chrono::steady_clock::now()>=deadline){
+			throw std::runtime_error("shared memory ring "+object+
+									 " did not appear");
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if(header_->version!=shm::kShmVersion||header_->block_count<2||
+	   (header_->block_count&(header_->block_count-1U))!=0||
+	   header_->slots_offset+
+			   header_->slot_stride*header_->block_count>
+		   mapping_bytes_){
+		munmap(mapping_,mapping_bytes_);
+		throw std::runtime_error("unsupported shared memory ring layout");
+	}
+}
+
+ShmRingReader::~ShmRingReader(){
+	if(mapping_){
+		release_held();
+		munmap(mapping_,mapping_bytes_);
+	}
+}
+
+SlotHeader&ShmRingReader::slot(std::uint64_t pos){
+	return *reinterpret_cast<SlotHeader*>(
+		static_cast<char*>(mapping_)+header_->slots_offset+
+		(pos&(header_->block_count-1U))*header_->slot_stride);
+}
+
+// Removes the name of a ring whose producer died, unless a new producer
+// has already replaced it.
+void ShmRingReader::unlink_if_same(){
+	int fd=shm_open(object_name_.c_str(),O_RDONLY|O_CLOEXEC,0);
+	if(fd<0){
+		return;
+	}
+	struct stat info{};
+	bool same=fstat(fd,&info)==0&&
+			  static_cast<std::uint64_t>(info.st_ino)==object_inode_;
+	::close(fd);
+	if(same){
+		shm_unlink(object_name_.c_str());
+	}
+}
+
+void ShmRingReader::release_held(){
+	if(!holding_){
+		return;
+	}
+	holding_=false;
+	shared(slot(held_pos_).state)
+		.store(held_pos_+header_->block_count,std::memory_order_release);
+	shared(header_->released).fetch_add(1,std::memory_order_acq_rel);
+	bump(header_->space_seq,header_->space_waiters);
+}
+
+bool ShmRingReader::next_block(const std::uint64_t*&primes,std::size_t&count,
+							   std::uint64_t&sequence){
+	release_held();
+	auto producer_alive=[&]{
+		if(shared(header_->closed).load(std::memory_order_acquire)!=0){
+			return;
+		}
+		pid_t pid=static_cast<pid_t>(header_->producer_pid);
+		if(kill(pid,0)!=0&&errno==ESRCH){
+			unlink_if_same();
+			throw std::runtime_error(
+				"shared memory producer exited without closing the ring");
+		}
+	};
+	for(;;){
+		std::uint64_t pos=shared(header_->read_pos).load(
+			std::memory_order_acquire);
+		SlotHeader&target=slot(pos);
+		std::uint64_t state=shared(target.state).load(
+			std::memory_order_acquire);
+		auto ahead=static_cast<std::int64_t>(state-(pos+1U));
+		if(ahead==0){
+			if(shared(header_->read_pos)
+				   .compare_exchange_weak(pos,pos+1U,
+										  std::memory_order_acq_rel)){
+				holding_=true;
+				held_pos_=pos;
+				primes=reinterpret_cast<const std::uint64_t*>(&target+1);
+				count=static_cast<std::size_t>(target.count);
+				sequence=target.sequence;
+				return true;
+			}
+			continue;
+		}
+		if(ahead>0){
+			continue; // another consumer claimed `pos` first
+		}
+		auto finished=[&]{
+			return shared(header_->closed).load(std::memory_order_acquire)!=
+					   0&&
+				   shared(header_->write_pos).load(
+					   std::memory_order_acquire)<=pos;
+		};
+		if(finished()){
+			return false;
+		}
+		wait_until(
+			header_->data_seq,header_->data_waiters,
+			[&]{
+				return shared(target.state).load(std::memory_order_acquire)==
+						   pos+1U||
+					   shared(header_->read_pos).load(
+						   std::memory_order_acquire)!=pos||
+					   finished();
+			},
+			true,producer_alive);
+	}
+}
+
+#else
+
+ShmRingWriter::ShmRingWriter(const std::string&,std::uint32_t,std::uint32_t,
+							 unsigned){
+	throw std::runtime_error("shared memory output is only supported on Linux");
+}
+ShmRingWriter::~ShmRingWriter()=default;
+void ShmRingWriter::write(const char*,std::size_t){}
+void ShmRingWriter::flush(){}
+void ShmRingWriter::close(){}
+
+ShmRingReader::ShmRingReader(const std::string&,unsigned){
+	throw std::runtime_error("shared memory input is only supported on Linux");
+}
+ShmRingReader::~ShmRingReader()=default;
+bool ShmRingReader::next_block(const std::uint64_t*&,std::size_t&,
+							   std::uint64_t&){
+	return false;
+}
+
+#endif
+
+} // namespace calcprime
@@ -0,0 +1,154 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace calcprime{
+
+// A ring of fixed-size blocks of primes in POSIX shared memory, written by
+// one process (`--out shm:NAME`) and read by any number of others.  Each
+// block goes to exactly one consumer; blocks carry their sequence number so
+// consumers that need the global order can merge.
+//
+// The protocol is the bounded queue of per-slot sequence numbers: slot
+// `pos % block_count` is free for block `pos` while its state is `pos`,
+// holds block `pos` while it is `pos + 1`, and is handed back as
+// `pos + block_count` once the consumer is done with it.  Waiting uses
+// process-shared futexes on two counters, bumped whenever a block is
+// published or released; the waiter counts keep the wake-up syscalls off
+// the fast path.
+//
+// Everything below is the shared-memory layout; it is versioned by
+// kShmVersion and uses native-endian fields, so producer and consumers must
+// run on the same host.
+namespace shm{
+
+constexpr std::uint32_t kShmMagic=0x52535043; // "CPSR"
+constexpr std::uint32_t kShmVersion=1;
+constexpr std::uint32_t kDefaultBlockCount=64;
+constexpr std::uint32_t kDefaultBlockBytes=256u<<10; // 32768 primes
+
+struct alignas(64) RingHeader{
+	std::uint32_t magic;	// stored last, once the ring is initialised
+	std::uint32_t version;
+	std::uint32_t block_count; // power of two
+	std::uint32_t block_bytes; // payload bytes per block, multiple of 8
+	std::uint64_t slot_stride; // bytes from one slot header to the next
+	std::uint64_t slots_offset;
+
+	alignas(64) std::uint64_t write_pos; // blocks published
+	alignas(64) std::uint64_t read_pos;	 // blocks claimed by consumers
+	alignas(64) std::uint64_t released;	 // blocks consumers are done with
+	alignas(64) std::uint32_t data_seq;
+	std::uint32_t data_waiters;
+	alignas(64) std::uint32_t space_seq;
+	std::uint32_t space_waiters;
+	std::uint32_t closed; // no block after write_pos will be published
+	std::uint32_t producer_pid;
+};
+
+struct alignas(64) SlotHeader{
+	std::uint64_t state;
+	std::uint64_t sequence; // block number, 0-based
+	std::uint64_t count;	// primes in the payload that follows
+};
+
+std::string object_name(const std::string&name);
+
+} // namespace shm
+
+// Producer side.  The constructor replaces any ring of the same name, so a
+// ring left behind by a killed producer goes away with the next run; a
+// consumer that finds the producer gone removes it as well.
+//
+// The producer needs consumers to make progress: it waits while the ring
+// is full and, on close, until every block has been released.  With a
+// nonzero `consumer_timeout_ms` it gives up with std::runtime_error once no
+// block has been released for that long, which covers both a ring nobody
+// attached to and a consumer that died holding a block; with 0 it waits
+// forever.
+class ShmRingWriter{
+  public:
+	ShmRingWriter(const std::string&name,
+				  std::uint32_t block_count=shm::kDefaultBlockCount,
+				  std::uint32_t block_bytes=shm::kDefaultBlockBytes,
+				  unsigned consumer_timeout_ms=0);
+	~ShmRingWriter();
+
+	ShmRingWriter(const ShmRingWriter&)=delete;
+	ShmRingWriter&operator=(const ShmRingWriter&)=delete;
+
+	// Copies little-endian u64 primes into blocks and publishes every full
+	// one; waits while the ring is full.
+	void write(const char*data,std::size_t size);
+	// Publishes the partly filled block; it must end on a whole prime.
+	void flush();
+	// Flushes, marks the end of the stream, waits until consumers have
+	// released every block and removes the name.
+	void close();
+
+	std::uint32_t block_count() const{ return block_count_; }
+	std::uint32_t block_bytes() const{ return block_bytes_; }
+	std::uint64_t bytes_written() const{ return bytes_written_; }
+	std::uint64_t blocks_published() const{ return next_block_; }
+	// Times the producer found the ring full.
+	std::uint64_t waits() const{ return waits_; }
+
+  private:
+	shm::SlotHeader&slot(std::uint64_t pos);
+	char*payload(std::uint64_t pos);
+	void acquire_slot();
+	// Sleeps until `ready()`, throwing once no block has been released for
+	// consumer_timeout_ms_.
+	template<class Ready>
+	void wait_for_consumers(Ready ready);
+	void publish(std::size_t bytes);
+	void release_mapping();
+
+	std::string object_name_;
+	std::uint32_t block_count_=0;
+	std::uint32_t block_bytes_=0;
+	unsigned consumer_timeout_ms_=0;
+	void*mapping_=nullptr;
+	std::size_t mapping_bytes_=0;
+	shm::RingHeader*header_=nullptr;
+	std::uint64_t next_block_=0;
+	bool have_slot_=false;
+	std::size_t used_=0;
+	std::uint64_t bytes_written_=0;
+	std::uint64_t waits_=0;
+	bool closed_=false;
+};
+
+// Consumer side, used by the calcprime_shm C API.
+class ShmRingReader{
+  public:
+	// Waits up to `timeout_ms` for the producer to create the ring.
+	ShmRingReader(const std::string&name,unsigned timeout_ms);
+	~ShmRingReader();
+
+	ShmRingReader(const ShmRingReader&)=delete;
+	ShmRingReader&operator=(const ShmRingReader&)=delete;
+
+	// Hands back the previous block and claims the next one.  Returns false
+	// once the producer has closed the ring and every block is taken.  The
+	// primes stay valid until the next call.
+	bool next_block(const std::uint64_t*&primes,std::size_t&count,
+					std::uint64_t&sequence);
+
+  private:
+	shm::SlotHeader&slot(std::uint64_t pos);
+	void release_held();
+	void unlink_if_same();
+
+	std::string object_name_;
+	std::uint64_t object_inode_=0; // tells a replacement ring apart
+	void*mapping_=nullptr;
+	std::size_t mapping_bytes_=0;
+	shm::RingHeader*header_=nullptr;
+	bool holding_=false;
+	std::uint64_t held_pos_=0;
+};
+
+} // namespace calcprime
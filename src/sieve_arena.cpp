@@ -0,0 +1,110 @@
+#include "sieve_arena.h"
+
+#include<cstdint>
+#include<new>
+
+#if defined(__linux__)
+#include<sys/mman.h>
+#endif
+
+namespace calcprime{
+
+const char*arena_pages_name(ArenaPages pages){
+	switch(pages){
+	case ArenaPages::HugeTlb:
+		return "hugetlb";
+	case ArenaPages::Transparent:
+		return "transparent";
+	case ArenaPages::Normal:
+		break;
+	}
+	return "normal";
+}
+
+SieveArena::SieveArena(bool huge_pages)
+	: huge_pages_(huge_pages),try_hugetlb_(huge_pages){}
+
+SieveArena::~SieveArena(){
+	for(const Chunk&chunk : chunks_){
+#if defined(__linux__)
+		if(chunk.mapped){
+			munmap(chunk.base,chunk.bytes);
+			continue;
+		}
+#endif
+		::operator delete(chunk.base,std::align_val_t{kAlignment});
+	}
+}
+
+void*SieveArena::allocate(std::size_t bytes){
+	bytes=(bytes+kAlignment-1)&~(kAlignment-1);
+	if(static_cast<std::size_t>(end_-cursor_)<bytes){
+		// The rest of the current chunk is abandoned; blocks are few and
+		// large, so little is lost.
+		Chunk chunk=allocate_chunk(bytes);
+		chunks_.push_back(chunk);
+		reserved_+=chunk.bytes;
+		cursor_=static_cast<char*>(chunk.base);
+		end_=cursor_+chunk.bytes;
+	}
+	void*block=cursor_;
+	cursor_+=bytes;
+	return block;
+}
+
+ArenaPages SieveArena::pages() const{
+	if(chunks_.empty()){
+		return ArenaPages::Normal;
+	}
+	ArenaPages weakest=ArenaPages::HugeTlb;
+	for(const Chunk&chunk : chunks_){
+		if(static_cast<int>(chunk.pages)<static_cast<int>(weakest)){
+			weakest=chunk.pages;
+		}
+	}
+	return weakest;
+}
+
+SieveArena::Chunk SieveArena::allocate_chunk(std::size_t bytes){
+	std::size_t granule=huge_pages_?kHugePageBytes:kChunkBytes;
+	std::size_t size=(bytes+granule-1)/granule*granule;
+#if defined(__linux__)
+	if(try_hugetlb_){
+		void*base=mmap(nullptr,size,PROT_READ|PROT_WRITE,
+					   MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+		if(base!=MAP_FAILED){
+			return Chunk{base,size,ArenaPages::HugeTlb,true};
+		}
+		try_hugetlb_=false;
+	}
+	if(huge_pages_){
+		// Map one huge page more than needed and trim both ends, so that
+		// the chunk starts on a 2 MiB boundary.
+		std::size_t padded=size+kHugePageBytes;
+		void*raw=mmap(nullptr,padded,PROT_READ|PROT_WRITE,
+					  MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+		if(raw==MAP_FAILED){
+			throw std::bad_alloc();
+		}
+		std::uintptr_t begin=reinterpret_cast<std::uintptr_t>(raw);
+		std::uintptr_t aligned=
+			(begin+kHugePageBytes-1)&
+			~static_cast<std::uintptr_t>(kHugePageBytes-1);
+		if(aligned>begin){
+			munmap(raw,aligned-begin);
+		}
+		std::uintptr_t tail=begin+padded-(aligned+size);
+		if(tail){
+			munmap(reinterpret_cast<void*>(aligned+size),tail);
+		}
+		void*base=reinterpret_cast<void*>(aligned);
+		bool advised=madvise(base,size,MADV_HUGEPAGE)==0;
+		return Chunk{base,size,
+					 advised?ArenaPages::Transparent:ArenaPages::Normal,true};
+	}
+#endif
+	void*base=::operator new(size,std::align_val_t{kAlignment});
+	return Chunk{base,size,ArenaPages::Normal,false};
+}
+
+} // namespace calcprime
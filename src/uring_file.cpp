@@ -0,0 +1,394 @@
+#include "uring_file.h"
+
+#include<stdexcept>
+
+#if defined(CALCPRIME_HAS_IO_URING)
+#include<algorithm>
+#include<atomic>
+#include<cerrno>
+#include<cstdlib>
+#include<cstring>
+#include<new>
+
+#include<fcntl.h>
+#include<linux/io_uring.h>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#endif
+
+namespace calcprime{
+
+#if defined(CALCPRIME_HAS_IO_URING)
+
+namespace{
+
+// O_DIRECT transfers must be aligned in address, offset and length.
+constexpr std::size_t kDirectAlignment=4096;
+constexpr std::uint64_t kMinPreallocateStep=std::uint64_t{64}<<20;
+constexpr std::uint64_t kMaxPreallocateStep=std::uint64_t{1}<<30;
+
+int io_uring_setup(unsigned entries,io_uring_params*params){
+	return static_cast<int>(syscall(__NR_io_uring_setup,entries,params));
+}
+
+int io_uring_enter(int ring_fd,unsigned to_submit,unsigned min_complete,
+				   unsigned flags){
+	return static_cast<int>(syscall(__NR_io_uring_enter,ring_fd,to_submit,
+									min_complete,flags,nullptr,0));
+}
+
+std::string errno_message(const char*what,int error){
+	return std::string(what)+": "+std::strerror(error);
+}
+
+} // namespace
+
+struct UringFile::Ring{
+	int fd=-1;
+	void*sq_ptr=MAP_FAILED;
+	std::size_t sq_size=0;
+	void*cq_ptr=MAP_FAILED;
+	std::size_t cq_size=0;
+	io_uring_sqe*sqes=static_cast<io_uring_sqe*>(MAP_FAILED);
+	std::size_t sqes_size=0;
+	unsigned*sq_tail=nullptr;
+	unsigned*sq_mask=nullptr;
+	unsigned*sq_array=nullptr;
+	unsigned*cq_head=nullptr;
+	unsigned*cq_tail=nullptr;
+	unsigned*cq_mask=nullptr;
+	io_uring_cqe*cqes=nullptr;
+
+	~Ring(){
+		if(sqes!=MAP_FAILED){
+			munmap(sqes,sqes_size);
+		}
+		if(cq_ptr!=MAP_FAILED&&cq_ptr!=sq_ptr){
+			munmap(cq_ptr,cq_size);
+		}
+		if(sq_ptr!=MAP_FAILED){
+			munmap(sq_ptr,sq_size);
+		}
+		if(fd>=0){
+			::close(fd);
+		}
+	}
+};
+
+UringFile::UringFile(const std::string&path,bool direct,unsigned queue_depth)
+	: direct_(direct),
+	  depth_(std::clamp(queue_depth==0?kDefaultQueueDepth:queue_depth,1u,
+						kMaxQueueDepth)){
+	int flags=O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC;
+	if(direct_){
+		flags|=O_DIRECT;
+	}
+	fd_=::open(path.c_str(),flags,0666);
+	if(fd_<0){
+		throw std::runtime_error(errno_message(
+			direct_?"Failed to open output file with O_DIRECT"
+				   :"Failed to open output file",
+			errno));
+	}
+	posix_fadvise(fd_,0,0,POSIX_FADV_SEQUENTIAL);
+	posix_fadvise(fd_,0,0,POSIX_FADV_NOREUSE);
+
+	try{
+		ring_=new Ring();
+		io_uring_params params{};
+		ring_->fd=io_uring_setup(depth_,&params);
+		if(ring_->fd<0){
+			throw std::runtime_error(errno_message("io_uring_setup",errno));
+		}
+		ring_->sq_size=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+		ring_->cq_size=
+			params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+		bool single_mmap=(params.features&IORING_FEAT_SINGLE_MMAP)!=0;
+		if(single_mmap){
+			ring_->sq_size=ring_->cq_size=
+				std::max(ring_->sq_size,ring_->cq_size);
+		}
+		ring_->sq_ptr=mmap(nullptr,ring_->sq_size,PROT_READ|PROT_WRITE,
+						   MAP_SHARED|MAP_POPULATE,ring_->fd,
+						   IORING_OFF_SQ_RING);
+		if(ring_->sq_ptr==MAP_FAILED){
+			throw std::runtime_error(errno_message("io_uring mmap",errno));
+		}
+		if(single_mmap){
+			ring_->cq_ptr=ring_->sq_ptr;
+		}else{
+			ring_->cq_ptr=mmap(nullptr,ring_->cq_size,PROT_READ|PROT_WRITE,
+							   MAP_SHARED|MAP_POPULATE,ring_->fd,
+							   IORING_OFF_CQ_RING);
+			if(ring_->cq_ptr==MAP_FAILED){
+				throw std::runtime_error(errno_message("io_uring mmap",errno));
+			}
+		}
+		ring_->sqes_size=params.sq_entries*sizeof(io_uring_sqe);
+		ring_->sqes=static_cast<io_uring_sqe*>(
+			mmap(nullptr,ring_->sqes_size,PROT_READ|PROT_WRITE,
+				 MAP_SHARED|MAP_POPULATE,ring_->fd,IORING_OFF_SQES));
+		if(ring_->sqes==MAP_FAILED){
+			throw std::runtime_error(errno_message("io_uring mmap",errno));
+		}
+		auto*sq=static_cast<char*>(ring_->sq_ptr);
+		auto*cq=static_cast<char*>(ring_->cq_ptr);
+		ring_->sq_tail=reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+		ring_->sq_mask=reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+		ring_->sq_array=reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+		ring_->cq_head=reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+		ring_->cq_tail=reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+		ring_->cq_mask=reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+		ring_->cqes=reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+
+		// One buffer more than the queue depth, so the next one can be
+		// filled while every other buffer is being written.
+		buffers_.resize(depth_+1U);
+		for(Buffer&buffer : buffers_){
+			buffer.data=static_cast<char*>(::operator new(
+				kBufferBytes,std::align_val_t{kDirectAlignment}));
+		}
+	}catch(...){
+		release();
+		throw;
+	}
+}
+
+UringFile::~UringFile(){
+	if(fd_>=0){
+		try{
+			wait_all();
+		}catch(...){
+			// the writer reports errors through close()
+		}
+	}
+	release();
+}
+
+void UringFile::release(){
+	delete ring_;
+	ring_=nullptr;
+	for(Buffer&buffer : buffers_){
+		if(buffer.data){
+			::operator delete(buffer.data,std::align_val_t{kDirectAlignment});
+			buffer.data=nullptr;
+		}
+	}
+	if(fd_>=0){
+		::close(fd_);
+		fd_=-1;
+	}
+}
+
+void UringFile::write(const char*data,std::size_t size){
+	throw_if_failed();
+	while(size>0){
+		Buffer&buffer=buffers_[current_];
+		std::size_t take=std::min(size,kBufferBytes-buffer.used);
+		std::memcpy(buffer.data+buffer.used,data,take);
+		buffer.used+=take;
+		data+=take;
+		size-=take;
+		logical_size_+=take;
+		if(buffer.used==kBufferBytes){
+			submit(current_,kBufferBytes);
+			next_offset_+=kBufferBytes;
+			current_=next_free_buffer();
+		}
+	}
+}
+
+void UringFile::flush(){
+	throw_if_failed();
+	Buffer&buffer=buffers_[current_];
+	if(buffer.used!=0){
+		if(direct_){
+			// The padded block is rewritten once the buffer fills up; the
+			// file is cut back to its logical size in the meantime.
+			std::size_t padded=(buffer.used+kDirectAlignment-1)/
+							   kDirectAlignment*kDirectAlignment;
+			std::memset(buffer.data+buffer.used,0,padded-buffer.used);
+			submit(current_,padded);
+			wait_all();
+			if(ftruncate(fd_,static_cast<off_t>(logical_size_))!=0){
+				error_=errno_message("ftruncate",errno);
+			}
+		}else{
+			submit(current_,buffer.used);
+			next_offset_+=buffer.used;
+			current_=next_free_buffer();
+		}
+	}
+	wait_all();
+	throw_if_failed();
+}
+
+void UringFile::close(){
+	if(fd_<0){
+		return;
+	}
+	flush();
+	// Drop the space fallocate reserved past the end of the data.
+	if(allocated_end_>logical_size_&&
+	   ftruncate(fd_,static_cast<off_t>(logical_size_))!=0){
+		error_=errno_message("ftruncate",errno);
+	}
+	int fd=fd_;
+	fd_=-1;
+	if(::close(fd)!=0&&error_.empty()){
+		error_=errno_message("close",errno);
+	}
+	release();
+	throw_if_failed();
+}
+
+void UringFile::submit(std::size_t index,std::size_t length){
+	// The spare buffer is for filling, not for a write past the depth.
+	while(in_flight_>=depth_){
+		reap(1);
+	}
+	Buffer&buffer=buffers_[index];
+	buffer.offset=next_offset_;
+	buffer.length=length;
+	buffer.done=0;
+	buffer.busy=true;
+	++in_flight_;
+	reserve_space(buffer.offset+length);
+	push_write(index);
+	++submissions_;
+	in_flight_total_+=in_flight_;
+}
+
+void UringFile::push_write(std::size_t index){
+	Buffer&buffer=buffers_[index];
+	unsigned tail=*ring_->sq_tail;
+	unsigned slot=tail&*ring_->sq_mask;
+	io_uring_sqe&sqe=ring_->sqes[slot];
+	std::memset(&sqe,0,sizeof(sqe));
+	sqe.opcode=IORING_OP_WRITE;
+	sqe.fd=fd_;
+	sqe.addr=reinterpret_cast<std::uint64_t>(buffer.data+buffer.done);
+	sqe.len=static_cast<std::uint32_t>(buffer.length-buffer.done);
+	sqe.off=buffer.offset+buffer.done;
+	sqe.user_data=index;
+	ring_->sq_array[slot]=slot;
+	std::atomic_ref<unsigned>(*ring_->sq_tail)
+		.store(tail+1U,std::memory_order_release);
+	int submitted=0;
+	do{
+		submitted=io_uring_enter(ring_->fd,1,0,0);
+	}while(submitted<0&&errno==EINTR);
+	if(submitted<0){
+		// A failed enter consumed nothing and, without SQPOLL, the kernel
+		// reads the queue only inside io_uring_enter, so take the entry
+		// back. Left queued, a later enter would submit it from a buffer
+		// that is already free again.
+		std::atomic_ref<unsigned>(*ring_->sq_tail)
+			.store(tail,std::memory_order_release);
+		error_=errno_message("io_uring_enter",errno);
+		buffer.busy=false;
+		buffer.used=0;
+		--in_flight_;
+	}
+}
+
+void UringFile::reap(unsigned wait_for){
+	if(in_flight_==0){
+		return;
+	}
+	if(wait_for!=0){
+		int result=0;
+		do{
+			result=io_uring_enter(ring_->fd,0,wait_for,IORING_ENTER_GETEVENTS);
+		}while(result<0&&errno==EINTR);
+		if(result<0){
+			throw std::runtime_error(errno_message("io_uring_enter",errno));
+		}
+	}
+	std::atomic_ref<unsigned> cq_tail(*ring_->cq_tail);
+	std::atomic_ref<unsigned> cq_head(*ring_->cq_head);
+	unsigned head=cq_head.load(std::memory_order_relaxed);
+	unsigned tail=cq_tail.load(std::memory_order_acquire);
+	for(;head!=tail;++head){
+		const io_uring_cqe&cqe=ring_->cqes[head&*ring_->cq_mask];
+		std::size_t index=static_cast<std::size_t>(cqe.user_data);
+		Buffer&buffer=buffers_[index];
+		bool finished=true;
+		if(cqe.res<0){
+			if(error_.empty()){
+				error_=errno_message("io_uring write",-cqe.res);
+			}
+		}else if(cqe.res==0){
+			if(error_.empty()){
+				error_="io_uring write made no progress";
+			}
+		}else{
+			buffer.done+=static_cast<std::size_t>(cqe.res);
+			if(buffer.done<buffer.length){
+				push_write(index);
+				finished=false;
+			}
+		}
+		if(finished){
+			buffer.busy=false;
+			--in_flight_;
+		}
+	}
+	cq_head.store(head,std::memory_order_release);
+}
+
+void UringFile::wait_all(){
+	while(in_flight_>0){
+		reap(1);
+	}
+}
+
+std::size_t UringFile::next_free_buffer(){
+	for(;;){
+		for(std::size_t i=0;i<buffers_.size();++i){
+			if(!buffers_[i].busy){
+				buffers_[i].used=0;
+				return i;
+			}
+		}
+		reap(1);
+	}
+}
+
+void UringFile::reserve_space(std::uint64_t end){
+	if(!preallocate_||end<=allocated_end_){
+		return;
+	}
+	std::uint64_t step=std::clamp(allocated_end_,kMinPreallocateStep,
+								  kMaxPreallocateStep);
+	std::uint64_t new_end=std::max(end,allocated_end_+step);
+	if(fallocate(fd_,FALLOC_FL_KEEP_SIZE,static_cast<off_t>(allocated_end_),
+				 static_cast<off_t>(new_end-allocated_end_))!=0){
+		preallocate_=false; // unsupported by the file system; not an error
+		return;
+	}
+	allocated_end_=new_end;
+}
+
+void UringFile::throw_if_failed() const{
+	if(!error_.empty()){
+		throw std::runtime_error(error_);
+	}
+}
+
+#else
+
+UringFile::UringFile(const std::string&,bool,unsigned){
+	throw std::runtime_error("io_uring not supported in this build");
+}
+
+UringFile::~UringFile()=default;
+
+void UringFile::write(const char*,std::size_t){}
+void UringFile::flush(){}
+void UringFile::close(){}
+
+#endif
+
+} // namespace calcprime
@@ -0,0 +1,85 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+namespace calcprime{
+
+// Sequential file writer on a raw io_uring, without liburing.  Data is
+// copied into page-aligned buffers; a full buffer is submitted as one
+// write and the caller moves on to the next, so up to `queue_depth` writes
+// are in flight.  With `direct` the file is opened O_DIRECT; the unaligned
+// tail is written padded and cut back with ftruncate.  Space is reserved
+// with fallocate in growing steps and the kernel is told the file is
+// written sequentially.
+//
+// Only available when built with CALCPRIME_HAS_IO_URING on Linux; the
+// constructor throws std::runtime_error when io_uring cannot be set up, so
+// callers can fall back to stdio.
+class UringFile{
+  public:
+	static constexpr std::size_t kBufferBytes=std::size_t{1}<<20;
+	static constexpr unsigned kDefaultQueueDepth=8;
+	// Larger requested depths are clamped to this.
+	static constexpr unsigned kMaxQueueDepth=64;
+
+	UringFile(const std::string&path,bool direct,unsigned queue_depth);
+	~UringFile();
+
+	UringFile(const UringFile&)=delete;
+	UringFile&operator=(const UringFile&)=delete;
+
+	// Errors are reported as std::runtime_error, here or on a later call.
+	void write(const char*data,std::size_t size);
+	// Waits until everything written so far is in the file.
+	void flush();
+	// Flushes, trims preallocated space and closes the file.
+	void close();
+
+	bool direct() const{ return direct_; }
+	unsigned queue_depth() const{ return depth_; }
+	std::uint64_t bytes_written() const{ return logical_size_; }
+	std::uint64_t submissions() const{ return submissions_; }
+	// Sum over all submissions of the writes in flight right after it.
+	std::uint64_t in_flight_total() const{ return in_flight_total_; }
+
+  private:
+	struct Buffer{
+		char*data=nullptr;
+		std::size_t used=0;
+		std::uint64_t offset=0;
+		std::size_t length=0;
+		std::size_t done=0;
+		bool busy=false;
+	};
+
+	struct Ring;
+
+	void submit(std::size_t index,std::size_t length);
+	void push_write(std::size_t index);
+	void reap(unsigned wait_for);
+	void wait_all();
+	std::size_t next_free_buffer();
+	void reserve_space(std::uint64_t end);
+	void throw_if_failed() const;
+	void release();
+
+	int fd_=-1;
+	bool direct_=false;
+	unsigned depth_=0;
+	Ring*ring_=nullptr;
+	std::vector<Buffer> buffers_;
+	std::size_t current_=0;
+	unsigned in_flight_=0;
+	std::uint64_t logical_size_=0;
+	std::uint64_t next_offset_=0;
+	std::uint64_t allocated_end_=0;
+	bool preallocate_=true;
+	std::uint64_t submissions_=0;
+	std::uint64_t in_flight_total_=0;
+	std::string error_;
+};
+
+} // namespace calcprime
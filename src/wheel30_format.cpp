@@ -0,0 +1,113 @@
+#include "wheel30_format.h"
+
+#include<cstring>
+#include<stdexcept>
+
+namespace calcprime::wheel30{
+
+namespace{
+
+void put_u64(std::uint8_t*out,std::uint64_t value){
+	for(int i=0;i<8;++i){
+		out[i]=static_cast<std::uint8_t>(value>>(8*i));
+	}
+}
+
+std::uint64_t get_u64(const std::uint8_t*in){
+	std::uint64_t value=0;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|in[i];
+	}
+	return value;
+}
+
+} // namespace
+
+Header make_layout(std::uint64_t from,std::uint64_t to,
+				   std::uint32_t index_interval){
+	if(to<from){
+		throw std::invalid_argument("wheel30 range is inverted");
+	}
+	if(index_interval==0||(index_interval%8U)!=0U){
+		throw std::invalid_argument(
+			"wheel30 index interval must be a positive multiple of 8");
+	}
+	Header header;
+	header.from=from;
+	header.to=to;
+	header.base=from-from%30U;
+	header.bitmap_bytes=(to>header.base)?(to-header.base+29U)/30U:0U;
+	header.index_interval=index_interval;
+	header.index_offset=kHeaderBytes+header.bitmap_bytes;
+	header.index_entries=header.bitmap_bytes/index_interval+1U;
+	static const std::uint64_t kSmall[3]={2,3,5};
+	for(int i=0;i<3;++i){
+		if(kSmall[i]>=from&&kSmall[i]<to){
+			header.small_primes|=static_cast<std::uint8_t>(1U<<i);
+		}
+	}
+	return header;
+}
+
+std::string encode_header(const Header&header){
+	std::string out(kHeaderBytes,'\0');
+	auto*bytes=reinterpret_cast<std::uint8_t*>(out.data());
+	std::memcpy(bytes,kMagic,sizeof(kMagic));
+	bytes[4]=static_cast<std::uint8_t>(kVersion);
+	bytes[5]=static_cast<std::uint8_t>(kVersion>>8);
+	bytes[6]=static_cast<std::uint8_t>(kHeaderBytes);
+	bytes[7]=0;
+	put_u64(bytes+8,header.from);
+	put_u64(bytes+16,header.to);
+	put_u64(bytes+24,header.base);
+	put_u64(bytes+32,header.bitmap_bytes);
+	put_u64(bytes+40,header.index_offset);
+	put_u64(bytes+48,header.index_entries);
+	for(int i=0;i<4;++i){
+		bytes[56+i]=static_cast<std::uint8_t>(header.index_interval>>(8*i));
+	}
+	bytes[60]=header.small_primes;
+	return out;
+}
+
+Header decode_header(const std::uint8_t*data,std::size_t size){
+	if(size<kHeaderBytes||std::memcmp(data,kMagic,sizeof(kMagic))!=0){
+		throw std::runtime_error("not a wheel30 file");
+	}
+	if((data[4]|(data[5]<<8))!=kVersion||data[6]!=kHeaderBytes){
+		throw std::runtime_error("unsupported wheel30 version");
+	}
+	Header header;
+	header.from=get_u64(data+8);
+	header.to=get_u64(data+16);
+	header.base=get_u64(data+24);
+	header.bitmap_bytes=get_u64(data+32);
+	header.index_offset=get_u64(data+40);
+	header.index_entries=get_u64(data+48);
+	header.index_interval=static_cast<std::uint32_t>(data[56])|
+						  (static_cast<std::uint32_t>(data[57])<<8)|
+						  (static_cast<std::uint32_t>(data[58])<<16)|
+						  (static_cast<std::uint32_t>(data[59])<<24);
+	header.small_primes=data[60];
+
+	Header expected=make_layout(header.from,header.to,header.index_interval);
+	if(expected.base!=header.base||
+	   expected.bitmap_bytes!=header.bitmap_bytes||
+	   expected.index_offset!=header.index_offset||
+	   expected.index_entries!=header.index_entries){
+		throw std::runtime_error("wheel30 header is inconsistent");
+	}
+	if(header.index_offset+header.index_entries*8U!=size){
+		throw std::runtime_error("wheel30 file is truncated");
+	}
+	return header;
+}
+
+int residue_bit(unsigned residue) noexcept{
+	static constexpr signed char kBits[30]={
+		-1,0,-1,-1,-1,-1,-1,1,-1,-1,-1,2,-1,3,-1,
+		-1,-1,4,-1,5,-1,-1,-1,6,-1,-1,-1,-1,-1,7};
+	return residue<30U?kBits[residue]:-1;
+}
+
+} // namespace calcprime::wheel30
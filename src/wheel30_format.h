@@ -0,0 +1,50 @@
+#pragma once
+
+#include<cstddef>
+#include<cstdint>
+#include<string>
+
+namespace calcprime::wheel30{
+
+// File layout (all integers little-endian):
+//
+//   header  64 bytes, see Header
+//   bitmap  one byte per 30 integers starting at `base`; bit i of byte k is
+//           set when base+30k+kResidues[i] is a prime inside [from, to)
+//   index   u64 per `index_interval` bitmap bytes: entry j is the number of
+//           set bits in bytes [0, j*index_interval)
+//
+// 2, 3 and 5 have no wheel residue and are flagged in `small_primes`
+// (bit 0: 2, bit 1: 3, bit 2: 5).
+constexpr char kMagic[4]={'C','P','W','3'};
+constexpr std::uint16_t kVersion=1;
+constexpr std::size_t kHeaderBytes=64;
+constexpr std::uint32_t kDefaultIndexInterval=4096; // 122880 integers
+constexpr std::uint8_t kResidues[8]={1,7,11,13,17,19,23,29};
+
+struct Header{
+	std::uint64_t from=0;
+	std::uint64_t to=0;
+	std::uint64_t base=0;
+	std::uint64_t bitmap_bytes=0;
+	std::uint64_t index_offset=0;
+	std::uint64_t index_entries=0;
+	std::uint32_t index_interval=kDefaultIndexInterval;
+	std::uint8_t small_primes=0;
+};
+
+// Lays out a file for [from, to): base, bitmap size, index position and the
+// small-prime flags all follow from the range.
+Header make_layout(std::uint64_t from,std::uint64_t to,
+				   std::uint32_t index_interval=kDefaultIndexInterval);
+
+std::string encode_header(const Header&header);
+
+// Throws if the data is not a wheel30 header or is inconsistent with `size`.
+Header decode_header(const std::uint8_t*data,std::size_t size);
+
+// Bit position of residue r (0..29) in a bitmap byte, or -1 when r shares a
+// factor with 30.
+int residue_bit(unsigned residue) noexcept;
+
+} // namespace calcprime::wheel30
@@ -0,0 +1,167 @@
+#include "wheel30_reader.h"
+#include "popcnt.h"
+#include "wheel30_format.h"
+
+#include<algorithm>
+#include<bit>
+#include<cstring>
+#include<stdexcept>
+
+namespace calcprime{
+
+namespace{
+
+constexpr std::uint64_t kSmallPrimes[3]={2,3,5};
+
+std::uint64_t popcount_bytes(const std::uint8_t*bytes,std::size_t count){
+	std::uint64_t total=0;
+	std::size_t i=0;
+	for(;i+8U<=count;i+=8U){
+		std::uint64_t word;
+		std::memcpy(&word,bytes+i,sizeof(word));
+		total+=popcount_u64(word);
+	}
+	for(;i<count;++i){
+		total+=static_cast<unsigned>(std::popcount(bytes[i]));
+	}
+	return total;
+}
+
+// Bits of a bitmap byte whose residue is below r.
+std::uint8_t residues_below_mask(unsigned r){
+	std::uint8_t mask=0;
+	for(int bit=0;bit<8;++bit){
+		if(wheel30::kResidues[bit]<r){
+			mask|=static_cast<std::uint8_t>(1U<<bit);
+		}
+	}
+	return mask;
+}
+
+} // namespace
+
+Wheel30Reader::Wheel30Reader(const std::string&path) : file_(path){
+	wheel30::Header header=wheel30::decode_header(file_.data(),file_.size());
+	from_=header.from;
+	to_=header.to;
+	base_=header.base;
+	bitmap_bytes_=header.bitmap_bytes;
+	index_entries_=header.index_entries;
+	index_interval_=header.index_interval;
+	small_primes_=header.small_primes;
+	small_count_=static_cast<unsigned>(std::popcount(small_primes_));
+	bitmap_=file_.data()+wheel30::kHeaderBytes;
+	index_=file_.data()+header.index_offset;
+	total_=small_count_+index_entry(index_entries_-1U)+
+		   popcount_bytes(bitmap_+(index_entries_-1U)*index_interval_,
+						  bitmap_bytes_-(index_entries_-1U)*index_interval_);
+}
+
+std::uint64_t Wheel30Reader::index_entry(std::size_t entry) const{
+	std::uint64_t value=0;
+	const std::uint8_t*bytes=index_+entry*8U;
+	for(int i=7;i>=0;--i){
+		value=(value<<8)|bytes[i];
+	}
+	return value;
+}
+
+std::uint64_t Wheel30Reader::bitmap_primes_below_byte(std::uint64_t byte) const{
+	std::uint64_t entry=byte/index_interval_;
+	std::uint64_t start=entry*index_interval_;
+	return index_entry(static_cast<std::size_t>(entry))+
+		   popcount_bytes(bitmap_+start,static_cast<std::size_t>(byte-start));
+}
+
+std::uint64_t Wheel30Reader::count_below(std::uint64_t x) const{
+	x=std::clamp(x,from_,to_);
+	std::uint64_t total=0;
+	for(int i=0;i<3;++i){
+		if((small_primes_&(1U<<i))!=0&&kSmallPrimes[i]<x){
+			++total;
+		}
+	}
+	if(x<=base_){
+		return total;
+	}
+	std::uint64_t offset=x-base_;
+	std::uint64_t byte=offset/30U;
+	unsigned residue=static_cast<unsigned>(offset%30U);
+	total+=bitmap_primes_below_byte(byte);
+	if(residue!=0&&byte<bitmap_bytes_){
+		total+=static_cast<unsigned>(
+			std::popcount(static_cast<std::uint8_t>(
+				bitmap_[byte]&residues_below_mask(residue))));
+	}
+	return total;
+}
+
+bool Wheel30Reader::is_prime(std::uint64_t n) const{
+	if(n<from_||n>=to_){
+		throw std::out_of_range("value outside the wheel30 file range");
+	}
+	if(n<7){
+		for(int i=0;i<3;++i){
+			if(kSmallPrimes[i]==n){
+				return (small_primes_&(1U<<i))!=0;
+			}
+		}
+		return false;
+	}
+	std::uint64_t offset=n-base_;
+	int bit=wheel30::residue_bit(static_cast<unsigned>(offset%30U));
+	if(bit<0){
+		return false;
+	}
+	return (bitmap_[offset/30U]>>bit)&1U;
+}
+
+std::uint64_t Wheel30Reader::count(std::uint64_t a,std::uint64_t b) const{
+	if(b<=a){
+		return 0;
+	}
+	return count_below(b)-count_below(a);
+}
+
+std::optional<std::uint64_t> Wheel30Reader::nth(std::uint64_t k) const{
+	if(k==0||k>total_){
+		return std::nullopt;
+	}
+	for(int i=0;i<3;++i){
+		if((small_primes_&(1U<<i))!=0&&--k==0){
+			return kSmallPrimes[i];
+		}
+	}
+	// Last index entry with fewer than k primes before it, then a byte scan
+	// of at most one interval.
+	std::size_t lo=0;
+	std::size_t hi=static_cast<std::size_t>(index_entries_);
+	while(hi-lo>1U){
+		std::size_t mid=lo+(hi-lo)/2U;
+		if(index_entry(mid)<k){
+			lo=mid;
+		}else{
+			hi=mid;
+		}
+	}
+	std::uint64_t seen=index_entry(lo);
+	for(std::uint64_t byte=static_cast<std::uint64_t>(lo)*index_interval_;
+		byte<bitmap_bytes_;++byte){
+		unsigned bits=static_cast<unsigned>(std::popcount(bitmap_[byte]));
+		if(seen+bits<k){
+			seen+=bits;
+			continue;
+		}
+		std::uint8_t value=bitmap_[byte];
+		for(int bit=0;bit<8;++bit){
+			if((value>>bit)&1U){
+				if(++seen==k){
+					return base_+byte*30U+wheel30::kResidues[bit];
+				}
+			}
+		}
+	}
+	return std::nullopt;
+}
+
+} // namespace calcprime
@@ -1,5 +1,15 @@
 #include "writer.h"
+#include "arrow_format.h"
+#include "container_format.h"
+#include "elias_fano_format.h"
+#include "gap8_format.h"
+#include "mapped_file.h"
 #include "parquet_format.h"
+#include "popcnt.h"
+#include "shm_ring.h"
+#include "pipe_output.h"
+#include "uring_file.h"
+#include "wheel30_format.h"
 
 #include<algorithm>
 #include<cerrno>
@@ -7,8 +17,10 @@
 #include<climits>
 #include<cstring>
 #include<exception>
+#include<filesystem>
 #include<limits>
 #include<stdexcept>
+#include<utility>
 
 #if defined(_MSC_VER)
 #include<intrin.h>
@@ -25,7 +37,15 @@ namespace{
 constexpr std::size_t kDefaultFileBuffer=8u<<20; // 8 MiB
 constexpr std::size_t kDefaultQueueCapacity=8;
 constexpr std::size_t kDefaultBufferThreshold=8u<<20; // 8 MiB
-constexpr std::size_t kParquetRowsPerGroup=1u<<20;
+constexpr std::size_t kParquetMaxDeltaBlockValues=1u<<20;
+constexpr std::size_t kParquetValuesPerPage=1u<<17; // 1 MiB of PLAIN values
+constexpr unsigned kMaxEncodeWorkers=8;
+// Values per Elias-Fano worker job; a multiple of the block size so that
+// only the final block of the file is short.
+constexpr std::size_t kEliasFanoGroupValues=ef::kDefaultBlockValues*16U;
+// Arrow record batches end at segment boundaries once they hold at least
+// this many rows.
+constexpr std::size_t kArrowMinBatchRows=1u<<16;
 constexpr char kParquetMagic[]={'P','A','R','1'};
 
 inline std::uint64_t to_little_endian_u64(std::uint64_t value){
@@ -47,35 +67,98 @@ inline std::uint16_t to_little_endian_u16(std::uint16_t value){
 } // namespace
 
 PrimeWriter::PrimeWriter(bool enabled,const std::string&path,
-						 PrimeOutputFormat format,bool use_zstd,
-						 ParquetEncoding parquet_encoding,
-						 std::size_t parquet_delta_block_values)
+						 const PrimeWriterOptions&options)
 	: enabled_(enabled),file_(nullptr),owns_file_(false),
+	  synchronous_(options.synchronous),
 	  queue_capacity_(kDefaultQueueCapacity),stop_requested_(false),
-	  buffer_threshold_(kDefaultBufferThreshold),format_(format),
-	  use_zstd_(use_zstd),parquet_encoding_(parquet_encoding),
-	  parquet_delta_block_values_(parquet_delta_block_values),
+	  buffer_threshold_(kDefaultBufferThreshold),
+	  chunk_buffers_(kDefaultQueueCapacity+2),
+	  value_buffers_(kMaxEncodeWorkers*4U+2),
+	  page_buffers_(kMaxEncodeWorkers*4U+2),format_(options.format),
+	  use_zstd_(options.use_zstd),use_lz4_(options.use_lz4),
+	  stream_zstd_(options.use_zstd&&
+				   options.format!=PrimeOutputFormat::Parquet&&
+				   options.format!=PrimeOutputFormat::Container&&
+				   options.format!=PrimeOutputFormat::Arrow),
+	  parquet_encoding_(options.parquet_encoding),
+	  parquet_delta_block_values_(options.parquet_delta_block_values),
 	  has_first_prime_(false),previous_prime_(0),
 	  zstd_cctx_(nullptr),file_offset_(0),parquet_num_rows_(0),
-	  parquet_footer_written_(false),io_error_(false){
+	  parquet_row_group_bytes_(options.parquet_row_group_bytes),
+	  container_encoding_(options.container_encoding),
+	  parquet_footer_written_(false),encode_workers_stop_(false),
+	  io_error_(false){
 	if(!enabled_){
 		return;
 	}
 	if(parquet_encoding_==ParquetEncoding::DeltaBinaryPacked&&
 	   (parquet_delta_block_values_==0||
 		(parquet_delta_block_values_%128U)!=0U||
-		parquet_delta_block_values_>kParquetRowsPerGroup)){
+		parquet_delta_block_values_>kParquetMaxDeltaBlockValues)){
 		throw std::invalid_argument(
 			"Parquet delta block values must be a multiple of 128 between 128 and 1048576");
 	}
+	if(format_==PrimeOutputFormat::Parquet&&parquet_row_group_bytes_==0){
+		throw std::invalid_argument("Parquet row group size must be positive");
+	}
+	if(format_==PrimeOutputFormat::Wheel30&&use_zstd_){
+		throw std::invalid_argument(
+			"wheel30 output is memory-mapped by readers and cannot use zstd");
+	}
+	if(format_==PrimeOutputFormat::EliasFano&&use_zstd_){
+		throw std::invalid_argument(
+			"ef output is memory-mapped by readers and cannot use zstd");
+	}
+	if(use_lz4_&&(format_!=PrimeOutputFormat::Arrow||use_zstd_)){
+		throw std::invalid_argument(
+			"lz4 is only supported as the Arrow buffer codec, without zstd");
+	}
+#if !defined(CALCPRIME_HAS_LZ4)
+	if(use_lz4_){
+		throw std::runtime_error("lz4 not supported in this build");
+	}
+#endif
 
 	if(path.empty()){
-		file_=stdout;
-		owns_file_=false;
-		std::fprintf(stderr,"[calcprime] warning: writing primes to stdout may "
-							"stall large outputs."
-							" Consider using --out <path>.\n");
-	}else{
+		std::fflush(stdout);
+		pipe_=PipeOutput::open(fileno(stdout));
+		if(pipe_){
+			io_stats_.backend=FileIoBackend::Pipe;
+		}else{
+			file_=stdout;
+			owns_file_=false;
+			std::fprintf(stderr,
+						 "[calcprime] warning: writing primes to stdout may "
+						 "stall large outputs."
+						 " Consider using --out <path>.\n");
+		}
+	}else if(is_shm_output(path)){
+		if(format_!=PrimeOutputFormat::Binary||use_zstd_||options.extend_after){
+			throw std::invalid_argument(
+				"shm: output carries binary primes; use --out-format binary "
+				"without --zstd");
+		}
+		shm_=std::make_unique<ShmRingWriter>(
+			path.substr(4),shm::kDefaultBlockCount,shm::kDefaultBlockBytes,
+			options.io.shm_timeout_ms);
+		io_stats_.backend=FileIoBackend::SharedMemory;
+	}else if(options.extend_after){
+		open_for_extend(path,*options.extend_after);
+	}else if(options.io.backend==FileIoBackend::IoUring){
+		try{
+			uring_=std::make_unique<UringFile>(path,options.io.direct,
+											   options.io.queue_depth);
+			io_stats_.backend=FileIoBackend::IoUring;
+			io_stats_.direct=uring_->direct();
+			io_stats_.queue_depth=uring_->queue_depth();
+		}catch(const std::exception&ex){
+			std::fprintf(stderr,
+						 "[calcprime] warning: io_uring output unavailable "
+						 "(%s); using stdio.\n",
+						 ex.what());
+		}
+	}
+	if(!has_output()){
 		file_=std::fopen(path.c_str(),"wb");
 		if(!file_){
 			throw std::runtime_error("Failed to open output file");
@@ -83,19 +166,22 @@ PrimeWriter::PrimeWriter(bool enabled,const std::string&path,
 		owns_file_=true;
 	}
 
-	if(!file_){
+	if(!has_output()){
 		throw std::runtime_error("Invalid output handle");
 	}
 
-	if(std::setvbuf(file_,nullptr,_IOFBF,kDefaultFileBuffer)!=0){
+	if(file_&&std::setvbuf(file_,nullptr,_IOFBF,kDefaultFileBuffer)!=0){
 		throw std::runtime_error("Failed to set file buffer");
 	}
-	if(format_==PrimeOutputFormat::Parquet){
+	if(format_==PrimeOutputFormat::Parquet&&!options.extend_after){
 		write_file_bytes(kParquetMagic,sizeof(kParquetMagic));
 		check_io_error();
 	}
 
-	if(use_zstd_){
+	// Parquet pages and container blocks are compressed by the encode
+	// workers, each with its own context; only the stream formats and
+	// synchronous writers need a writer-side context.
+	if(stream_zstd_||(synchronous_&&use_zstd_)){
 #if defined(CALCPRIME_HAS_ZSTD)
 		ZSTD_CCtx*cctx=ZSTD_createCCtx();
 		if(!cctx){
@@ -115,10 +201,54 @@ PrimeWriter::PrimeWriter(bool enabled,const std::string&path,
 		throw std::runtime_error("zstd not supported in this build");
 #endif
 	}
+#if !defined(CALCPRIME_HAS_ZSTD)
+	if(use_zstd_){
+		throw std::runtime_error("zstd not supported in this build");
+	}
+#endif
 
-	buffer_.reserve(buffer_threshold_);
+	if(format_!=PrimeOutputFormat::Parquet){
+		buffer_.reserve(buffer_threshold_);
+	}
+	if(format_==PrimeOutputFormat::Gap8){
+		// The writer thread has not started yet, so the header can go
+		// straight into the (possibly zstd-compressed) stream buffer.
+		buffer_.append(gap8::make_file_header(gap8::kDefaultRestartInterval));
+		gap8_pending_values_.reserve(gap8::kDefaultRestartInterval);
+	}
+	if(format_==PrimeOutputFormat::Arrow){
+		buffer_.append(arrow::make_lead());
+	}
+	if(format_==PrimeOutputFormat::EliasFano){
+		buffer_.append(ef::make_lead());
+		ef_pending_values_.reserve(kEliasFanoGroupValues);
+	}
 	queue_.clear();
 
+	if(synchronous_){
+		return;
+	}
+	if(format_==PrimeOutputFormat::Parquet||
+	   format_==PrimeOutputFormat::EliasFano||
+	   format_==PrimeOutputFormat::Container||
+	   format_==PrimeOutputFormat::Arrow){
+		unsigned workers=options.encode_threads;
+		if(workers==0){
+			workers=std::clamp(std::thread::hardware_concurrency(),1u,
+							   kMaxEncodeWorkers);
+		}
+		// Every queued chunk holds one in-flight page or group, so the
+		// queue depth bounds both memory and the parallelism of the
+		// encode workers.
+		queue_capacity_=std::max<std::size_t>(
+			kDefaultQueueCapacity,static_cast<std::size_t>(workers)*4U);
+		encode_workers_.reserve(workers);
+		for(unsigned i=0;i<workers;++i){
+			encode_workers_.emplace_back(
+				&PrimeWriter::encode_worker_loop,this);
+		}
+	}
+
 	writer_thread_=std::thread(&PrimeWriter::writer_loop,this);
 }
 
@@ -126,7 +256,12 @@ PrimeWriter::~PrimeWriter(){
 	try{
 		finish();
 	}catch(...){
-		std::terminate();
+		// While unwinding from an error (often this writer's own, seen by
+		// the caller first) the stored one adds nothing; otherwise an
+		// unreported error must not be lost.
+		if(std::uncaught_exceptions()==0){
+			std::terminate();
+		}
 	}
 }
 
@@ -140,8 +275,7 @@ void PrimeWriter::write_segment(const std::vector<std::uint64_t>&primes){
 
 	switch(format_){
 	case PrimeOutputFormat::Text:{
-		std::string chunk;
-		chunk.reserve(primes.size()*24);
+		std::string chunk=chunk_buffers_.acquire(primes.size()*24);
 		char local[32];
 		for(std::uint64_t value : primes){
 			auto result=std::to_chars(local,local+sizeof(local),value);
@@ -151,11 +285,14 @@ void PrimeWriter::write_segment(const std::vector<std::uint64_t>&primes){
 			chunk.append(local,result.ptr);
 			chunk.push_back('\n');
 		}
-		enqueue_chunk(Chunk{std::move(chunk),false});
+		Chunk entry;
+		entry.data=std::move(chunk);
+		enqueue_chunk(std::move(entry));
 		break;
 	}
 	case PrimeOutputFormat::Binary:{
-		std::string chunk;
+		std::string chunk=
+			chunk_buffers_.acquire(primes.size()*sizeof(std::uint64_t));
 		chunk.resize(primes.size()*sizeof(std::uint64_t));
 		char*dest=chunk.data();
 		for(std::uint64_t value : primes){
@@ -163,40 +300,62 @@ void PrimeWriter::write_segment(const std::vector<std::uint64_t>&primes){
 			std::memcpy(dest,&encoded,sizeof(encoded));
 			dest+=sizeof(encoded);
 		}
-		enqueue_chunk(Chunk{std::move(chunk),false});
+		Chunk entry;
+		entry.data=std::move(chunk);
+		enqueue_chunk(std::move(entry));
 		break;
 	}
 	case PrimeOutputFormat::Delta16:{
 		std::string data=encode_delta16(primes);
 		if(!data.empty()){
-			enqueue_chunk(Chunk{std::move(data),false});
+			Chunk entry;
+			entry.data=std::move(data);
+			enqueue_chunk(std::move(entry));
 		}
 		break;
 	}
 	case PrimeOutputFormat::Parquet:{
-		for(std::size_t offset=0;offset<primes.size();){
-			std::size_t count=std::min(kParquetRowsPerGroup,
-								 primes.size()-offset);
-			std::string data;
-			if(parquet_encoding_==ParquetEncoding::DeltaBinaryPacked){
-				data=parquet::encode_delta_binary_packed(
-					primes.data()+offset,count,parquet_delta_block_values_);
-			}else{
-				data.resize(count*sizeof(std::uint64_t));
-				char*dest=data.data();
-				for(std::size_t i=0;i<count;++i){
-					std::uint64_t encoded=
-						to_little_endian_u64(primes[offset+i]);
-					std::memcpy(dest,&encoded,sizeof(encoded));
-					dest+=sizeof(encoded);
-				}
+		// Pages are cut at fixed value counts independent of the segment
+		// boundaries of the caller.
+		std::size_t offset=0;
+		while(offset<primes.size()){
+			std::size_t room=
+				kParquetValuesPerPage-parquet_pending_values_.size();
+			std::size_t take=std::min(room,primes.size()-offset);
+			parquet_pending_values_.insert(
+				parquet_pending_values_.end(),
+				primes.begin()+static_cast<std::ptrdiff_t>(offset),
+				primes.begin()+static_cast<std::ptrdiff_t>(offset+take));
+			offset+=take;
+			if(parquet_pending_values_.size()>=kParquetValuesPerPage){
+				submit_parquet_page(std::move(parquet_pending_values_));
+				parquet_pending_values_=
+					value_buffers_.acquire(kParquetValuesPerPage);
 			}
-			enqueue_chunk(Chunk{std::move(data),false,
-								static_cast<std::uint64_t>(count)});
-			offset+=count;
 		}
 		break;
 	}
+	case PrimeOutputFormat::Gap8:
+		append_gap8_values(primes.data(),primes.size());
+		break;
+	case PrimeOutputFormat::Wheel30:
+		append_wheel30_values(primes.data(),primes.size());
+		break;
+	case PrimeOutputFormat::EliasFano:
+		append_elias_fano_values(primes.data(),primes.size());
+		break;
+	case PrimeOutputFormat::Container:
+		append_container_values(primes.data(),primes.size());
+		break;
+	case PrimeOutputFormat::Arrow:
+		// Batches only end between segments, so every record batch covers
+		// whole segments.
+		arrow_pending_values_.insert(arrow_pending_values_.end(),
+									 primes.begin(),primes.end());
+		if(arrow_pending_values_.size()>=kArrowMinBatchRows){
+			submit_arrow_batch();
+		}
+		break;
 	}
 }
 
@@ -213,43 +372,96 @@ void PrimeWriter::write_value(std::uint64_t value){
 		}
 		std::string chunk(local,result.ptr);
 		chunk.push_back('\n');
-		enqueue_chunk(Chunk{std::move(chunk),false});
+		Chunk entry;
+		entry.data=std::move(chunk);
+		enqueue_chunk(std::move(entry));
 		break;
 	}
 	case PrimeOutputFormat::Binary:{
 		std::uint64_t encoded=to_little_endian_u64(value);
 		std::string chunk(reinterpret_cast<const char*>(&encoded),
 						  sizeof(encoded));
-		enqueue_chunk(Chunk{std::move(chunk),false});
+		Chunk entry;
+		entry.data=std::move(chunk);
+		enqueue_chunk(std::move(entry));
 		break;
 	}
 	case PrimeOutputFormat::Delta16:{
 		std::string data=encode_delta16_value(value);
 		if(!data.empty()){
-			enqueue_chunk(Chunk{std::move(data),false});
+			Chunk entry;
+			entry.data=std::move(data);
+			enqueue_chunk(std::move(entry));
 		}
 		break;
 	}
 	case PrimeOutputFormat::Parquet:{
-		std::string chunk;
-		if(parquet_encoding_==ParquetEncoding::DeltaBinaryPacked){
-			chunk=parquet::encode_delta_binary_packed(
-				&value,1,parquet_delta_block_values_);
-		}else{
-			std::uint64_t encoded=to_little_endian_u64(value);
-			chunk.assign(reinterpret_cast<const char*>(&encoded),sizeof(encoded));
+		parquet_pending_values_.push_back(value);
+		if(parquet_pending_values_.size()>=kParquetValuesPerPage){
+			submit_parquet_page(std::move(parquet_pending_values_));
+			parquet_pending_values_=
+				value_buffers_.acquire(kParquetValuesPerPage);
 		}
-		enqueue_chunk(Chunk{std::move(chunk),false,1});
 		break;
 	}
+	case PrimeOutputFormat::Gap8:
+		append_gap8_values(&value,1);
+		break;
+	case PrimeOutputFormat::Wheel30:
+		append_wheel30_values(&value,1);
+		break;
+	case PrimeOutputFormat::EliasFano:
+		append_elias_fano_values(&value,1);
+		break;
+	case PrimeOutputFormat::Container:
+		append_container_values(&value,1);
+		break;
+	case PrimeOutputFormat::Arrow:
+		arrow_pending_values_.push_back(value);
+		break;
 	}
 }
 
+void PrimeWriter::set_range(std::uint64_t from,std::uint64_t to){
+	if(!enabled_){
+		return;
+	}
+	if(range_set_){
+		throw std::logic_error("PrimeWriter range is already set");
+	}
+	range_set_=true;
+	range_from_=from;
+	range_to_=to;
+	if(format_==PrimeOutputFormat::Wheel30){
+		wheel30::Header header=wheel30::make_layout(from,to);
+		wheel30_base_=header.base;
+		wheel30_bitmap_bytes_=header.bitmap_bytes;
+		wheel30_index_interval_=header.index_interval;
+		wheel30_index_.reserve(static_cast<std::size_t>(header.index_entries));
+		Chunk entry;
+		entry.data=wheel30::encode_header(header);
+		enqueue_chunk(std::move(entry));
+	}
+}
+
+void PrimeWriter::set_wheel(std::uint32_t modulus){
+	wheel_modulus_=modulus;
+}
+
 void PrimeWriter::flush(){
 	if(!enabled_){
 		return;
 	}
-	enqueue_chunk(Chunk{{},true});
+	if(format_==PrimeOutputFormat::Parquet&&!parquet_pending_values_.empty()){
+		submit_parquet_page(std::move(parquet_pending_values_));
+		parquet_pending_values_=value_buffers_.acquire(kParquetValuesPerPage);
+	}
+	if(format_==PrimeOutputFormat::Gap8){
+		flush_gap8_block();
+	}
+	Chunk chunk;
+	chunk.flush=true;
+	enqueue_chunk(std::move(chunk));
 }
 
 void PrimeWriter::finish(){
@@ -266,7 +478,29 @@ void PrimeWriter::finish(){
 	std::exception_ptr flush_error;
 	if(!already_stopped){
 		try{
+			if(format_==PrimeOutputFormat::Wheel30){
+				finish_wheel30();
+			}
+			// Elias-Fano blocks must be full except the last one, so the
+			// remainder is only submitted here and not on every flush().
+			if(format_==PrimeOutputFormat::EliasFano){
+				submit_elias_fano_group(std::move(ef_pending_values_));
+				ef_pending_values_.clear();
+			}
+			// Container blocks are likewise kept full-sized across flushes.
+			if(format_==PrimeOutputFormat::Container){
+				submit_container_block(std::move(container_pending_values_));
+				container_pending_values_.clear();
+				write_container_header();
+			}
+			if(format_==PrimeOutputFormat::Arrow){
+				submit_arrow_batch();
+				write_arrow_schema();
+			}
 			flush();
+			if(synchronous_){
+				write_trailer();
+			}
 		}catch(...){
 			flush_error=std::current_exception();
 		}
@@ -280,6 +514,7 @@ void PrimeWriter::finish(){
 	if(writer_thread_.joinable()){
 		writer_thread_.join();
 	}
+	stop_encode_workers();
 
 #if defined(CALCPRIME_HAS_ZSTD)
 	if(zstd_cctx_){
@@ -288,6 +523,49 @@ void PrimeWriter::finish(){
 	}
 #endif
 
+	if(uring_){
+		try{
+			uring_->close();
+		}catch(const std::exception&ex){
+			if(!flush_error){
+				flush_error=std::make_exception_ptr(
+					std::runtime_error(std::string("Failed to close output file: ")+
+									   ex.what()));
+			}
+		}
+		io_stats_.bytes=uring_->bytes_written();
+		io_stats_.submissions=uring_->submissions();
+		io_stats_.in_flight_total=uring_->in_flight_total();
+		uring_.reset();
+	}
+	if(shm_){
+		try{
+			shm_->close();
+		}catch(const std::exception&ex){
+			if(!flush_error){
+				flush_error=std::make_exception_ptr(std::runtime_error(
+					std::string("Failed to close shared memory output: ")+
+					ex.what()));
+			}
+		}
+		io_stats_.bytes=shm_->bytes_written();
+		io_stats_.submissions=shm_->blocks_published();
+		io_stats_.waits=shm_->waits();
+		shm_.reset();
+	}
+	if(pipe_){
+		try{
+			pipe_->close();
+		}catch(const std::exception&ex){
+			if(!flush_error){
+				flush_error=std::make_exception_ptr(std::runtime_error(
+					std::string("Failed to flush output stream: ")+ex.what()));
+			}
+		}
+		io_stats_.bytes=pipe_->bytes_written();
+		io_stats_.submissions=pipe_->writes();
+		pipe_.reset();
+	}
 	if(file_){
 		if(owns_file_){
 			if(std::fclose(file_)!=0){
@@ -314,6 +592,95 @@ void PrimeWriter::finish(){
 	check_io_error();
 }
 
+// Reopens an existing export for appending.  Stream formats simply grow;
+// for a zstd stream the new data becomes a further frame, which decoders
+// read as a continuation.  A Parquet file is cut back to its last data
+// page and its row groups are rebuilt from the page headers, so that
+// finish() writes a page index and footer covering old and new pages.  The
+// existing codec and value encoding are kept.
+void PrimeWriter::open_for_extend(const std::string&path,
+								  std::uint64_t last_prime){
+	std::uint64_t keep=0;
+	switch(format_){
+	case PrimeOutputFormat::Text:
+	case PrimeOutputFormat::Binary:
+		keep=std::filesystem::file_size(path);
+		break;
+	case PrimeOutputFormat::Delta16:
+		keep=std::filesystem::file_size(path);
+		has_first_prime_=true;
+		previous_prime_=last_prime;
+		break;
+	case PrimeOutputFormat::Parquet:{
+		MappedFile mapped(path);
+		const std::uint8_t*data=mapped.data();
+		parquet::FileInfo info=parquet::decode_file_info(data,mapped.size());
+		use_zstd_=info.zstd;
+		keep=sizeof(kParquetMagic);
+		for(const parquet::ColumnChunkInfo&chunk : info.row_groups){
+			ParquetRowGroup group;
+			group.data_page_offset=chunk.data_page_offset;
+			group.total_uncompressed_size=chunk.total_uncompressed_size;
+			group.total_compressed_size=chunk.total_compressed_size;
+			std::uint64_t position=
+				static_cast<std::uint64_t>(chunk.data_page_offset);
+			std::uint64_t end=position+static_cast<std::uint64_t>(
+										   chunk.total_compressed_size);
+			while(position<end){
+				parquet::PageInfo page=parquet::read_page_header(
+					data+position,static_cast<std::size_t>(end-position));
+				if(!page.data_page||!page.has_statistics){
+					throw std::runtime_error(
+						"Parquet page without statistics cannot be extended");
+				}
+				parquet_encoding_=
+					page.encoding==parquet::ValueEncoding::DeltaBinaryPacked
+						?ParquetEncoding::DeltaBinaryPacked
+						:ParquetEncoding::Plain;
+				ParquetPage entry;
+				entry.offset=static_cast<std::int64_t>(position);
+				entry.compressed_page_size=static_cast<std::int32_t>(
+					page.header_bytes+
+					static_cast<std::size_t>(page.compressed_size));
+				entry.first_row_index=group.num_values;
+				entry.num_values=page.num_values;
+				entry.min_value=page.min_value;
+				entry.max_value=page.max_value;
+				group.pages.push_back(entry);
+				group.num_values+=entry.num_values;
+				position+=static_cast<std::uint64_t>(
+					entry.compressed_page_size);
+			}
+			if(group.pages.empty()){
+				continue;
+			}
+			group.min_value=group.pages.front().min_value;
+			group.max_value=group.pages.back().max_value;
+			parquet_num_rows_+=static_cast<std::uint64_t>(group.num_values);
+			keep=std::max(keep,end);
+			parquet_row_groups_.push_back(std::move(group));
+		}
+		if(!parquet_row_groups_.empty()&&
+		   parquet_row_groups_.back().max_value!=last_prime){
+			throw std::runtime_error(
+				"Parquet statistics disagree with the last prime in the file");
+		}
+		stream_zstd_=false;
+		break;
+	}
+	default:
+		throw std::invalid_argument(
+			"--extend supports text, binary, delta16 and parquet output");
+	}
+	std::filesystem::resize_file(path,keep);
+	file_=std::fopen(path.c_str(),"ab");
+	if(!file_){
+		throw std::runtime_error("Failed to open output file");
+	}
+	owns_file_=true;
+	file_offset_=keep;
+}
+
 void PrimeWriter::enqueue_chunk(Chunk&&chunk){
 	if(!enabled_){
 		return;
@@ -321,6 +688,13 @@ void PrimeWriter::enqueue_chunk(Chunk&&chunk){
 
 	check_io_error();
 
+	if(synchronous_){
+		write_chunk(chunk);
+		chunk_buffers_.release(std::move(chunk.data));
+		check_io_error();
+		return;
+	}
+
 	std::unique_lock<std::mutex> lock(queue_mutex_);
 	queue_not_full_.wait(
 		lock,[&]{ return queue_.size()<queue_capacity_||stop_requested_; });
@@ -350,50 +724,94 @@ void PrimeWriter::writer_loop(){
 			queue_not_full_.notify_one();
 		}
 
-		if(format_==PrimeOutputFormat::Parquet&&!chunk.data.empty()){
-			write_parquet_chunk(chunk);
-		}else if(!chunk.data.empty()){
+		write_chunk(chunk);
+		chunk_buffers_.release(std::move(chunk.data));
+	}
+
+	write_trailer();
+}
+
+void PrimeWriter::write_chunk(Chunk&chunk){
+	if(chunk.page.valid()){
+		try{
+			write_parquet_page(chunk.page.get());
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
+	}else if(chunk.ef_group.valid()){
+		try{
+			write_elias_fano_group(chunk.ef_group.get());
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
+	}else if(chunk.encoded.valid()){
+		try{
+			if(format_==PrimeOutputFormat::Arrow){
+				write_arrow_batch(chunk.encoded.get());
+			}else{
+				write_container_block(chunk.encoded.get());
+			}
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
+	}else if(!chunk.data.empty()){
+		if((pipe_||shm_)&&!stream_zstd_){
+			// The pipe or shared-memory ring is the buffer; copying
+			// through buffer_ first would double the memory traffic.
+			flush_buffer();
+			write_file_bytes(chunk.data.data(),chunk.data.size());
+		}else{
 			buffer_.append(chunk.data);
 			if(buffer_.size()>=buffer_threshold_){
 				flush_buffer();
 			}
 		}
-		if(chunk.flush){
-			if(format_!=PrimeOutputFormat::Parquet){
-				flush_buffer();
+	}
+	if(chunk.flush){
+		if(format_!=PrimeOutputFormat::Parquet){
+			flush_buffer();
 #if defined(CALCPRIME_HAS_ZSTD)
-				if(use_zstd_){
-					flush_zstd_stream(false);
-				}
-#endif
-			}
-			if(file_&&std::fflush(file_)!=0){
-				set_error(std::strerror(errno));
+			if(stream_zstd_){
+				flush_zstd_stream(false);
 			}
+#endif
 		}
+		flush_file();
 	}
+}
 
+// Footers and the end of the zstd stream, after the last chunk.
+void PrimeWriter::write_trailer(){
 	if(format_==PrimeOutputFormat::Parquet){
 		write_parquet_footer();
 	}else{
+		try{
+			if(format_==PrimeOutputFormat::EliasFano){
+				write_elias_fano_footer();
+			}else if(format_==PrimeOutputFormat::Container){
+				write_container_footer();
+			}else if(format_==PrimeOutputFormat::Arrow){
+				write_arrow_footer();
+			}
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
 		flush_buffer();
 	}
 #if defined(CALCPRIME_HAS_ZSTD)
-	if(use_zstd_&&format_!=PrimeOutputFormat::Parquet){
+	if(stream_zstd_){
 		flush_zstd_stream(true);
 	}
 #endif
-	if(file_&&std::fflush(file_)!=0){
-		set_error(std::strerror(errno));
-	}
+	flush_file();
 }
 
 void PrimeWriter::flush_buffer(){
-	if(!file_||buffer_.empty()){
+	if(!has_output()||buffer_.empty()){
 		return;
 	}
 
-	if(!use_zstd_){
+	if(!stream_zstd_){
 		write_file_bytes(buffer_.data(),buffer_.size());
 		if(!io_error_.load(std::memory_order_acquire)){
 			buffer_.clear();
@@ -465,7 +883,7 @@ std::string PrimeWriter::encode_delta16(
 		}
 	}
 
-	std::string encoded;
+	std::string encoded=chunk_buffers_.acquire(bytes);
 	encoded.resize(bytes);
 	char*dest=encoded.data();
 
@@ -544,7 +962,34 @@ std::string PrimeWriter::encode_delta16_value(std::uint64_t value){
 }
 
 void PrimeWriter::write_file_bytes(const char*data,std::size_t size){
-	if(!file_||size==0){
+	if(size==0){
+		return;
+	}
+	if(uring_){
+		try{
+			uring_->write(data,size);
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+			return;
+		}
+		file_offset_+=static_cast<std::uint64_t>(size);
+		return;
+	}
+	if(pipe_||shm_){
+		try{
+			if(pipe_){
+				pipe_->write(data,size);
+			}else{
+				shm_->write(data,size);
+			}
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+			return;
+		}
+		file_offset_+=static_cast<std::uint64_t>(size);
+		return;
+	}
+	if(!file_){
 		return;
 	}
 	const char*cursor=data;
@@ -560,87 +1005,681 @@ void PrimeWriter::write_file_bytes(const char*data,std::size_t size){
 		cursor+=written;
 		remaining-=written;
 		file_offset_+=static_cast<std::uint64_t>(written);
+		io_stats_.bytes+=static_cast<std::uint64_t>(written);
 	}
 }
 
-void PrimeWriter::write_parquet_chunk(const Chunk&chunk){
-	if(chunk.value_count==0||chunk.data.empty()){
+void PrimeWriter::flush_file(){
+	if(uring_){
+		try{
+			uring_->flush();
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
+	}else if(pipe_||shm_){
+		try{
+			if(pipe_){
+				pipe_->flush();
+			}else{
+				shm_->flush();
+			}
+		}catch(const std::exception&ex){
+			set_error(ex.what());
+		}
+	}else if(file_&&std::fflush(file_)!=0){
+		set_error(std::strerror(errno));
+	}
+}
+
+void PrimeWriter::submit_parquet_page(std::vector<std::uint64_t>&&values){
+	if(values.empty()){
 		return;
 	}
-	if(chunk.value_count>
-	   static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max())||
-	   chunk.data.size()>
-		   static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())){
-		set_error("Parquet data page exceeds the supported 2 GiB limit");
+	EncodeJob job;
+	job.values=std::move(values);
+	Chunk chunk;
+	chunk.page=job.page.get_future();
+	submit_encode_job(std::move(chunk),std::move(job));
+}
+
+void PrimeWriter::submit_encode_job(Chunk&&chunk,EncodeJob&&job){
+	if(synchronous_){
+		run_encode_job(job,zstd_cctx_);
+		enqueue_chunk(std::move(chunk));
 		return;
 	}
+	// Queue the placeholder first: the writer consumes pages in submission
+	// order and the bounded queue throttles how many pages are in flight.
+	enqueue_chunk(std::move(chunk));
+	{
+		std::lock_guard<std::mutex> lock(encode_jobs_mutex_);
+		encode_jobs_.push_back(std::move(job));
+	}
+	encode_jobs_cv_.notify_one();
+}
 
-	const std::string*payload=&chunk.data;
-	std::string compressed;
+void PrimeWriter::encode_worker_loop(){
+	void*cctx=nullptr;
+#if defined(CALCPRIME_HAS_ZSTD)
+	if(use_zstd_){
+		ZSTD_CCtx*context=ZSTD_createCCtx();
+		if(context&&ZSTD_isError(ZSTD_CCtx_setParameter(
+					   context,ZSTD_c_compressionLevel,1))){
+			ZSTD_freeCCtx(context);
+			context=nullptr;
+		}
+		cctx=context;
+	}
+#endif
+	for(;;){
+		EncodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(encode_jobs_mutex_);
+			encode_jobs_cv_.wait(lock,[&]{
+				return encode_workers_stop_||!encode_jobs_.empty();
+			});
+			if(encode_jobs_.empty()){
+				break;
+			}
+			job=std::move(encode_jobs_.front());
+			encode_jobs_.pop_front();
+		}
+		run_encode_job(job,cctx);
+	}
 #if defined(CALCPRIME_HAS_ZSTD)
+	if(cctx){
+		ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(cctx));
+	}
+#endif
+}
+
+// Encodes one job and fulfils its promise, with the exception on failure.
+// The values go back to the pool either way.
+void PrimeWriter::run_encode_job(EncodeJob&job,void*cctx) const{
+	if(format_==PrimeOutputFormat::EliasFano){
+		try{
+			job.ef_group.set_value(encode_elias_fano_group(job.values));
+		}catch(...){
+			job.ef_group.set_exception(std::current_exception());
+		}
+	}else if(format_==PrimeOutputFormat::Arrow){
+		try{
+			job.encoded.set_value(arrow::encode_record_batch(
+				job.values.data(),job.values.size(),
+				use_zstd_?arrow::Codec::Zstd
+						 :(use_lz4_?arrow::Codec::Lz4Frame
+								   :arrow::Codec::None),
+				cctx));
+		}catch(...){
+			job.encoded.set_exception(std::current_exception());
+		}
+	}else if(format_==PrimeOutputFormat::Container){
+		try{
+			job.encoded.set_value(container::encode_block(
+				job.values.data(),job.values.size(),
+				container_encoding_==ContainerEncoding::Gap8,cctx));
+		}catch(...){
+			job.encoded.set_exception(std::current_exception());
+		}
+	}else{
+		try{
+			job.page.set_value(encode_parquet_page(job.values,cctx));
+		}catch(...){
+			job.page.set_exception(std::current_exception());
+		}
+	}
+	value_buffers_.release(std::move(job.values));
+}
+
+void PrimeWriter::stop_encode_workers(){
+	{
+		std::lock_guard<std::mutex> lock(encode_jobs_mutex_);
+		encode_workers_stop_=true;
+	}
+	encode_jobs_cv_.notify_all();
+	for(std::thread&worker : encode_workers_){
+		if(worker.joinable()){
+			worker.join();
+		}
+	}
+	encode_workers_.clear();
+}
+
+PrimeWriter::ParquetEncodedPage PrimeWriter::encode_parquet_page(
+	const std::vector<std::uint64_t>&values,void*zstd_cctx) const{
+	std::string data=
+		page_buffers_.acquire(values.size()*sizeof(std::uint64_t));
+	if(parquet_encoding_==ParquetEncoding::DeltaBinaryPacked){
+		parquet::encode_delta_binary_packed(data,values.data(),values.size(),
+											parquet_delta_block_values_);
+	}else{
+		data.resize(values.size()*sizeof(std::uint64_t));
+		char*dest=data.data();
+		for(std::uint64_t value : values){
+			std::uint64_t encoded=to_little_endian_u64(value);
+			std::memcpy(dest,&encoded,sizeof(encoded));
+			dest+=sizeof(encoded);
+		}
+	}
+	if(values.size()>
+	   static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())||
+	   data.size()>
+		   static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())){
+		throw std::runtime_error(
+			"Parquet data page exceeds the supported 2 GiB limit");
+	}
+
+	std::string compressed;
+	const std::string*payload=&data;
 	if(use_zstd_){
-		std::size_t bound=ZSTD_compressBound(chunk.data.size());
-		compressed.resize(bound);
+#if defined(CALCPRIME_HAS_ZSTD)
+		if(!zstd_cctx){
+			throw std::runtime_error("zstd context is not initialized");
+		}
+		compressed=page_buffers_.acquire(ZSTD_compressBound(data.size()));
+		compressed.resize(ZSTD_compressBound(data.size()));
 		std::size_t result=ZSTD_compress2(
-			static_cast<ZSTD_CCtx*>(zstd_cctx_),compressed.data(),
-			compressed.size(),chunk.data.data(),chunk.data.size());
+			static_cast<ZSTD_CCtx*>(zstd_cctx),compressed.data(),
+			compressed.size(),data.data(),data.size());
 		if(ZSTD_isError(result)){
 			std::string message="zstd compress error: ";
 			message.append(ZSTD_getErrorName(result));
-			set_error(message);
-			return;
+			throw std::runtime_error(message);
 		}
 		compressed.resize(result);
 		payload=&compressed;
-	}
 #else
-	if(use_zstd_){
-		set_error("zstd not supported in this build");
-		return;
-	}
+		(void)zstd_cctx;
+		throw std::runtime_error("zstd not supported in this build");
 #endif
-
-	if(payload->size()>
-	   static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())){
-		set_error("Compressed Parquet data page exceeds the supported 2 GiB limit");
-		return;
 	}
 
+	ParquetEncodedPage page;
+	page.value_count=static_cast<std::uint64_t>(values.size());
+	page.min_value=values.front();
+	page.max_value=values.back();
 	std::string header=parquet::make_data_page_header(
-		static_cast<std::int32_t>(chunk.value_count),
-		static_cast<std::int32_t>(chunk.data.size()),
+		static_cast<std::int32_t>(values.size()),
+		static_cast<std::int32_t>(data.size()),
 		static_cast<std::int32_t>(payload->size()),
 		parquet_encoding_==ParquetEncoding::DeltaBinaryPacked
 			?parquet::ValueEncoding::DeltaBinaryPacked
-			:parquet::ValueEncoding::Plain);
+			:parquet::ValueEncoding::Plain,
+		page.min_value,page.max_value);
+	page.uncompressed_size=
+		static_cast<std::int64_t>(header.size()+data.size());
+	page.bytes=page_buffers_.acquire(header.size()+payload->size());
+	page.bytes.append(header);
+	page.bytes.append(*payload);
+	page_buffers_.release(std::move(data));
+	page_buffers_.release(std::move(compressed));
+	if(page.bytes.size()>
+	   static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())){
+		throw std::runtime_error(
+			"Compressed Parquet data page exceeds the supported 2 GiB limit");
+	}
+	return page;
+}
+
+void PrimeWriter::write_parquet_page(ParquetEncodedPage&&page){
+	if(page.value_count==0||io_error_.load(std::memory_order_acquire)){
+		return;
+	}
 	std::uint64_t page_offset=file_offset_;
-	write_file_bytes(header.data(),header.size());
-	write_file_bytes(payload->data(),payload->size());
+	write_file_bytes(page.bytes.data(),page.bytes.size());
+	std::int64_t page_bytes=static_cast<std::int64_t>(page.bytes.size());
+	page_buffers_.release(std::move(page.bytes));
 	if(io_error_.load(std::memory_order_acquire)){
 		return;
 	}
 
-	ParquetRowGroup row_group;
-	row_group.data_page_offset=static_cast<std::int64_t>(page_offset);
-	row_group.num_values=static_cast<std::int64_t>(chunk.value_count);
-	row_group.total_uncompressed_size=static_cast<std::int64_t>(
-		header.size()+chunk.data.size());
-	row_group.total_compressed_size=static_cast<std::int64_t>(
-		header.size()+payload->size());
-	parquet_row_groups_.push_back(row_group);
-	parquet_num_rows_+=chunk.value_count;
+	ParquetRowGroup&group=parquet_current_row_group_;
+	if(group.pages.empty()){
+		group.data_page_offset=static_cast<std::int64_t>(page_offset);
+		group.min_value=page.min_value;
+	}
+	ParquetPage entry;
+	entry.offset=static_cast<std::int64_t>(page_offset);
+	entry.compressed_page_size=static_cast<std::int32_t>(page_bytes);
+	entry.first_row_index=group.num_values;
+	entry.num_values=static_cast<std::int64_t>(page.value_count);
+	entry.min_value=page.min_value;
+	entry.max_value=page.max_value;
+	group.pages.push_back(entry);
+	group.num_values+=entry.num_values;
+	group.total_uncompressed_size+=page.uncompressed_size;
+	group.total_compressed_size+=page_bytes;
+	group.max_value=page.max_value;
+	parquet_num_rows_+=page.value_count;
+
+	if(static_cast<std::uint64_t>(group.total_compressed_size)>=
+	   static_cast<std::uint64_t>(parquet_row_group_bytes_)){
+		close_parquet_row_group();
+	}
+}
+
+void PrimeWriter::close_parquet_row_group(){
+	if(parquet_current_row_group_.pages.empty()){
+		return;
+	}
+	parquet_row_groups_.push_back(std::move(parquet_current_row_group_));
+	parquet_current_row_group_=ParquetRowGroup{};
+}
+
+// gap8_encoded_ is empty between calls; its storage was moved into the last
+// chunk, so a pooled buffer takes its place.
+void PrimeWriter::reserve_gap8_encoded(std::size_t bytes){
+	if(gap8_encoded_.empty()&&gap8_encoded_.capacity()<bytes){
+		chunk_buffers_.release(std::move(gap8_encoded_));
+		gap8_encoded_=chunk_buffers_.acquire(bytes);
+	}
+}
+
+// Gap8 blocks restart every kDefaultRestartInterval primes regardless of how
+// the caller splits its segments; finished blocks of one call are batched
+// into a single chunk.
+void PrimeWriter::append_gap8_values(const std::uint64_t*values,
+									 std::size_t count){
+	// One byte per gap plus the block headers; escapes are rare.
+	reserve_gap8_encoded(count+(count/gap8::kDefaultRestartInterval+2)*
+								   gap8::kBlockHeaderBytes);
+	std::size_t offset=0;
+	while(offset<count){
+		std::size_t room=
+			gap8::kDefaultRestartInterval-gap8_pending_values_.size();
+		std::size_t take=std::min(room,count-offset);
+		if(gap8_pending_values_.empty()&&take==gap8::kDefaultRestartInterval){
+			gap8::append_block(gap8_encoded_,values+offset,take);
+		}else{
+			gap8_pending_values_.insert(gap8_pending_values_.end(),
+										values+offset,values+offset+take);
+			if(gap8_pending_values_.size()==gap8::kDefaultRestartInterval){
+				gap8::append_block(gap8_encoded_,gap8_pending_values_.data(),
+								   gap8_pending_values_.size());
+				gap8_pending_values_.clear();
+			}
+		}
+		offset+=take;
+	}
+	if(!gap8_encoded_.empty()){
+		Chunk entry;
+		entry.data=std::move(gap8_encoded_);
+		gap8_encoded_.clear();
+		enqueue_chunk(std::move(entry));
+	}
+}
+
+void PrimeWriter::flush_gap8_block(){
+	if(gap8_pending_values_.empty()){
+		return;
+	}
+	reserve_gap8_encoded(gap8_pending_values_.size()+gap8::kBlockHeaderBytes);
+	gap8::append_block(gap8_encoded_,gap8_pending_values_.data(),
+					   gap8_pending_values_.size());
+	gap8_pending_values_.clear();
+	Chunk entry;
+	entry.data=std::move(gap8_encoded_);
+	gap8_encoded_.clear();
+	enqueue_chunk(std::move(entry));
+}
+
+void PrimeWriter::append_wheel30_values(const std::uint64_t*values,
+										std::size_t count){
+	if(!range_set_){
+		throw std::logic_error("wheel30 output requires the export range");
+	}
+	std::string chunk;
+	for(std::size_t i=0;i<count;++i){
+		std::uint64_t value=values[i];
+		if(value<range_from_||value>=range_to_){
+			throw std::runtime_error("prime lies outside the wheel30 range");
+		}
+		if(value<7){
+			// 2, 3 and 5 are implied by the range flags in the header.
+			continue;
+		}
+		std::uint64_t offset=value-wheel30_base_;
+		int bit=wheel30::residue_bit(static_cast<unsigned>(offset%30U));
+		std::uint64_t byte=offset/30U;
+		if(bit<0||byte<wheel30_next_byte_){
+			throw std::runtime_error(
+				"wheel30 output requires increasing primes coprime to 30");
+		}
+		emit_wheel30_bytes_until(byte,chunk);
+		wheel30_current_|=static_cast<std::uint8_t>(1U<<bit);
+	}
+	if(!chunk.empty()){
+		Chunk entry;
+		entry.data=std::move(chunk);
+		enqueue_chunk(std::move(entry));
+	}
+}
+
+// Emits every bitmap byte before `byte`, recording a cumulative count each
+// time an index interval starts.
+void PrimeWriter::emit_wheel30_bytes_until(std::uint64_t byte,
+										   std::string&out){
+	while(wheel30_next_byte_<byte){
+		if(wheel30_next_byte_%wheel30_index_interval_==0){
+			wheel30_index_.push_back(wheel30_bits_);
+		}
+		out.push_back(static_cast<char>(wheel30_current_));
+		wheel30_bits_+=popcount_u64(wheel30_current_);
+		wheel30_current_=0;
+		++wheel30_next_byte_;
+	}
+}
+
+void PrimeWriter::finish_wheel30(){
+	if(wheel30_finished_){
+		return;
+	}
+	if(!range_set_){
+		throw std::logic_error("wheel30 output requires the export range");
+	}
+	wheel30_finished_=true;
+	std::string trailer;
+	emit_wheel30_bytes_until(wheel30_bitmap_bytes_,trailer);
+	if(wheel30_bitmap_bytes_%wheel30_index_interval_==0){
+		wheel30_index_.push_back(wheel30_bits_);
+	}
+	std::size_t offset=trailer.size();
+	trailer.resize(offset+wheel30_index_.size()*sizeof(std::uint64_t));
+	for(std::uint64_t entry : wheel30_index_){
+		std::uint64_t encoded=to_little_endian_u64(entry);
+		std::memcpy(trailer.data()+offset,&encoded,sizeof(encoded));
+		offset+=sizeof(encoded);
+	}
+	Chunk entry;
+	entry.data=std::move(trailer);
+	enqueue_chunk(std::move(entry));
+}
+
+void PrimeWriter::append_elias_fano_values(const std::uint64_t*values,
+										   std::size_t count){
+	std::size_t offset=0;
+	while(offset<count){
+		std::size_t take=std::min(
+			kEliasFanoGroupValues-ef_pending_values_.size(),count-offset);
+		ef_pending_values_.insert(ef_pending_values_.end(),values+offset,
+								  values+offset+take);
+		offset+=take;
+		if(ef_pending_values_.size()==kEliasFanoGroupValues){
+			submit_elias_fano_group(std::move(ef_pending_values_));
+			ef_pending_values_=value_buffers_.acquire(kEliasFanoGroupValues);
+		}
+	}
+}
+
+void PrimeWriter::submit_elias_fano_group(std::vector<std::uint64_t>&&values){
+	if(values.empty()){
+		return;
+	}
+	EncodeJob job;
+	job.values=std::move(values);
+	Chunk chunk;
+	chunk.ef_group=job.ef_group.get_future();
+	submit_encode_job(std::move(chunk),std::move(job));
+}
+
+PrimeWriter::EliasFanoEncodedGroup PrimeWriter::encode_elias_fano_group(
+	const std::vector<std::uint64_t>&values) const{
+	EliasFanoEncodedGroup group;
+	group.blocks.reserve(
+		(values.size()+ef::kDefaultBlockValues-1U)/ef::kDefaultBlockValues);
+	for(std::size_t start=0;start<values.size();
+		start+=ef::kDefaultBlockValues){
+		std::size_t count=
+			std::min<std::size_t>(ef::kDefaultBlockValues,values.size()-start);
+		EliasFanoBlock block;
+		block.first=values[start];
+		block.offset=group.bytes.size();
+		block.lower_bits=
+			ef::append_block(group.bytes,values.data()+start,count);
+		group.blocks.push_back(block);
+	}
+	group.value_count=values.size();
+	group.last_value=values.back();
+	return group;
+}
+
+// Runs on the writer thread: blocks are placed in submission order, so the
+// directory offsets follow from the bytes written so far.
+void PrimeWriter::write_elias_fano_group(EliasFanoEncodedGroup&&group){
+	if(group.value_count==0||io_error_.load(std::memory_order_acquire)){
+		return;
+	}
+	if(ef_count_!=0&&group.blocks.front().first<=ef_last_value_){
+		throw std::runtime_error(
+			"Elias-Fano output requires strictly increasing primes");
+	}
+	std::uint64_t base=file_offset_+buffer_.size();
+	for(EliasFanoBlock block : group.blocks){
+		block.offset+=base;
+		ef_blocks_.push_back(block);
+	}
+	ef_count_+=group.value_count;
+	ef_last_value_=group.last_value;
+	buffer_.append(group.bytes);
+	if(buffer_.size()>=buffer_threshold_){
+		flush_buffer();
+	}
+}
+
+void PrimeWriter::write_elias_fano_footer(){
+	ef::Footer footer;
+	if(range_set_){
+		footer.from=range_from_;
+		footer.to=range_to_;
+	}else if(ef_count_!=0){
+		footer.from=ef_blocks_.front().first;
+		footer.to=ef_last_value_+1U;
+	}
+	footer.count=ef_count_;
+	footer.block_values=ef::kDefaultBlockValues;
+	footer.block_count=ef_blocks_.size();
+	footer.bucket_shift=static_cast<std::uint8_t>(
+		ef::bucket_shift_for(footer.from,footer.to,footer.block_count));
+	footer.directory_offset=file_offset_+buffer_.size();
+	footer.bucket_offset=footer.directory_offset+
+						 footer.block_count*ef::kDirectoryEntryBytes;
+
+	std::vector<std::uint64_t> firsts;
+	firsts.reserve(ef_blocks_.size());
+	for(const EliasFanoBlock&block : ef_blocks_){
+		ef::append_directory_entry(buffer_,block.first,block.offset,
+								   block.lower_bits);
+		firsts.push_back(block.first);
+	}
+	ef::append_buckets(buffer_,firsts.data(),firsts.size(),footer.from,
+					   footer.to,footer.bucket_shift);
+	buffer_.append(ef::encode_footer(footer));
+}
+
+void PrimeWriter::append_container_values(const std::uint64_t*values,
+										  std::size_t count){
+	std::size_t offset=0;
+	while(offset<count){
+		std::size_t take=std::min<std::size_t>(
+			container::kDefaultBlockValues-container_pending_values_.size(),
+			count-offset);
+		container_pending_values_.insert(container_pending_values_.end(),
+										 values+offset,values+offset+take);
+		offset+=take;
+		if(container_pending_values_.size()==container::kDefaultBlockValues){
+			submit_container_block(std::move(container_pending_values_));
+			container_pending_values_=
+				value_buffers_.acquire(container::kDefaultBlockValues);
+		}
+	}
+}
+
+void PrimeWriter::write_container_header(){
+	if(container_header_written_){
+		return;
+	}
+	container_header_written_=true;
+	container::FileHeader header;
+	if(range_set_){
+		header.from=range_from_;
+		header.to=range_to_;
+		header.flags|=container::kFlagRangeKnown;
+	}
+	header.wheel=wheel_modulus_;
+	header.compression=use_zstd_?container::Compression::Zstd
+								:container::Compression::None;
+	Chunk entry;
+	entry.data=container::encode_file_header(header);
+	enqueue_chunk(std::move(entry));
+}
+
+void PrimeWriter::submit_container_block(std::vector<std::uint64_t>&&values){
+	write_container_header();
+	if(values.empty()){
+		return;
+	}
+	EncodeJob job;
+	job.values=std::move(values);
+	Chunk chunk;
+	chunk.encoded=job.encoded.get_future();
+	submit_encode_job(std::move(chunk),std::move(job));
+}
+
+// Runs on the writer thread, which knows each block's final offset.
+void PrimeWriter::write_container_block(std::string&&block){
+	if(io_error_.load(std::memory_order_acquire)){
+		return;
+	}
+	container::BlockHeader header=container::read_block_header(
+		reinterpret_cast<const std::uint8_t*>(block.data()),block.size());
+	container::IndexEntry entry;
+	entry.offset=file_offset_+buffer_.size();
+	entry.first_prime=header.first_prime;
+	entry.count=header.count;
+	entry.block_bytes=static_cast<std::uint32_t>(block.size());
+	container::append_index_entry(container_index_,entry);
+	++container_blocks_;
+	container_count_+=header.count;
+	buffer_.append(block);
+	if(buffer_.size()>=buffer_threshold_){
+		flush_buffer();
+	}
+}
+
+void PrimeWriter::write_container_footer(){
+	container::Footer footer;
+	footer.index_offset=file_offset_+buffer_.size();
+	footer.block_count=container_blocks_;
+	footer.prime_count=container_count_;
+	footer.index_checksum=
+		container::crc32c(container_index_.data(),container_index_.size());
+	buffer_.append(container_index_);
+	buffer_.append(container::encode_footer(footer));
+}
+
+// The schema carries the range, so it is written lazily once set_range()
+// had its chance.
+void PrimeWriter::write_arrow_schema(){
+	if(arrow_schema_written_){
+		return;
+	}
+	arrow_schema_written_=true;
+	Chunk entry;
+	entry.data=arrow::encode_schema_message(
+		arrow::SchemaInfo{range_set_,range_from_,range_to_});
+	enqueue_chunk(std::move(entry));
+}
+
+void PrimeWriter::submit_arrow_batch(){
+	write_arrow_schema();
+	if(arrow_pending_values_.empty()){
+		return;
+	}
+	std::size_t rows=arrow_pending_values_.size();
+	EncodeJob job;
+	job.values=std::move(arrow_pending_values_);
+	arrow_pending_values_=value_buffers_.acquire(rows);
+	Chunk chunk;
+	chunk.encoded=job.encoded.get_future();
+	submit_encode_job(std::move(chunk),std::move(job));
+}
+
+void PrimeWriter::write_arrow_batch(std::string&&message){
+	if(io_error_.load(std::memory_order_acquire)){
+		return;
+	}
+	ArrowBatch batch;
+	batch.offset=static_cast<std::int64_t>(file_offset_+buffer_.size());
+	batch.metadata_length=arrow::encapsulated_metadata_length(message);
+	batch.body_length=static_cast<std::int64_t>(message.size())-
+					  batch.metadata_length;
+	arrow_batches_.push_back(batch);
+	buffer_.append(message);
+	if(buffer_.size()>=buffer_threshold_){
+		flush_buffer();
+	}
+}
+
+void PrimeWriter::write_arrow_footer(){
+	std::vector<arrow::BlockInfo> blocks;
+	blocks.reserve(arrow_batches_.size());
+	for(const ArrowBatch&batch : arrow_batches_){
+		arrow::BlockInfo block;
+		block.offset=batch.offset;
+		block.metadata_length=batch.metadata_length;
+		block.body_length=batch.body_length;
+		blocks.push_back(block);
+	}
+	buffer_.append(arrow::encode_file_tail(
+		arrow::SchemaInfo{range_set_,range_from_,range_to_},blocks));
 }
 
 void PrimeWriter::write_parquet_footer(){
 	if(parquet_footer_written_||io_error_.load(std::memory_order_acquire)){
 		return;
 	}
+	close_parquet_row_group();
 	std::vector<parquet::RowGroupMetadata> metadata;
 	metadata.reserve(parquet_row_groups_.size());
+	std::vector<std::vector<parquet::PageMetadata>> pages;
+	pages.reserve(parquet_row_groups_.size());
 	for(const ParquetRowGroup&row_group : parquet_row_groups_){
-		metadata.push_back(parquet::RowGroupMetadata{
-			row_group.data_page_offset,row_group.num_values,
-			row_group.total_uncompressed_size,row_group.total_compressed_size});
+		parquet::RowGroupMetadata entry;
+		entry.data_page_offset=row_group.data_page_offset;
+		entry.num_values=row_group.num_values;
+		entry.total_uncompressed_size=row_group.total_uncompressed_size;
+		entry.total_compressed_size=row_group.total_compressed_size;
+		entry.min_value=row_group.min_value;
+		entry.max_value=row_group.max_value;
+		metadata.push_back(entry);
+		std::vector<parquet::PageMetadata> group_pages;
+		group_pages.reserve(row_group.pages.size());
+		for(const ParquetPage&page : row_group.pages){
+			group_pages.push_back(parquet::PageMetadata{
+				page.offset,page.compressed_page_size,page.first_row_index,
+				page.num_values,page.min_value,page.max_value});
+		}
+		pages.push_back(std::move(group_pages));
+	}
+
+	// The page index lives between the last data page and the footer: all
+	// ColumnIndex structures first, then all OffsetIndex structures.
+	for(std::size_t i=0;i<metadata.size();++i){
+		std::string column_index=parquet::make_column_index(pages[i]);
+		metadata[i].column_index_offset=static_cast<std::int64_t>(file_offset_);
+		metadata[i].column_index_length=
+			static_cast<std::int32_t>(column_index.size());
+		write_file_bytes(column_index.data(),column_index.size());
+	}
+	for(std::size_t i=0;i<metadata.size();++i){
+		std::string offset_index=parquet::make_offset_index(pages[i]);
+		metadata[i].offset_index_offset=static_cast<std::int64_t>(file_offset_);
+		metadata[i].offset_index_length=
+			static_cast<std::int32_t>(offset_index.size());
+		write_file_bytes(offset_index.data(),offset_index.size());
+	}
+	if(io_error_.load(std::memory_order_acquire)){
+		return;
 	}
 	std::string footer=parquet::make_file_metadata(
 		metadata,static_cast<std::int64_t>(parquet_num_rows_),use_zstd_,
@@ -666,7 +1705,7 @@ void PrimeWriter::write_parquet_footer(){
 
 #if defined(CALCPRIME_HAS_ZSTD)
 void PrimeWriter::flush_zstd_stream(bool final_frame){
-	if(!use_zstd_){
+	if(!stream_zstd_){
 		return;
 	}
 	if(!zstd_cctx_){
@@ -698,4 +1737,28 @@ void PrimeWriter::flush_zstd_stream(bool final_frame){
 }
 #endif
 
+FileIoStats&FileIoStats::operator+=(const FileIoStats&other){
+	if(other.backend==FileIoBackend::IoUring){
+		backend=FileIoBackend::IoUring;
+		direct=direct||other.direct;
+		queue_depth=std::max(queue_depth,other.queue_depth);
+	}
+	if(other.backend!=FileIoBackend::Stdio&&backend==FileIoBackend::Stdio){
+		backend=other.backend;
+	}
+	bytes+=other.bytes;
+	waits+=other.waits;
+	submissions+=other.submissions;
+	in_flight_total+=other.in_flight_total;
+	return *this;
+}
+
+double FileIoStats::queue_utilization() const{
+	if(submissions==0||queue_depth==0){
+		return 0.0;
+	}
+	return static_cast<double>(in_flight_total)/
+		   (static_cast<double>(submissions)*queue_depth);
+}
+
 } // namespace calcprime
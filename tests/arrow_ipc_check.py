@@ -0,0 +1,63 @@
+"""Read --out-format arrow output with PyArrow and compare it to the binary export.
+
+usage: arrow_ipc_check.py CALCPRIMELIST WORKDIR [zstd|lz4]...
+"""
+
+import os
+import subprocess
+import sys
+
+import pyarrow as pa
+import pyarrow.ipc as ipc
+
+RANGE_FROM = 1000
+RANGE_TO = 20000000
+
+
+def export(calcprimelist, path, fmt, extra):
+    subprocess.run([calcprimelist, "--from", str(RANGE_FROM), "--to", str(RANGE_TO),
+                    "--segment", "65536", "--print", "--out", path,
+                    "--out-format", fmt] + extra, check=True)
+
+
+def check(calcprimelist, workdir, codec, expected):
+    name = codec or "plain"
+    path = os.path.join(workdir, f"ctest-primes-{name}.arrow")
+    export(calcprimelist, path, "arrow", [f"--{codec}"] if codec else [])
+
+    reader = ipc.open_file(pa.memory_map(path))
+    field = reader.schema.field("prime")
+    if field.type != pa.uint64() or field.nullable:
+        sys.exit(f"{name}: unexpected field {field}")
+    metadata = reader.schema.metadata or {}
+    if (metadata.get(b"calcprime.from") != str(RANGE_FROM).encode() or
+            metadata.get(b"calcprime.to") != str(RANGE_TO).encode()):
+        sys.exit(f"{name}: unexpected schema metadata {metadata}")
+    if reader.num_record_batches < 2:
+        sys.exit(f"{name}: expected several record batches")
+
+    table = reader.read_all()
+    table.validate(full=True)
+    decoded = b"".join(chunk.buffers()[1].to_pybytes()[:len(chunk) * 8]
+                       for chunk in table.column("prime").chunks)
+    if decoded != expected:
+        sys.exit(f"{name}: {table.num_rows} rows differ from the binary export")
+    print(f"{name}: {table.num_rows} rows in {reader.num_record_batches} batches")
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    calcprimelist, workdir = sys.argv[1], sys.argv[2]
+    binary_path = os.path.join(workdir, "ctest-primes-arrow.binary")
+    export(calcprimelist, binary_path, "binary", [])
+    with open(binary_path, "rb") as handle:
+        expected = handle.read()
+    if sys.byteorder != "little":
+        sys.exit("the binary export is little-endian only")
+    for codec in [None] + sys.argv[3:]:
+        check(calcprimelist, workdir, codec, expected)
+
+
+if __name__ == "__main__":
+    main()
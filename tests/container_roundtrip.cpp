@@ -0,0 +1,131 @@
+// Decodes a `container` export block by block on several threads and
+// compares it with a `binary` export of the same range.  Also checks that a
+// flipped payload byte is caught by the block checksum.
+//
+//   container_roundtrip FILE.container FILE.bin
+
+#include "container_format.h"
+
+#include<algorithm>
+#include<atomic>
+#include<cstdint>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<vector>
+
+namespace{
+
+std::vector<std::uint8_t> read_file(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	return std::vector<std::uint8_t>((std::istreambuf_iterator<char>(in)),
+									 std::istreambuf_iterator<char>());
+}
+
+void expect(bool condition,const std::string&what){
+	if(!condition){
+		throw std::runtime_error(what);
+	}
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	using namespace calcprime;
+	if(argc!=3){
+		std::cerr<<"usage: container_roundtrip FILE.container FILE.bin\n";
+		return 2;
+	}
+	try{
+		expect(container::crc32c("123456789",9)==0xE3069283U,
+			   "CRC-32C check value mismatch");
+
+		std::vector<std::uint8_t> file=read_file(argv[1]);
+		std::vector<std::uint8_t> binary=read_file(argv[2]);
+		std::vector<std::uint64_t> expected(binary.size()/8U);
+		for(std::size_t i=0;i<expected.size();++i){
+			std::uint64_t value=0;
+			for(int b=7;b>=0;--b){
+				value=(value<<8)|binary[i*8U+static_cast<std::size_t>(b)];
+			}
+			expected[i]=value;
+		}
+
+		container::FileHeader header=
+			container::decode_file_header(file.data(),file.size());
+		container::Footer footer=
+			container::decode_footer(file.data(),file.size());
+		std::vector<container::IndexEntry> index=
+			container::decode_index(file.data(),file.size(),footer);
+		expect(footer.prime_count==expected.size(),"prime count mismatch");
+		expect((header.flags&container::kFlagRangeKnown)!=0,
+			   "range flag missing");
+
+		std::vector<std::uint64_t> starts(index.size()+1U,0);
+		for(std::size_t b=0;b<index.size();++b){
+			starts[b+1U]=starts[b]+index[b].count;
+		}
+		std::vector<std::uint64_t> decoded(expected.size());
+		std::atomic<std::size_t> next{0};
+		std::atomic<bool> failed{false};
+		std::string failure;
+		auto worker=[&]{
+			for(std::size_t b=next++;b<index.size();b=next++){
+				try{
+					const std::uint8_t*block=file.data()+index[b].offset;
+					container::BlockHeader block_header=
+						container::read_block_header(block,index[b].block_bytes);
+					expect(block_header.first_prime==index[b].first_prime&&
+							   block_header.count==index[b].count,
+						   "index does not match block header");
+					container::decode_block(
+						block_header,block,block+container::kBlockHeaderBytes,
+						decoded.data()+starts[b]);
+				}catch(const std::exception&ex){
+					if(!failed.exchange(true)){
+						failure=ex.what();
+					}
+				}
+			}
+		};
+		unsigned threads=std::clamp(std::thread::hardware_concurrency(),1u,8u);
+		std::vector<std::thread> pool;
+		for(unsigned t=0;t<threads;++t){
+			pool.emplace_back(worker);
+		}
+		for(std::thread&thread : pool){
+			thread.join();
+		}
+		expect(!failed,failure);
+		expect(decoded==expected,"decoded primes differ from binary export");
+
+		if(!index.empty()){
+			std::uint8_t*block=file.data()+index[0].offset;
+			container::BlockHeader block_header=
+				container::read_block_header(block,index[0].block_bytes);
+			block[container::kBlockHeaderBytes+block_header.stored_bytes/2U]^=0x10U;
+			bool detected=false;
+			try{
+				container::decode_block(block_header,block,
+										block+container::kBlockHeaderBytes,
+										decoded.data());
+			}catch(const std::runtime_error&){
+				detected=true;
+			}
+			expect(detected,"corrupted block was not detected");
+		}
+		std::cout<<expected.size()<<" primes in "<<index.size()
+				 <<" blocks decoded and verified\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"Error: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}
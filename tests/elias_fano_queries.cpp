@@ -0,0 +1,130 @@
+// Checks EliasFanoReader::select, rank and iteration against a `binary`
+// export of the same range, plus the broadword select against a bit loop.
+//
+//   elias_fano_queries FILE.ef FILE.bin
+
+#include "elias_fano_format.h"
+#include "elias_fano_reader.h"
+
+#include<algorithm>
+#include<cstdint>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<random>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+namespace{
+
+std::vector<std::uint64_t> read_binary(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)),
+									 std::istreambuf_iterator<char>());
+	std::vector<std::uint64_t> values(bytes.size()/8U);
+	for(std::size_t i=0;i<values.size();++i){
+		std::uint64_t value=0;
+		for(int b=7;b>=0;--b){
+			value=(value<<8)|bytes[i*8U+static_cast<std::size_t>(b)];
+		}
+		values[i]=value;
+	}
+	return values;
+}
+
+void expect(bool condition,const std::string&what){
+	if(!condition){
+		throw std::runtime_error(what);
+	}
+}
+
+void check_select_in_word(){
+	std::mt19937_64 rng(12345);
+	for(int round=0;round<20000;++round){
+		std::uint64_t word=rng();
+		if(round%3==1){
+			word&=rng();
+		}else if(round%3==2){
+			word|=rng()|rng();
+		}
+		if(word==0){
+			continue;
+		}
+		unsigned k=0;
+		for(unsigned bit=0;bit<64;++bit){
+			if((word>>bit)&1U){
+				expect(calcprime::ef::select_in_word(word,k)==bit,
+					   "select_in_word mismatch");
+				++k;
+			}
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	if(argc!=3){
+		std::cerr<<"usage: elias_fano_queries FILE.ef FILE.bin\n";
+		return 2;
+	}
+	try{
+		check_select_in_word();
+		calcprime::EliasFanoReader reader(argv[1]);
+		std::vector<std::uint64_t> primes=read_binary(argv[2]);
+		expect(reader.size()==primes.size(),"size mismatch");
+
+		std::size_t k=0;
+		for(std::uint64_t value : reader){
+			expect(k<primes.size()&&value==primes[k],
+				   "iteration mismatch at "+std::to_string(k));
+			++k;
+		}
+		expect(k==primes.size(),"iteration stopped early");
+
+		for(std::size_t i=0;i<primes.size();++i){
+			expect(reader.select(i)==primes[i],
+				   "select mismatch at "+std::to_string(i));
+			expect(reader.rank(primes[i])==i&&reader.rank(primes[i]+1U)==i+1U,
+				   "rank mismatch at "+std::to_string(primes[i]));
+		}
+		auto below=[&](std::uint64_t x){
+			return static_cast<std::uint64_t>(
+				std::lower_bound(primes.begin(),primes.end(),x)-primes.begin());
+		};
+		std::mt19937_64 rng(7);
+		std::uint64_t span=reader.to()-reader.from()+2000U;
+		for(int i=0;i<200000;++i){
+			std::uint64_t x=reader.from()+rng()%span-1000U;
+			expect(reader.rank(x)==below(x),"rank mismatch at "+std::to_string(x));
+		}
+		expect(reader.rank(0)==0&&reader.rank(~0ULL)==primes.size(),
+			   "rank bounds mismatch");
+
+		for(std::uint64_t start=0;start<primes.size();start+=4093U){
+			auto it=reader.iterator_at(start);
+			for(std::uint64_t j=start;j<std::min<std::uint64_t>(start+5000U,primes.size());
+				++j,++it){
+				expect(it!=reader.end()&&*it==primes[j],
+					   "iterator_at mismatch at "+std::to_string(j));
+			}
+		}
+		bool threw=false;
+		try{
+			reader.select(primes.size());
+		}catch(const std::out_of_range&){
+			threw=true;
+		}
+		expect(threw,"select past the end must throw");
+		std::cout<<primes.size()<<" primes, select/rank/iteration match\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"Error: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}
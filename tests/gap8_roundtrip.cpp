@@ -0,0 +1,89 @@
+// Decodes a gap8 file block by block with both the dispatched (AVX2) and the
+// scalar decoder and compares the result with a `binary` export of the same
+// range.
+//
+//   gap8_roundtrip FILE.gap8 FILE.bin
+
+#include "gap8_format.h"
+
+#include<cstdint>
+#include<cstdio>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<stdexcept>
+#include<vector>
+
+namespace{
+
+std::vector<std::uint8_t> read_file(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in),
+									 std::istreambuf_iterator<char>());
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	if(argc!=3){
+		std::cerr<<"usage: gap8_roundtrip FILE.gap8 FILE.bin\n";
+		return 2;
+	}
+	try{
+		std::vector<std::uint8_t> gap8=read_file(argv[1]);
+		std::vector<std::uint8_t> binary=read_file(argv[2]);
+		std::vector<std::uint64_t> expected(binary.size()/8U);
+		for(std::size_t i=0;i<expected.size();++i){
+			std::uint64_t value=0;
+			for(int b=7;b>=0;--b){
+				value=(value<<8)|binary[i*8U+static_cast<std::size_t>(b)];
+			}
+			expected[i]=value;
+		}
+
+		std::uint32_t interval=
+			calcprime::gap8::parse_file_header(gap8.data(),gap8.size());
+		std::size_t pos=calcprime::gap8::kFileHeaderBytes;
+		std::size_t index=0;
+		std::size_t blocks=0;
+		std::vector<std::uint64_t> fast;
+		std::vector<std::uint64_t> scalar;
+		while(pos<gap8.size()){
+			calcprime::gap8::BlockHeader header=
+				calcprime::gap8::read_block_header(gap8.data()+pos,
+												   gap8.size()-pos);
+			pos+=calcprime::gap8::kBlockHeaderBytes;
+			if(header.count>interval||header.payload_bytes>gap8.size()-pos){
+				throw std::runtime_error("block exceeds restart interval or file");
+			}
+			fast.assign(header.count,0);
+			scalar.assign(header.count,0);
+			calcprime::gap8::decode_block(header,gap8.data()+pos,fast.data());
+			calcprime::gap8::decode_block_scalar(header,gap8.data()+pos,
+												 scalar.data());
+			if(fast!=scalar){
+				throw std::runtime_error("SIMD and scalar decoders disagree");
+			}
+			for(std::uint64_t value : fast){
+				if(index>=expected.size()||expected[index]!=value){
+					throw std::runtime_error("decoded prime does not match");
+				}
+				++index;
+			}
+			pos+=header.payload_bytes;
+			++blocks;
+		}
+		if(index!=expected.size()){
+			throw std::runtime_error("decoded prime count does not match");
+		}
+		std::cout<<index<<" primes in "<<blocks<<" blocks match\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"Error: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+// Sieves windows of about 2^21 numbers just below 2^64, where the next hit
+// of most sieving primes lies past 2^64, with sieving primes up to 2^16
+// only (all of 2^32 would take minutes in an unoptimized build).  Counts
+// the survivors once in order with one thread state and once split over
+// two states that take alternate super-segments, and checks both against
+// counts made independently by sieving the windows in Python.
+//
+// Segments of 1 KiB, so primes above 2^14 are bucketed and the
+// super-segment skipping path is exercised as well.  Neither window is a
+// whole number of tiles, and the first ends at UINT64_MAX, so the last
+// tile reaches past 2^64.
+
+#include "base_sieve.h"
+#include "marker.h"
+#include "segmenter.h"
+#include "wheel.h"
+
+#include<cstdint>
+#include<exception>
+#include<iostream>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+namespace{
+
+struct Window{
+	std::uint64_t begin;
+	std::uint64_t end;
+	// Odd numbers in [begin, end) without a prime factor up to 2^16.
+	std::uint64_t expected;
+};
+
+constexpr Window kWindows[]={
+	{18446744073707455463ULL,18446744073709551615ULL,105951},
+	{18446744073707454849ULL,18446744073709551001ULL,105956},
+};
+
+calcprime::SegmentConfig make_config(){
+	calcprime::SegmentConfig config{};
+	config.segment_bytes=1024;
+	config.tile_bytes=256;
+	config.segment_bits=config.segment_bytes*8;
+	config.tile_bits=config.tile_bytes*8;
+	config.segment_span=config.segment_bits*2ULL;
+	config.tile_span=config.tile_bits*2ULL;
+	config.super_segment_segments=4;
+	return config;
+}
+
+void expect_count(const Window&window,std::uint64_t count,
+				  const std::string&what){
+	if(count!=window.expected){
+		throw std::runtime_error(
+			"["+std::to_string(window.begin)+", "+std::to_string(window.end)+
+			") "+what+": "+std::to_string(count)+", expected "+
+			std::to_string(window.expected));
+	}
+}
+
+void check_window(const Window&window,
+				  const std::vector<std::uint32_t>&primes){
+	calcprime::SegmentConfig config=make_config();
+	calcprime::PrimeMarker marker(
+		calcprime::get_wheel(calcprime::WheelType::Mod30),config,window.begin,
+		window.end,primes);
+	calcprime::SegmentWorkQueue queue(
+		calcprime::SieveRange{window.begin,window.end},config);
+
+	auto sieve=[&](calcprime::PrimeMarker::ThreadState&state,
+				   std::uint64_t segment_id){
+		std::uint64_t low=0;
+		std::uint64_t high=0;
+		if(!queue.segment_bounds(segment_id,low,high)){
+			throw std::runtime_error("segment out of range");
+		}
+		return marker.sieve_segment_count(state,segment_id,low,high);
+	};
+
+	auto state=marker.make_thread_state(0,1);
+	std::uint64_t count=0;
+	for(std::uint64_t id=0;id<queue.total_segments();++id){
+		count+=sieve(state,id);
+	}
+	expect_count(window,count,"one thread");
+
+	auto even=marker.make_thread_state(0,2);
+	auto odd=marker.make_thread_state(1,2);
+	count=0;
+	for(std::uint64_t id=0;id<queue.total_segments();++id){
+		bool first=(id/config.super_segment_segments)%2==0;
+		count+=sieve(first?even:odd,id);
+	}
+	expect_count(window,count,"alternate super-segments");
+}
+
+} // namespace
+
+int main(){
+	try{
+		std::vector<std::uint32_t> primes=calcprime::simple_sieve(1U<<16);
+		for(const Window&window : kWindows){
+			check_window(window,primes);
+		}
+	}catch(const std::exception&ex){
+		std::cerr<<"marker_high_range: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,96 @@
+// Writes a DELTA_BINARY_PACKED Parquet file whose miniblocks cover every bit
+// width from 0 to 40, plus the same values as little-endian uint64 so that
+// parquet_delta_roundtrip.py can compare what PyArrow decodes.
+//
+//   parquet_delta_roundtrip OUTPUT.parquet EXPECTED.bin BLOCK_VALUES
+
+#include "writer.h"
+
+#include<cstdint>
+#include<cstdio>
+#include<exception>
+#include<iostream>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+namespace{
+
+constexpr unsigned kMaxWidth=40;
+constexpr std::size_t kMiniBlockValues=32;
+
+// Appends one miniblock of deltas 1+r with r spanning exactly `width` bits.
+// Each miniblock contains a delta of 1, so the block minimum is always 1 and
+// the encoded bit width is `width`.
+void append_miniblock(std::vector<std::uint64_t>&values,unsigned width,
+					  std::uint64_t&state){
+	std::uint64_t mask=(width==0)?0:((std::uint64_t{1}<<width)-1U);
+	for(std::size_t i=0;i<kMiniBlockValues;++i){
+		state=state*6364136223846793005ULL+1442695040888963407ULL;
+		std::uint64_t r=(state>>17)&mask;
+		if(i==0){
+			r=0;
+		}else if(i==kMiniBlockValues-1U){
+			r=mask;
+		}
+		values.push_back(values.back()+1U+r);
+	}
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	if(argc!=4){
+		std::cerr<<"usage: parquet_delta_roundtrip OUTPUT.parquet EXPECTED.bin "
+				   "BLOCK_VALUES\n";
+		return 2;
+	}
+	try{
+		std::size_t block_values=std::stoul(argv[3]);
+		std::size_t minis_per_block=block_values/kMiniBlockValues;
+		std::vector<std::uint64_t> values{1};
+		std::uint64_t state=0x853c49e6748fea9bULL;
+
+		// Uniform blocks exercise the 16-bit delta path up to width 15 and
+		// the 64-bit path beyond it.
+		for(unsigned width=0;width<=kMaxWidth;++width){
+			for(std::size_t mini=0;mini<minis_per_block;++mini){
+				append_miniblock(values,width,state);
+			}
+		}
+		// Mixed blocks put narrow miniblocks next to wide ones so that the
+		// 64-bit path also packs widths 1..16.
+		static const unsigned kMixed[]={3,40,1,9,16,24,0,12,33,7,2,15};
+		for(unsigned width : kMixed){
+			append_miniblock(values,width,state);
+		}
+		// Finish with a partial miniblock.
+		std::size_t keep=values.size()-13U;
+		values.resize(keep);
+
+		calcprime::PrimeWriterOptions options;
+		options.format=calcprime::PrimeOutputFormat::Parquet;
+		options.parquet_encoding=calcprime::ParquetEncoding::DeltaBinaryPacked;
+		options.parquet_delta_block_values=block_values;
+		calcprime::PrimeWriter writer(true,argv[1],options);
+		writer.write_segment(values);
+		writer.finish();
+
+		std::FILE*expected=std::fopen(argv[2],"wb");
+		if(!expected){
+			throw std::runtime_error("cannot open expected output");
+		}
+		for(std::uint64_t value : values){
+			unsigned char bytes[8];
+			for(int i=0;i<8;++i){
+				bytes[i]=static_cast<unsigned char>(value>>(8*i));
+			}
+			std::fwrite(bytes,1,sizeof(bytes),expected);
+		}
+		std::fclose(expected);
+	}catch(const std::exception&ex){
+		std::cerr<<"Error: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+"""Decode DELTA_BINARY_PACKED output with PyArrow and compare every value.
+
+usage: parquet_delta_roundtrip.py GENERATOR WORKDIR
+"""
+
+import array
+import os
+import subprocess
+import sys
+
+import pyarrow.parquet as pq
+
+
+def check(generator, workdir, block_values):
+    parquet_path = os.path.join(workdir, f"ctest-delta-widths-{block_values}.parquet")
+    expected_path = parquet_path + ".bin"
+    subprocess.run([generator, parquet_path, expected_path, str(block_values)],
+                   check=True)
+
+    expected = array.array("Q")
+    with open(expected_path, "rb") as handle:
+        expected.frombytes(handle.read())
+    if sys.byteorder != "little":
+        expected.byteswap()
+
+    decoded = pq.read_table(parquet_path).column("prime").to_pylist()
+    if len(decoded) != len(expected):
+        sys.exit(f"block {block_values}: {len(decoded)} rows, expected {len(expected)}")
+    for index, (got, want) in enumerate(zip(decoded, expected)):
+        if got != want:
+            sys.exit(f"block {block_values}: row {index} is {got}, expected {want}")
+    print(f"block {block_values}: {len(decoded)} values round-tripped")
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    for block_values in (128, 256):
+        check(sys.argv[1], sys.argv[2], block_values)
+
+
+if __name__ == "__main__":
+    main()
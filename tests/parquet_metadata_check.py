@@ -0,0 +1,80 @@
+"""Check the row group statistics, sorting columns and page index of a
+multi-row-group --out-format parquet export with PyArrow.
+
+usage: parquet_metadata_check.py CALCPRIMELIST WORKDIR [zstd]
+"""
+
+import os
+import subprocess
+import sys
+
+import pyarrow.parquet as pq
+
+RANGE_TO = 5000000
+
+
+def check(calcprimelist, workdir, encoding, extra):
+    name = "-".join([encoding] + [flag.lstrip("-") for flag in extra])
+    path = os.path.join(workdir, f"ctest-primes-metadata-{name}.parquet")
+    subprocess.run([calcprimelist, "--to", str(RANGE_TO), "--print", "--out", path,
+                    "--out-format", "parquet", "--parquet-encoding", encoding,
+                    "--parquet-row-group-bytes", "64K", "--encode-threads", "2"] + extra,
+                   check=True)
+
+    parquet_file = pq.ParquetFile(path)
+    metadata = parquet_file.metadata
+    if metadata.num_row_groups < 2:
+        sys.exit(f"{name}: expected several row groups, got {metadata.num_row_groups}")
+
+    previous_max = None
+    for index in range(metadata.num_row_groups):
+        row_group = metadata.row_group(index)
+        column = row_group.column(0)
+        values = parquet_file.read_row_group(index).column("prime").to_pylist()
+        if len(values) != row_group.num_rows:
+            sys.exit(f"{name}: row group {index} has {len(values)} values, "
+                     f"expected {row_group.num_rows}")
+
+        statistics = column.statistics
+        if statistics is None or not statistics.has_min_max:
+            sys.exit(f"{name}: row group {index} has no min/max statistics")
+        if statistics.min != values[0] or statistics.max != values[-1]:
+            sys.exit(f"{name}: row group {index} statistics "
+                     f"[{statistics.min}, {statistics.max}], "
+                     f"values [{values[0]}, {values[-1]}]")
+        if previous_max is not None and statistics.min <= previous_max:
+            sys.exit(f"{name}: row group {index} overlaps the previous one")
+        previous_max = statistics.max
+
+        sorting = row_group.sorting_columns
+        if (len(sorting) != 1 or sorting[0].column_index != 0 or
+                sorting[0].descending):
+            sys.exit(f"{name}: row group {index} sorting columns {sorting}")
+
+        if not column.has_column_index or not column.has_offset_index:
+            sys.exit(f"{name}: row group {index} lacks a page index")
+
+    # Row group and page pruning must not drop any matching value.
+    low, high = 1000003, 4000037
+    selected = pq.read_table(path, filters=[("prime", ">=", low),
+                                            ("prime", "<=", high)])
+    expected = [value for value in pq.read_table(path).column("prime").to_pylist()
+                if low <= value <= high]
+    if selected.column("prime").to_pylist() != expected:
+        sys.exit(f"{name}: filtered read returned {selected.num_rows} rows, "
+                 f"expected {len(expected)}")
+    print(f"{name}: {metadata.num_row_groups} row groups checked")
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    calcprimelist, workdir = sys.argv[1], sys.argv[2]
+    for encoding in ("plain", "delta"):
+        check(calcprimelist, workdir, encoding, [])
+        if "zstd" in sys.argv[3:]:
+            check(calcprimelist, workdir, encoding, ["--zstd"])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+// Reads an export of any format through PrimeReader and through the C
+// reader API and compares both with a `binary` export of the same range:
+// full iteration, single-threaded iteration and seeks to several points.
+//
+//   prime_reader_check FILE.FORMAT FILE.bin
+
+#include "calcprime/reader.h"
+#include "prime_reader.h"
+
+#include<algorithm>
+#include<cstdint>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+namespace{
+
+std::vector<std::uint64_t> read_binary(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+									std::istreambuf_iterator<char>());
+	std::vector<std::uint64_t> values(bytes.size()/8U);
+	for(std::size_t i=0;i<values.size();++i){
+		std::uint64_t value=0;
+		for(int b=7;b>=0;--b){
+			value=(value<<8)|bytes[i*8U+static_cast<std::size_t>(b)];
+		}
+		values[i]=value;
+	}
+	return values;
+}
+
+void expect(bool condition,const std::string&what){
+	if(!condition){
+		throw std::runtime_error(what);
+	}
+}
+
+std::vector<std::uint64_t> drain(calcprime::PrimeReader&reader){
+	std::vector<std::uint64_t> all;
+	std::vector<std::uint64_t> block;
+	while(reader.next_block(block)){
+		expect(!block.empty(),"empty block before the end");
+		all.insert(all.end(),block.begin(),block.end());
+	}
+	return all;
+}
+
+void check_c_api(const char*path,const std::vector<std::uint64_t>&expected){
+	calcprime_reader_options options;
+	expect(calcprime_reader_options_init(&options)==0,"options init failed");
+	calcprime_reader*reader=nullptr;
+	calcprime_status status=calcprime_reader_open(path,&options,&reader);
+	expect(reader!=nullptr,"calcprime_reader_open returned no reader");
+	if(status!=CALCPRIME_STATUS_SUCCESS){
+		std::string message=calcprime_reader_error_message(reader);
+		calcprime_reader_close(reader);
+		throw std::runtime_error("C API open failed: "+message);
+	}
+	std::vector<std::uint64_t> all;
+	for(;;){
+		const std::uint64_t*primes=nullptr;
+		std::size_t count=0;
+		status=calcprime_reader_next_block(reader,&primes,&count);
+		if(status!=CALCPRIME_STATUS_SUCCESS||count==0){
+			break;
+		}
+		all.insert(all.end(),primes,primes+count);
+	}
+	bool seek_ok=false;
+	if(status==CALCPRIME_STATUS_SUCCESS&&!expected.empty()){
+		std::uint64_t target=expected[expected.size()/2U];
+		const std::uint64_t*primes=nullptr;
+		std::size_t count=0;
+		seek_ok=calcprime_reader_seek(reader,target)==
+					CALCPRIME_STATUS_SUCCESS&&
+				calcprime_reader_next_block(reader,&primes,&count)==
+					CALCPRIME_STATUS_SUCCESS&&
+				count!=0&&primes[0]==target;
+	}else{
+		seek_ok=status==CALCPRIME_STATUS_SUCCESS;
+	}
+	calcprime_reader_close(reader);
+	expect(status==CALCPRIME_STATUS_SUCCESS,"C API decode failed");
+	expect(all==expected,"C API iteration mismatch");
+	expect(seek_ok,"C API seek mismatch");
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	using namespace calcprime;
+	if(argc!=3){
+		std::cerr<<"usage: prime_reader_check FILE.FORMAT FILE.bin\n";
+		return 2;
+	}
+	try{
+		std::vector<std::uint64_t> expected=read_binary(argv[2]);
+
+		PrimeReader reader(argv[1]);
+		expect(drain(reader)==expected,"iteration mismatch");
+
+		PrimeReader single(argv[1],reader.format(),1);
+		expect(drain(single)==expected,"single-threaded iteration mismatch");
+
+		// Seek to the first prime, primes in the middle, a composite between
+		// two primes and past the end; then back to the start.
+		std::vector<std::uint64_t> targets;
+		if(!expected.empty()){
+			targets.push_back(expected.front());
+			targets.push_back(expected[expected.size()/3U]);
+			targets.push_back(expected[expected.size()/2U]+1U);
+			targets.push_back(expected.back());
+			targets.push_back(expected.back()+1U);
+		}
+		targets.push_back(0);
+		for(std::uint64_t target:targets){
+			reader.seek(target);
+			std::vector<std::uint64_t> rest=drain(reader);
+			auto first=std::lower_bound(expected.begin(),expected.end(),target);
+			expect(std::equal(rest.begin(),rest.end(),first,expected.end()),
+				   "seek to "+std::to_string(target)+" mismatch");
+		}
+
+		check_c_api(argv[1],expected);
+		std::cout<<"prime_reader round trip ok: "<<expected.size()
+				 <<" primes, format "<<static_cast<int>(reader.format())
+				 <<(reader.zstd_stream()?" (zstd stream)":"")<<", "
+				 <<reader.threads()<<" threads\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"prime_reader_check: "<<ex.what()<<'\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,140 @@
+// Attaches CONSUMERS readers to the shared-memory ring NAME of a running
+// `--out shm:NAME` export, puts their blocks back in sequence order and
+// compares the result with a `binary` export of the same range.
+//
+//   shm_ring_check NAME FILE.bin CONSUMERS
+
+#include "calcprime/reader.h"
+
+#include<algorithm>
+#include<cstdint>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<stdexcept>
+#include<string>
+#include<thread>
+#include<utility>
+#include<vector>
+
+namespace{
+
+struct Block{
+	std::uint64_t sequence=0;
+	std::vector<std::uint64_t> primes;
+};
+
+std::vector<std::uint64_t> read_binary(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)),
+									std::istreambuf_iterator<char>());
+	std::vector<std::uint64_t> values(bytes.size()/8U);
+	for(std::size_t i=0;i<values.size();++i){
+		std::uint64_t value=0;
+		for(int b=7;b>=0;--b){
+			value=(value<<8)|bytes[i*8U+static_cast<std::size_t>(b)];
+		}
+		values[i]=value;
+	}
+	return values;
+}
+
+std::vector<Block> consume(const char*name){
+	calcprime_shm_reader*reader=nullptr;
+	calcprime_status status=calcprime_shm_reader_open(name,30000,&reader);
+	if(status!=CALCPRIME_STATUS_SUCCESS){
+		std::string message=calcprime_shm_reader_error_message(reader);
+		calcprime_shm_reader_close(reader);
+		throw std::runtime_error("open failed: "+message);
+	}
+	std::vector<Block> blocks;
+	for(;;){
+		const std::uint64_t*primes=nullptr;
+		std::size_t count=0;
+		std::uint64_t sequence=0;
+		status=calcprime_shm_reader_next_block(reader,&primes,&count,
+											   &sequence);
+		if(status!=CALCPRIME_STATUS_SUCCESS||count==0){
+			break;
+		}
+		blocks.push_back({sequence,std::vector<std::uint64_t>(
+									   primes,primes+count)});
+	}
+	std::string message;
+	if(status!=CALCPRIME_STATUS_SUCCESS){
+		message=calcprime_shm_reader_error_message(reader);
+	}
+	calcprime_shm_reader_close(reader);
+	if(!message.empty()){
+		throw std::runtime_error("read failed: "+message);
+	}
+	return blocks;
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	if(argc!=4){
+		std::cerr<<"usage: shm_ring_check NAME FILE.bin CONSUMERS\n";
+		return 2;
+	}
+	try{
+		unsigned consumers=static_cast<unsigned>(std::stoul(argv[3]));
+		if(consumers==0){
+			throw std::invalid_argument("CONSUMERS must be positive");
+		}
+		std::vector<std::vector<Block>> results(consumers);
+		std::vector<std::exception_ptr> errors(consumers);
+		std::vector<std::thread> threads;
+		for(unsigned i=0;i<consumers;++i){
+			threads.emplace_back([&,i]{
+				try{
+					results[i]=consume(argv[1]);
+				}catch(...){
+					errors[i]=std::current_exception();
+				}
+			});
+		}
+		for(std::thread&thread : threads){
+			thread.join();
+		}
+		for(const std::exception_ptr&error : errors){
+			if(error){
+				std::rethrow_exception(error);
+			}
+		}
+
+		std::vector<Block> blocks;
+		std::string split;
+		for(std::vector<Block>&result : results){
+			split+=(split.empty()?"":"/")+std::to_string(result.size());
+			std::move(result.begin(),result.end(),std::back_inserter(blocks));
+		}
+		std::sort(blocks.begin(),blocks.end(),
+				  [](const Block&a,const Block&b){
+					  return a.sequence<b.sequence;
+				  });
+		std::vector<std::uint64_t> all;
+		for(std::size_t i=0;i<blocks.size();++i){
+			if(blocks[i].sequence!=i){
+				throw std::runtime_error("block "+std::to_string(i)+
+										 " missing or repeated");
+			}
+			all.insert(all.end(),blocks[i].primes.begin(),
+					   blocks[i].primes.end());
+		}
+		if(all!=read_binary(argv[2])){
+			throw std::runtime_error("primes differ from the binary export");
+		}
+		std::cout<<"shm ring ok: "<<all.size()<<" primes in "<<blocks.size()
+				 <<" blocks, per consumer "<<split<<"\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"shm_ring_check: "<<ex.what()<<'\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,73 @@
+"""Copy standard input to OUTPUT, holding on to the pages like a splice(2)
+consumer would.
+
+The input is moved with splice(2) into a chain of pipes and only read once
+standard input ends or every pipe is full, so the pages written into the
+input pipe stay referenced long after the writer has moved on.  A writer
+that reuses pages it gave to the pipe shows up as corrupted output.
+
+usage: splice_hold_reader.py OUTPUT [PIPES]
+"""
+
+import fcntl
+import os
+import select
+import sys
+
+F_SETPIPE_SZ = 1031
+PIPE_BYTES = 1 << 20
+
+
+def make_holding_pipe():
+    read_end, write_end = os.pipe()
+    try:
+        fcntl.fcntl(write_end, F_SETPIPE_SZ, PIPE_BYTES)
+    except OSError:
+        pass
+    os.set_blocking(write_end, False)
+    return read_end, write_end
+
+
+def hold(source, pipes):
+    """Splice until `source` ends or the pipes are full; True on end."""
+    poller = select.poll()
+    poller.register(source, select.POLLIN)
+    index = 0
+    while index < len(pipes):
+        poller.poll()
+        try:
+            moved = os.splice(source, pipes[index][1], PIPE_BYTES)
+        except BlockingIOError:
+            # The input has data, so the holding pipe is full.
+            index += 1
+            continue
+        if moved == 0:
+            return True
+    return False
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    count = int(sys.argv[2]) if len(sys.argv) == 3 else 32
+    source = sys.stdin.fileno()
+    pipes = [make_holding_pipe() for _ in range(count)]
+    ended = hold(source, pipes)
+
+    with open(sys.argv[1], "wb") as output:
+        for read_end, write_end in pipes:
+            os.close(write_end)
+            while True:
+                data = os.read(read_end, PIPE_BYTES)
+                if not data:
+                    break
+                output.write(data)
+            os.close(read_end)
+        while not ended:
+            data = os.read(source, PIPE_BYTES)
+            ended = not data
+            output.write(data)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,36 @@
+# Exports [0, RANGE_MID) as FORMAT, grows it with --extend to RANGE_TO and
+# runs CHECK_EXE FILE.FORMAT FILE.binary against a `binary` export of
+# [0, RANGE_TO).  FORMAT_ARGS (a semicolon list) is passed to the first
+# export only.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED CHECK_EXE OR
+   NOT DEFINED FORMAT OR NOT DEFINED OUTPUT_FILE OR
+   NOT DEFINED RANGE_MID OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, CHECK_EXE, FORMAT, OUTPUT_FILE, RANGE_MID and RANGE_TO are required")
+endif()
+
+function(run_calcprime)
+    execute_process(
+        COMMAND "${CALCPRIME_EXE}" ${ARGN}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "calcprimelist ${ARGN} failed: ${error_output}")
+    endif()
+endfunction()
+
+run_calcprime(--to ${RANGE_MID} --print --out "${OUTPUT_FILE}.${FORMAT}"
+              --out-format ${FORMAT} ${FORMAT_ARGS})
+run_calcprime(--extend "${OUTPUT_FILE}.${FORMAT}" --to ${RANGE_TO})
+run_calcprime(--to ${RANGE_TO} --print --out "${OUTPUT_FILE}.binary"
+              --out-format binary)
+
+execute_process(
+    COMMAND "${CHECK_EXE}" "${OUTPUT_FILE}.${FORMAT}" "${OUTPUT_FILE}.binary"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE check_output
+    ERROR_VARIABLE error_output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${FORMAT} extension check failed: ${error_output}")
+endif()
+message(STATUS "${check_output}")
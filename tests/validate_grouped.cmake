@@ -0,0 +1,53 @@
+# Exports [RANGE_FROM, RANGE_TO) as `binary` split by GROUP_ARGS (a
+# semicolon list such as --out-groups;16) and checks that the group files,
+# in index order, concatenate to a single `binary` export of the range.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED GROUP_ARGS OR
+   NOT DEFINED OUTPUT_FILE OR NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, GROUP_ARGS, OUTPUT_FILE, RANGE_FROM and RANGE_TO are required")
+endif()
+
+file(GLOB stale "${OUTPUT_FILE}.g*.bin")
+if(stale)
+    file(REMOVE ${stale})
+endif()
+
+foreach(target grouped single)
+    if(target STREQUAL "grouped")
+        set(out_args --out "${OUTPUT_FILE}.bin" ${GROUP_ARGS})
+    else()
+        set(out_args --out "${OUTPUT_FILE}.single.bin")
+    endif()
+    execute_process(
+        COMMAND "${CALCPRIME_EXE}" --from "${RANGE_FROM}" --to "${RANGE_TO}"
+                --print --out-format binary ${out_args}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${target} export failed: ${error_output}")
+    endif()
+endforeach()
+
+file(STRINGS "${OUTPUT_FILE}.bin.index.tsv" index_lines)
+list(POP_FRONT index_lines)
+set(joined "")
+set(total 0)
+foreach(line ${index_lines})
+    string(REPLACE "\t" ";" fields "${line}")
+    list(GET fields 1 group_file)
+    list(GET fields 4 group_count)
+    file(READ "${group_file}" group_hex HEX)
+    string(APPEND joined "${group_hex}")
+    math(EXPR total "${total}+${group_count}")
+endforeach()
+file(READ "${OUTPUT_FILE}.single.bin" single_hex HEX)
+if(NOT joined STREQUAL single_hex)
+    message(FATAL_ERROR "group files do not concatenate to the single export")
+endif()
+string(LENGTH "${single_hex}" hex_length)
+math(EXPR expected "${hex_length}/16")
+if(NOT total EQUAL expected)
+    message(FATAL_ERROR "index counts ${total} primes, expected ${expected}")
+endif()
+list(LENGTH index_lines groups)
+message(STATUS "${groups} groups, ${total} primes")
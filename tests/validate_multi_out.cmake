@@ -0,0 +1,46 @@
+# Exports [RANGE_FROM, RANGE_TO) once with an --out PATH:FORMAT sink per
+# entry of FORMATS (a semicolon list; "FMT+zstd" adds ":zstd"), then runs
+# CHECK_EXE on every sink against a separate `binary` export.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED CHECK_EXE OR
+   NOT DEFINED FORMATS OR NOT DEFINED OUTPUT_FILE OR
+   NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, CHECK_EXE, FORMATS, OUTPUT_FILE, RANGE_FROM and RANGE_TO are required")
+endif()
+
+set(sink_args "")
+set(sink_files "")
+foreach(entry ${FORMATS})
+    string(REPLACE "+" "-" suffix "${entry}")
+    string(REPLACE "+" ":" spec "${entry}")
+    list(APPEND sink_args --out "${OUTPUT_FILE}.${suffix}:${spec}")
+    list(APPEND sink_files "${OUTPUT_FILE}.${suffix}")
+endforeach()
+
+foreach(args IN ITEMS "sinks" "reference")
+    if(args STREQUAL "sinks")
+        set(out_args ${sink_args})
+    else()
+        set(out_args --out "${OUTPUT_FILE}.binary" --out-format binary)
+    endif()
+    execute_process(
+        COMMAND "${CALCPRIME_EXE}" --from "${RANGE_FROM}" --to "${RANGE_TO}"
+                --print ${out_args}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${args} export failed: ${error_output}")
+    endif()
+endforeach()
+
+foreach(file ${sink_files})
+    execute_process(
+        COMMAND "${CHECK_EXE}" "${file}" "${OUTPUT_FILE}.binary"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE check_output
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${file} check failed: ${error_output}")
+    endif()
+    message(STATUS "${check_output}")
+endforeach()
@@ -13,9 +13,18 @@ if(USE_DELTA)
              "${DELTA_BLOCK_VALUES}")
     endif()
 endif()
+if(DEFINED ROW_GROUP_BYTES)
+    list(APPEND extra_args --parquet-row-group-bytes "${ROW_GROUP_BYTES}")
+endif()
+if(DEFINED PAGE_THREADS)
+    list(APPEND extra_args --parquet-threads "${PAGE_THREADS}")
+endif()
+if(NOT DEFINED RANGE_TO)
+    set(RANGE_TO 100)
+endif()
 
 execute_process(
-    COMMAND "${CALCPRIME_EXE}" --from 1 --to 100 --print
+    COMMAND "${CALCPRIME_EXE}" --from 1 --to "${RANGE_TO}" --print
             --out "${OUTPUT_FILE}" --out-format parquet ${extra_args}
     RESULT_VARIABLE result
     ERROR_VARIABLE error_output)
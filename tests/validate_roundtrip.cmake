@@ -0,0 +1,35 @@
+# Exports [RANGE_FROM, RANGE_TO) as FORMAT and as `binary`, then runs
+# CHECK_EXE FILE.FORMAT FILE.binary to compare them.  FORMAT_ARGS (a
+# semicolon list) is passed to the FORMAT export only.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED CHECK_EXE OR
+   NOT DEFINED FORMAT OR NOT DEFINED OUTPUT_FILE OR
+   NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, CHECK_EXE, FORMAT, OUTPUT_FILE, RANGE_FROM and RANGE_TO are required")
+endif()
+
+foreach(format ${FORMAT} binary)
+    set(extra_args "")
+    if(format STREQUAL FORMAT)
+        set(extra_args ${FORMAT_ARGS})
+    endif()
+    execute_process(
+        COMMAND "${CALCPRIME_EXE}" --from "${RANGE_FROM}" --to "${RANGE_TO}"
+                --print --out "${OUTPUT_FILE}.${format}" --out-format ${format}
+                ${extra_args}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${format} export failed: ${error_output}")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND "${CHECK_EXE}" "${OUTPUT_FILE}.${FORMAT}" "${OUTPUT_FILE}.binary"
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE check_output
+    ERROR_VARIABLE error_output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${FORMAT} round trip failed: ${error_output}")
+endif()
+message(STATUS "${check_output}")
@@ -0,0 +1,33 @@
+# Exports [RANGE_FROM, RANGE_TO) into the shared-memory ring NAME while
+# CHECK_EXE reads it with CONSUMERS readers, and compares what they got
+# with a `binary` file export.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED CHECK_EXE OR
+   NOT DEFINED NAME OR NOT DEFINED CONSUMERS OR NOT DEFINED OUTPUT_FILE OR
+   NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, CHECK_EXE, NAME, CONSUMERS, OUTPUT_FILE, RANGE_FROM and RANGE_TO are required")
+endif()
+
+set(export_args --from "${RANGE_FROM}" --to "${RANGE_TO}" --print
+                --out-format binary)
+execute_process(
+    COMMAND "${CALCPRIME_EXE}" ${export_args} --out "${OUTPUT_FILE}.binary"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE error_output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "binary export failed: ${error_output}")
+endif()
+
+# Both commands run at the same time; the producer blocks while the ring
+# is full and exits once the readers have taken every block.
+execute_process(
+    COMMAND "${CALCPRIME_EXE}" ${export_args} --out "shm:${NAME}" --stats
+    COMMAND "${CHECK_EXE}" "${NAME}" "${OUTPUT_FILE}.binary" "${CONSUMERS}"
+    RESULTS_VARIABLE results
+    OUTPUT_VARIABLE check_output
+    ERROR_VARIABLE error_output
+    TIMEOUT 120)
+if(NOT results STREQUAL "0;0")
+    message(FATAL_ERROR "shared memory export failed (${results}): ${error_output}")
+endif()
+message(STATUS "${check_output}")
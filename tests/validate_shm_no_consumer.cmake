@@ -0,0 +1,21 @@
+# Exports into the shared-memory ring NAME with nobody reading it: the
+# producer must give up after --shm-timeout, fail, and remove the ring.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED NAME)
+    message(FATAL_ERROR "CALCPRIME_EXE and NAME are required")
+endif()
+
+execute_process(
+    COMMAND "${CALCPRIME_EXE}" --from 0 --to 1000000 --print
+            --out-format binary --out "shm:${NAME}" --shm-timeout 300
+    RESULT_VARIABLE result
+    ERROR_VARIABLE error_output
+    TIMEOUT 60)
+if(result EQUAL 0)
+    message(FATAL_ERROR "export without a consumer succeeded")
+endif()
+if(NOT error_output MATCHES "no consumer released a block")
+    message(FATAL_ERROR "unexpected failure (${result}): ${error_output}")
+endif()
+if(EXISTS "/dev/shm/${NAME}")
+    message(FATAL_ERROR "ring /dev/shm/${NAME} was left behind")
+endif()
@@ -0,0 +1,46 @@
+# Exports [RANGE_FROM, RANGE_TO) as FORMAT once with --out and once to
+# standard output through `| cat`, so the pipe path (PipeOutput on Linux) is
+# taken, and checks that both files are identical.  Needs a POSIX shell.
+# PIPE_READER, when set, is a command line (a list) that replaces `cat`;
+# it is given the file to write.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED FORMAT OR
+   NOT DEFINED OUTPUT_FILE OR NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, FORMAT, OUTPUT_FILE, RANGE_FROM and RANGE_TO are required")
+endif()
+
+set(export_args --from "${RANGE_FROM}" --to "${RANGE_TO}" --print
+                --out-format "${FORMAT}")
+execute_process(
+    COMMAND "${CALCPRIME_EXE}" ${export_args} --out "${OUTPUT_FILE}.${FORMAT}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE error_output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "file export failed: ${error_output}")
+endif()
+
+list(JOIN export_args " " export_line)
+if(DEFINED PIPE_READER)
+    list(JOIN PIPE_READER "' '" reader_line)
+    set(reader_line "'${reader_line}' '${OUTPUT_FILE}.pipe.${FORMAT}'")
+else()
+    set(reader_line "cat > '${OUTPUT_FILE}.pipe.${FORMAT}'")
+endif()
+execute_process(
+    COMMAND sh -c
+        "set -e; '${CALCPRIME_EXE}' ${export_line} | ${reader_line}"
+    RESULT_VARIABLE result
+    ERROR_VARIABLE error_output)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "piped export failed: ${error_output}")
+endif()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files
+            "${OUTPUT_FILE}.${FORMAT}" "${OUTPUT_FILE}.pipe.${FORMAT}"
+    RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${FORMAT} output through a pipe differs from --out")
+endif()
+file(SIZE "${OUTPUT_FILE}.${FORMAT}" size)
+message(STATUS "${FORMAT} through a pipe matches --out (${size} bytes)")
@@ -0,0 +1,54 @@
+# Exports [RANGE_FROM, RANGE_TO) as `binary` shards with --out-unordered
+# on THREADS workers with 32 KiB segments, reassembles them in manifest
+# order and compares the result with a single `binary` export.
+if(NOT DEFINED CALCPRIME_EXE OR NOT DEFINED OUTPUT_DIR OR
+   NOT DEFINED THREADS OR NOT DEFINED RANGE_FROM OR NOT DEFINED RANGE_TO)
+    message(FATAL_ERROR
+        "CALCPRIME_EXE, OUTPUT_DIR, THREADS, RANGE_FROM and RANGE_TO are required")
+endif()
+
+file(REMOVE_RECURSE "${OUTPUT_DIR}")
+
+foreach(target unordered single)
+    if(target STREQUAL "unordered")
+        set(out_args --out-unordered "${OUTPUT_DIR}" --threads ${THREADS}
+                     --segment 32768)
+    else()
+        set(out_args --out "${OUTPUT_DIR}.single.bin")
+    endif()
+    execute_process(
+        COMMAND "${CALCPRIME_EXE}" --from "${RANGE_FROM}" --to "${RANGE_TO}"
+                --print --out-format binary ${out_args}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error_output)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${target} export failed: ${error_output}")
+    endif()
+endforeach()
+
+file(STRINGS "${OUTPUT_DIR}/manifest.tsv" manifest_lines)
+list(POP_FRONT manifest_lines)
+set(joined "")
+set(shards "")
+foreach(line ${manifest_lines})
+    string(REPLACE "\t" ";" fields "${line}")
+    list(GET fields 1 shard_file)
+    list(GET fields 6 shard_offset)
+    list(GET fields 7 prime_count)
+    list(APPEND shards "${shard_file}")
+    if(prime_count GREATER 0)
+        math(EXPR byte_offset "${shard_offset}*8")
+        math(EXPR byte_count "${prime_count}*8")
+        file(READ "${shard_file}" chunk_hex OFFSET ${byte_offset}
+             LIMIT ${byte_count} HEX)
+        string(APPEND joined "${chunk_hex}")
+    endif()
+endforeach()
+file(READ "${OUTPUT_DIR}.single.bin" single_hex HEX)
+if(NOT joined STREQUAL single_hex)
+    message(FATAL_ERROR "shards in manifest order differ from the single export")
+endif()
+list(REMOVE_DUPLICATES shards)
+list(LENGTH shards shard_count)
+list(LENGTH manifest_lines chunk_count)
+message(STATUS "${shard_count} shards, ${chunk_count} chunks")
@@ -0,0 +1,91 @@
+// Checks Wheel30Reader::is_prime, count and nth against a `binary` export of
+// the same range.
+//
+//   wheel30_queries FILE.wheel30 FILE.bin
+
+#include "wheel30_reader.h"
+
+#include<algorithm>
+#include<cstdint>
+#include<exception>
+#include<fstream>
+#include<iostream>
+#include<iterator>
+#include<stdexcept>
+#include<string>
+#include<vector>
+
+namespace{
+
+std::vector<std::uint64_t> read_binary(const char*path){
+	std::ifstream in(path,std::ios::binary);
+	if(!in){
+		throw std::runtime_error(std::string("cannot open ")+path);
+	}
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)),
+									 std::istreambuf_iterator<char>());
+	std::vector<std::uint64_t> values(bytes.size()/8U);
+	for(std::size_t i=0;i<values.size();++i){
+		std::uint64_t value=0;
+		for(int b=7;b>=0;--b){
+			value=(value<<8)|bytes[i*8U+static_cast<std::size_t>(b)];
+		}
+		values[i]=value;
+	}
+	return values;
+}
+
+void expect(bool condition,const std::string&what){
+	if(!condition){
+		throw std::runtime_error(what);
+	}
+}
+
+} // namespace
+
+int main(int argc,char**argv){
+	if(argc!=3){
+		std::cerr<<"usage: wheel30_queries FILE.wheel30 FILE.bin\n";
+		return 2;
+	}
+	try{
+		calcprime::Wheel30Reader reader(argv[1]);
+		std::vector<std::uint64_t> primes=read_binary(argv[2]);
+		expect(reader.prime_count()==primes.size(),"prime_count mismatch");
+
+		auto below=[&](std::uint64_t x){
+			return static_cast<std::uint64_t>(
+				std::lower_bound(primes.begin(),primes.end(),x)-primes.begin());
+		};
+		std::size_t next=0;
+		for(std::uint64_t n=reader.from();n<reader.to();++n){
+			bool expected=next<primes.size()&&primes[next]==n;
+			if(expected){
+				++next;
+			}
+			expect(reader.is_prime(n)==expected,
+				   "is_prime mismatch at "+std::to_string(n));
+		}
+		std::uint64_t span=reader.to()-reader.from();
+		for(std::uint64_t step=1;step<=span;step=step*7U+3U){
+			for(std::uint64_t a=reader.from();a<reader.to();a+=step*13U+1U){
+				std::uint64_t b=std::min(a+step,reader.to()+5U);
+				expect(reader.count(a,b)==below(b)-below(a),
+					   "count mismatch for ["+std::to_string(a)+", "+
+						   std::to_string(b)+")");
+			}
+		}
+		expect(reader.count(0,~0ULL)==primes.size(),"full count mismatch");
+		for(std::size_t k=0;k<primes.size();++k){
+			auto value=reader.nth(k+1U);
+			expect(value&&*value==primes[k],"nth mismatch at "+std::to_string(k+1U));
+		}
+		expect(!reader.nth(0)&&!reader.nth(primes.size()+1U),
+			   "nth out of range must be empty");
+		std::cout<<primes.size()<<" primes, is_prime/count/nth match\n";
+	}catch(const std::exception&ex){
+		std::cerr<<"Error: "<<ex.what()<<"\n";
+		return 1;
+	}
+	return 0;
+}